@@ -17,9 +17,11 @@ set(SALAMANDER_SOURCES
   "${SAL_SRC}/common/array.cpp"
   "${SAL_SRC}/common/handles.cpp"
   "${SAL_SRC}/common/heap.cpp"
+  "${SAL_SRC}/common/linregexp.cpp"
   "${SAL_SRC}/common/messages.cpp"
   "${SAL_SRC}/common/moore.cpp"
   "${SAL_SRC}/common/multimon.cpp"
+  "${SAL_SRC}/common/multisearch.cpp"
   "${SAL_SRC}/common/regexp.cpp"
   "${SAL_SRC}/common/sheets.cpp"
   "${SAL_SRC}/common/str.cpp"
@@ -32,6 +34,8 @@ set(SALAMANDER_SOURCES
   "${SAL_SRC}/common/Win32Clipboard.cpp"
   "${SAL_SRC}/common/Win32Registry.cpp"
   "${SAL_SRC}/common/Win32FileEnumerator.cpp"
+  "${SAL_SRC}/common/MemoryFileEnumerator.cpp"
+  "${SAL_SRC}/common/MemoryFileSystem.cpp"
   "${SAL_SRC}/common/Win32Process.cpp"
   "${SAL_SRC}/common/Win32Shell.cpp"
   "${SAL_SRC}/common/Win32Environment.cpp"
@@ -54,6 +58,7 @@ set(SALAMANDER_SOURCES
   "${SAL_SRC}/dialogse.cpp"
   "${SAL_SRC}/dialogsp.cpp"
   "${SAL_SRC}/darkmode.cpp"
+  "${SAL_SRC}/dirreader.cpp"
   "${SAL_SRC}/drivelst.cpp"
   "${SAL_SRC}/editwnd.cpp"
   "${SAL_SRC}/edtlbwnd.cpp"
@@ -79,6 +84,7 @@ set(SALAMANDER_SOURCES
   "${SAL_SRC}/find_dialog_actions.cpp"
   "${SAL_SRC}/geticon.cpp"
   "${SAL_SRC}/gui.cpp"
+  "${SAL_SRC}/hashcache.cpp"
   "${SAL_SRC}/icncache.cpp"
   "${SAL_SRC}/iconlist.cpp"
   "${SAL_SRC}/jumplist.cpp"
@@ -157,6 +163,7 @@ set(SALAMANDER_SOURCES
   "${SAL_SRC}/viewer_thread_buffering.cpp"
   "${SAL_SRC}/viewer_interaction_scrolling.cpp"
   "${SAL_SRC}/worker.cpp"
+  "${SAL_SRC}/worker_journal.cpp"
   "${SAL_SRC}/zip.cpp"
   "${SAL_SRC}/ui/DeletePromptPolicy.cpp"
   "${SAL_SRC}/ui/UIPrompter.cpp"
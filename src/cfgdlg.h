@@ -441,6 +441,7 @@ struct CConfiguration
 
     // Find dialog
     BOOL SearchFileContent;
+    BOOL FindKeepResultsOrder; // file contents are tested on more threads: add found files in the order of searching?
     WINDOWPLACEMENT FindDialogWindowPlacement;
     int FindColNameWidth; // width of the Name column in the Find dialog
 
@@ -44,6 +44,8 @@ BOOL BuildScriptFromSnapshot(
     script->OverwriteOlder = snapshot.OverwriteOlder;
     script->CopySecurity = snapshot.CopySecurity;
     script->CopyAttrs = snapshot.CopyAttrs;
+    script->VerifyCopy = snapshot.VerifyCopy;
+    script->DeltaCopy = snapshot.DeltaCopy;
     script->PreserveDirTime = snapshot.PreserveDirTime;
     script->TargetPathSupADS = config.TargetSupportsADS;
     script->InvertRecycleBin = snapshot.InvertRecycleBin;
@@ -59,6 +61,7 @@ BOOL BuildScriptFromSnapshot(
         script->SetWorkPath1(snapshot.SourcePath.c_str(), TRUE);
     if (!snapshot.TargetPath.empty())
         script->SetWorkPath2(snapshot.TargetPath.c_str(), TRUE);
+    script->SetQueueDevices(snapshot.SourcePath.c_str(), snapshot.TargetPath.c_str());
 
     // ClearReadOnly mask: if ClearReadOnly config is set, remove FILE_ATTRIBUTE_READONLY
     if (config.ClearReadOnly)
@@ -34,6 +34,9 @@ struct CBuildScriptState
     // Tick count for periodic UI interruption checks
     DWORD LastTickCount;
 
+    // Tick count when the build started (for starting a pipelined build, see COperations::BeginPipelinedBuild)
+    DWORD StartTickCount;
+
     CBuildScriptState()
     {
         Reset();
@@ -56,5 +59,6 @@ struct CBuildScriptState
         ErrTooBigFileFAT32SkipAll = FALSE;
         ErrGetFileSizeOfLnkTgtIgnAll = FALSE;
         LastTickCount = GetTickCount();
+        StartTickCount = LastTickCount;
     }
 };
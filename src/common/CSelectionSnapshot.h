@@ -93,6 +93,8 @@ struct CSelectionSnapshot
     bool OverwriteOlder;        // overwrite only older files
     bool CopySecurity;          // preserve NTFS permissions
     bool CopyAttrs;             // preserve Archive/Encrypt/Compress
+    bool VerifyCopy;            // verify copied files by reading them back
+    bool DeltaCopy;             // write only changed blocks of existing target files
     bool PreserveDirTime;       // preserve directory timestamps
     bool IgnoreADS;             // skip alternate data streams
     bool SkipEmptyDirs;         // skip empty directories during copy
@@ -112,6 +114,8 @@ struct CSelectionSnapshot
         , OverwriteOlder(false)
         , CopySecurity(false)
         , CopyAttrs(false)
+        , VerifyCopy(false)
+        , DeltaCopy(false)
         , PreserveDirTime(false)
         , IgnoreADS(false)
         , SkipEmptyDirs(false)
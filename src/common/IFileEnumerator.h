@@ -4,6 +4,7 @@
 
 #include <string>
 #include <cstdint>
+#include <cstring>
 #include <windows.h>
 
 // File entry returned by enumeration
@@ -22,6 +23,147 @@ struct FileEnumEntry
     bool IsReadOnly() const { return (attributes & FILE_ATTRIBUTE_READONLY) != 0; }
 };
 
+// Fixed-size record of one entry returned by IFileEnumerator::NextBatch
+// The name is stored in the name arena of the batch
+struct FileEnumRecord
+{
+    uint64_t size;
+    FILETIME creationTime;
+    FILETIME lastAccessTime;
+    FILETIME lastWriteTime;
+    DWORD attributes;
+    DWORD reparseTag;      // Reparse point tag (with FILE_ATTRIBUTE_REPARSE_POINT), otherwise 0
+    uint32_t nameOffset;   // Offset of the null-terminated name in FileEnumBatch::names (in characters)
+    uint32_t nameLength;   // Name length in characters (without the terminator)
+    wchar_t altName[14];   // Short (8.3) name, empty if the entry has none
+};
+
+// Caller-provided arena filled by IFileEnumerator::NextBatch: fixed-size records and names
+// packed contiguously behind each other; each call overwrites the previous content
+struct FileEnumBatch
+{
+    FileEnumRecord* records;
+    int recordCapacity;
+    wchar_t* names;
+    size_t nameCapacity;   // In characters, must be at least MAX_PATH
+    int count;             // Number of records filled by the last call
+    size_t nameUsed;       // Number of characters of 'names' used by the last call
+
+    const wchar_t* Name(int index) const { return names + records[index].nameOffset; }
+
+    void Clear()
+    {
+        count = 0;
+        nameUsed = 0;
+    }
+
+    // True if one more entry (with name of any length) fits into the arena
+    bool HasSpace() const { return count < recordCapacity && nameCapacity - nameUsed >= MAX_PATH; }
+
+    // Adds entry (used by implementations, the caller checks HasSpace() first)
+    void Add(const WIN32_FIND_DATAW& data)
+    {
+        FileEnumRecord& rec = records[count++];
+        rec.size = ((uint64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+        rec.creationTime = data.ftCreationTime;
+        rec.lastAccessTime = data.ftLastAccessTime;
+        rec.lastWriteTime = data.ftLastWriteTime;
+        rec.attributes = data.dwFileAttributes;
+        rec.reparseTag = (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) ? data.dwReserved0 : 0;
+        size_t len = wcsnlen(data.cFileName, MAX_PATH - 1);
+        rec.nameOffset = (uint32_t)nameUsed;
+        rec.nameLength = (uint32_t)len;
+        memcpy(names + nameUsed, data.cFileName, len * sizeof(wchar_t));
+        names[nameUsed + len] = 0;
+        nameUsed += len + 1;
+        memcpy(rec.altName, data.cAlternateFileName, sizeof(rec.altName));
+        rec.altName[13] = 0;
+    }
+
+    void Add(const FileEnumEntry& entry)
+    {
+        FileEnumRecord& rec = records[count++];
+        rec.size = entry.size;
+        rec.creationTime = entry.creationTime;
+        rec.lastAccessTime = entry.lastAccessTime;
+        rec.lastWriteTime = entry.lastWriteTime;
+        rec.attributes = entry.attributes;
+        rec.reparseTag = 0;
+        size_t len = entry.name.size() < MAX_PATH - 1 ? entry.name.size() : MAX_PATH - 1;
+        rec.nameOffset = (uint32_t)nameUsed;
+        rec.nameLength = (uint32_t)len;
+        memcpy(names + nameUsed, entry.name.c_str(), len * sizeof(wchar_t));
+        names[nameUsed + len] = 0;
+        nameUsed += len + 1;
+        rec.altName[0] = 0;
+    }
+
+    // Adds entry returned by GetFileInformationByHandleEx(FileIdBothDirectoryInfo)
+    void Add(const FILE_ID_BOTH_DIR_INFO& info)
+    {
+        FileEnumRecord& rec = records[count++];
+        rec.size = (uint64_t)info.EndOfFile.QuadPart;
+        rec.creationTime.dwLowDateTime = info.CreationTime.LowPart;
+        rec.creationTime.dwHighDateTime = (DWORD)info.CreationTime.HighPart;
+        rec.lastAccessTime.dwLowDateTime = info.LastAccessTime.LowPart;
+        rec.lastAccessTime.dwHighDateTime = (DWORD)info.LastAccessTime.HighPart;
+        rec.lastWriteTime.dwLowDateTime = info.LastWriteTime.LowPart;
+        rec.lastWriteTime.dwHighDateTime = (DWORD)info.LastWriteTime.HighPart;
+        rec.attributes = info.FileAttributes;
+        rec.reparseTag = (info.FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) ? info.EaSize : 0; // EaSize holds the tag of reparse points
+        size_t len = info.FileNameLength / sizeof(wchar_t);
+        if (len > MAX_PATH - 1)
+            len = MAX_PATH - 1;
+        rec.nameOffset = (uint32_t)nameUsed;
+        rec.nameLength = (uint32_t)len;
+        memcpy(names + nameUsed, info.FileName, len * sizeof(wchar_t));
+        names[nameUsed + len] = 0;
+        nameUsed += len + 1;
+        size_t altLen = info.ShortNameLength / sizeof(wchar_t);
+        if (altLen > 13)
+            altLen = 13;
+        memcpy(rec.altName, info.ShortName, altLen * sizeof(wchar_t));
+        rec.altName[altLen] = 0;
+    }
+
+    // Fills FindFirstFile data of the entry (for code working with WIN32_FIND_DATAW)
+    void GetFindData(int index, WIN32_FIND_DATAW* data) const
+    {
+        const FileEnumRecord& rec = records[index];
+        data->dwFileAttributes = rec.attributes;
+        data->ftCreationTime = rec.creationTime;
+        data->ftLastAccessTime = rec.lastAccessTime;
+        data->ftLastWriteTime = rec.lastWriteTime;
+        data->nFileSizeHigh = (DWORD)(rec.size >> 32);
+        data->nFileSizeLow = (DWORD)rec.size;
+        data->dwReserved0 = rec.reparseTag;
+        data->dwReserved1 = 0;
+        memcpy(data->cFileName, names + rec.nameOffset, (rec.nameLength + 1) * sizeof(wchar_t));
+        memcpy(data->cAlternateFileName, rec.altName, sizeof(rec.altName));
+    }
+};
+
+// Buffer for large directory queries (GetFileInformationByHandleEx with FileIdBothDirectoryInfo),
+// one query returns as many entries as fit into it; entries which do not fit into the batch being
+// filled stay in the buffer for the next batch
+struct FileEnumDirQuery
+{
+    BYTE* buffer;
+    DWORD size;     // In bytes, FILE_ID_BOTH_DIR_INFO is aligned to 8 bytes
+    DWORD offset;   // Offset of the next entry in 'buffer'
+    bool pending;   // True if 'buffer' contains entries not added to a batch yet
+
+    void Init(void* mem, DWORD memSize)
+    {
+        buffer = (BYTE*)mem;
+        size = memSize;
+        offset = 0;
+        pending = false;
+    }
+};
+
+#define FILEENUM_QUERY_SIZE (64 * 1024) // Recommended size of FileEnumDirQuery::buffer (the same as FIND_FIRST_EX_LARGE_FETCH uses)
+
 // Result of enumeration operations
 struct EnumResult
 {
@@ -55,6 +197,13 @@ public:
     // Returns EnumResult::Done() when no more files, EnumResult::Error() on failure
     virtual EnumResult NextFile(HENUM handle, FileEnumEntry& entry) = 0;
 
+    // Get next entries, as many as fit into the arena of 'batch'
+    // Returns EnumResult::Ok() with batch.count > 0, EnumResult::Done() (batch.count is 0) when
+    // no more files, EnumResult::Error() on failure (entries read before the failure were returned
+    // by the previous call)
+    // The default implementation collects entries from NextFile()
+    virtual EnumResult NextBatch(HENUM handle, FileEnumBatch& batch);
+
     // Close enumeration handle
     virtual void EndEnum(HENUM handle) = 0;
 
@@ -72,12 +221,36 @@ public:
     }
 };
 
+inline EnumResult IFileEnumerator::NextBatch(HENUM handle, FileEnumBatch& batch)
+{
+    batch.Clear();
+    FileEnumEntry entry;
+    while (batch.HasSpace())
+    {
+        EnumResult res = NextFile(handle, entry);
+        if (!res.success || res.noMoreFiles)
+        {
+            if (batch.count > 0)
+                break; // the end or the failure is returned by the next call
+            return res;
+        }
+        batch.Add(entry);
+    }
+    return EnumResult::Ok();
+}
+
 // Global file enumerator instance - default is Win32 implementation
 extern IFileEnumerator* gFileEnumerator;
 
 // Returns the default Win32 implementation
 IFileEnumerator* GetWin32FileEnumerator();
 
+// Fills 'batch' with the next entries of directory 'dir' (opened with FILE_LIST_DIRECTORY and
+// FILE_FLAG_BACKUP_SEMANTICS), reading them by large directory queries through 'query'
+// Returns the same as IFileEnumerator::NextBatch; if the file system does not support the query,
+// the first call returns EnumResult::Error() (use FindFirstFile then)
+EnumResult QueryDirectoryBatch(HANDLE dir, FileEnumDirQuery& query, FileEnumBatch& batch);
+
 // ANSI helper: Convert ANSI path and start enumeration
 inline std::wstring AnsiEnumPathToWide(const char* path)
 {
@@ -0,0 +1,366 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+#include "MemoryFileEnumerator.h"
+
+namespace
+{
+// Returns 'path' without the \\?\ prefix and the trailing backslashes
+std::wstring NormalizePath(const wchar_t* path)
+{
+    std::wstring result;
+    if (wcsncmp(path, L"\\\\?\\UNC\\", 8) == 0)
+        result = std::wstring(L"\\\\") + (path + 8);
+    else if (wcsncmp(path, L"\\\\?\\", 4) == 0)
+        result = path + 4;
+    else
+        result = path;
+    while (!result.empty() && result.back() == L'\\')
+        result.pop_back();
+    return result;
+}
+
+std::wstring LowerCase(const std::wstring& str)
+{
+    std::wstring result(str);
+    if (!result.empty())
+        CharLowerBuffW(&result[0], (DWORD)result.length());
+    return result;
+}
+
+// True for "c:" and "\\server\share" (roots have no parent directory and no "." and "..")
+bool IsRootPath(const std::wstring& path)
+{
+    if (path.compare(0, 2, L"\\\\") == 0)
+    {
+        size_t server = path.find(L'\\', 2);
+        return server == std::wstring::npos || path.find(L'\\', server + 1) == std::wstring::npos;
+    }
+    return path.find(L'\\') == std::wstring::npos;
+}
+
+// Matches lower case 'name' against lower case 'pattern' with '*' and '?' wildcards
+bool MatchPattern(const wchar_t* pattern, const wchar_t* name)
+{
+    while (*pattern != 0)
+    {
+        if (*pattern == L'*')
+        {
+            while (*pattern == L'*')
+                pattern++;
+            if (*pattern == 0)
+                return true;
+            for (; *name != 0; name++)
+            {
+                if (MatchPattern(pattern, name))
+                    return true;
+            }
+            return false;
+        }
+        if (*name == 0 || *pattern != L'?' && *pattern != *name)
+            return false;
+        pattern++;
+        name++;
+    }
+    return *name == 0;
+}
+
+FileEnumEntry MakeEntry(const std::wstring& name, uint64_t size, DWORD attributes)
+{
+    FileEnumEntry entry;
+    entry.name = name;
+    entry.size = size;
+    GetSystemTimeAsFileTime(&entry.lastWriteTime);
+    entry.creationTime = entry.lastWriteTime;
+    entry.lastAccessTime = entry.lastWriteTime;
+    entry.attributes = attributes;
+    return entry;
+}
+
+// Enumeration started by MemoryFileEnumerator::StartEnum
+struct MemoryEnumState
+{
+    std::vector<FileEnumEntry> entries; // copy of the listing (the tree may change meanwhile)
+    size_t next;                        // index of the next returned entry
+};
+} // namespace
+
+//
+// MemoryFileTree
+//
+
+MemoryFileTree::MemoryFileTree()
+{
+    InitializeCriticalSection(&CS);
+    Count = 0;
+}
+
+MemoryFileTree::~MemoryFileTree()
+{
+    DeleteCriticalSection(&CS);
+}
+
+DWORD MemoryFileTree::AddAux(const std::wstring& path, const FileEnumEntry& entry)
+{
+    std::wstring key = LowerCase(path);
+    if (IsRootPath(path))
+    {
+        if ((entry.attributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+            return ERROR_INVALID_NAME;
+        return Dirs.insert(std::make_pair(key, EntryMap())).second ? ERROR_SUCCESS : ERROR_ALREADY_EXISTS;
+    }
+
+    size_t slash = path.rfind(L'\\');
+    std::map<std::wstring, EntryMap>::iterator dir = Dirs.find(key.substr(0, slash));
+    if (dir == Dirs.end()) // add the missing parent directory
+    {
+        DWORD err = AddAux(path.substr(0, slash), MakeEntry(std::wstring(), 0, FILE_ATTRIBUTE_DIRECTORY));
+        if (err != ERROR_SUCCESS)
+            return err == ERROR_ALREADY_EXISTS ? ERROR_PATH_NOT_FOUND : err; // the parent is a file
+        dir = Dirs.find(key.substr(0, slash));
+    }
+
+    std::pair<EntryMap::iterator, bool> res = dir->second.insert(std::make_pair(key.substr(slash + 1), entry));
+    if (!res.second)
+        return ERROR_ALREADY_EXISTS;
+    res.first->second.name = path.substr(slash + 1);
+    if (entry.attributes & FILE_ATTRIBUTE_DIRECTORY)
+        Dirs.insert(std::make_pair(key, EntryMap()));
+    Count++;
+    return ERROR_SUCCESS;
+}
+
+DWORD MemoryFileTree::AddFile(const wchar_t* path, uint64_t size, DWORD attributes)
+{
+    std::wstring normPath = NormalizePath(path);
+    EnterCriticalSection(&CS);
+    DWORD err = AddAux(normPath, MakeEntry(std::wstring(), size, attributes & ~FILE_ATTRIBUTE_DIRECTORY));
+    LeaveCriticalSection(&CS);
+    return err;
+}
+
+DWORD MemoryFileTree::AddDirectory(const wchar_t* path, DWORD attributes)
+{
+    std::wstring normPath = NormalizePath(path);
+    EnterCriticalSection(&CS);
+    DWORD err = AddAux(normPath, MakeEntry(std::wstring(), 0, attributes | FILE_ATTRIBUTE_DIRECTORY));
+    LeaveCriticalSection(&CS);
+    return err;
+}
+
+DWORD MemoryFileTree::Remove(const wchar_t* path, bool directory)
+{
+    std::wstring key = LowerCase(NormalizePath(path));
+    if (IsRootPath(key))
+        return ERROR_ACCESS_DENIED;
+    size_t slash = key.rfind(L'\\');
+
+    DWORD err = ERROR_SUCCESS;
+    EnterCriticalSection(&CS);
+    std::map<std::wstring, EntryMap>::iterator dir = Dirs.find(key.substr(0, slash));
+    EntryMap::iterator item;
+    if (dir == Dirs.end())
+        err = ERROR_PATH_NOT_FOUND;
+    else if ((item = dir->second.find(key.substr(slash + 1))) == dir->second.end())
+        err = ERROR_FILE_NOT_FOUND;
+    else
+    {
+        bool isDir = (item->second.attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+        if (isDir != directory)
+            err = directory ? ERROR_DIRECTORY : ERROR_ACCESS_DENIED; // the same as RemoveDirectory and DeleteFile
+        else if (item->second.attributes & FILE_ATTRIBUTE_READONLY)
+            err = ERROR_ACCESS_DENIED;
+        else if (isDir)
+        {
+            std::map<std::wstring, EntryMap>::iterator sub = Dirs.find(key);
+            if (sub != Dirs.end() && !sub->second.empty())
+                err = ERROR_DIR_NOT_EMPTY;
+            else if (sub != Dirs.end())
+                Dirs.erase(sub);
+        }
+        if (err == ERROR_SUCCESS)
+        {
+            dir->second.erase(item);
+            Count--;
+        }
+    }
+    LeaveCriticalSection(&CS);
+    return err;
+}
+
+bool MemoryFileTree::GetEntry(const wchar_t* path, FileEnumEntry& entry)
+{
+    std::wstring normPath = NormalizePath(path);
+    std::wstring key = LowerCase(normPath);
+    bool found = false;
+    EnterCriticalSection(&CS);
+    if (IsRootPath(key))
+    {
+        if (Dirs.find(key) != Dirs.end())
+        {
+            entry = MakeEntry(normPath, 0, FILE_ATTRIBUTE_DIRECTORY);
+            found = true;
+        }
+    }
+    else
+    {
+        size_t slash = key.rfind(L'\\');
+        std::map<std::wstring, EntryMap>::iterator dir = Dirs.find(key.substr(0, slash));
+        if (dir != Dirs.end())
+        {
+            EntryMap::iterator item = dir->second.find(key.substr(slash + 1));
+            if (item != dir->second.end())
+            {
+                entry = item->second;
+                found = true;
+            }
+        }
+    }
+    LeaveCriticalSection(&CS);
+    return found;
+}
+
+DWORD MemoryFileTree::SetAttributes(const wchar_t* path, DWORD attributes)
+{
+    std::wstring key = LowerCase(NormalizePath(path));
+    if (IsRootPath(key))
+        return ERROR_ACCESS_DENIED;
+    size_t slash = key.rfind(L'\\');
+
+    DWORD err = ERROR_FILE_NOT_FOUND;
+    EnterCriticalSection(&CS);
+    std::map<std::wstring, EntryMap>::iterator dir = Dirs.find(key.substr(0, slash));
+    if (dir != Dirs.end())
+    {
+        EntryMap::iterator item = dir->second.find(key.substr(slash + 1));
+        if (item != dir->second.end())
+        {
+            DWORD& attr = item->second.attributes;
+            attr = (attributes & ~FILE_ATTRIBUTE_DIRECTORY) | (attr & FILE_ATTRIBUTE_DIRECTORY);
+            err = ERROR_SUCCESS;
+        }
+    }
+    else
+        err = ERROR_PATH_NOT_FOUND;
+    LeaveCriticalSection(&CS);
+    return err;
+}
+
+DWORD MemoryFileTree::List(const wchar_t* path, const wchar_t* pattern, std::vector<FileEnumEntry>& entries)
+{
+    std::wstring key = LowerCase(NormalizePath(path));
+    std::wstring mask = pattern != NULL && *pattern != 0 ? LowerCase(pattern) : std::wstring(L"*");
+    if (mask == L"*.*")
+        mask = L"*"; // also names without extension, like FindFirstFile
+
+    entries.clear();
+    DWORD err = ERROR_SUCCESS;
+    EnterCriticalSection(&CS);
+    std::map<std::wstring, EntryMap>::iterator dir = Dirs.find(key);
+    if (dir != Dirs.end())
+    {
+        if (!IsRootPath(key))
+        {
+            if (MatchPattern(mask.c_str(), L"."))
+                entries.push_back(MakeEntry(L".", 0, FILE_ATTRIBUTE_DIRECTORY));
+            if (MatchPattern(mask.c_str(), L".."))
+                entries.push_back(MakeEntry(L"..", 0, FILE_ATTRIBUTE_DIRECTORY));
+        }
+        entries.reserve(entries.size() + dir->second.size());
+        EntryMap::iterator item;
+        for (item = dir->second.begin(); item != dir->second.end(); ++item)
+        {
+            if (MatchPattern(mask.c_str(), item->first.c_str()))
+                entries.push_back(item->second);
+        }
+        if (entries.empty())
+            err = ERROR_FILE_NOT_FOUND;
+    }
+    else
+        err = ERROR_PATH_NOT_FOUND;
+    LeaveCriticalSection(&CS);
+    return err;
+}
+
+void MemoryFileTree::Clear()
+{
+    EnterCriticalSection(&CS);
+    Dirs.clear();
+    Count = 0;
+    LeaveCriticalSection(&CS);
+}
+
+size_t MemoryFileTree::GetCount()
+{
+    EnterCriticalSection(&CS);
+    size_t count = Count;
+    LeaveCriticalSection(&CS);
+    return count;
+}
+
+//
+// MemoryFileEnumerator
+//
+
+HENUM MemoryFileEnumerator::StartEnum(const wchar_t* path, const wchar_t* pattern)
+{
+    if (path == NULL)
+    {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return INVALID_HENUM;
+    }
+
+    // the mask can also be the last component of 'path' (e.g. "C:\\dir\\*")
+    std::wstring dir(path);
+    std::wstring mask(pattern != NULL ? pattern : L"");
+    if (mask.empty() && HasPattern(path))
+    {
+        size_t slash = dir.rfind(L'\\');
+        mask = dir.substr(slash == std::wstring::npos ? 0 : slash + 1);
+        dir.erase(slash == std::wstring::npos ? 0 : slash);
+    }
+
+    MemoryEnumState* state = new MemoryEnumState;
+    state->next = 0;
+    DWORD err = Tree->List(dir.c_str(), mask.c_str(), state->entries);
+    if (err != ERROR_SUCCESS)
+    {
+        delete state;
+        SetLastError(err);
+        return INVALID_HENUM;
+    }
+    return static_cast<HENUM>(state);
+}
+
+EnumResult MemoryFileEnumerator::NextFile(HENUM handle, FileEnumEntry& entry)
+{
+    if (!handle)
+        return EnumResult::Error(ERROR_INVALID_HANDLE);
+
+    MemoryEnumState* state = static_cast<MemoryEnumState*>(handle);
+    if (state->next >= state->entries.size())
+        return EnumResult::Done();
+    entry = state->entries[state->next++];
+    return EnumResult::Ok();
+}
+
+EnumResult MemoryFileEnumerator::NextBatch(HENUM handle, FileEnumBatch& batch)
+{
+    batch.Clear();
+    if (!handle)
+        return EnumResult::Error(ERROR_INVALID_HANDLE);
+
+    MemoryEnumState* state = static_cast<MemoryEnumState*>(handle);
+    if (state->next >= state->entries.size())
+        return EnumResult::Done();
+    while (batch.HasSpace() && state->next < state->entries.size())
+        batch.Add(state->entries[state->next++]);
+    return EnumResult::Ok();
+}
+
+void MemoryFileEnumerator::EndEnum(HENUM handle)
+{
+    if (handle)
+        delete static_cast<MemoryEnumState*>(handle);
+}
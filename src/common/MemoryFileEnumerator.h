@@ -0,0 +1,74 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include "IFileEnumerator.h"
+#include <map>
+#include <vector>
+
+// In-memory directory tree for tests and benchmarks (no disk access, so the measured time is the
+// overhead of the code using the tree); paths are full paths (e.g. L"C:\\dir\\file.txt", the
+// \\?\ prefix is accepted), names are compared case-insensitively; thread-safe
+class MemoryFileTree
+{
+public:
+    MemoryFileTree();
+    ~MemoryFileTree();
+
+    // Adds file 'path'; missing parent directories are added too
+    // Returns ERROR_SUCCESS or ERROR_ALREADY_EXISTS
+    DWORD AddFile(const wchar_t* path, uint64_t size, DWORD attributes = FILE_ATTRIBUTE_ARCHIVE);
+
+    // Adds directory 'path'; missing parent directories are added too
+    // Returns ERROR_SUCCESS or ERROR_ALREADY_EXISTS
+    DWORD AddDirectory(const wchar_t* path, DWORD attributes = FILE_ATTRIBUTE_DIRECTORY);
+
+    // Removes file ('directory' is false) or empty directory 'path'
+    // Returns ERROR_SUCCESS or the error of DeleteFile/RemoveDirectory (ERROR_FILE_NOT_FOUND,
+    // ERROR_PATH_NOT_FOUND, ERROR_DIR_NOT_EMPTY, ERROR_ACCESS_DENIED for read-only entries, ...)
+    DWORD Remove(const wchar_t* path, bool directory);
+
+    // Returns data of 'path' in 'entry' (entry.name is the name only); false if it does not exist
+    bool GetEntry(const wchar_t* path, FileEnumEntry& entry);
+
+    // Changes attributes of 'path' (FILE_ATTRIBUTE_DIRECTORY of the entry is kept)
+    // Returns ERROR_SUCCESS or ERROR_FILE_NOT_FOUND
+    DWORD SetAttributes(const wchar_t* path, DWORD attributes);
+
+    // Returns entries of directory 'path' matching 'pattern' ('*' and '?' wildcards, NULL = all)
+    // in 'entries'; like FindFirstFile, directories other than roots contain "." and ".."
+    // Returns ERROR_SUCCESS, ERROR_PATH_NOT_FOUND or ERROR_FILE_NOT_FOUND (nothing matches)
+    DWORD List(const wchar_t* path, const wchar_t* pattern, std::vector<FileEnumEntry>& entries);
+
+    // Removes all entries
+    void Clear();
+
+    // Returns the number of files and directories in the tree
+    size_t GetCount();
+
+protected:
+    typedef std::map<std::wstring, FileEnumEntry> EntryMap; // key: name in lower case
+
+    CRITICAL_SECTION CS;                  // access to Dirs
+    std::map<std::wstring, EntryMap> Dirs; // key: path of the directory in lower case without the trailing backslash
+    size_t Count;                         // number of files and directories
+
+    // adds 'entry' with path 'key' (in lower case) into the tree, missing parent directories are
+    // added too; must be called in CS
+    DWORD AddAux(const std::wstring& key, const FileEnumEntry& entry);
+};
+
+// IFileEnumerator listing a MemoryFileTree (see gFileEnumerator)
+class MemoryFileEnumerator : public IFileEnumerator
+{
+public:
+    MemoryFileEnumerator(MemoryFileTree* tree) { Tree = tree; }
+
+    HENUM StartEnum(const wchar_t* path, const wchar_t* pattern = nullptr) override;
+    EnumResult NextFile(HENUM handle, FileEnumEntry& entry) override;
+    EnumResult NextBatch(HENUM handle, FileEnumBatch& batch) override;
+    void EndEnum(HENUM handle) override;
+
+protected:
+    MemoryFileTree* Tree;
+};
@@ -0,0 +1,143 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+#include "MemoryFileSystem.h"
+
+namespace
+{
+FileResult MakeResult(DWORD err)
+{
+    return err == ERROR_SUCCESS ? FileResult::Ok() : FileResult::Error(err);
+}
+} // namespace
+
+bool MemoryFileSystem::FileExists(const wchar_t* path)
+{
+    FileEnumEntry entry;
+    return Tree->GetEntry(path, entry) && (entry.attributes & FILE_ATTRIBUTE_DIRECTORY) == 0;
+}
+
+bool MemoryFileSystem::DirectoryExists(const wchar_t* path)
+{
+    FileEnumEntry entry;
+    return Tree->GetEntry(path, entry) && (entry.attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+}
+
+FileResult MemoryFileSystem::GetFileInfo(const wchar_t* path, FileInfo& info)
+{
+    FileEnumEntry entry;
+    if (!Tree->GetEntry(path, entry))
+        return FileResult::Error(ERROR_FILE_NOT_FOUND);
+    info.name = path; // the same as Win32FileSystem: the original path
+    info.size = entry.size;
+    info.creationTime = entry.creationTime;
+    info.lastWriteTime = entry.lastWriteTime;
+    info.attributes = entry.attributes;
+    info.isDirectory = (entry.attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+    return FileResult::Ok();
+}
+
+DWORD MemoryFileSystem::GetFileAttributes(const wchar_t* path)
+{
+    FileEnumEntry entry;
+    if (!Tree->GetEntry(path, entry))
+    {
+        SetLastError(ERROR_FILE_NOT_FOUND);
+        return INVALID_FILE_ATTRIBUTES;
+    }
+    return entry.attributes;
+}
+
+FileResult MemoryFileSystem::SetFileAttributes(const wchar_t* path, DWORD attributes)
+{
+    return MakeResult(Tree->SetAttributes(path, attributes));
+}
+
+FileResult MemoryFileSystem::DeleteFile(const wchar_t* path)
+{
+    return MakeResult(Tree->Remove(path, false));
+}
+
+FileResult MemoryFileSystem::MoveFile(const wchar_t* source, const wchar_t* target)
+{
+    FileEnumEntry entry;
+    if (!Tree->GetEntry(source, entry))
+        return FileResult::Error(ERROR_FILE_NOT_FOUND);
+    if (entry.attributes & FILE_ATTRIBUTE_DIRECTORY)
+        return FileResult::Error(ERROR_NOT_SUPPORTED);
+    DWORD err = Tree->AddFile(target, entry.size, entry.attributes);
+    if (err == ERROR_SUCCESS)
+    {
+        // the source can be read-only, MoveFile moves it anyway
+        Tree->SetAttributes(source, entry.attributes & ~FILE_ATTRIBUTE_READONLY);
+        err = Tree->Remove(source, false);
+        if (err != ERROR_SUCCESS)
+        {
+            Tree->SetAttributes(source, entry.attributes);
+            Tree->Remove(target, false);
+        }
+    }
+    return MakeResult(err);
+}
+
+FileResult MemoryFileSystem::CopyFile(const wchar_t* source, const wchar_t* target, bool failIfExists)
+{
+    FileEnumEntry entry;
+    if (!Tree->GetEntry(source, entry))
+        return FileResult::Error(ERROR_FILE_NOT_FOUND);
+    if (entry.attributes & FILE_ATTRIBUTE_DIRECTORY)
+        return FileResult::Error(ERROR_NOT_SUPPORTED);
+    FileEnumEntry targetEntry;
+    if (Tree->GetEntry(target, targetEntry))
+    {
+        if (failIfExists)
+            return FileResult::Error(ERROR_FILE_EXISTS);
+        DWORD err = Tree->Remove(target, false); // fails for directories and read-only files like CopyFile
+        if (err != ERROR_SUCCESS)
+            return FileResult::Error(err);
+    }
+    return MakeResult(Tree->AddFile(target, entry.size, entry.attributes));
+}
+
+FileResult MemoryFileSystem::CreateDirectory(const wchar_t* path)
+{
+    return MakeResult(Tree->AddDirectory(path));
+}
+
+FileResult MemoryFileSystem::RemoveDirectory(const wchar_t* path)
+{
+    return MakeResult(Tree->Remove(path, true));
+}
+
+HANDLE MemoryFileSystem::CreateFile(const wchar_t* path, DWORD desiredAccess, DWORD shareMode,
+                                    LPSECURITY_ATTRIBUTES securityAttributes, DWORD creationDisposition,
+                                    DWORD flagsAndAttributes, HANDLE templateFile)
+{
+    SetLastError(ERROR_NOT_SUPPORTED);
+    return INVALID_HANDLE_VALUE;
+}
+
+HANDLE MemoryFileSystem::FindFirstFile(const wchar_t* path, WIN32_FIND_DATAW* findData)
+{
+    SetLastError(ERROR_NOT_SUPPORTED);
+    return INVALID_HANDLE_VALUE;
+}
+
+BOOL MemoryFileSystem::FindNextFile(HANDLE findHandle, WIN32_FIND_DATAW* findData)
+{
+    SetLastError(ERROR_INVALID_HANDLE);
+    return FALSE;
+}
+
+HANDLE MemoryFileSystem::OpenFileForRead(const wchar_t* path, DWORD shareMode)
+{
+    SetLastError(ERROR_NOT_SUPPORTED);
+    return INVALID_HANDLE_VALUE;
+}
+
+HANDLE MemoryFileSystem::CreateFileForWrite(const wchar_t* path, bool failIfExists)
+{
+    SetLastError(ERROR_NOT_SUPPORTED);
+    return INVALID_HANDLE_VALUE;
+}
@@ -0,0 +1,46 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include "IFileSystem.h"
+#include "MemoryFileEnumerator.h"
+
+// IFileSystem over a MemoryFileTree for tests and benchmarks (see gFileSystem); only metadata
+// operations are supported: files have no contents and the callers close the returned handles by
+// Win32 functions (e.g. HANDLES(FindClose(find)) in the worker), so CreateFile, FindFirstFile,
+// OpenFileForRead and CreateFileForWrite always fail with ERROR_NOT_SUPPORTED
+class MemoryFileSystem : public IFileSystem
+{
+public:
+    MemoryFileSystem(MemoryFileTree* tree) { Tree = tree; }
+
+    bool FileExists(const wchar_t* path) override;
+    bool DirectoryExists(const wchar_t* path) override;
+    FileResult GetFileInfo(const wchar_t* path, FileInfo& info) override;
+
+    DWORD GetFileAttributes(const wchar_t* path) override;
+    FileResult SetFileAttributes(const wchar_t* path, DWORD attributes) override;
+
+    // MoveFile and CopyFile support only files (directories fail with ERROR_NOT_SUPPORTED)
+    FileResult DeleteFile(const wchar_t* path) override;
+    FileResult MoveFile(const wchar_t* source, const wchar_t* target) override;
+    FileResult CopyFile(const wchar_t* source, const wchar_t* target, bool failIfExists) override;
+
+    // missing parent directories are created too (see MemoryFileTree::AddDirectory)
+    FileResult CreateDirectory(const wchar_t* path) override;
+    FileResult RemoveDirectory(const wchar_t* path) override;
+
+    HANDLE CreateFile(const wchar_t* path, DWORD desiredAccess, DWORD shareMode,
+                      LPSECURITY_ATTRIBUTES securityAttributes, DWORD creationDisposition,
+                      DWORD flagsAndAttributes, HANDLE templateFile) override;
+
+    HANDLE FindFirstFile(const wchar_t* path, WIN32_FIND_DATAW* findData) override;
+    BOOL FindNextFile(HANDLE findHandle, WIN32_FIND_DATAW* findData) override;
+
+    HANDLE OpenFileForRead(const wchar_t* path, DWORD shareMode = FILE_SHARE_READ) override;
+    HANDLE CreateFileForWrite(const wchar_t* path, bool failIfExists) override;
+    void CloseHandle(HANDLE h) override {}
+
+protected:
+    MemoryFileTree* Tree;
+};
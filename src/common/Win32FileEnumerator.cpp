@@ -10,11 +10,59 @@
 // Internal enumeration state
 struct EnumState
 {
-    HANDLE hFind;
+    HANDLE hFind;              // FindFirstFileExW search (INVALID_HANDLE_VALUE if hDir is used)
+    HANDLE hDir;               // Directory read by large directory queries (INVALID_HANDLE_VALUE if hFind is used)
+    FileEnumDirQuery query;    // Buffer of the queries on hDir
     WIN32_FIND_DATAW findData;
     bool firstRead;  // First entry already read from FindFirstFileW
+    DWORD lastError; // Error which ended the enumeration (ERROR_NO_MORE_FILES at the end), otherwise ERROR_SUCCESS
 };
 
+// Returns the next entry read through 'query' (the next query on 'dir' is made when all entries
+// of the previous one were returned), SkipDirEntry() moves behind it
+// Returns NULL at the end of the directory or on error (call GetLastError(), ERROR_NO_MORE_FILES at the end)
+static const FILE_ID_BOTH_DIR_INFO* PeekDirEntry(HANDLE dir, FileEnumDirQuery& query)
+{
+    if (!query.pending)
+    {
+        if (!GetFileInformationByHandleEx(dir, FileIdBothDirectoryInfo, query.buffer, query.size))
+            return NULL;
+        query.offset = 0;
+        query.pending = true;
+    }
+    return (const FILE_ID_BOTH_DIR_INFO*)(query.buffer + query.offset);
+}
+
+static void SkipDirEntry(FileEnumDirQuery& query)
+{
+    const FILE_ID_BOTH_DIR_INFO* info = (const FILE_ID_BOTH_DIR_INFO*)(query.buffer + query.offset);
+    if (info->NextEntryOffset == 0)
+        query.pending = false; // The last entry returned by the query
+    else
+        query.offset += info->NextEntryOffset;
+}
+
+EnumResult QueryDirectoryBatch(HANDLE dir, FileEnumDirQuery& query, FileEnumBatch& batch)
+{
+    batch.Clear();
+    while (batch.HasSpace())
+    {
+        const FILE_ID_BOTH_DIR_INFO* info = PeekDirEntry(dir, query);
+        if (info == NULL)
+        {
+            DWORD err = GetLastError();
+            if (batch.count > 0)
+                break; // The end or the failure is returned by the next call
+            if (err == ERROR_NO_MORE_FILES || err == ERROR_SUCCESS)
+                return EnumResult::Done();
+            return EnumResult::Error(err);
+        }
+        batch.Add(*info);
+        SkipDirEntry(query);
+    }
+    return EnumResult::Ok();
+}
+
 class Win32FileEnumerator : public IFileEnumerator
 {
 public:
@@ -67,21 +115,92 @@ public:
             return INVALID_HENUM;
         }
         memset(state, 0, sizeof(EnumState));
+        state->hFind = INVALID_HANDLE_VALUE;
+        state->hDir = INVALID_HANDLE_VALUE;
 
-        state->hFind = FindFirstFileW(longPath.c_str(), &state->findData);
+        // All entries of the directory: read by large directory queries, many entries per call
+        size_t len = longPath.length();
+        if (len >= 2 && longPath[len - 1] == L'*' && longPath[len - 2] == L'\\')
+        {
+            void* buffer = malloc(FILEENUM_QUERY_SIZE);
+            if (buffer != NULL)
+            {
+                state->query.Init(buffer, FILEENUM_QUERY_SIZE);
+                std::wstring dirPath = longPath.substr(0, len - 1); // Keep the backslash (root of a drive)
+                HANDLE dir = CreateFileW(dirPath.c_str(), FILE_LIST_DIRECTORY,
+                                         FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                                         OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+                if (dir != INVALID_HANDLE_VALUE)
+                {
+                    if (PeekDirEntry(dir, state->query) != NULL)
+                        state->hDir = dir;
+                    else
+                        CloseHandle(dir); // Query not supported or no entries, FindFirstFileExW reports it
+                }
+                if (state->hDir == INVALID_HANDLE_VALUE)
+                {
+                    free(buffer);
+                    state->query.Init(NULL, 0);
+                }
+            }
+        }
 
-        if (state->hFind == INVALID_HANDLE_VALUE)
+        if (state->hDir == INVALID_HANDLE_VALUE)
         {
-            DWORD err = GetLastError();
-            free(state);
-            SetLastError(err);
-            return INVALID_HENUM;
+            // Large fetch: the file system returns more entries per directory query (fewer round trips on network shares)
+            state->hFind = FindFirstFileExW(longPath.c_str(), FindExInfoStandard, &state->findData,
+                                            FindExSearchNameMatch, NULL, FIND_FIRST_EX_LARGE_FETCH);
+
+            if (state->hFind == INVALID_HANDLE_VALUE)
+            {
+                DWORD err = GetLastError();
+                free(state);
+                SetLastError(err);
+                return INVALID_HENUM;
+            }
         }
 
         state->firstRead = true;
+        state->lastError = ERROR_SUCCESS;
         return static_cast<HENUM>(state);
     }
 
+    EnumResult NextBatch(HENUM handle, FileEnumBatch& batch) override
+    {
+        batch.Clear();
+        if (!handle)
+            return EnumResult::Error(ERROR_INVALID_HANDLE);
+
+        EnumState* state = static_cast<EnumState*>(handle);
+        if (state->hDir != INVALID_HANDLE_VALUE)
+            return QueryDirectoryBatch(state->hDir, state->query, batch);
+
+        while (batch.HasSpace())
+        {
+            // First entry is the data from FindFirstFileExW
+            if (!state->firstRead)
+            {
+                if (state->lastError == ERROR_SUCCESS && !FindNextFileW(state->hFind, &state->findData))
+                {
+                    state->lastError = GetLastError();
+                    if (state->lastError == ERROR_SUCCESS)
+                        state->lastError = ERROR_NO_MORE_FILES;
+                }
+                if (state->lastError != ERROR_SUCCESS)
+                {
+                    if (batch.count > 0)
+                        break; // The end or the failure is returned by the next call
+                    if (state->lastError == ERROR_NO_MORE_FILES)
+                        return EnumResult::Done();
+                    return EnumResult::Error(state->lastError);
+                }
+            }
+            state->firstRead = false;
+            batch.Add(state->findData);
+        }
+        return EnumResult::Ok();
+    }
+
     EnumResult NextFile(HENUM handle, FileEnumEntry& entry) override
     {
         if (!handle)
@@ -89,6 +208,29 @@ public:
 
         EnumState* state = static_cast<EnumState*>(handle);
 
+        if (state->hDir != INVALID_HANDLE_VALUE)
+        {
+            const FILE_ID_BOTH_DIR_INFO* info = PeekDirEntry(state->hDir, state->query);
+            if (info == NULL)
+            {
+                DWORD err = GetLastError();
+                if (err == ERROR_NO_MORE_FILES)
+                    return EnumResult::Done();
+                return EnumResult::Error(err);
+            }
+            entry.name.assign(info->FileName, info->FileNameLength / sizeof(wchar_t));
+            entry.size = (uint64_t)info->EndOfFile.QuadPart;
+            entry.creationTime.dwLowDateTime = info->CreationTime.LowPart;
+            entry.creationTime.dwHighDateTime = (DWORD)info->CreationTime.HighPart;
+            entry.lastAccessTime.dwLowDateTime = info->LastAccessTime.LowPart;
+            entry.lastAccessTime.dwHighDateTime = (DWORD)info->LastAccessTime.HighPart;
+            entry.lastWriteTime.dwLowDateTime = info->LastWriteTime.LowPart;
+            entry.lastWriteTime.dwHighDateTime = (DWORD)info->LastWriteTime.HighPart;
+            entry.attributes = info->FileAttributes;
+            SkipDirEntry(state->query);
+            return EnumResult::Ok();
+        }
+
         // First call returns data from FindFirstFileW
         if (!state->firstRead)
         {
@@ -121,6 +263,10 @@ public:
         EnumState* state = static_cast<EnumState*>(handle);
         if (state->hFind != INVALID_HANDLE_VALUE)
             FindClose(state->hFind);
+        if (state->hDir != INVALID_HANDLE_VALUE)
+            CloseHandle(state->hDir);
+        if (state->query.buffer != NULL)
+            free(state->query.buffer);
         free(state);
     }
 };
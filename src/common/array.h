@@ -138,11 +138,22 @@ public:
 
     int SetDelta(int delta); // change 'Delta', return real used value; NOTE: can be used only for empty array
 
+    // if 'geometric' is TRUE, array is enlarged at least by half of its allocated size (but still at
+    // least by 'Delta'), so adding of many items does not reallocate (move) the array again and again;
+    // suitable for arrays which can grow to hundreds of thousands of items (directory listings)
+    void SetGrowGeometric(BOOL geometric) { GrowGeometric = geometric; }
+
+    // allocates array for at least 'count' items, so adding of items up to this count does not
+    // reallocate it; it is only an optimization: on low memory array stays as it is (State is
+    // not changed, items are then allocated while adding them)
+    void Reserve(int count);
+
 protected:
-    DATA_TYPE* Data; // pointer to array
-    int Available;   // allocated size of array
-    int Base;        // smallest allocated size of array
-    int Delta;       // allocated array size is enlarged/reduced by this value
+    DATA_TYPE* Data;    // pointer to array
+    int Available;      // allocated size of array
+    int Base;           // smallest allocated size of array
+    int Delta;          // allocated array size is enlarged/reduced by this value
+    BOOL GrowGeometric; // TRUE = array is enlarged geometrically, see SetGrowGeometric()
 
     virtual void Error(CErrorType err) // array error handling
     {
@@ -154,6 +165,9 @@ protected:
     void EnlargeArray(); // enlarges array
     void ReduceArray();  // reduces array
 
+    // returns new allocated size of array which must hold at least 'needed' items
+    int GetEnlargedSize(int needed);
+
     void Move(CArrayDirection direction, int first, int count); // move selected items to next/previous index
 
     void CallCopyConstructor(DATA_TYPE* placement, const DATA_TYPE& member)
@@ -679,6 +693,7 @@ TDirectArray<DATA_TYPE>::TDirectArray(int base, int delta)
     if (delta <= 0)
         TRACE_E("Delta is less or equal to zero, correcting to 1.");
     Delta = (delta > 0) ? delta : 1;
+    GrowGeometric = FALSE;
     State = etNone;
     Available = Count = 0;
     Data = (DATA_TYPE*)malloc(Base * sizeof(DATA_TYPE));
@@ -803,8 +818,7 @@ void TDirectArray<DATA_TYPE>::Insert(int index, const DATA_TYPE* members, int co
             int needed = Count + count;
             if (needed > Available)
             {
-                needed -= Base + 1;
-                needed = needed - (needed % Delta) + Delta + Base;
+                needed = GetEnlargedSize(needed);
                 DATA_TYPE* newData = (DATA_TYPE*)realloc(Data, needed * sizeof(DATA_TYPE));
 #ifndef SAFE_ALLOC
                 if (newData == NULL)
@@ -853,8 +867,7 @@ int TDirectArray<DATA_TYPE>::Add(const DATA_TYPE* members, int count)
         int needed = Count + count;
         if (needed > Available)
         {
-            needed -= Base + 1;
-            needed = needed - (needed % Delta) + Delta + Base;
+            needed = GetEnlargedSize(needed);
             DATA_TYPE* newData = (DATA_TYPE*)realloc(Data, needed * sizeof(DATA_TYPE));
 #ifndef SAFE_ALLOC
             if (newData == NULL)
@@ -953,7 +966,8 @@ void TDirectArray<DATA_TYPE>::Delete(int index)
             CallDestructor(Data[index]);
             Move(drUp, index + 1, Count - index - 1);
             Count--;
-            if (Available > Base && Available - Delta == Count)
+            if (Available > Base && Available - Delta == Count &&
+                (!GrowGeometric || Count <= Available / 2)) // geometrically enlarged array is reduced only when half empty
                 ReduceArray();
 #if defined(_DEBUG) || defined(__ARRAY_DEBUG)
         }
@@ -978,7 +992,8 @@ void TDirectArray<DATA_TYPE>::Delete(int index, int count)
                 CallDestructor(Data[i]);
             memmove(Data + index, Data + index + count, (Count - count - index) * sizeof(DATA_TYPE));
             Count -= count;
-            if (Available > Base && Available - Delta >= Count)
+            if (Available > Base && Available - Delta >= Count &&
+                (!GrowGeometric || Count <= Available / 2)) // geometrically enlarged array is reduced only when half empty
             {
                 int a = (Count <= Base) ? Base : Base + Delta * ((Count - Base - 1) / Delta + 1);
                 DATA_TYPE* New = (DATA_TYPE*)realloc(Data, a * sizeof(DATA_TYPE));
@@ -1018,7 +1033,8 @@ void TDirectArray<DATA_TYPE>::Detach(int index)
 #endif
             Move(drUp, index + 1, Count - index - 1);
             Count--;
-            if (Available > Base && Available - Delta == Count)
+            if (Available > Base && Available - Delta == Count &&
+                (!GrowGeometric || Count <= Available / 2)) // geometrically enlarged array is reduced only when half empty
                 ReduceArray();
 #if defined(_DEBUG) || defined(__ARRAY_DEBUG)
         }
@@ -1041,7 +1057,8 @@ void TDirectArray<DATA_TYPE>::Detach(int index, int count)
 #endif
             memmove(Data + index, Data + index + count, (Count - count - index) * sizeof(DATA_TYPE));
             Count -= count;
-            if (Available > Base && Available - Delta >= Count)
+            if (Available > Base && Available - Delta >= Count &&
+                (!GrowGeometric || Count <= Available / 2)) // geometrically enlarged array is reduced only when half empty
             {
                 int a = (Count <= Base) ? Base : Base + Delta * ((Count - Base - 1) / Delta + 1);
                 DATA_TYPE* New = (DATA_TYPE*)realloc(Data, a * sizeof(DATA_TYPE));
@@ -1099,7 +1116,8 @@ void TDirectArray<DATA_TYPE>::EnlargeArray()
     if (State == etNone)
     {
 #endif
-        DATA_TYPE* New = (DATA_TYPE*)realloc(Data, (Available + Delta) * sizeof(DATA_TYPE));
+        int newAvailable = GetEnlargedSize(Available + 1);
+        DATA_TYPE* New = (DATA_TYPE*)realloc(Data, newAvailable * sizeof(DATA_TYPE));
 #ifndef SAFE_ALLOC
         if (New == NULL)
         {
@@ -1109,7 +1127,42 @@ void TDirectArray<DATA_TYPE>::EnlargeArray()
         }
 #endif // SAFE_ALLOC
         Data = New;
-        Available += Delta;
+        Available = newAvailable;
+#if defined(_DEBUG) || defined(__ARRAY_DEBUG)
+    }
+    else
+        TRACE_E("Incorrect call to array method (State = " << State << ").");
+#endif
+}
+
+template <class DATA_TYPE>
+int TDirectArray<DATA_TYPE>::GetEnlargedSize(int needed)
+{
+    needed -= Base + 1;
+    needed = needed - (needed % Delta) + Delta + Base; // Base + multiple of Delta
+    if (GrowGeometric && needed < Available + Available / 2)
+        needed = Available + Available / 2;
+    return needed;
+}
+
+template <class DATA_TYPE>
+void TDirectArray<DATA_TYPE>::Reserve(int count)
+{
+#if defined(_DEBUG) || defined(__ARRAY_DEBUG)
+    if (State == etNone)
+    {
+#endif
+        if (count > Available)
+        {
+            DATA_TYPE* New = (DATA_TYPE*)realloc(Data, count * sizeof(DATA_TYPE));
+            if (New == NULL)
+            {
+                TRACE_E("Low memory for array reservation.");
+                return; // items will be allocated while adding them
+            }
+            Data = New;
+            Available = count;
+        }
 #if defined(_DEBUG) || defined(__ARRAY_DEBUG)
     }
     else
@@ -0,0 +1,892 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+#include <windows.h>
+#include <crtdbg.h>
+#include <ostream>
+#include <limits.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#if defined(_DEBUG) && defined(_MSC_VER) // without passing file+line to 'new' operator, list of memory leaks shows only 'crtdbg.h(552)'
+#define new new (_NORMAL_BLOCK, __FILE__, __LINE__)
+#endif
+
+#pragma warning(3 : 4706) // warning C4706: assignment within conditional expression
+
+#include "trace.h"
+#include "str.h"
+#include "moore.h"
+#include "regexp.h"
+#include "linregexp.h"
+
+#define ISMULT(c) ((c) == '*' || (c) == '+' || (c) == '?')
+
+//
+// ****************************************************************************
+// CLinearRegExp
+//
+
+CLinearRegExp::CLinearRegExp()
+{
+    HasPattern = FALSE;
+    Flags = sfCaseSensitive | sfForward;
+    LastErrorText = NULL;
+    Parse = NULL;
+    Backward = FALSE;
+    HasLineStart = FALSE;
+    ZeroMemory(Fold, sizeof(Fold));
+    ZeroMemory(IsWord, sizeof(IsWord));
+    ZeroMemory(ClassOf, sizeof(ClassOf));
+    ZeroMemory(ClassByte, sizeof(ClassByte));
+    ClassCount = 0;
+    UseRequiredText = FALSE;
+    MarkGen = 0;
+    StatesMemory = 0;
+    StartState = -1;
+    CurState = -1;
+    InLine = FALSE;
+    Line = NULL;
+    LineLength = 0;
+}
+
+BOOL CLinearRegExp::Set(const char* pattern, WORD flags)
+{
+    if (pattern == NULL)
+    {
+        HasPattern = FALSE;
+        Program.clear();
+        LastErrorText = RegExpErrorText(reeEmpty);
+        return FALSE;
+    }
+    OriginalPattern = pattern;
+    HasPattern = TRUE;
+    return SetFlags(flags);
+}
+
+BOOL CLinearRegExp::SetFlags(WORD flags)
+{
+    Flags = flags;
+    Program.clear();
+    ClearStates();
+    InLine = FALSE;
+    UseRequiredText = FALSE;
+    if (!HasPattern)
+    {
+        LastErrorText = RegExpErrorText(reeEmpty);
+        return FALSE;
+    }
+
+    // case insensitive search compares lower case, the same as CRegularExpression
+    std::string pattern = OriginalPattern;
+    int i;
+    for (i = 0; i < 256; i++)
+        Fold[i] = (Flags & sfCaseSensitive) ? (BYTE)i : LowerCase[i];
+    if ((Flags & sfCaseSensitive) == 0)
+    {
+        for (i = 0; i < (int)pattern.length(); i++)
+            pattern[i] = (char)LowerCase[(BYTE)pattern[i]];
+    }
+
+    Nodes.clear();
+    Sets.clear();
+    Parse = (const BYTE*)pattern.c_str();
+    BOOL hasWidth;
+    int root = ParseAlternation(FALSE, 0, hasWidth);
+    if (root == -1)
+    {
+        Nodes.clear();
+        Sets.clear();
+        return FALSE;
+    }
+
+    Backward = (Flags & sfForward) == 0;
+    if (Flags & sfWholeWords)
+        AddInstruction(opWordStart, 0, 0);
+    Emit(root, Backward);
+    if (Flags & sfWholeWords)
+        AddInstruction(opWordEnd, 0, 0);
+    AddInstruction(opMatch, 0, 0);
+
+    std::string required;
+    GetRequiredText(root, required);
+    Nodes.clear();
+    if (Program.size() > LINREGEXP_MAX_PROGRAM)
+    {
+        Program.clear();
+        Sets.clear();
+        LastErrorText = RegExpErrorText(reeTooBig);
+        return FALSE;
+    }
+    UseRequiredText = (int)required.length() >= LINREGEXP_MIN_REQUIRED_LEN;
+    if (UseRequiredText)
+    {
+        RequiredText.Set(required.c_str(), (int)required.length(), (WORD)(sfForward | (Flags & sfCaseSensitive)));
+        UseRequiredText = RequiredText.IsGood();
+    }
+
+    HasLineStart = FALSE;
+    for (i = 0; i < (int)Program.size(); i++)
+    {
+        if (Program[i].Op == opLineStart)
+            HasLineStart = TRUE;
+    }
+    for (i = 0; i < 256; i++)
+        IsWord[i] = (Flags & sfWholeWords) && (i == '_' || IsCharAlphaNumericA((char)i));
+    BuildByteClasses();
+
+    Mark.assign(Program.size(), 0);
+    MarkGen = 0;
+    LastErrorText = NULL;
+    return TRUE;
+}
+
+//
+// ****************************************************************************
+// Parsing
+// follows Spencer's regcomp (see regexp.cpp) including its errors, so both engines
+// accept the same expressions; parentheses only group (there are no subexpressions),
+// so their number is not limited, only their nesting
+//
+
+int CLinearRegExp::AddNode(CNodeType type, int set)
+{
+    CNode node;
+    node.Type = type;
+    node.Set = set;
+    Nodes.push_back(node);
+    return (int)Nodes.size() - 1;
+}
+
+int CLinearRegExp::AddClassNode(const CByteSet& set)
+{
+    Sets.push_back(set);
+    return AddNode(ntClass, (int)Sets.size() - 1);
+}
+
+int CLinearRegExp::ParseAlternation(BOOL paren, int depth, BOOL& hasWidth)
+{
+    if (depth > LINREGEXP_MAX_NESTING)
+    {
+        LastErrorText = RegExpErrorText(reeTooManyParenthesises);
+        return -1;
+    }
+    hasWidth = TRUE;
+    std::vector<int> kids;
+    while (1)
+    {
+        BOOL width;
+        int kid = ParseConcat(depth, width);
+        if (kid == -1)
+            return -1;
+        if (!width)
+            hasWidth = FALSE;
+        kids.push_back(kid);
+        if (*Parse != '|')
+            break;
+        Parse++;
+    }
+
+    if (paren && *Parse != ')' || !paren && *Parse != 0)
+    {
+        LastErrorText = RegExpErrorText(reeUnmatchedParenthesis);
+        return -1;
+    }
+    if (paren)
+        Parse++;
+
+    if (kids.size() == 1)
+        return kids[0];
+    int node = AddNode(ntAlternation, -1);
+    Nodes[node].Kids.swap(kids);
+    return node;
+}
+
+int CLinearRegExp::ParseConcat(int depth, BOOL& hasWidth)
+{
+    hasWidth = FALSE;
+    std::vector<int> kids;
+    while (*Parse != 0 && *Parse != '|' && *Parse != ')')
+    {
+        BOOL width;
+        int kid = ParsePiece(depth, width);
+        if (kid == -1)
+            return -1;
+        if (width)
+            hasWidth = TRUE;
+        kids.push_back(kid);
+    }
+
+    if (kids.empty())
+        return AddNode(ntEmpty, -1);
+    if (kids.size() == 1)
+        return kids[0];
+    int node = AddNode(ntConcat, -1);
+    Nodes[node].Kids.swap(kids);
+    return node;
+}
+
+int CLinearRegExp::ParsePiece(int depth, BOOL& hasWidth)
+{
+    BOOL width;
+    int atom = ParseAtom(depth, width);
+    if (atom == -1)
+        return -1;
+
+    BYTE op = *Parse;
+    if (!ISMULT(op))
+    {
+        hasWidth = width;
+        return atom;
+    }
+    if (!width && op != '?')
+    {
+        LastErrorText = RegExpErrorText(reeOperandCouldBeEmpty);
+        return -1;
+    }
+    hasWidth = op == '+';
+    Parse++;
+    if (ISMULT(*Parse))
+    {
+        LastErrorText = RegExpErrorText(reeNested);
+        return -1;
+    }
+
+    int node = AddNode(op == '*' ? ntStar : op == '+' ? ntPlus : ntQuestion, -1);
+    Nodes[node].Kids.push_back(atom);
+    return node;
+}
+
+int CLinearRegExp::ParseAtom(int depth, BOOL& hasWidth)
+{
+    CByteSet set;
+    ZeroMemory(&set, sizeof(set));
+    hasWidth = TRUE;
+    BYTE c = *Parse++;
+    switch (c)
+    {
+    case '^':
+    {
+        hasWidth = FALSE;
+        return AddNode(ntLineStart, -1);
+    }
+
+    case '$':
+    {
+        hasWidth = FALSE;
+        return AddNode(ntLineEnd, -1);
+    }
+
+    case '.':
+    {
+        int i;
+        for (i = 1; i < 256; i++)
+            set.Add((BYTE)i);
+        return AddClassNode(set);
+    }
+
+    case '[':
+    {
+        BOOL complement = FALSE;
+        if (*Parse == '^')
+        {
+            complement = TRUE;
+            Parse++;
+        }
+        if (*Parse == ']' || *Parse == '-')
+            set.Add(*Parse++);
+        while (*Parse != 0 && *Parse != ']')
+        {
+            if (*Parse == '-')
+            {
+                Parse++;
+                if (*Parse == ']' || *Parse == 0)
+                    set.Add('-');
+                else
+                {
+                    int from = *(Parse - 2) + 1; // the character before '-' is already in the set
+                    int to = *Parse++;
+                    if (from > to + 1)
+                    {
+                        LastErrorText = RegExpErrorText(reeInvalidRange);
+                        return -1;
+                    }
+                    for (; from <= to; from++)
+                        set.Add((BYTE)from);
+                }
+            }
+            else
+                set.Add(*Parse++);
+        }
+        if (*Parse != ']')
+        {
+            LastErrorText = RegExpErrorText(reeUnmatchedBracket);
+            return -1;
+        }
+        Parse++;
+        if (complement)
+        {
+            int i;
+            for (i = 0; i < 8; i++)
+                set.Bits[i] = ~set.Bits[i];
+            set.Bits[0] &= ~1; // null character never matches, the same as in CRegularExpression
+        }
+        return AddClassNode(set);
+    }
+
+    case '(':
+        return ParseAlternation(TRUE, depth + 1, hasWidth);
+
+    case 0:
+    case '|':
+    case ')':
+    case '?':
+    case '+':
+    case '*':
+    {
+        LastErrorText = RegExpErrorText(reeFollowsNothing);
+        return -1;
+    }
+
+    case '\\':
+    {
+        if (*Parse == 0)
+        {
+            LastErrorText = RegExpErrorText(reeTrailingBackslash);
+            return -1;
+        }
+        set.Add(*Parse++);
+        return AddClassNode(set);
+    }
+
+    default:
+    {
+        set.Add(c);
+        return AddClassNode(set);
+    }
+    }
+}
+
+//
+// ****************************************************************************
+// Emit
+// Thompson's construction; alternatives and repetitions prefer the same paths as
+// backtracking in CRegularExpression, so the Pike VM finds the same matches; the
+// backward program reads the reversed line: concatenations are reversed and the
+// beginning and the end of the line are swapped
+//
+
+int CLinearRegExp::AddInstruction(COpcode op, int x, int y)
+{
+    CInstruction inst;
+    inst.Op = op;
+    inst.X = x;
+    inst.Y = y;
+    Program.push_back(inst);
+    return (int)Program.size() - 1;
+}
+
+void CLinearRegExp::Emit(int node, BOOL backward)
+{
+    if (Program.size() > LINREGEXP_MAX_PROGRAM)
+        return; // too big, SetFlags reports the error
+    const CNode& n = Nodes[node];
+    int count = (int)n.Kids.size();
+    int i;
+    switch (n.Type)
+    {
+    case ntEmpty:
+        break;
+
+    case ntClass:
+        AddInstruction(opClass, n.Set, 0);
+        break;
+
+    case ntLineStart:
+        AddInstruction(backward ? opLineEnd : opLineStart, 0, 0);
+        break;
+
+    case ntLineEnd:
+        AddInstruction(backward ? opLineStart : opLineEnd, 0, 0);
+        break;
+
+    case ntConcat:
+    {
+        for (i = 0; i < count; i++)
+            Emit(n.Kids[backward ? count - 1 - i : i], backward);
+        break;
+    }
+
+    case ntAlternation:
+    {
+        std::vector<int> jumps;
+        for (i = 0; i < count - 1; i++)
+        {
+            int split = AddInstruction(opSplit, (int)Program.size() + 1, 0);
+            Emit(n.Kids[i], backward);
+            jumps.push_back(AddInstruction(opJump, 0, 0));
+            Program[split].Y = (int)Program.size();
+        }
+        Emit(n.Kids[count - 1], backward);
+        for (i = 0; i < (int)jumps.size(); i++)
+            Program[jumps[i]].X = (int)Program.size();
+        break;
+    }
+
+    case ntStar:
+    {
+        int split = AddInstruction(opSplit, (int)Program.size() + 1, 0);
+        Emit(n.Kids[0], backward);
+        AddInstruction(opJump, split, 0);
+        Program[split].Y = (int)Program.size();
+        break;
+    }
+
+    case ntPlus:
+    {
+        int loop = (int)Program.size();
+        Emit(n.Kids[0], backward);
+        AddInstruction(opSplit, loop, (int)Program.size() + 1);
+        break;
+    }
+
+    case ntQuestion:
+    {
+        int split = AddInstruction(opSplit, (int)Program.size() + 1, 0);
+        Emit(n.Kids[0], backward);
+        Program[split].Y = (int)Program.size();
+        break;
+    }
+    }
+}
+
+//
+// ****************************************************************************
+// GetRequiredText
+// returns the longest text every match of 'node' contains: consecutive single
+// characters of a concatenation (assertions between them do not matter)
+//
+
+void CLinearRegExp::GetRequiredText(int node, std::string& text)
+{
+    text.clear();
+    const CNode& n = Nodes[node];
+    switch (n.Type)
+    {
+    case ntClass:
+    {
+        int i, found = -1;
+        for (i = 0; i < 256; i++)
+        {
+            if (Sets[n.Set].Has((BYTE)i))
+            {
+                if (found != -1)
+                    return; // more characters
+                found = i;
+            }
+        }
+        if (found != -1)
+            text += (char)found;
+        break;
+    }
+
+    case ntConcat:
+    {
+        std::string run, kidText;
+        int i;
+        for (i = 0; i < (int)n.Kids.size(); i++)
+        {
+            const CNode& kid = Nodes[n.Kids[i]];
+            if (kid.Type == ntLineStart || kid.Type == ntLineEnd)
+                continue;
+            GetRequiredText(n.Kids[i], kidText);
+            if (kid.Type == ntClass && kidText.length() == 1)
+                run += kidText;
+            else
+            {
+                if (run.length() > text.length())
+                    text = run;
+                run.clear();
+                if (kidText.length() > text.length())
+                    text = kidText;
+            }
+        }
+        if (run.length() > text.length())
+            text = run;
+        break;
+    }
+
+    case ntPlus:
+        GetRequiredText(n.Kids[0], text);
+        break;
+
+    default:
+        break; // alternatives, optional parts and assertions do not require any text
+    }
+}
+
+//
+// ****************************************************************************
+// BuildByteClasses
+// bytes read by the same instructions (and equal for sfWholeWords) share one
+// column of the DFA transition table
+//
+
+void CLinearRegExp::BuildByteClasses()
+{
+    std::unordered_map<std::string, int> classes;
+    std::string key;
+    ClassCount = 0;
+    int i, j;
+    for (i = 0; i < 256; i++)
+    {
+        key.assign(1, (char)IsWord[i]);
+        for (j = 0; j < (int)Sets.size(); j++)
+            key += (char)Sets[j].Has(Fold[i]);
+        auto it = classes.find(key);
+        if (it == classes.end())
+        {
+            classes[key] = ClassCount;
+            ClassByte[ClassCount] = (BYTE)i;
+            ClassOf[i] = (BYTE)ClassCount++;
+        }
+        else
+            ClassOf[i] = (BYTE)it->second;
+    }
+}
+
+//
+// ****************************************************************************
+// AddClosure
+//
+
+void CLinearRegExp::NextMark()
+{
+    if (++MarkGen == INT_MAX)
+    {
+        std::fill(Mark.begin(), Mark.end(), 0);
+        MarkGen = 1;
+    }
+}
+
+void CLinearRegExp::AddClosure(std::vector<int>& list, int pc, int ctx, BOOL pending)
+{
+    Stack.clear();
+    Stack.push_back(pc);
+    while (!Stack.empty())
+    {
+        pc = Stack.back();
+        Stack.pop_back();
+        if (Mark[pc] == MarkGen)
+            continue;
+        Mark[pc] = MarkGen;
+        const CInstruction& inst = Program[pc];
+        switch (inst.Op)
+        {
+        case opSplit:
+        {
+            Stack.push_back(inst.Y);
+            Stack.push_back(inst.X); // X is preferred, it is added to 'list' first
+            break;
+        }
+
+        case opJump:
+            Stack.push_back(inst.X);
+            break;
+
+        case opLineStart:
+        {
+            if (ctx & ctxLineStart)
+                Stack.push_back(pc + 1);
+            break;
+        }
+
+        case opWordStart:
+        {
+            if ((ctx & ctxPrevWord) == 0)
+                Stack.push_back(pc + 1);
+            break;
+        }
+
+        case opLineEnd:
+        {
+            if (ctx & ctxLineEnd)
+                Stack.push_back(pc + 1);
+            else if (pending)
+                list.push_back(pc);
+            break;
+        }
+
+        case opWordEnd:
+        {
+            if (ctx & (ctxLineEnd | ctxNextNotWord))
+                Stack.push_back(pc + 1);
+            else if (pending)
+                list.push_back(pc);
+            break;
+        }
+
+        default: // opClass, opMatch
+            list.push_back(pc);
+            break;
+        }
+    }
+}
+
+//
+// ****************************************************************************
+// Lazy DFA
+// a state is the set of NFA instructions waiting for the next character (plus the
+// context needed to decide assertions); states and transitions are created when the
+// search needs them and all are dropped when they take too much memory, so the DFA
+// never costs more than simulating the NFA
+//
+
+void CLinearRegExp::ClearStates()
+{
+    StateIndex.clear();
+    StateKeys.clear();
+    Table.clear();
+    Matching.clear();
+    EndMatching.clear();
+    StatesMemory = 0;
+    StartState = -1;
+}
+
+int CLinearRegExp::AddState(std::vector<int>& pcs, int ctx)
+{
+    // the rest of the context does not change transitions, states differing only in it are merged
+    ctx &= (HasLineStart ? ctxLineStart : 0) | ((Flags & sfWholeWords) ? ctxPrevWord : 0);
+    std::sort(pcs.begin(), pcs.end());
+    std::string key(1, (char)ctx);
+    key.append((const char*)pcs.data(), pcs.size() * sizeof(int));
+    auto it = StateIndex.find(key);
+    if (it != StateIndex.end())
+        return it->second;
+
+    int state = (int)StateKeys.size();
+    BYTE match = FALSE;
+    int i;
+    for (i = 0; i < (int)pcs.size(); i++)
+    {
+        if (Program[pcs[i]].Op == opMatch)
+            match = TRUE;
+    }
+    StateKeys.push_back(key);
+    Matching.push_back(match);
+    EndMatching.push_back(-1);
+    Table.resize(Table.size() + ClassCount, -1);
+    StatesMemory += 2 * key.length() + ClassCount * sizeof(int) + 64;
+    StateIndex[key] = state;
+    return state;
+}
+
+void CLinearRegExp::GetStatePcs(int state, std::vector<int>& pcs, int& ctx)
+{
+    const std::string& key = StateKeys[state];
+    ctx = (BYTE)key[0];
+    pcs.resize((key.length() - 1) / sizeof(int));
+    if (!pcs.empty())
+        memcpy(pcs.data(), key.data() + 1, pcs.size() * sizeof(int));
+}
+
+int CLinearRegExp::GetStartState()
+{
+    if (StartState == -1)
+    {
+        NextMark();
+        Work1.clear();
+        AddClosure(Work1, 0, ctxLineStart, TRUE);
+        StartState = AddState(Work1, ctxLineStart);
+    }
+    return StartState;
+}
+
+int CLinearRegExp::AddTransition(int state, int cls)
+{
+    BYTE c = ClassByte[cls];
+    int ctx;
+    GetStatePcs(state, Work1, ctx);
+    NextMark();
+    int i;
+    for (i = 0; i < (int)Work1.size(); i++)
+        Mark[Work1[i]] = MarkGen;
+    if ((Flags & sfWholeWords) && !IsWord[c])
+    { // the character is not part of a word, threads waiting for the end of a word continue
+        int count = (int)Work1.size();
+        for (i = 0; i < count; i++)
+        {
+            if (Program[Work1[i]].Op == opWordEnd)
+                AddClosure(Work1, Work1[i] + 1, ctx | ctxNextNotWord, TRUE);
+        }
+    }
+
+    NextMark();
+    Work2.clear();
+    int nextCtx = IsWord[c] ? ctxPrevWord : 0;
+    for (i = 0; i < (int)Work1.size(); i++)
+    {
+        const CInstruction& inst = Program[Work1[i]];
+        if (inst.Op == opClass && Sets[inst.X].Has(Fold[c]))
+            AddClosure(Work2, Work1[i] + 1, nextCtx, TRUE);
+        else
+        {
+            if (inst.Op == opMatch) // a match ended before the character (at the end of a word)
+                AddClosure(Work2, Work1[i], nextCtx, TRUE);
+        }
+    }
+    AddClosure(Work2, 0, nextCtx, TRUE); // a match can start at any position
+
+    if (StatesMemory > LINREGEXP_MAX_DFA_MEMORY)
+    { // drop all states, only the source state is needed (its transition is stored)
+        GetStatePcs(state, Work1, ctx);
+        ClearStates();
+        state = AddState(Work1, ctx);
+    }
+    int next = AddState(Work2, nextCtx);
+    Table[state * ClassCount + cls] = next;
+    return next;
+}
+
+BOOL CLinearRegExp::MatchesAtLineEnd(int state)
+{
+    if (EndMatching[state] == -1)
+    {
+        int ctx;
+        GetStatePcs(state, Work1, ctx);
+        NextMark();
+        Work2.clear();
+        int i;
+        for (i = 0; i < (int)Work1.size(); i++)
+        {
+            COpcode op = Program[Work1[i]].Op;
+            if (op == opLineEnd || op == opWordEnd)
+                AddClosure(Work2, Work1[i] + 1, ctx | ctxLineEnd | ctxNextNotWord, TRUE);
+        }
+        EndMatching[state] = Matching[state];
+        for (i = 0; i < (int)Work2.size(); i++)
+        {
+            if (Program[Work2[i]].Op == opMatch)
+                EndMatching[state] = TRUE;
+        }
+    }
+    return EndMatching[state];
+}
+
+BOOL CLinearRegExp::MatchLine(const char* text, int length, BOOL lineEnd)
+{
+    int state = InLine ? CurState : GetStartState();
+    const BYTE* t = (const BYTE*)text;
+    const BYTE* end = t + length;
+    while (!Matching[state] && t < end)
+    {
+        int cls = ClassOf[*t++];
+        int next = Table[state * ClassCount + cls];
+        state = next != -1 ? next : AddTransition(state, cls);
+    }
+    BOOL found = Matching[state] || lineEnd && MatchesAtLineEnd(state);
+    CurState = state;
+    InLine = !found && !lineEnd;
+    return found;
+}
+
+//
+// ****************************************************************************
+// Pike VM
+// threads of the NFA run in parallel in the order of their priority (the order
+// backtracking would try them), a matching thread drops all threads with lower
+// priority; the line is read only once
+//
+
+void CLinearRegExp::SetLine(const char* start, const char* end)
+{
+    Line = start;
+    LineLength = (int)(end - start);
+}
+
+int CLinearRegExp::GetContext(int i) const
+{
+    int ctx = 0;
+    if (i == 0)
+        ctx |= ctxLineStart;
+    else if (IsWord[CharAt(i - 1)])
+        ctx |= ctxPrevWord;
+    if (i == LineLength)
+        ctx |= ctxLineEnd;
+    else if (!IsWord[CharAt(i)])
+        ctx |= ctxNextNotWord;
+    return ctx;
+}
+
+int CLinearRegExp::SearchLine(int start, int& foundEnd)
+{
+    int found = -1;
+    Work1.clear();
+    Starts1.clear();
+    NextMark();
+    int i, k;
+    for (i = start; i <= LineLength; i++)
+    {
+        if (found == -1) // a new thread starts at each position until a match is found
+        {
+            AddClosure(Work1, 0, GetContext(i), FALSE);
+            Starts1.resize(Work1.size(), i);
+        }
+        else
+        {
+            if (Work1.empty())
+                break; // no thread can find a preferred match
+        }
+
+        NextMark();
+        Work2.clear();
+        Starts2.clear();
+        BYTE c = i < LineLength ? Fold[CharAt(i)] : 0;
+        int ctx = i < LineLength ? GetContext(i + 1) : 0;
+        for (k = 0; k < (int)Work1.size(); k++)
+        {
+            const CInstruction& inst = Program[Work1[k]];
+            if (inst.Op == opMatch)
+            {
+                found = Starts1[k];
+                foundEnd = i;
+                break; // threads with lower priority are dropped
+            }
+            if (i < LineLength && inst.Op == opClass && Sets[inst.X].Has(c))
+            {
+                AddClosure(Work2, Work1[k] + 1, ctx, FALSE);
+                Starts2.resize(Work2.size(), Starts1[k]);
+            }
+        }
+        Work1.swap(Work2);
+        Starts1.swap(Starts2);
+    }
+    return found;
+}
+
+int CLinearRegExp::SearchForward(int start, int& foundLen)
+{
+    if (start < 0 || start > LineLength)
+        return -1;
+    int end;
+    int found = SearchLine(start, end);
+    if (found != -1)
+        foundLen = end - found;
+    return found;
+}
+
+int CLinearRegExp::SearchBackward(int length, int& foundLen)
+{
+    if (length < 0 || length > LineLength)
+        return -1;
+    int end;
+    int found = SearchLine(LineLength - length, end); // positions in the reversed line
+    if (found == -1)
+        return -1;
+    foundLen = end - found;
+    return LineLength - end;
+}
@@ -0,0 +1,195 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// ****************************************************************************
+// Regular expressions searched in linear time
+// ****************************************************************************
+//
+// Accepts the same syntax as CRegularExpression (see regexp.h), but the pattern is
+// compiled into a Thompson NFA instead of a backtracking program: testing whether
+// a line contains a match runs a lazily built DFA, the position and length of the
+// leftmost match are found by simulating the NFA (Pike VM). Both take time linear
+// in the length of the line, so no pattern can make the search hang and lines of
+// any length can be searched by parts.
+
+#pragma once
+
+// search flags are shared with CRegularExpression (see regexp.h): sfCaseSensitive, sfForward
+#define sfWholeWords 0x04 // 2. bit = 1: a match must not be preceded nor followed by a letter, digit or '_'
+
+#define LINREGEXP_MAX_PROGRAM 65536                // maximum number of NFA instructions
+#define LINREGEXP_MAX_NESTING 256                  // maximum nesting of parentheses
+#define LINREGEXP_MAX_DFA_MEMORY (8 * 1024 * 1024) // cached DFA states are dropped when they take more memory
+#define LINREGEXP_MIN_REQUIRED_LEN 2               // shorter required texts are not used to skip lines
+
+// ****************************************************************************
+
+class CLinearRegExp
+{
+public:
+    CLinearRegExp();
+
+    BOOL IsGood() const { return !Program.empty(); }
+    const char* GetPattern() const { return HasPattern ? OriginalPattern.c_str() : NULL; }
+    WORD GetFlags() const { return Flags; }
+
+    const char* GetLastErrorText() const { return LastErrorText; }
+    BOOL Set(const char* pattern, WORD flags); // returns FALSE on error (call GetLastErrorText method)
+    BOOL SetFlags(WORD flags);                 // returns FALSE on error (call GetLastErrorText method)
+
+    // searching for the leftmost match (used by the viewer): line of text to search in,
+    // the text is not copied, it must exist until the next SetLine call
+    void SetLine(const char* start, const char* end);
+    // returns the position of the leftmost match from 'start' or -1, in 'foundLen' its length
+    // (the expression must be compiled for the forward direction)
+    int SearchForward(int start, int& foundLen);
+    // returns the position of the match ending nearest to 'length' or -1, in 'foundLen' its length
+    // (the expression must be compiled for the backward direction)
+    int SearchBackward(int length, int& foundLen);
+
+    // testing whether lines contain a match (used by Find, the expression must be compiled for
+    // the forward direction): 'text' of 'length' characters is the beginning of a line or continues
+    // the line passed by the previous call, 'lineEnd' is TRUE if the line ends behind 'text';
+    // returns TRUE if a match was found in the line (the next call then starts a new line)
+    BOOL MatchLine(const char* text, int length, BOOL lineEnd);
+    // the next MatchLine call starts a new line (e.g. at the beginning of a file)
+    void ResetLine() { InLine = FALSE; }
+    // returns TRUE if the last MatchLine call ended inside a line
+    BOOL IsInLine() const { return InLine; }
+
+    // every match contains the required text (if there is one), lines without it need not be
+    // tested; returns the position of the required text in 'text' from 'start' or -1
+    BOOL HasRequiredText() const { return UseRequiredText; }
+    int SearchRequiredText(const char* text, int length, int start) { return RequiredText.SearchForward(text, length, start); }
+
+protected:
+    // nodes of the syntax tree
+    enum CNodeType
+    {
+        ntEmpty,
+        ntClass, // one character from Sets[Set]
+        ntLineStart,
+        ntLineEnd,
+        ntConcat,
+        ntAlternation,
+        ntStar,
+        ntPlus,
+        ntQuestion,
+    };
+
+    struct CNode
+    {
+        CNodeType Type;
+        int Set;               // ntClass: index into Sets
+        std::vector<int> Kids; // indexes into Nodes
+    };
+
+    // NFA instructions; the next instruction follows unless stated otherwise
+    enum COpcode
+    {
+        opClass,     // reads a character from Sets[X]
+        opSplit,     // continues at X and at Y (X is preferred)
+        opJump,      // continues at X
+        opLineStart, // beginning of the line
+        opLineEnd,   // end of the line
+        opWordStart, // no letter, digit nor '_' before
+        opWordEnd,   // no letter, digit nor '_' behind
+        opMatch,
+    };
+
+    struct CInstruction
+    {
+        COpcode Op;
+        int X;
+        int Y;
+    };
+
+    struct CByteSet
+    {
+        DWORD Bits[8];
+
+        BOOL Has(BYTE c) const { return (Bits[c >> 5] >> (c & 31)) & 1; }
+        void Add(BYTE c) { Bits[c >> 5] |= 1 << (c & 31); }
+    };
+
+    // context of a position in the line for deciding assertions
+    enum
+    {
+        ctxLineStart = 0x01,  // the position is the beginning of the line
+        ctxPrevWord = 0x02,   // a letter, digit or '_' is before the position
+        ctxLineEnd = 0x04,    // the position is the end of the line
+        ctxNextNotWord = 0x08 // no letter, digit nor '_' is behind the position
+    };
+
+    // parsing of Pattern (Spencer's grammar, see regexp.cpp); functions return the index
+    // of the node or -1 on error (LastErrorText is set)
+    int ParseAlternation(BOOL paren, int depth, BOOL& hasWidth);
+    int ParseConcat(int depth, BOOL& hasWidth);
+    int ParsePiece(int depth, BOOL& hasWidth);
+    int ParseAtom(int depth, BOOL& hasWidth);
+    int AddNode(CNodeType type, int set);
+    int AddClassNode(const CByteSet& set);
+
+    void Emit(int node, BOOL backward);        // appends the program of 'node' to Program
+    int AddInstruction(COpcode op, int x, int y);
+    void GetRequiredText(int node, std::string& text);
+    void BuildByteClasses();
+
+    // adds instructions reachable from 'pc' without reading a character and not added yet
+    // (see Mark) to 'list': character classes, opMatch and, if 'pending' is TRUE, assertions
+    // which cannot be decided in context 'ctx' (they wait for the next character)
+    void AddClosure(std::vector<int>& list, int pc, int ctx, BOOL pending);
+    void NextMark(); // starts a new list for AddClosure
+
+    // lazy DFA: states are sets of NFA instructions created on first use
+    int GetStartState();
+    int AddState(std::vector<int>& pcs, int ctx);
+    int AddTransition(int state, int cls);
+    BOOL MatchesAtLineEnd(int state);
+    void GetStatePcs(int state, std::vector<int>& pcs, int& ctx);
+    void ClearStates();
+
+    // Pike VM: the leftmost match in Line from 'start' (reading the line backward if Backward)
+    int SearchLine(int start, int& foundEnd);
+    BYTE CharAt(int i) const { return Backward ? (BYTE)Line[LineLength - 1 - i] : (BYTE)Line[i]; }
+    int GetContext(int i) const;
+
+    std::string OriginalPattern;
+    BOOL HasPattern;
+    WORD Flags;
+    const char* LastErrorText;
+
+    const BYTE* Parse;          // current position in the pattern being parsed
+    std::vector<CNode> Nodes;   // syntax tree (only while compiling)
+    std::vector<CByteSet> Sets; // character sets of ntClass nodes and opClass instructions
+
+    std::vector<CInstruction> Program; // compiled expression, starts at 0
+    BOOL Backward;                     // program is compiled from the reversed expression
+    BOOL HasLineStart;                 // program contains opLineStart
+    BYTE Fold[256];                    // byte -> byte matched against Sets (lower case if case insensitive)
+    BYTE IsWord[256];                  // letters, digits and '_' (only for sfWholeWords)
+    BYTE ClassOf[256];                 // byte -> class of bytes with the same transitions
+    BYTE ClassByte[256];               // representative byte of each class
+    int ClassCount;                    // number of classes
+    CSearchData RequiredText;          // text contained in every match (see LINREGEXP_MIN_REQUIRED_LEN)
+    BOOL UseRequiredText;              // FALSE if RequiredText is not set or too short
+
+    std::vector<int> Mark; // Mark[pc] == MarkGen: instruction is already in the list being built
+    int MarkGen;
+    std::vector<int> Work1, Work2, Starts1, Starts2; // lists of instructions and start positions of threads
+    std::vector<int> Stack;                          // for AddClosure
+
+    // DFA cache
+    std::unordered_map<std::string, int> StateIndex; // key (context + sorted instructions) -> state
+    std::vector<std::string> StateKeys;              // StateKeys[state]: key of the state
+    std::vector<int> Table;                          // Table[state * ClassCount + class]: next state or -1 if not known yet
+    std::vector<BYTE> Matching;                      // Matching[state]: a match ends in the state
+    std::vector<signed char> EndMatching;            // EndMatching[state]: a match ends in the state at the end of the line (-1 = not known yet)
+    size_t StatesMemory;                             // approximate memory taken by the states
+    int StartState;                                  // -1 if not known yet
+    int CurState;                                    // state reached by MatchLine in the current line
+    BOOL InLine;                                     // MatchLine continues in the current line
+
+    const char* Line; // line set by SetLine
+    int LineLength;
+};
@@ -23,6 +23,30 @@
 #include "str.h"
 #include "moore.h"
 
+#if defined(_M_IX86) || defined(_M_X64)
+#include <intrin.h>
+#include <immintrin.h>
+#define SEARCH_VECTOR_X86 // SSE2 is always available (x64 or /arch:SSE2), AVX2 is detected at runtime
+
+#ifndef PF_AVX2_INSTRUCTIONS_AVAILABLE
+#define PF_AVX2_INSTRUCTIONS_AVAILABLE 40
+#endif
+
+#ifdef __clang__ // clang-cl compiles AVX2 intrinsics only in functions targeted to AVX2
+#define SEARCH_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SEARCH_TARGET_AVX2
+#endif
+
+// returns TRUE if the CPU and the system support AVX2 (on older systems which do not
+// know this feature SSE2 is used)
+static BOOL SearchCanUseAVX2()
+{
+    static const BOOL canUseAVX2 = IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE);
+    return canUseAVX2;
+}
+#endif // defined(_M_IX86) || defined(_M_X64)
+
 //
 // ****************************************************************************
 // Initialize
@@ -149,8 +173,140 @@ void CSearchData::SetFlags(WORD flags)
         }
     }
     Initialize();
+    InitializeFilter();
+}
+
+//
+// ****************************************************************************
+// vectorized SearchForward
+//
+
+void CSearchData::InitializeFilter()
+{
+    FirstBytesCount = LastBytesCount = 0;
+#ifdef SEARCH_VECTOR_X86
+    if (Pattern == NULL || Length == 0 || (Flags & sfForward) == 0)
+        return;
+
+    // all bytes which Boyer-Moore considers equal to the first/last character of the pattern
+    BYTE firstBytes[SEARCH_FILTER_MAX_BYTES];
+    BYTE lastBytes[SEARCH_FILTER_MAX_BYTES];
+    int firstCount = 0;
+    int lastCount = 0;
+    int c;
+    for (c = 0; c < 256; c++)
+    {
+        BYTE folded = (Flags & sfCaseSensitive) ? (BYTE)c : LowerCase[c];
+        if (folded == (BYTE)Pattern[0])
+        {
+            if (firstCount == SEARCH_FILTER_MAX_BYTES)
+                return; // too many variants, the filter would not pay off
+            firstBytes[firstCount++] = (BYTE)c;
+        }
+        if (folded == (BYTE)Pattern[Length - 1])
+        {
+            if (lastCount == SEARCH_FILTER_MAX_BYTES)
+                return; // too many variants, the filter would not pay off
+            lastBytes[lastCount++] = (BYTE)c;
+        }
+    }
+    if (firstCount == 0 || lastCount == 0)
+        return; // the pattern cannot be found, leave it to Boyer-Moore
+    memcpy(FirstBytes, firstBytes, firstCount);
+    memcpy(LastBytes, lastBytes, lastCount);
+    FirstBytesCount = firstCount;
+    LastBytesCount = lastCount;
+#endif // SEARCH_VECTOR_X86
+}
+
+int CSearchData::SearchForwardVector(const char* text, int length, int start)
+{
+#ifdef SEARCH_VECTOR_X86
+    int found = SearchCanUseAVX2() ? SearchForwardAVX2(text, length, start) : SearchForwardSSE2(text, length, start);
+    if (found != -1)
+        return found;
+#endif // SEARCH_VECTOR_X86
+    return SearchForwardScalar(text, length, start); // the rest of the text (shorter than one block + pattern)
+}
+
+#ifdef SEARCH_VECTOR_X86
+
+int CSearchData::SearchForwardSSE2(const char* text, int length, int& start)
+{
+    __m128i first[SEARCH_FILTER_MAX_BYTES];
+    __m128i last[SEARCH_FILTER_MAX_BYTES];
+    int k;
+    for (k = 0; k < FirstBytesCount; k++)
+        first[k] = _mm_set1_epi8((char)FirstBytes[k]);
+    for (k = 0; k < LastBytesCount; k++)
+        last[k] = _mm_set1_epi8((char)LastBytes[k]);
+
+    const char* lastText = text + Length - 1; // text under the last character of the pattern
+    int i;
+    for (i = start; i + Length - 1 + 16 <= length; i += 16)
+    {
+        __m128i blockFirst = _mm_loadu_si128((const __m128i*)(text + i));
+        __m128i blockLast = _mm_loadu_si128((const __m128i*)(lastText + i));
+        __m128i eqFirst = _mm_cmpeq_epi8(blockFirst, first[0]);
+        for (k = 1; k < FirstBytesCount; k++)
+            eqFirst = _mm_or_si128(eqFirst, _mm_cmpeq_epi8(blockFirst, first[k]));
+        __m128i eqLast = _mm_cmpeq_epi8(blockLast, last[0]);
+        for (k = 1; k < LastBytesCount; k++)
+            eqLast = _mm_or_si128(eqLast, _mm_cmpeq_epi8(blockLast, last[k]));
+
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(eqFirst, eqLast));
+        while (mask != 0) // candidates from left to right, so the first occurrence is returned
+        {
+            unsigned long bit;
+            _BitScanForward(&bit, mask);
+            if (MatchesInside(text + i + bit))
+                return i + (int)bit;
+            mask &= mask - 1;
+        }
+    }
+    start = i;
+    return -1;
+}
+
+SEARCH_TARGET_AVX2 int CSearchData::SearchForwardAVX2(const char* text, int length, int& start)
+{
+    __m256i first[SEARCH_FILTER_MAX_BYTES];
+    __m256i last[SEARCH_FILTER_MAX_BYTES];
+    int k;
+    for (k = 0; k < FirstBytesCount; k++)
+        first[k] = _mm256_set1_epi8((char)FirstBytes[k]);
+    for (k = 0; k < LastBytesCount; k++)
+        last[k] = _mm256_set1_epi8((char)LastBytes[k]);
+
+    const char* lastText = text + Length - 1; // text under the last character of the pattern
+    int i;
+    for (i = start; i + Length - 1 + 32 <= length; i += 32)
+    {
+        __m256i blockFirst = _mm256_loadu_si256((const __m256i*)(text + i));
+        __m256i blockLast = _mm256_loadu_si256((const __m256i*)(lastText + i));
+        __m256i eqFirst = _mm256_cmpeq_epi8(blockFirst, first[0]);
+        for (k = 1; k < FirstBytesCount; k++)
+            eqFirst = _mm256_or_si256(eqFirst, _mm256_cmpeq_epi8(blockFirst, first[k]));
+        __m256i eqLast = _mm256_cmpeq_epi8(blockLast, last[0]);
+        for (k = 1; k < LastBytesCount; k++)
+            eqLast = _mm256_or_si256(eqLast, _mm256_cmpeq_epi8(blockLast, last[k]));
+
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(eqFirst, eqLast));
+        while (mask != 0) // candidates from left to right, so the first occurrence is returned
+        {
+            unsigned long bit;
+            _BitScanForward(&bit, mask);
+            if (MatchesInside(text + i + bit))
+                return i + (int)bit;
+            mask &= mask - 1;
+        }
+    }
+    start = i;
+    return -1;
 }
 
+#endif // SEARCH_VECTOR_X86
+
 void CSearchData::Set(const char* pattern, WORD flags)
 {
     if (pattern != NULL)
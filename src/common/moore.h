@@ -12,6 +12,12 @@
 #define sfCaseSensitive 0x01 // 0. bit = 1
 #define sfForward 0x02       // 1. bit = 1
 
+// vectorized forward search: candidate positions are found by comparing 16 or 32 bytes at once
+// with the first and last character of the pattern (all their case variants), only candidates are
+// compared with the whole pattern; the rest of the text is searched by Boyer-Moore
+#define SEARCH_FILTER_MAX_BYTES 4   // maximum number of bytes matching the first/last character
+#define SEARCH_VECTOR_MIN_LENGTH 64 // shorter texts are searched only by Boyer-Moore
+
 // ****************************************************************************
 
 class CSearchData
@@ -24,6 +30,7 @@ public:
         Length = 0;
         Pattern = NULL;
         Flags = 0;
+        FirstBytesCount = LastBytesCount = 0;
     }
 
     ~CSearchData()
@@ -61,6 +68,24 @@ protected:
     int Minimum(int a, int b) { return (a < b) ? a : b; }
     int Maximum(int a, int b) { return (a > b) ? a : b; }
 
+    inline int SearchForwardScalar(const char* text, int length, int start);
+
+    // vectorized search (SSE2 or AVX2 according to the CPU), then Boyer-Moore for the rest of the text
+    int SearchForwardVector(const char* text, int length, int start);
+    // searches 16/32 candidate positions at once from 'start'; returns pattern position or -1
+    // and in 'start' the first position which was not searched
+    int SearchForwardSSE2(const char* text, int length, int& start);
+    int SearchForwardAVX2(const char* text, int length, int& start);
+    // compares the pattern without its first and last character with 'text' (the pattern position)
+    inline BOOL MatchesInside(const char* text);
+    // fills FirstBytes and LastBytes (called from SetFlags)
+    void InitializeFilter();
+
+    BYTE FirstBytes[SEARCH_FILTER_MAX_BYTES]; // bytes matching the first character of the pattern
+    BYTE LastBytes[SEARCH_FILTER_MAX_BYTES];  // bytes matching the last character of the pattern
+    int FirstBytesCount;                      // number of bytes in FirstBytes (0 = vectorized search is not used)
+    int LastBytesCount;                       // number of bytes in LastBytes
+
     int* Fail1;            // fail array for current character
     int* Fail2;            // fail array for substring occurrence from right
     char* OriginalPattern; // original pattern to search for
@@ -83,6 +108,13 @@ private:
 //
 
 int CSearchData::SearchForward(const char* text, int length, int start)
+{
+    if (FirstBytesCount > 0 && length - start >= SEARCH_VECTOR_MIN_LENGTH)
+        return SearchForwardVector(text, length, start);
+    return SearchForwardScalar(text, length, start);
+}
+
+int CSearchData::SearchForwardScalar(const char* text, int length, int start)
 {
     int l1 = Length - 1;
     int i, j = l1 + start;
@@ -119,6 +151,19 @@ int CSearchData::SearchForward(const char* text, int length, int start)
     return -1;
 }
 
+BOOL CSearchData::MatchesInside(const char* text)
+{
+    int i;
+    if (Flags & sfCaseSensitive)
+        return Length < 3 || memcmp(text + 1, Pattern + 1, Length - 2) == 0;
+    for (i = 1; i < Length - 1; i++)
+    {
+        if (LowerCase[text[i]] != Pattern[i])
+            return FALSE;
+    }
+    return TRUE;
+}
+
 //
 // ****************************************************************************
 // SearchBackward
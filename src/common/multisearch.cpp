@@ -0,0 +1,440 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+#include <windows.h>
+#include <crtdbg.h>
+#include <ostream>
+#include <limits.h>
+#include <string>
+#include <vector>
+
+#if defined(_DEBUG) && defined(_MSC_VER) // without passing file+line to 'new' operator, list of memory leaks shows only 'crtdbg.h(552)'
+#define new new (_NORMAL_BLOCK, __FILE__, __LINE__)
+#endif
+
+#pragma warning(3 : 4706) // warning C4706: assignment within conditional expression
+
+#include "trace.h"
+#include "messages.h"
+#include "handles.h"
+
+#include "str.h"
+#include "moore.h"
+#include "multisearch.h"
+#include "unicode/helpers.h"
+
+//
+// ****************************************************************************
+// CMultiSearchData
+//
+
+CMultiSearchData::CMultiSearchData()
+{
+    MinLength = MaxLength = 0;
+    ZeroMemory(ClassOf, sizeof(ClassOf));
+    ClassCount = 0;
+    StatesCount = 0;
+    Next = NULL;
+    Depth = NULL;
+    Output = NULL;
+    DictionaryLink = NULL;
+    SamePattern = NULL;
+    Terminal = NULL;
+    Flags = 0;
+    LastError = mseNoError;
+}
+
+void CMultiSearchData::Clear()
+{
+    if (Next != NULL)
+        delete[] (Next);
+    if (Depth != NULL)
+        delete[] (Depth);
+    if (Output != NULL)
+        delete[] (Output);
+    if (DictionaryLink != NULL)
+        delete[] (DictionaryLink);
+    if (SamePattern != NULL)
+        delete[] (SamePattern);
+    if (Terminal != NULL)
+        delete[] (Terminal);
+    Next = Depth = Output = DictionaryLink = SamePattern = NULL;
+    Terminal = NULL;
+    ClassCount = 0;
+    StatesCount = 0;
+}
+
+void CMultiSearchData::AddPattern(const char* pattern, int length)
+{
+    if (length <= 0)
+        return; // empty texts are skipped (e.g. "a||b" or empty lines in the file)
+    Patterns.push_back(std::string(pattern, length));
+    if (MinLength == 0 || length < MinLength)
+        MinLength = length;
+    if (length > MaxLength)
+        MaxLength = length;
+}
+
+BOOL CMultiSearchData::SetList(const char* list, WORD flags)
+{
+    Clear();
+    Patterns.clear();
+    MinLength = MaxLength = 0;
+    List = list;
+    Flags = flags;
+
+    if (*list == '@') // list of texts in a file, one text per line
+    {
+        HANDLE file = HANDLES_Q(CreateFileW(AnsiToWide(list + 1).c_str(), GENERIC_READ,
+                                            FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                                            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            LastError = mseListFile;
+            return FALSE;
+        }
+        DWORD sizeHigh;
+        DWORD size = GetFileSize(file, &sizeHigh);
+        if (size == INVALID_FILE_SIZE && GetLastError() != NO_ERROR ||
+            sizeHigh != 0 || size > MULTISEARCH_MAX_LIST_FILE_SIZE)
+        {
+            HANDLES(CloseHandle(file));
+            LastError = size > MULTISEARCH_MAX_LIST_FILE_SIZE || sizeHigh != 0 ? mseTooBig : mseListFile;
+            return FALSE;
+        }
+        char* buf = new char[size + 1];
+        if (buf == NULL)
+        {
+            HANDLES(CloseHandle(file));
+            TRACE_E("Low memory for searching.");
+            LastError = mseLowMemory;
+            return FALSE;
+        }
+        DWORD read;
+        BOOL ok = ReadFile(file, buf, size, &read, NULL) && read == size;
+        HANDLES(CloseHandle(file));
+        if (!ok)
+        {
+            delete[] (buf);
+            LastError = mseListFile;
+            return FALSE;
+        }
+        const char* line = buf;
+        const char* end = buf + size;
+        while (line < end)
+        {
+            const char* eol = line;
+            while (eol < end && *eol != '\r' && *eol != '\n')
+                eol++;
+            AddPattern(line, (int)(eol - line));
+            if (eol < end && *eol == '\r')
+                eol++;
+            if (eol < end && *eol == '\n')
+                eol++;
+            line = eol;
+        }
+        delete[] (buf);
+    }
+    else // texts separated by MULTISEARCH_SEPARATOR
+    {
+        const char* s = list;
+        while (1)
+        {
+            const char* e = strchr(s, MULTISEARCH_SEPARATOR);
+            if (e == NULL)
+            {
+                AddPattern(s, (int)strlen(s));
+                break;
+            }
+            AddPattern(s, (int)(e - s));
+            s = e + 1;
+        }
+    }
+    return Build();
+}
+
+BOOL CMultiSearchData::SetTexts(const std::vector<std::string>& texts, WORD flags)
+{
+    Clear();
+    Patterns.clear();
+    MinLength = MaxLength = 0;
+    List.clear();
+    Flags = flags;
+
+    size_t i;
+    for (i = 0; i < texts.size(); i++)
+        AddPattern(texts[i].data(), (int)texts[i].length());
+    return Build();
+}
+
+BOOL CMultiSearchData::SetFlags(WORD flags)
+{
+    if (Next != NULL && Flags == flags)
+        return TRUE; // the automaton is already built for these flags
+    if (Patterns.empty())
+        return FALSE; // SetList failed, keep its error
+    Flags = flags;
+    return Build();
+}
+
+//
+// ****************************************************************************
+// Build
+// builds the trie of texts (reversed when searching backward), completes it with
+// failure transitions to a DFA and precomputes dictionary links for reporting all
+// texts ending in a state
+//
+
+BOOL CMultiSearchData::Build()
+{
+    Clear();
+    if (Patterns.empty())
+    {
+        TRACE_E("Empty list of searched texts.");
+        LastError = mseEmpty;
+        return FALSE;
+    }
+    if (MaxLength > MULTISEARCH_MAX_TEXT_LEN)
+    {
+        TRACE_E("Searched text is too long.");
+        LastError = mseTooBig;
+        return FALSE;
+    }
+
+    BOOL caseSensitive = (Flags & sfCaseSensitive) != 0;
+    BOOL forward = (Flags & sfForward) != 0;
+    int count = GetCount();
+
+    // bytes which do not occur in texts share one class, so the transition table is narrow
+    BYTE used[256];
+    ZeroMemory(used, sizeof(used));
+    __int64 maxStates = 1;
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        const std::string& p = Patterns[i];
+        maxStates += p.length();
+        size_t k;
+        for (k = 0; k < p.length(); k++)
+        {
+            BYTE c = (BYTE)p[k];
+            used[caseSensitive ? c : LowerCase[c]] = 1;
+        }
+    }
+    BYTE classOfUsed[256];
+    int classes = 0;
+    for (i = 0; i < 256; i++)
+    {
+        if (used[i])
+            classOfUsed[i] = (BYTE)classes++;
+    }
+    BYTE otherClass = (BYTE)(classes < 256 ? classes : 0);
+    ClassCount = classes < 256 ? classes + 1 : 256;
+    for (i = 0; i < 256; i++)
+    {
+        BYTE c = caseSensitive ? (BYTE)i : LowerCase[i];
+        ClassOf[i] = used[c] ? classOfUsed[c] : otherClass;
+    }
+
+    if (maxStates * ClassCount > MULTISEARCH_MAX_TRANSITIONS)
+    {
+        TRACE_E("Too many searched texts.");
+        ClassCount = 0;
+        LastError = mseTooBig;
+        return FALSE;
+    }
+    int statesLimit = (int)maxStates;
+
+    Next = new int[statesLimit * ClassCount];
+    Depth = new int[statesLimit];
+    Output = new int[statesLimit];
+    DictionaryLink = new int[statesLimit];
+    SamePattern = new int[count];
+    Terminal = new BYTE[statesLimit];
+    int* fail = new int[statesLimit];
+    int* queue = new int[statesLimit];
+    if (Next == NULL || Depth == NULL || Output == NULL || DictionaryLink == NULL ||
+        SamePattern == NULL || Terminal == NULL || fail == NULL || queue == NULL)
+    {
+        TRACE_E("Low memory for searching.");
+        if (fail != NULL)
+            delete[] (fail);
+        if (queue != NULL)
+            delete[] (queue);
+        Clear();
+        LastError = mseLowMemory;
+        return FALSE;
+    }
+    memset(Next, 0xFF, sizeof(int) * statesLimit * ClassCount); // -1: no transition yet
+    memset(Output, 0xFF, sizeof(int) * statesLimit);
+    memset(SamePattern, 0xFF, sizeof(int) * count);
+
+    // trie
+    Depth[0] = 0;
+    StatesCount = 1;
+    for (i = 0; i < count; i++)
+    {
+        const std::string& p = Patterns[i];
+        int len = (int)p.length();
+        int s = 0;
+        int k;
+        for (k = 0; k < len; k++)
+        {
+            int* n = Next + s * ClassCount + ClassOf[(BYTE)p[forward ? k : len - 1 - k]];
+            if (*n == -1)
+            {
+                *n = StatesCount;
+                Depth[StatesCount++] = Depth[s] + 1;
+            }
+            s = *n;
+        }
+        if (Output[s] == -1)
+            Output[s] = i;
+        else // the same text (differing at most in case): add it to the list of texts ending here
+        {
+            int o = Output[s];
+            while (SamePattern[o] != -1)
+                o = SamePattern[o];
+            SamePattern[o] = i;
+        }
+    }
+
+    // failure transitions (breadth-first, so the failure state is always complete)
+    int head = 0, tail = 0;
+    fail[0] = 0;
+    DictionaryLink[0] = -1;
+    Terminal[0] = 0;
+    int c;
+    for (c = 0; c < ClassCount; c++)
+    {
+        int n = Next[c];
+        if (n == -1)
+            Next[c] = 0;
+        else
+        {
+            fail[n] = 0;
+            queue[tail++] = n;
+        }
+    }
+    while (head < tail)
+    {
+        int s = queue[head++];
+        int f = fail[s];
+        DictionaryLink[s] = Output[f] != -1 ? f : DictionaryLink[f];
+        Terminal[s] = Output[s] != -1 || DictionaryLink[s] != -1;
+        int* row = Next + s * ClassCount;
+        const int* failRow = Next + f * ClassCount;
+        for (c = 0; c < ClassCount; c++)
+        {
+            if (row[c] == -1)
+                row[c] = failRow[c];
+            else
+            {
+                fail[row[c]] = failRow[c];
+                queue[tail++] = row[c];
+            }
+        }
+    }
+
+    delete[] (fail);
+    delete[] (queue);
+    LastError = mseNoError;
+    return TRUE;
+}
+
+//
+// ****************************************************************************
+// SearchForward
+// returns position of the leftmost occurrence or -1
+// text - text to search in
+// length - length of text string
+// start - first character numbered from 0
+//
+
+int CMultiSearchData::SearchForward(const char* text, int length, int start, int& foundLen) const
+{
+    int found = -1;
+    foundLen = 0;
+    int s = 0;
+    int i;
+    for (i = start; i < length; i++)
+    {
+        s = Next[s * ClassCount + ClassOf[(BYTE)text[i]]];
+        // the state matches the longest suffix which can still become a text, so once it starts
+        // behind the found occurrence, no occurrence starting earlier can follow
+        if (found != -1 && i + 1 - Depth[s] > found)
+            break;
+        if (Terminal[s])
+        {
+            // the first state on the dictionary path is the deepest one = the longest text ending here
+            int o = Output[s] != -1 ? s : DictionaryLink[s];
+            int pos = i + 1 - Depth[o];
+            if (found == -1 || pos <= found) // the same position = a longer text
+            {
+                found = pos;
+                foundLen = Depth[o];
+            }
+        }
+    }
+    return found;
+}
+
+//
+// ****************************************************************************
+// SearchBackward
+// returns position of the occurrence starting nearest to the end of text or -1
+// text - text to search in
+// length - length of text string
+//
+
+int CMultiSearchData::SearchBackward(const char* text, int length, int& foundLen) const
+{
+    foundLen = 0;
+    int s = 0;
+    int i;
+    for (i = length - 1; i >= 0; i--)
+    {
+        // the automaton is built from reversed texts, so a text ending in the state starts at 'i'
+        s = Next[s * ClassCount + ClassOf[(BYTE)text[i]]];
+        if (Terminal[s])
+        {
+            int o = Output[s] != -1 ? s : DictionaryLink[s];
+            foundLen = Depth[o];
+            return i;
+        }
+    }
+    return -1;
+}
+
+//
+// ****************************************************************************
+// IsAt
+//
+
+BOOL CMultiSearchData::IsAt(const char* text, int length, int index) const
+{
+    const std::string& p = Patterns[index];
+    if ((int)p.length() > length)
+        return FALSE;
+    const BYTE* t = (const BYTE*)text;
+    size_t i;
+    if (Flags & sfCaseSensitive)
+    {
+        for (i = 0; i < p.length(); i++)
+        {
+            if (t[i] != (BYTE)p[i])
+                return FALSE;
+        }
+    }
+    else
+    {
+        for (i = 0; i < p.length(); i++)
+        {
+            if (LowerCase[t[i]] != LowerCase[(BYTE)p[i]])
+                return FALSE;
+        }
+    }
+    return TRUE;
+}
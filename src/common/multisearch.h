@@ -0,0 +1,165 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// ****************************************************************************
+// Aho-Corasick search for several strings at once
+// ****************************************************************************
+
+#pragma once
+
+// search flags are shared with CSearchData (see moore.h): sfCaseSensitive, sfForward
+
+#define MULTISEARCH_SEPARATOR '|'                        // separator of texts typed into the search combobox
+#define MULTISEARCH_MAX_LIST_FILE_SIZE (4 * 1024 * 1024) // maximum size of a file with the list of texts ("@file")
+#define MULTISEARCH_MAX_TRANSITIONS (16 * 1024 * 1024)   // maximum size of the transition table (in states * byte classes)
+#define MULTISEARCH_MAX_TEXT_LEN 1000                    // maximum length of one text (the viewer searches overlapping parts of the file)
+
+enum CMultiSearchErrors
+{
+    mseNoError,
+    mseLowMemory,
+    mseEmpty,
+    mseTooBig,
+    mseListFile,
+};
+
+// function that returns the text of the occurred error
+const char* MultiSearchErrorText(CMultiSearchErrors err);
+
+// ****************************************************************************
+
+// progress of CMultiSearchData::SearchAll in one text (e.g. a file searched by parts);
+// each thread searching texts needs its own
+class CMultiSearchState
+{
+public:
+    int State;               // state of the automaton after the last searched part of the text
+    std::vector<BYTE> Found; // Found[i] != 0 if the i-th text was found
+    int FoundCount;          // number of found texts
+
+    CMultiSearchState()
+    {
+        State = 0;
+        FoundCount = 0;
+    }
+
+    // prepares the state for searching a new text; 'count' is the number of searched texts
+    void Reset(int count)
+    {
+        State = 0;
+        Found.assign(count, 0);
+        FoundCount = 0;
+    }
+};
+
+// ****************************************************************************
+
+class CMultiSearchData
+{
+public:
+    CMultiSearchData();
+    ~CMultiSearchData() { Clear(); }
+
+    // sets the list of searched texts: either texts separated by MULTISEARCH_SEPARATOR or
+    // "@" followed by the name of a file with one text per line; returns FALSE on error
+    // (call GetLastErrorText method)
+    BOOL SetList(const char* list, WORD flags);
+    // sets the searched texts directly, they may contain any bytes (e.g. a text transcoded
+    // to UTF-16); returns FALSE on error (call GetLastErrorText method)
+    BOOL SetTexts(const std::vector<std::string>& texts, WORD flags);
+    // builds the automaton for the direction and case sensitivity in 'flags' (the automaton
+    // is rebuilt only if 'flags' differ); returns FALSE on error (call GetLastErrorText method)
+    BOOL SetFlags(WORD flags);
+
+    BOOL IsGood() const { return Next != NULL; }
+    const char* GetLastErrorText() const { return MultiSearchErrorText(LastError); }
+    const char* GetList() const { return List.c_str(); }
+    WORD GetFlags() const { return Flags; }
+
+    int GetCount() const { return (int)Patterns.size(); }
+    const char* GetPattern(int index) const { return Patterns[index].c_str(); }
+    int GetPatternLength(int index) const { return (int)Patterns[index].length(); }
+    int GetMinLength() const { return MinLength; }
+    int GetMaxLength() const { return MaxLength; }
+
+    // searches 'text' of 'length' characters which continues the text searched by previous
+    // calls with the same 'state' (the automaton must be built for the forward direction);
+    // marks found texts in 'state' and returns TRUE once all texts have been found
+    inline BOOL SearchAll(const char* text, int length, CMultiSearchState& state) const;
+
+    // returns the position of the leftmost occurrence of any text (the longest one if more texts
+    // start there) from 'start' or -1; 'foundLen' receives its length
+    int SearchForward(const char* text, int length, int start, int& foundLen) const;
+    // returns the position of the occurrence of any text starting nearest to the end of 'text'
+    // (the longest one if more texts start there) or -1; 'foundLen' receives its length
+    int SearchBackward(const char* text, int length, int& foundLen) const;
+    // returns TRUE if the 'index'-th text starts at 'text' of 'length' characters (compared
+    // according to the case sensitivity in 'flags' of SetList/SetTexts)
+    BOOL IsAt(const char* text, int length, int index) const;
+
+protected:
+    void Clear(); // releases the automaton
+    BOOL Build(); // builds the automaton from Patterns according to Flags
+    void AddPattern(const char* pattern, int length);
+
+    std::string List;                  // list of texts as passed to SetList
+    std::vector<std::string> Patterns; // searched texts
+    int MinLength;                     // length of the shortest text
+    int MaxLength;                     // length of the longest text
+
+    // automaton (built from texts reversed when searching backward)
+    BYTE ClassOf[256];   // byte -> class of bytes with the same transitions
+    int ClassCount;      // number of classes (columns of Next)
+    int StatesCount;     // number of states (rows of Next)
+    int* Next;           // transitions: Next[state * ClassCount + class]
+    int* Depth;          // length of the text prefix leading to the state
+    int* Output;         // index of the text ending in the state or -1
+    int* DictionaryLink; // nearest state on the failure path with Output != -1 or -1
+    int* SamePattern;    // SamePattern[i]: next text equal to the i-th one (for case insensitive search) or -1
+    BYTE* Terminal;      // Terminal[state] != 0 if some text ends in the state (Output or DictionaryLink is used)
+
+    WORD Flags;
+    CMultiSearchErrors LastError;
+};
+
+//
+// ****************************************************************************
+// SearchAll
+//
+
+BOOL CMultiSearchData::SearchAll(const char* text, int length, CMultiSearchState& state) const
+{
+    int count = GetCount();
+    int s = state.State;
+    const BYTE* t = (const BYTE*)text;
+    const BYTE* end = t + length;
+    while (t < end)
+    {
+        s = Next[s * ClassCount + ClassOf[*t++]];
+        if (Terminal[s])
+        {
+            int o = Output[s] != -1 ? s : DictionaryLink[s];
+            while (o != -1)
+            {
+                int p = Output[o];
+                while (p != -1)
+                {
+                    if (!state.Found[p])
+                    {
+                        state.Found[p] = 1;
+                        state.FoundCount++;
+                    }
+                    p = SamePattern[p];
+                }
+                o = DictionaryLink[o];
+            }
+            if (state.FoundCount == count)
+            {
+                state.State = s;
+                return TRUE;
+            }
+        }
+    }
+    state.State = s;
+    return FALSE;
+}
@@ -1161,12 +1161,14 @@ void regoptail(char* p, char* val)
  */
 
 /*
- * Global work variables for regexec().
+ * Work variables for regexec(), per thread (regexec() runs without
+ * __RegExpSection, so several threads can match at once, each with
+ * its own compiled program - see CRegularExpression).
  */
-char* reginput;   /* String-input pointer. */
-char* regbol;     /* Beginning of input, for ^ check. */
-char** regstartp; /* Pointer to startp array. */
-char** regendp;   /* Ditto for endp. */
+thread_local char* reginput;   /* String-input pointer. */
+thread_local char* regbol;     /* Beginning of input, for ^ check. */
+thread_local char** regstartp; /* Pointer to startp array. */
+thread_local char** regendp;   /* Ditto for endp. */
 
 /*
  * Forwards.
@@ -1180,15 +1182,11 @@ int regrepeat(char* p);
  */
 int regexec(regexp* prog, char* string, int offset)
 {
-    __RegExpSection.Enter();
     char* s;
 
     /* Check validity of program. */
     if (UCHARAT(prog->program) != MAGIC)
-    {
-        __RegExpSection.Leave();
         return (0);
-    }
 
     /* If there is a "must appear" string, look for it. */
     if (prog->regmust != NULL)
@@ -1201,10 +1199,7 @@ int regexec(regexp* prog, char* string, int offset)
             s++;
         }
         if (s == NULL) /* Not present. */
-        {
-            __RegExpSection.Leave();
             return (0);
-        }
     }
 
     /* Mark beginning of line for ^ . */
@@ -1212,18 +1207,7 @@ int regexec(regexp* prog, char* string, int offset)
 
     /* Simplest case:  anchored match need be tried only once. */
     if (prog->reganch)
-    {
-        if (regtry(prog, string + offset))
-        {
-            __RegExpSection.Leave();
-            return (1);
-        }
-        else
-        {
-            __RegExpSection.Leave();
-            return (0);
-        }
-    }
+        return (regtry(prog, string + offset));
 
     /* Messy cases:  unanchored match. */
     s = string + offset;
@@ -1232,10 +1216,7 @@ int regexec(regexp* prog, char* string, int offset)
         while ((s = strchr(s, prog->regstart)) != NULL)
         {
             if (regtry(prog, s))
-            {
-                __RegExpSection.Leave();
                 return (1);
-            }
             s++;
         }
     else
@@ -1243,14 +1224,10 @@ int regexec(regexp* prog, char* string, int offset)
         do
         {
             if (regtry(prog, s))
-            {
-                __RegExpSection.Leave();
                 return (1);
-            }
         } while (*s++ != '\0');
 
     /* Failure. */
-    __RegExpSection.Leave();
     return (0);
 }
 
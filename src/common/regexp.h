@@ -113,6 +113,7 @@ public:
 
     BOOL IsGood() const { return OriginalPattern != NULL && Expression != NULL; }
     const char* GetPattern() const { return OriginalPattern; }
+    WORD GetFlags() const { return Flags; }
 
     const char* GetLastErrorText() const { return LastErrorText; }
     BOOL Set(const char* pattern, WORD flags); // Returns FALSE on error (call GetLastErrorText method)
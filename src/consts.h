@@ -1241,6 +1241,8 @@ struct COpenViewerData
 
 #define WM_USER_USERMENUICONS_READY WM_APP + 415 // [bkgndReaderData, threadID] - notification for main window that reading icons for User Menu completed in thread with ID 'threadID'
 
+#define WM_USER_RESUMECOPIES WM_APP + 416 // [0, 0] - offer to resume Copy/Move operations interrupted in the previous session (see ResumeInterruptedCopies)
+
 // states for Shift+F1 help mode
 #define HELP_INACTIVE 0 // not in Shift+F1 help mode (must be 0)
 #define HELP_ACTIVE 1   // in Shift+F1 help mode (non-zero)
@@ -849,6 +849,8 @@ void CCopyMoveMoreDialog::TransferCriteriaControls(CTransferInfo& ti)
     ti.CheckBox(IDC_CM_STARTONIDLE, Criteria->StartOnIdle);
     ti.CheckBox(IDC_CM_SECURITY, Criteria->CopySecurity);
     ti.CheckBox(IDC_CM_COPYATTRS, Criteria->CopyAttrs);
+    ti.CheckBox(IDC_CM_VERIFY, Criteria->VerifyCopy);
+    ti.CheckBox(IDC_CM_DELTA, Criteria->DeltaCopy);
     ti.CheckBox(IDC_CM_DIRTIME, Criteria->PreserveDirTime);
     ti.CheckBox(IDC_CM_IGNADS, Criteria->IgnoreADS);
     ti.CheckBox(IDC_CM_EMPTY, Criteria->SkipEmptyDirs);
@@ -1008,7 +1010,7 @@ void CCopyMoveMoreDialog::DisplayMore(BOOL more, BOOL fast)
     // hide the concealed controls so they are removed from the tab order
     int controls[] = {IDC_CM_NEWER, IDC_CM_STARTONIDLE, IDC_CM_SPEEDLIMIT, IDE_CM_SPEEDLIMIT,
                       IDC_CM_SPEEDLIMITUNITS, IDC_CM_SECURITY, IDC_CM_COPYATTRS,
-                      IDC_CM_DIRTIME, IDC_CM_IGNADS, IDC_CM_EMPTY, IDC_CM_NAMED_MASK, IDC_CM_NAMED,
+                      IDC_CM_DIRTIME, IDC_CM_IGNADS, IDC_CM_VERIFY, IDC_CM_DELTA, IDC_CM_EMPTY, IDC_CM_NAMED_MASK, IDC_CM_NAMED,
                       IDC_FILEMASK_HINT, IDC_CM_ADVANCED, IDC_CM_ADVANCED_INFO,
                       IDC_CM_SEPARATOR, -1};
 
@@ -1309,6 +1311,8 @@ MENU_TEMPLATE_ITEM CopyMoveMoreDialogMenu[] =
             case IDC_CM_SECURITY:
             case IDC_CM_DIRTIME:
             case IDC_CM_IGNADS:
+            case IDC_CM_VERIFY:
+            case IDC_CM_DELTA:
             case IDC_CM_EMPTY:
             case IDC_CM_NAMED:
             case IDC_CM_ADVANCED:
@@ -520,6 +520,7 @@ CConfiguration::CConfiguration()
 
     // Find dialog
     SearchFileContent = FALSE;
+    FindKeepResultsOrder = TRUE;
     FindDialogWindowPlacement.length = 0; // not valid yet
     // column width of the Find dialog
     FindColNameWidth = -1; // let it be set according to the window size
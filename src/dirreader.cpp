@@ -0,0 +1,155 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+#include "dirreader.h"
+#include "common/IFileSystem.h"
+
+//
+// ****************************************************************************
+// CDirectoryReader
+//
+
+CDirectoryReader::CDirectoryReader()
+{
+    FileSystem = NULL;
+    Dir = INVALID_HANDLE_VALUE;
+    Search = INVALID_HANDLE_VALUE;
+    Arena = NULL;
+    Query.Init(NULL, 0);
+    memset(&Batch, 0, sizeof(Batch));
+    BatchErr = NO_ERROR;
+    ReadIndex = 0;
+}
+
+BOOL CDirectoryReader::OpenW(const wchar_t* path, WIN32_FIND_DATAW* findData, IFileSystem* fileSystem)
+{
+    CALL_STACK_MESSAGE1("CDirectoryReader::OpenW()");
+    Close();
+
+    FileSystem = fileSystem != NULL ? fileSystem : gFileSystem;
+    if (FileSystem == NULL)
+        FileSystem = GetWin32FileSystem();
+
+    size_t len = wcslen(path);
+    if (len >= 2 && path[len - 1] == L'*' && path[len - 2] == L'\\') // whole directory: large directory queries
+    {
+        Arena = malloc(FILEENUM_QUERY_SIZE + DIRREADER_BATCH_SIZE * sizeof(FileEnumRecord) +
+                       DIRREADER_BATCH_NAMES * sizeof(wchar_t));
+        if (Arena == NULL)
+        {
+            TRACE_E(LOW_MEMORY);
+            SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+            return FALSE;
+        }
+        Query.Init(Arena, FILEENUM_QUERY_SIZE);
+        Batch.records = (FileEnumRecord*)((char*)Arena + FILEENUM_QUERY_SIZE);
+        Batch.recordCapacity = DIRREADER_BATCH_SIZE;
+        Batch.names = (wchar_t*)((char*)Batch.records + DIRREADER_BATCH_SIZE * sizeof(FileEnumRecord));
+        Batch.nameCapacity = DIRREADER_BATCH_NAMES;
+        Batch.Clear();
+
+        std::wstring dir(path, len - 1); // keep the backslash (root of a drive)
+        Dir = FileSystem->CreateFile(dir.c_str(), FILE_LIST_DIRECTORY,
+                                     FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                                     OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+        DWORD err = GetLastError();
+        HANDLES_ADD_EX(__otQuiet, Dir != INVALID_HANDLE_VALUE, __htFile, __hoCreateFile, Dir, err, TRUE);
+        if (Dir != INVALID_HANDLE_VALUE)
+        {
+            ReadBatchAux();
+            if (Batch.count > 0)
+            {
+                Batch.GetFindData(0, findData);
+                ReadIndex = 1;
+                return TRUE;
+            }
+            // query is not supported or the listing is empty, FindFirstFile reports it the usual way
+            HANDLES(CloseHandle(Dir));
+            Dir = INVALID_HANDLE_VALUE;
+        }
+    }
+
+    Search = FileSystem->FindFirstFile(path, findData);
+    DWORD err = GetLastError();
+    HANDLES_ADD_EX(__otQuiet, Search != INVALID_HANDLE_VALUE, __htFindFile, __hoFindFirstFile, Search, err, TRUE);
+    if (Search == INVALID_HANDLE_VALUE)
+    {
+        Close();
+        SetLastError(err);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+BOOL CDirectoryReader::Open(const char* path, WIN32_FIND_DATAW* findData)
+{
+    CALL_STACK_MESSAGE2("CDirectoryReader::Open(%s)", path);
+    std::wstring widePath = AnsiPathToWide(path);
+    if (widePath.empty() && path != NULL && *path != 0)
+    {
+        DWORD err = GetLastError();
+        Close();
+        SetLastError(err != NO_ERROR ? err : ERROR_INVALID_NAME);
+        return FALSE;
+    }
+    return OpenW(widePath.c_str(), findData, NULL);
+}
+
+void CDirectoryReader::Close()
+{
+    CALL_STACK_MESSAGE1("CDirectoryReader::Close()");
+    if (Dir != INVALID_HANDLE_VALUE)
+    {
+        HANDLES(CloseHandle(Dir));
+        Dir = INVALID_HANDLE_VALUE;
+    }
+    if (Search != INVALID_HANDLE_VALUE)
+    {
+        HANDLES(FindClose(Search));
+        Search = INVALID_HANDLE_VALUE;
+    }
+    if (Arena != NULL)
+    {
+        free(Arena);
+        Arena = NULL;
+    }
+    Query.Init(NULL, 0);
+    memset(&Batch, 0, sizeof(Batch));
+    BatchErr = NO_ERROR;
+    ReadIndex = 0;
+}
+
+DWORD CDirectoryReader::ReadBatchAux()
+{
+    EnumResult res = QueryDirectoryBatch(Dir, Query, Batch);
+    if (!res.success)
+        BatchErr = res.errorCode != NO_ERROR ? res.errorCode : ERROR_NO_MORE_FILES;
+    else
+        BatchErr = res.noMoreFiles ? ERROR_NO_MORE_FILES : NO_ERROR;
+    return BatchErr;
+}
+
+BOOL CDirectoryReader::FindNext(WIN32_FIND_DATAW* findData)
+{
+    if (Search != INVALID_HANDLE_VALUE)
+        return FileSystem->FindNextFile(Search, findData);
+    if (Dir == INVALID_HANDLE_VALUE)
+    {
+        SetLastError(ERROR_NO_MORE_FILES);
+        return FALSE;
+    }
+    while (ReadIndex >= Batch.count) // the batch is processed
+    {
+        if (BatchErr != NO_ERROR)
+        {
+            SetLastError(BatchErr);
+            return FALSE; // end of the listing
+        }
+        ReadBatchAux();
+        ReadIndex = 0;
+    }
+    Batch.GetFindData(ReadIndex++, findData);
+    return TRUE;
+}
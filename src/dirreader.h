@@ -0,0 +1,55 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+#include "common/IFileEnumerator.h"
+
+class IFileSystem;
+
+//
+// ****************************************************************************
+// CDirectoryReader
+//
+// reads entries of a directory and returns them one by one in the form of FindFirstFile data;
+// the whole directory (mask "*") is read by large directory queries (see QueryDirectoryBatch),
+// many entries per call, into a batch; other masks and file systems without the query use
+// FindFirstFile/FindNextFile; handles are opened through IFileSystem (see gFileSystem)
+
+#define DIRREADER_BATCH_SIZE 128                                     // number of entries in one batch
+#define DIRREADER_BATCH_NAMES (DIRREADER_BATCH_SIZE * 32 + MAX_PATH) // size of name arena of the batch (in characters)
+
+class CDirectoryReader
+{
+protected:
+    IFileSystem* FileSystem; // file system used to open the handles
+    HANDLE Dir;              // directory read by large directory queries (INVALID_HANDLE_VALUE = none)
+    HANDLE Search;           // FindFirstFile search used instead of 'Dir' (INVALID_HANDLE_VALUE = none)
+    void* Arena;             // memory of the query buffer and of the batch (records and names)
+    FileEnumDirQuery Query;  // buffer of the queries on 'Dir'
+    FileEnumBatch Batch;     // entries being returned by FindNext()
+    DWORD BatchErr;          // if not NO_ERROR, the listing ends after the batch (ERROR_NO_MORE_FILES = no more entries)
+    int ReadIndex;           // index of the next entry in the batch
+
+public:
+    CDirectoryReader();
+    ~CDirectoryReader() { Close(); }
+
+    // starts reading of 'path' (with mask, e.g. "C:\\dir\\*") and returns its first entry in
+    // 'findData'; returns FALSE on error, see GetLastError(); 'fileSystem' NULL = gFileSystem
+    BOOL OpenW(const wchar_t* path, WIN32_FIND_DATAW* findData, IFileSystem* fileSystem = NULL);
+
+    // ANSI version of OpenW() (uses gFileSystem)
+    BOOL Open(const char* path, WIN32_FIND_DATAW* findData);
+
+    // like FindNextFile: returns the next entry in 'findData'; returns FALSE at the end of the
+    // listing or on error, see GetLastError() (ERROR_NO_MORE_FILES at the end of the listing)
+    BOOL FindNext(WIN32_FIND_DATAW* findData);
+
+    // ends the enumeration (also when the listing is interrupted)
+    void Close();
+
+protected:
+    // reads the next batch from 'Dir'; returns error which ends the listing after this batch or NO_ERROR
+    DWORD ReadBatchAux();
+};
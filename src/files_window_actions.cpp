@@ -554,7 +554,7 @@ void CFilesWindow::ChangeSortType(CSortType newType, BOOL reverse, BOOL force)
     //---  sorting
     if (UseSystemIcons || UseThumbnails)
         SleepIconCacheThread();
-    SortDirectory();
+    SortDirectory(NULL, NULL, !force); // 'force' is used when items changed (e.g. sizes of directories were computed)
     if (UseSystemIcons || UseThumbnails)
         WakeupIconCacheThread();
     //---  select items for focus + perform final sorting
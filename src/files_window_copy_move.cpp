@@ -21,6 +21,7 @@
 #include "common/unicode/CopyNamePolicy.h"
 #include "common/IEnvironment.h"
 #include "common/widepath.h"
+#include "dirreader.h"
 
 #include "common/CBuildScriptState.h"
 #include "common/CSelectionSnapshot.h"
@@ -101,6 +102,53 @@ CSelectionSnapshot CFilesWindow::TakeSnapshot(CActionType type, int selCount,
 // Transient state for BuildScriptMain/Dir/File
 static CBuildScriptState bsState;
 
+// pipelined build: once enumerating the source tree takes longer than SCRIPT_PIPE_START_DELAY,
+// starts the operation (only if allowed by the caller via script->PipelinedCaption) and from then
+// on publishes the new operations for the worker; called every BS_TIMEOUT from BuildScriptDir;
+// returns FALSE if the build should be cancelled (the worker has ended or the user wants to cancel)
+static BOOL ContinuePipelinedBuild(COperations* script)
+{
+    if (!script->IsPipelinedBuild())
+    {
+        if (script->PipelinedCaption.empty() || script->Count < 2 ||
+            GetTickCount() - bsState.StartTickCount <= SCRIPT_PIPE_START_DELAY)
+        {
+            return TRUE;
+        }
+        // free space is checked after the build, so start only if the data found so far fits on the target
+        if (script->BytesPerCluster == 0 || script->TotalFileSize <= script->FreeSpace)
+        {
+            if (script->BeginPipelinedBuild() &&
+                !StartProgressDialog(script, script->PipelinedCaption.c_str(), NULL, NULL))
+            {
+                script->CancelPipelinedBuild(); // the operation was not started, the caller starts it after the build
+            }
+        }
+        script->PipelinedCaption.clear(); // try it only once
+        return TRUE;
+    }
+
+    BOOL tooFarAhead;
+    while (1)
+    {
+        if (!script->PublishOperations(&tooFarAhead))
+            return FALSE; // the worker has ended (e.g. cancelled by the user), no need to continue
+        if (!tooFarAhead)
+            return TRUE;
+        if (UserWantsToCancelSafeWaitWindow())
+        {
+            MSG msg; // discard the buffered ESC
+            while (PeekMessage(&msg, NULL, WM_KEYFIRST, WM_KEYLAST, PM_REMOVE))
+                ;
+            PromptResult res = gPrompter->AskYesNo(LoadStrW(IDS_QUESTION), LoadStrW(IDS_CANCELOPERATION));
+            UpdateWindow(MainWindow->HWindow);
+            if (res.type == PromptResult::kYes)
+                return FALSE;
+        }
+        script->WaitForWorker(BS_TIMEOUT);
+    }
+}
+
 //
 // ****************************************************************************
 // CFilesWindow
@@ -1077,14 +1125,18 @@ void CFilesWindow::DropCopyMove(BOOL copy, char* targetPath, CCopyMoveData* data
             TRACE_E(LOW_MEMORY);
         else
         {
-            if (!copy && data->Count > 0)
+            if (data->Count > 0 && data->At(0)->FileName != NULL)
             {
                 CPathBuffer source; // Heap-allocated for long path support
                 lstrcpyn(source, data->At(0)->FileName, source.Size());
                 CutDirectory(source);
-                BOOL sameRootPath = HasTheSameRootPath(source, targetPath);
-                script->SameRootButDiffVolume = sameRootPath && !HasTheSameRootPathAndVolume(source, targetPath);
-                script->ShowStatus = !sameRootPath || script->SameRootButDiffVolume;
+                if (!copy)
+                {
+                    BOOL sameRootPath = HasTheSameRootPath(source, targetPath);
+                    script->SameRootButDiffVolume = sameRootPath && !HasTheSameRootPathAndVolume(source, targetPath);
+                    script->ShowStatus = !sameRootPath || script->SameRootButDiffVolume;
+                }
+                script->SetQueueDevices(source, targetPath);
             }
             if (copy)
                 script->ShowStatus = TRUE;
@@ -1308,6 +1360,8 @@ BOOL CFilesWindow::BuildScriptMain(COperations* script, CActionType type,
             script->CopySecurity = filterCriteria->CopySecurity;
             script->PreserveDirTime = filterCriteria->PreserveDirTime;
             script->CopyAttrs = filterCriteria->CopyAttrs;
+            script->VerifyCopy = filterCriteria->VerifyCopy;
+            script->DeltaCopy = filterCriteria->DeltaCopy;
             script->StartOnIdle = filterCriteria->StartOnIdle;
 
             if (script->CopySecurity)
@@ -1479,9 +1533,12 @@ BOOL CFilesWindow::BuildScriptMain(COperations* script, CActionType type,
     }
 
     SetCurrentDirectoryToSystem();
-    int i;
-    for (i = 0; i < script->Count; i++)
-        script->TotalSize += script->At(i).Size;
+    if (!script->IsPipelinedBuild()) // a pipelined build refines TotalSize while publishing operations
+    {
+        int i;
+        for (i = 0; i < script->Count; i++)
+            script->TotalSize += script->At(i).Size;
+    }
     return TRUE;
 }
 
@@ -2077,10 +2134,11 @@ BOOL CFilesWindow::BuildScriptDir(COperations* script, CActionType type, char* s
     if (!copyMoveDirIsLink || !copyMoveSkipLinkContent)
     {
         WIN32_FIND_DATAW f;
+        CDirectoryReader dirReader; // entries are read in batches
         strcpy(st, "\\*");
-        HANDLE search = SalFindFirstFileHW(sourcePath, &f);
+        BOOL opened = dirReader.Open(sourcePath, &f);
         *st = 0; // remove "\\*"
-        if (search == INVALID_HANDLE_VALUE)
+        if (!opened)
         {
             DWORD err = GetLastError();
             if (err == ERROR_PATH_NOT_FOUND && type == atCountSize && dirDOSName != NULL && strcmp(dirName, dirDOSName) != 0)
@@ -2090,8 +2148,7 @@ BOOL CFilesWindow::BuildScriptDir(COperations* script, CActionType type, char* s
                     SalPathAppend(finalName, dirDOSName, 2 * MAX_PATH + 200) &&
                     SalPathAppend(finalName, "*", 2 * MAX_PATH + 200))
                 {
-                    search = SalFindFirstFileHW(finalName, &f);
-                    if (search != INVALID_HANDLE_VALUE)
+                    if (dirReader.Open(finalName, &f))
                     {
                         strcpy(*sourceEnd == '\\' ? sourceEnd + 1 : sourceEnd, dirDOSName); // modify sourcePath (it's used further for handling found files and directories)
                         goto BROWSE_DIR;
@@ -2169,6 +2226,8 @@ BOOL CFilesWindow::BuildScriptDir(COperations* script, CActionType type, char* s
                         if (res.type == PromptResult::kYes)
                             goto BUILD_ERROR;
                     }
+                    if (!ContinuePipelinedBuild(script))
+                        goto BUILD_ERROR;
 
                     bsState.LastTickCount = GetTickCount();
                 }
@@ -2189,7 +2248,7 @@ BOOL CFilesWindow::BuildScriptDir(COperations* script, CActionType type, char* s
                                         &f.ftLastWriteTime, srcAndTgtPathsFlags, f.cFileName))
                     {
                     BUILD_ERROR:
-                        HANDLES(FindClose(search));
+                        dirReader.Close();
                         *sourceEnd = 0; // restoring sourcePath
                         if (targetEnd != NULL)
                             *targetEnd = 0; // restoring targetPath
@@ -2212,9 +2271,9 @@ BOOL CFilesWindow::BuildScriptDir(COperations* script, CActionType type, char* s
                     else
                         canDelDirAfterMove = FALSE; // not everything is being moved (filter skipped something); the source directory cannot be deleted (it would not be empty)
                 }
-            } while (SalLPFindNextFile(search, &f));
+            } while (dirReader.FindNext(&f));
             DWORD err = GetLastError();
-            HANDLES(FindClose(search));
+            dirReader.Close();
 
             *sourceEnd = 0; // restoring sourcePath
             if (targetEnd != NULL)
@@ -1051,18 +1051,33 @@ void CFilesWindow::FilesAction(CActionType type, CFilesWindow* target, int count
 
                     char* auxTargetPath = NULL;
                     if (type == atCopy || type == atMove)
+                    {
                         auxTargetPath = path;
+
+                        // copying may start while the source tree is still being enumerated (pipelined build),
+                        // the progress dialog takes the paths for refreshing when it opens, so set them now
+                        script->PipelinedCaption = caption;
+                        script->SetQueueDevices(GetPath(), path);
+                        script->SetWorkPath1(type == atCopy ? path : GetPath(), TRUE);
+                        if (type == atMove)
+                            script->SetWorkPath2(path, TRUE);
+                    }
                     BOOL res2 = BuildScriptMain(script, type, auxTargetPath, mask, count, indexes.get(),
                                                 f, NULL, &changeCaseData, countSizeMode != 0,
                                                 criteriaPtr);
+                    BOOL pipelined = script->IsPipelinedBuild(); // TRUE = the operation is already running
+                    if (pipelined)
+                        script->EndPipelinedBuild(res2); // WARNING: from now on the worker may free the script at any time
                     // if there's nothing to do, don't show the progress dialog
-                    BOOL emptyScript = script->Count == 0 && type != atCountSize;
+                    BOOL emptyScript = !pipelined && script->Count == 0 && type != atCountSize;
 
                     // swapped to allow activation of the main window (must not be disabled), otherwise it switches to another app
                     EnableWindow(MainWindow->HWindow, TRUE);
                     DestroySafeWaitWindow();
                     if (type == atCountSize) // additional directory sizes have been calculated
                     {
+                        SortOrderCache.Invalidate(); // remembered orders by size are no longer valid
+
                         // perform sorting if counting was done across multiple selected directories or all directories
                         if (((countSizeMode == 0 && dirs > 1) || countSizeMode == 2) && SortType == stSize)
                         {
@@ -1086,7 +1101,7 @@ void CFilesWindow::FilesAction(CActionType type, CFilesWindow* target, int count
                     SetCursor(oldCur);
 
                     BOOL cancel = FALSE;
-                    if (!emptyScript && res2 && (type == atCopy || type == atMove))
+                    if (!pipelined && !emptyScript && res2 && (type == atCopy || type == atMove))
                     {
                         BOOL occupiedSpTooBig = script->OccupiedSpace != CQuadWord(0, 0) &&
                                                 script->BytesPerCluster != 0 && // we have disk information
@@ -1109,7 +1124,7 @@ void CFilesWindow::FilesAction(CActionType type, CFilesWindow* target, int count
                     if (!cancel)
                     {
                         // prepare refresh of directories that are not auto-refreshed
-                        if (!emptyScript && type != atCountSize)
+                        if (!pipelined && !emptyScript && type != atCountSize)
                         {
                             if (type == atDelete || type == atChangeCase || type == atMove)
                             {
@@ -1128,7 +1143,7 @@ void CFilesWindow::FilesAction(CActionType type, CFilesWindow* target, int count
                             }
                         }
 
-                        if (!emptyScript &&
+                        if (!pipelined && !emptyScript &&
                             (!res2 || type == atCountSize ||
                              !StartProgressDialog(script, caption, NULL, NULL)))
                         {
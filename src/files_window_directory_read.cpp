@@ -18,6 +18,7 @@
 #include "zip.h"
 #include "shiconov.h"
 #include "common/widepath.h"
+#include "dirreader.h"
 #include "ui/IPrompter.h"
 #include "common/unicode/helpers.h"
 #include "common/IEnvironment.h"
@@ -270,6 +271,7 @@ BOOL CFilesWindow::ReadDirectory(HWND parent, BOOL isRefresh)
         iconData.SetReadingDone(0); // just for the form
         BOOL addtoIconCache;
         CFileData file;
+        CDirectoryReader dirReader;
         // inicialization of structure members which will not be changed later
         file.NameW = NULL;
         file.PluginData = -1; // -1 just like that, ignored
@@ -305,9 +307,9 @@ BOOL CFilesWindow::ReadDirectory(HWND parent, BOOL isRefresh)
         WIN32_FIND_DATAW fileDataW;
         CPathBuffer ansiFileName; // Heap-allocated for long path support; ANSI conversion buffer for cFileName (also used as scratch)
         BOOL nameConversionLossy = FALSE; // TRUE if wide->ANSI conversion lost characters
-        HANDLE search;
-        search = SalFindFirstFileHW(fileName, &fileDataW);
-        if (search == INVALID_HANDLE_VALUE)
+        BOOL firstPass; // TRUE = the first pass (entries are read by dirReader)
+        firstPass = dirReader.Open(fileName, &fileDataW);
+        if (!firstPass)
         {
             DWORD err = GetLastError();
             DestroySafeWaitWindow();
@@ -532,10 +534,10 @@ BOOL CFilesWindow::ReadDirectory(HWND parent, BOOL isRefresh)
                 file.Name = (char*)malloc(len + 1); // allocation
                 if (file.Name == NULL)
                 {
-                    if (search != NULL)
+                    if (firstPass)
                     {
                         DestroySafeWaitWindow();
-                        HANDLES(FindClose(search));
+                        dirReader.Close();
                     }
                     TRACE_E(LOW_MEMORY);
                     SetCurrentDirectoryToSystem();
@@ -597,10 +599,10 @@ BOOL CFilesWindow::ReadDirectory(HWND parent, BOOL isRefresh)
                     if (file.DosName == NULL)
                     {
                         free(file.Name);
-                        if (search != NULL)
+                        if (firstPass)
                         {
                             DestroySafeWaitWindow();
-                            HANDLES(FindClose(search));
+                            dirReader.Close();
                         }
                         TRACE_E(LOW_MEMORY);
                         SetCurrentDirectoryToSystem();
@@ -653,10 +655,10 @@ BOOL CFilesWindow::ReadDirectory(HWND parent, BOOL isRefresh)
                     if (!Dirs->IsGood())
                     {
                         Dirs->ResetState();
-                        if (search != NULL)
+                        if (firstPass)
                         {
                             DestroySafeWaitWindow();
-                            HANDLES(FindClose(search));
+                            dirReader.Close();
                         }
                         SetCurrentDirectoryToSystem();
                         Files->DestroyMembers();
@@ -737,10 +739,10 @@ BOOL CFilesWindow::ReadDirectory(HWND parent, BOOL isRefresh)
                     if (!Files->IsGood())
                     {
                         Files->ResetState();
-                        if (search != NULL)
+                        if (firstPass)
                         {
                             DestroySafeWaitWindow();
-                            HANDLES(FindClose(search));
+                            dirReader.Close();
                         }
                         SetCurrentDirectoryToSystem();
                         Files->DestroyMembers();
@@ -888,7 +890,7 @@ BOOL CFilesWindow::ReadDirectory(HWND parent, BOOL isRefresh)
                             free(iconData.NameAndData);
                     }
                 }
-                if (search == NULL)
+                if (!firstPass)
                 {
                     testFindNextErr = FALSE;
 #ifndef _WIN64
@@ -896,13 +898,13 @@ BOOL CFilesWindow::ReadDirectory(HWND parent, BOOL isRefresh)
 #endif                     // _WIN64
                     break; // the second pass (adding ".." or win64 redirected-dir)
                 }
-            } while (SalLPFindNextFile(search, &fileDataW));
+            } while (dirReader.FindNext(&fileDataW));
             DWORD err = GetLastError();
 
-            if (search != NULL) // the first pass
+            if (firstPass)
             {
                 DestroySafeWaitWindow();
-                HANDLES(FindClose(search));
+                dirReader.Close();
             }
 
             if (testFindNextErr && err != ERROR_NO_MORE_FILES)
@@ -920,6 +922,7 @@ BOOL CFilesWindow::ReadDirectory(HWND parent, BOOL isRefresh)
         {
             upDir = FALSE;
             *(fileNameEnd - 1) = 0; // it's not logical, but times ".." are from current directory
+            HANDLE search;
             if (!UNCRootUpDir)
                 search = SalFindFirstFileHW(fileName, &fileDataW);
             else
@@ -948,7 +951,7 @@ BOOL CFilesWindow::ReadDirectory(HWND parent, BOOL isRefresh)
             }
             else
                 HANDLES(FindClose(search));
-            search = NULL;                                               // the second/third pass
+            firstPass = FALSE;                                           // the second/third pass
             fileDataW.dwFileAttributes |= FILE_ATTRIBUTE_DIRECTORY;      // this is ptDisk
             fileDataW.dwFileAttributes &= ~FILE_ATTRIBUTE_REPARSE_POINT; // need to remove flag FILE_ATTRIBUTE_REPARSE_POINT, otherwise link overlay will be on ".."
             wcscpy(fileDataW.cFileName, L"..");
@@ -1007,7 +1010,7 @@ BOOL CFilesWindow::ReadDirectory(HWND parent, BOOL isRefresh)
             MultiByteToWideChar(CP_ACP, 0, fileDataA.cAlternateFileName, -1, fileDataW.cAlternateFileName, 14);
 
             isWin64RedirectedDir = TRUE;
-            search = NULL; // the second/third pass...
+            firstPass = FALSE; // the second/third pass...
             strcpy(ansiFileName, fileDataA.cFileName);
             st = ansiFileName;
             len = (int)strlen(st);
@@ -1061,8 +1064,8 @@ BOOL CFilesWindow::ReadDirectory(HWND parent, BOOL isRefresh)
             if (ZIPFiles != NULL && ZIPDirs != NULL)
             {
                 // see comment in case of ptPluginFS
-                Files->SetDelta(DeltaForTotalCount(ZIPFiles->Count));
-                Dirs->SetDelta(DeltaForTotalCount(ZIPDirs->Count));
+                Files->Reserve(ZIPFiles->Count);
+                Dirs->Reserve(ZIPDirs->Count + 1); // + ".."
 
                 int i;
                 for (i = 0; i < ZIPFiles->Count; i++)
@@ -1327,9 +1330,10 @@ BOOL CFilesWindow::ReadDirectory(HWND parent, BOOL isRefresh)
                 {
                     // The Undelete plugin can show tens of thousands of files in one heap in the merged directory
                     // and the reallocation of CFilesArray after implicit 200 items then took several seconds.
-                    // Because we know the number of items in advance, we can choose a better strategy for reallocations.
-                    Files->SetDelta(DeltaForTotalCount(FSFiles->Count));
-                    Dirs->SetDelta(DeltaForTotalCount(FSDirs->Count));
+                    // Because we know the number of items in advance, we allocate the arrays at once
+                    // (hidden and filtered items make them only a bit bigger than needed).
+                    Files->Reserve(FSFiles->Count);
+                    Dirs->Reserve(FSDirs->Count + 1); // + ".."
 
                     int i;
                     for (i = 0; i < FSFiles->Count; i++)
@@ -1754,7 +1758,7 @@ void SortFilesAndDirectories(CFilesArray* files, CFilesArray* dirs, CSortType so
     }
 }
 
-void CFilesWindow::SortDirectory(CFilesArray* files, CFilesArray* dirs)
+void CFilesWindow::SortDirectory(CFilesArray* files, CFilesArray* dirs, BOOL useSortOrderCache)
 {
     CALL_STACK_MESSAGE1("CFilesWindow::SortDirectory()");
 
@@ -1762,7 +1766,25 @@ void CFilesWindow::SortDirectory(CFilesArray* files, CFilesArray* dirs)
         files = Files;
     if (dirs == NULL)
         dirs = Dirs;
-    SortFilesAndDirectories(files, dirs, SortType, ReverseSort, Configuration.SortDirsByName);
+    if (files == Files && dirs == Dirs)
+    {
+        if (!useSortOrderCache)
+            SortOrderCache.Invalidate(); // new listing or changed items (e.g. computed sizes of directories)
+        if (!useSortOrderCache ||
+            !SortOrderCache.Restore(files, dirs, SortType, ReverseSort, Configuration.SortDirsByName))
+        {
+            if (PreviousFiles != NULL && PreviousFiles != files) // refresh: sort only changes against the previous listing
+            {
+                SortRefreshedFilesAndDirectories(files, dirs, PreviousFiles, PreviousDirs, SortType, ReverseSort,
+                                                 Configuration.SortDirsByName);
+            }
+            else
+                SortFilesAndDirectories(files, dirs, SortType, ReverseSort, Configuration.SortDirsByName);
+            SortOrderCache.Store(files, dirs, SortType, ReverseSort, Configuration.SortDirsByName);
+        }
+    }
+    else
+        SortFilesAndDirectories(files, dirs, SortType, ReverseSort, Configuration.SortDirsByName);
 
     // single-purpose monitors for changes of Configuration.SortUsesLocale and Configuration.SortDetectNumbers
     // variables for the method CFilesWindow::RefreshDirectory
@@ -2240,6 +2240,149 @@ BOOL AreTheSameFiles(DWORD validFileData, CPluginDataInterfaceEncapsulation* plu
     return FALSE;
 }
 
+BOOL CFilesWindow::TransferListingState(CFilesArray* oldFiles, CFilesArray* oldDirs, BOOL focusFirstNewItem,
+                                        int* firstNewItemIsDir)
+{
+    CALL_STACK_MESSAGE1("CFilesWindow::TransferListingState()");
+
+    // if 'caseSensitive' is TRUE, we require exact (case sensitive) matching of name
+    BOOL caseSensitive = IsCaseSensitive();
+
+    // we skip the ".." (up-dir symbol) in both listings
+    int firstDir = 0;
+    if (Dirs->Count > 0 && Dirs->At(0).NameLen == 2 && Dirs->At(0).Name[0] == '.' && Dirs->At(0).Name[1] == '.')
+        firstDir = 1;
+    int oldFirstDir = 0;
+    if (oldDirs->Count > 0 && oldDirs->At(0).NameLen == 2 && oldDirs->At(0).Name[0] == '.' && oldDirs->At(0).Name[1] == '.')
+        oldFirstDir = 1;
+
+    // hash table: name of new item -> its index in Dirs+Files + 1
+    int count = Dirs->Count + Files->Count;
+    int size = 16;
+    while (size < 2 * count)
+        size *= 2;
+    int* table = (int*)calloc(size, sizeof(int));
+    BYTE* paired = focusFirstNewItem ? (BYTE*)calloc(max(count, 1), sizeof(BYTE)) : NULL;
+    if (table == NULL || focusFirstNewItem && paired == NULL)
+    {
+        TRACE_E(LOW_MEMORY); // old selection etc. is lost, as after change of path
+        if (table != NULL)
+            free(table);
+        if (paired != NULL)
+            free(paired);
+        return FALSE;
+    }
+    int i;
+    for (i = firstDir; i < count; i++)
+    {
+        CFileData* f = (i < Dirs->Count) ? &Dirs->At(i) : &Files->At(i - Dirs->Count);
+        int slot = (int)GetFileNameHashIgnCase(f->Name, f->NameLen) & (size - 1);
+        while (table[slot] != 0)
+            slot = (slot + 1) & (size - 1);
+        table[slot] = i + 1;
+    }
+
+    BOOL dirSizesTransferred = FALSE;
+    int oldCount = oldDirs->Count + oldFiles->Count;
+    for (i = oldFirstDir; i < oldCount; i++)
+    {
+        BOOL isDir = i < oldDirs->Count;
+        CFileData* oldData = isDir ? &oldDirs->At(i) : &oldFiles->At(i - oldDirs->Count);
+        if (!focusFirstNewItem && !oldData->Selected && (!isDir || !oldData->SizeValid) && !oldData->CutToClip &&
+            oldData->IconOverlayIndex == ICONOVERLAYINDEX_NOTUSED)
+        {
+            continue; // nothing to transfer
+        }
+
+        // we look for the new item of the same name, exact match is preferred over case insensitive match
+        CFileData* newData = NULL;
+        int newIndex = -1;
+        BOOL exactMatch = FALSE;
+        int slot = (int)GetFileNameHashIgnCase(oldData->Name, oldData->NameLen) & (size - 1);
+        while (table[slot] != 0)
+        {
+            int index = table[slot] - 1;
+            CFileData* f = (index < Dirs->Count) ? &Dirs->At(index) : &Files->At(index - Dirs->Count);
+            if ((index < Dirs->Count) == isDir && f->NameLen == oldData->NameLen &&
+                StrICmpEx(f->Name, f->NameLen, oldData->Name, oldData->NameLen) == 0)
+            {
+                if (memcmp(f->Name, oldData->Name, f->NameLen) == 0)
+                {
+                    newData = f;
+                    newIndex = index;
+                    exactMatch = TRUE;
+                    break;
+                }
+                if (newData == NULL)
+                {
+                    newData = f;
+                    newIndex = index;
+                }
+            }
+            slot = (slot + 1) & (size - 1);
+        }
+
+        if (newData != NULL)
+        {
+            if (paired != NULL)
+                paired[newIndex] = 1;
+            if (!caseSensitive || exactMatch)
+            {
+                // we transfer values from the old item to the new one
+                if (oldData->Selected)
+                    SetSel(TRUE, newData);
+                if (isDir)
+                {
+                    newData->SizeValid = oldData->SizeValid;
+                    if (newData->SizeValid)
+                    {
+                        newData->Size = oldData->Size;
+                        dirSizesTransferred = TRUE;
+                    }
+                }
+                newData->CutToClip = oldData->CutToClip;
+                newData->IconOverlayIndex = oldData->IconOverlayIndex;
+            }
+        }
+    }
+
+    if (paired != NULL) // we look for the first (by name) new item, directories go first
+    {
+        CFileData* firstNew = NULL;
+        int firstNewIndex = -1;
+        for (i = firstDir; i < count; i++)
+        {
+            if (i == Dirs->Count && firstNew != NULL)
+                break; // new directory was found
+            CFileData* f = (i < Dirs->Count) ? &Dirs->At(i) : &Files->At(i - Dirs->Count);
+            if (!paired[i] && (firstNew == NULL || LessNameExtIgnCase(*f, *firstNew, FALSE)))
+            {
+                firstNew = f;
+                firstNewIndex = i;
+            }
+        }
+        if (firstNew != NULL)
+        {
+            if (firstNewIndex < Dirs->Count)
+            {
+                strcpy(NextFocusName, firstNew->Name);
+                *firstNewItemIsDir = 1 /* is directory */;
+            }
+            else
+            {
+                if (!Is(ptDisk) || (firstNew->Attr & FILE_ATTRIBUTE_TEMPORARY) == 0) // on disk, we ignore tmp files (they disappear immediately), see https://forum.altap.cz/viewtopic.php?t=2496
+                {
+                    strcpy(NextFocusName, firstNew->Name);
+                    *firstNewItemIsDir = 0 /* is file */;
+                }
+            }
+        }
+        free(paired);
+    }
+    free(table);
+    return dirSizesTransferred;
+}
+
 void CFilesWindow::RefreshDirectory(BOOL probablyUselessRefresh, BOOL forceReloadThumbnails, BOOL isInactiveRefresh)
 {
     CALL_STACK_MESSAGE1("CFilesWindow::RefreshDirectory()");
@@ -2320,38 +2463,6 @@ void CFilesWindow::RefreshDirectory(BOOL probablyUselessRefresh, BOOL forceReloa
         }
     }
 
-    // To synchronize the old and new versions of the listing, we need the items sorted by
-    // name ascending - with a different sorting, a temporary change must occur.
-    //
-    // SortedWithRegSet contains the state of the Configuration.SortUsesLocale variable from the last
-    // call to SortDirectory(). SortedWithDetectNum contains the state of the variable
-    // Configuration.SortDetectNumbers from the last call to SortDirectory().
-    // If the configuration has changed in the meantime, it is necessary to force the following
-    // sorting, otherwise the subsequent synchronization of the two listings would not work.
-    BOOL changeSortType;
-    BOOL sortDirectoryPostponed = FALSE;
-    CSortType currentSortType;
-    BOOL currentReverseSort;
-    if (SortType != stName || ReverseSort || SortedWithRegSet != Configuration.SortUsesLocale ||
-        SortedWithDetectNum != Configuration.SortDetectNumbers)
-    {
-        changeSortType = TRUE;
-        currentReverseSort = ReverseSort;
-        currentSortType = SortType;
-        // at the same time, we define the conditions for sorting the new listing, which will run from CommonRefresh
-        ReverseSort = FALSE;
-        SortType = stName;
-        if (!OnlyDetachFSListing)
-            SortDirectory(); // we sort the old listing
-        else
-        {
-            // We will sort the FS listings later so that they can be drawn well in the panel in the meantime (so that the indices match).
-            sortDirectoryPostponed = TRUE;
-        }
-    }
-    else
-        changeSortType = FALSE;
-
     // we back up the old listing
     CPanelType oldPanelType = GetPanelType();                                  // the panel type can also change (e.g., inaccessible path)
     CSalamanderDirectory* oldArchiveDir = GetArchiveDir();                     // archive data
@@ -2458,17 +2569,8 @@ void CFilesWindow::RefreshDirectory(BOOL probablyUselessRefresh, BOOL forceReloa
 
         DontClearNextFocusName = FALSE;
 
-        // return to the user-selected sorting
-        if (changeSortType)
-        {
-            ReverseSort = currentReverseSort;
-            SortType = currentSortType;
-            // if (!sortDirectoryPostponed) SortDirectory();  // this doesn't work, new listings also come here (via _LABEL_2), not just oldFiles+oldDirs, plus there's a risk of changing sort parameters (we'd rather re-sort old listings too)
-            SortDirectory();
-        }
-
         if (UseSystemIcons || UseThumbnails)
-            WakeupIconCacheThread(); // wake-up after SortDirectory()
+            WakeupIconCacheThread();
 
         if (refreshDir) // restore the panel (after jumping to _LABEL_1)
         {
@@ -2511,6 +2613,14 @@ void CFilesWindow::RefreshDirectory(BOOL probablyUselessRefresh, BOOL forceReloa
     // ATTENTION: before leaving this function, we must put zero back into WaitBeforeReadingIcons !!!
     WaitBeforeReadingIcons = 30;
 
+    // the new listing is sorted using the old one (only changed items are sorted, see SortDirectory);
+    // it makes sense only if sort options did not change since the old listing was sorted
+    if (SortedWithRegSet == Configuration.SortUsesLocale && SortedWithDetectNum == Configuration.SortDetectNumbers)
+    {
+        PreviousFiles = oldFiles;
+        PreviousDirs = oldDirs;
+    }
+
     // refresh of the path (change to the same one with forceUpdate TRUE)
     BOOL noChange;
     BOOL result;
@@ -2575,6 +2685,9 @@ void CFilesWindow::RefreshDirectory(BOOL probablyUselessRefresh, BOOL forceReloa
     }
     }
 
+    PreviousFiles = NULL;
+    PreviousDirs = NULL;
+
     // return to the original path remembering mode
     MainWindow->CanAddToDirHistory = oldCanAddToDirHistory;
 
@@ -2638,15 +2751,6 @@ void CFilesWindow::RefreshDirectory(BOOL probablyUselessRefresh, BOOL forceReloa
     if (OnlyDetachFSListing)
         TRACE_E("FATAL ERROR: New listing didn't use prealocated objects???");
 
-    // we perform the postponed sorting of the FS listing
-    if (sortDirectoryPostponed)
-    {
-        if (ReverseSort || SortType != stName)
-            TRACE_E("FATAL ERROR: Unexpected change of sort type!");
-        SortDirectory(oldFiles, oldDirs);
-        sortDirectoryPostponed = FALSE;
-    }
-
     // we have a new version of the listing for the same path; now we'll enrich it with parts from the old listing
     // !!! ATTENTION: refresh in an archive that hasn't changed — oldFiles and oldDirs point to
     // ArchiveDir+PluginData (see above in ChangePathToArchive), oldArchiveDir+oldPluginData
@@ -2723,199 +2827,15 @@ void CFilesWindow::RefreshDirectory(BOOL probablyUselessRefresh, BOOL forceReloa
     if (count != oldCount + 1 && focusFirstNewItem)
         focusFirstNewItem = FALSE; // one item wasn't added
 
-    // if 'caseSensitive' is TRUE, we require exact (case sensitive) matching of name
-    // during the following flag synchronization
-    BOOL caseSensitive = IsCaseSensitive();
-
     int firstNewItemIsDir = -1; // -1 (unknown), 0 (is file), 1 (is directory)
-    int i = 0;
-    if (i < Dirs->Count) // we skip the ".." (up-dir symbol) in the new data
-    {
-        CFileData* newData = &Dirs->At(i);
-        if (newData->NameLen == 2 && newData->Name[0] == '.' && newData->Name[1] == '.')
-            i++;
-    }
-    int j = 0;
-    if (j < oldDirs->Count) // we skip the ".." (up-dir symbol) in the old data
-    {
-        CFileData* oldData = &oldDirs->At(j);
-        if (oldData->NameLen == 2 && oldData->Name[0] == '.' && oldData->Name[1] == '.')
-            j++;
-    }
-    for (; j < oldDirs->Count; j++) // first directories
-    {
-        CFileData* oldData = &oldDirs->At(j);
-        if (focusFirstNewItem || oldData->Selected || oldData->SizeValid || oldData->CutToClip ||
-            oldData->IconOverlayIndex != ICONOVERLAYINDEX_NOTUSED)
-        {
-            while (i < Dirs->Count)
-            {
-                CFileData* newData = &Dirs->At(i);
-                if (!LessNameExtIgnCase(*newData, *oldData, FALSE)) // new >= old
-                {
-                    if (LessNameExtIgnCase(*oldData, *newData, FALSE))
-                        break; // new > old -> new != old
-                    else       // new == old
-                    {
-                        // we look for an exact match between otherwise identical names
-                        int ii = i;
-                        BOOL exactMatch = FALSE; // TRUE if the old and new name match case sensitive
-                        while (ii < Dirs->Count)
-                        {
-                            CFileData* newData2 = &Dirs->At(ii);
-                            if (!LessNameExt(*newData2, *oldData, FALSE)) // new >= old
-                            {
-                                if (!LessNameExt(*oldData, *newData2, FALSE)) // old == new (exact) - we prefer exact match over case insensitive match
-                                {
-                                    exactMatch = TRUE;
-                                    if (ii > i) // we skipped at least one item (it was smaller than the searched old item)
-                                    {
-                                        if (focusFirstNewItem) // found a new item
-                                        {
-                                            strcpy(NextFocusName, newData->Name);
-                                            firstNewItemIsDir = 1 /* is directory */;
-                                            focusFirstNewItem = FALSE;
-                                        }
-                                        i = ii;
-                                        newData = newData2;
-                                    }
-                                }
-                                break; // in any case, we end the search for exact match
-                            }
-                            ii++;
-                        }
-
-                        if (!caseSensitive || exactMatch)
-                        {
-                            // we transfer values from the old item to the new one
-                            if (oldData->Selected)
-                                SetSel(TRUE, newData);
-                            newData->SizeValid = oldData->SizeValid;
-                            if (newData->SizeValid)
-                                newData->Size = oldData->Size;
-                            newData->CutToClip = oldData->CutToClip;
-                            newData->IconOverlayIndex = oldData->IconOverlayIndex;
-                        }
-                        i++;
-                        break;
-                    }
-                }
-                else // new < old
-                {
-                    if (focusFirstNewItem) // found a new item
-                    {
-                        strcpy(NextFocusName, newData->Name);
-                        firstNewItemIsDir = 1 /* is directory */;
-                        focusFirstNewItem = FALSE;
-                    }
-                }
-                i++;
-            }
-            if (i >= Dirs->Count)
-                break; // end of searching for selected items
-        }
-    }
-    if (focusFirstNewItem && i == Dirs->Count - 1) // found a new item
-    {
-        strcpy(NextFocusName, Dirs->At(i).Name);
-        firstNewItemIsDir = 1 /* is directory */;
-        focusFirstNewItem = FALSE;
-    }
-
-    i = 0;
-    for (j = 0; j < oldFiles->Count; j++) // after directories also files
-    {
-        CFileData* oldData = &oldFiles->At(j);
-        if (focusFirstNewItem || oldData->Selected || oldData->CutToClip ||
-            oldData->IconOverlayIndex != ICONOVERLAYINDEX_NOTUSED)
-        {
-            while (i < Files->Count)
-            {
-                CFileData* newData = &Files->At(i);
-                if (!LessNameExtIgnCase(*newData, *oldData, FALSE)) // new >= old
-                {
-                    if (LessNameExtIgnCase(*oldData, *newData, FALSE))
-                        break; // new > old -> new != old
-                    else       // new == old (ign. case)
-                    {
-                        // look for an exact match between otherwise identical names
-                        int ii = i;
-                        BOOL exactMatch = FALSE; // TRUE if the old and new name match case sensitive
-                        while (ii < Files->Count)
-                        {
-                            CFileData* newData2 = &Files->At(ii);
-                            if (!LessNameExt(*newData2, *oldData, FALSE)) // new >= old
-                            {
-                                if (!LessNameExt(*oldData, *newData2, FALSE)) // old == new (exact) - we prefer exact match over case insensitive match
-                                {
-                                    exactMatch = TRUE;
-                                    if (ii > i) // we skipped at least one item (it was smaller than the searched old item)
-                                    {
-                                        if (focusFirstNewItem) // found a new item
-                                        {
-                                            if (!Is(ptDisk) || (newData->Attr & FILE_ATTRIBUTE_TEMPORARY) == 0) // on disk, we ignore tmp files (they disappear immediately), see https://forum.altap.cz/viewtopic.php?t=2496
-                                            {
-                                                strcpy(NextFocusName, newData->Name);
-                                                firstNewItemIsDir = 0 /* is file */;
-                                            }
-                                            focusFirstNewItem = FALSE;
-                                        }
-                                        i = ii;
-                                        newData = newData2;
-                                    }
-                                }
-                                break; // in any case, we end the search for exact match
-                            }
-                            ii++;
-                        }
-
-                        if (!caseSensitive || exactMatch)
-                        {
-                            // we transfer values from the old item to the new one
-                            if (oldData->Selected)
-                                SetSel(TRUE, newData);
-                            newData->CutToClip = oldData->CutToClip;
-                            newData->IconOverlayIndex = oldData->IconOverlayIndex;
-                        }
-                        i++;
-                        break;
-                    }
-                }
-                else // new < old
-                {
-                    if (focusFirstNewItem) // found a new item
-                    {
-                        if (!Is(ptDisk) || (newData->Attr & FILE_ATTRIBUTE_TEMPORARY) == 0) // on disk, we ignore tmp files (they disappear immediately), see https://forum.altap.cz/viewtopic.php?t=2496
-                        {
-                            strcpy(NextFocusName, newData->Name);
-                            firstNewItemIsDir = 0 /* is file */;
-                        }
-                        focusFirstNewItem = FALSE;
-                    }
-                }
-                i++;
-            }
-            if (i >= Files->Count)
-                break; // end of searching for selected items
-        }
-    }
-    if (focusFirstNewItem && i == Files->Count - 1) // found a new item
-    {
-        if (!Is(ptDisk) || (Files->At(i).Attr & FILE_ATTRIBUTE_TEMPORARY) == 0) //  on disk, we ignore tmp files (they disappear immediately), see https://forum.altap.cz/viewtopic.php?t=2496
-        {
-            strcpy(NextFocusName, Files->At(i).Name);
-            firstNewItemIsDir = 0 /* is file */;
-        }
-        focusFirstNewItem = FALSE;
-    }
+    int i;
+    BOOL dirSizesTransferred = TransferListingState(oldFiles, oldDirs, focusFirstNewItem, &firstNewItemIsDir);
 
-    // return to the user-selected sorting
-    if (changeSortType)
+    // directories sorted by size must be sorted again with their transferred sizes
+    if (dirSizesTransferred && SortType == stSize)
     {
         if (!iconReaderIsSleeping && (UseSystemIcons || UseThumbnails))
             SleepIconCacheThread(); // the icon thread must be put to sleep before modifying Files/Dirs (if it's not already sleeping)
-        ReverseSort = currentReverseSort;
-        SortType = currentSortType;
         SortDirectory();
         if (!iconReaderIsSleeping && (UseSystemIcons || UseThumbnails))
             WakeupIconCacheThread();
@@ -2009,6 +2009,8 @@ void CFilesWindow::CalculateOccupiedZIPSpace(int countSizeMode)
             }
         }
 
+        SortOrderCache.Invalidate(); // sizes of directories have changed, remembered orders by size are no longer valid
+
         // sort if we counted over more than one selected directory or over all of them
         if (((countSizeMode == 0 && dirs > 1) || countSizeMode == 2) && SortType == stSize)
         {
@@ -1397,6 +1397,8 @@ CFilesWindow::CFilesWindow(CMainWindow* parent)
     ReverseSort = FALSE;
     SortedWithRegSet = FALSE;    // initial state doesn't matter; set in SortDirectory()
     SortedWithDetectNum = FALSE; // initial state doesn't matter; set in SortDirectory()
+    PreviousFiles = NULL;
+    PreviousDirs = NULL;
     LastFocus = INT_MAX;
     SetValidFileData(VALID_DATA_ALL);
     AutomaticRefresh = TRUE;
@@ -985,6 +985,8 @@ void CCriteriaData::Reset()
     StartOnIdle = FALSE;
     CopySecurity = FALSE;
     CopyAttrs = FALSE;
+    VerifyCopy = FALSE;
+    DeltaCopy = FALSE;
     PreserveDirTime = FALSE;
     IgnoreADS = FALSE;
     SkipEmptyDirs = FALSE;
@@ -1003,6 +1005,8 @@ CCriteriaData::operator=(const CCriteriaData& s)
     StartOnIdle = s.StartOnIdle;
     CopySecurity = s.CopySecurity;
     CopyAttrs = s.CopyAttrs;
+    VerifyCopy = s.VerifyCopy;
+    DeltaCopy = s.DeltaCopy;
     PreserveDirTime = s.PreserveDirTime;
     IgnoreADS = s.IgnoreADS;
     SkipEmptyDirs = s.SkipEmptyDirs;
@@ -1018,7 +1022,7 @@ CCriteriaData::operator=(const CCriteriaData& s)
 
 BOOL CCriteriaData::IsDirty()
 {
-    return OverwriteOlder || StartOnIdle || CopySecurity || CopyAttrs ||
+    return OverwriteOlder || StartOnIdle || CopySecurity || CopyAttrs || VerifyCopy || DeltaCopy ||
            PreserveDirTime || IgnoreADS || SkipEmptyDirs || UseMasks ||
            UseAdvanced || UseSpeedLimit;
 }
@@ -1076,6 +1080,8 @@ const char* CRITERIADATA_OVERWRITEOLDER_REG = "Overwrite Older";
 const char* CRITERIADATA_STARTONIDLE_REG = "Start On Idle";
 const char* CRITERIADATA_COPYSECURITY_REG = "Copy Security";
 const char* CRITERIADATA_COPYATTRIBUTES_REG = "Copy Attributes";
+const char* CRITERIADATA_VERIFYCOPY_REG = "Verify Copy";
+const char* CRITERIADATA_DELTACOPY_REG = "Delta Copy";
 const char* CRITERIADATA_PRESERVEDIRTIME_REG = "Preserve Dir Time";
 const char* CRITERIADATA_IGNOREADS_REG = "Ignore ADS";
 const char* CRITERIADATA_SKIPEMPTYDIRS_REG = "Skip Empty Dirs";
@@ -1099,6 +1105,10 @@ BOOL CCriteriaData::Save(HKEY hKey)
         SetValue(hKey, CRITERIADATA_COPYSECURITY_REG, REG_DWORD, &CopySecurity, sizeof(DWORD));
     if (CopyAttrs != def.CopyAttrs)
         SetValue(hKey, CRITERIADATA_COPYATTRIBUTES_REG, REG_DWORD, &CopyAttrs, sizeof(DWORD));
+    if (VerifyCopy != def.VerifyCopy)
+        SetValue(hKey, CRITERIADATA_VERIFYCOPY_REG, REG_DWORD, &VerifyCopy, sizeof(DWORD));
+    if (DeltaCopy != def.DeltaCopy)
+        SetValue(hKey, CRITERIADATA_DELTACOPY_REG, REG_DWORD, &DeltaCopy, sizeof(DWORD));
     if (PreserveDirTime != def.PreserveDirTime)
         SetValue(hKey, CRITERIADATA_PRESERVEDIRTIME_REG, REG_DWORD, &PreserveDirTime, sizeof(DWORD));
     if (IgnoreADS != def.IgnoreADS)
@@ -1127,6 +1137,8 @@ BOOL CCriteriaData::Load(HKEY hKey)
     GetValue(hKey, CRITERIADATA_STARTONIDLE_REG, REG_DWORD, &StartOnIdle, sizeof(DWORD));
     GetValue(hKey, CRITERIADATA_COPYSECURITY_REG, REG_DWORD, &CopySecurity, sizeof(DWORD));
     GetValue(hKey, CRITERIADATA_COPYATTRIBUTES_REG, REG_DWORD, &CopyAttrs, sizeof(DWORD));
+    GetValue(hKey, CRITERIADATA_VERIFYCOPY_REG, REG_DWORD, &VerifyCopy, sizeof(DWORD));
+    GetValue(hKey, CRITERIADATA_DELTACOPY_REG, REG_DWORD, &DeltaCopy, sizeof(DWORD));
     GetValue(hKey, CRITERIADATA_PRESERVEDIRTIME_REG, REG_DWORD, &PreserveDirTime, sizeof(DWORD));
     GetValue(hKey, CRITERIADATA_IGNOREADS_REG, REG_DWORD, &IgnoreADS, sizeof(DWORD));
     GetValue(hKey, CRITERIADATA_SKIPEMPTYDIRS_REG, REG_DWORD, &SkipEmptyDirs, sizeof(DWORD));
@@ -80,6 +80,8 @@ public:
     BOOL StartOnIdle;         // start only when nothing else is running
     BOOL CopySecurity;        // preserve NTFS permissions, FALSE = don't care = no special handling, result doesn't matter
     BOOL CopyAttrs;           // preserve Archive, Encrypt and Compress attributes; FALSE = don't care = no special handling, result doesn't matter to us
+    BOOL VerifyCopy;          // verify copied files: read them back and compare with the data read from the source files
+    BOOL DeltaCopy;           // overwrite existing large files in place, writing only the blocks which differ from the source file
     BOOL PreserveDirTime;     // preserve date and time of directories
     BOOL IgnoreADS;           // ignore ADS (do not search for them in the copy source) - strips ADS and speeds up on slow networks (especially VPN)
     BOOL SkipEmptyDirs;       // skip empty directories (or directories containing only directories)
@@ -770,6 +772,9 @@ public:
     BOOL ReverseSort;         // reverse order
     BOOL SortedWithRegSet;    // used to monitor changes of the global variable Configuration.SortUsesLocale
     BOOL SortedWithDetectNum; // used to monitor changes of the global variable Configuration.SortDetectNumbers
+    CSortOrderCache SortOrderCache; // orders of Files and Dirs for already used sort types (see ChangeSortType)
+    CFilesArray* PreviousFiles;     // only during RefreshDirectory: previous listing of the refreshed path (NULL = none), see SortDirectory
+    CFilesArray* PreviousDirs;
 
     CPathBuffer DropPath;  // buffer for the current directory used in a drop operation
     CPathBuffer NextFocusName; // the name that will receive focus on the next refresh
@@ -1340,8 +1345,10 @@ public:
     BOOL ReadDirectory(HWND parent, BOOL isRefresh);
 
     // sorts Files and Dirs using the current ordering method; because it reorders them,
-    // icon loading for Files and Dirs must be paused during sorting (see SleepIconCacheThread())
-    void SortDirectory(CFilesArray* files = NULL, CFilesArray* dirs = NULL);
+    // icon loading for Files and Dirs must be paused during sorting (see SleepIconCacheThread());
+    // if 'useSortOrderCache' is TRUE, the listing did not change since the last sorting and an
+    // order remembered in SortOrderCache can be used, otherwise remembered orders are dropped
+    void SortDirectory(CFilesArray* files = NULL, CFilesArray* dirs = NULL, BOOL useSortOrderCache = FALSE);
 
     void RefreshListBox(int suggestedXOffset,         // if not -1 this value is used
                         int suggestedTopIndex,        // if not -1 this value is used
@@ -1357,6 +1364,15 @@ public:
     void RefreshDirectory(BOOL probablyUselessRefresh = FALSE, BOOL forceReloadThumbnails = FALSE,
                           BOOL isInactiveRefresh = FALSE);
 
+    // helper for RefreshDirectory: transfers selection, cut-to-clip flags, icon overlays and sizes of
+    // directories from items of the old listing 'oldFiles'+'oldDirs' to items of the same names in
+    // Files+Dirs (items are paired using a hash table of names, so both listings can be sorted in any
+    // way); if 'focusFirstNewItem' is TRUE, the name of the first (by name) added item is stored to
+    // NextFocusName and 'firstNewItemIsDir' is set to 1 for directory and 0 for file; returns TRUE if
+    // sizes of some directories were transferred
+    BOOL TransferListingState(CFilesArray* oldFiles, CFilesArray* oldDirs, BOOL focusFirstNewItem,
+                              int* firstNewItemIsDir);
+
     // read-dir (archives, FS, disk), sort
     // parent is the parent message box
     // if suggestedTopIndex != -1, the top index will be set
@@ -7,6 +7,7 @@
 #include "cfgdlg.h"
 #include "find.h"
 #include "md5.h"
+#include "hashcache.h"
 #include "common/unicode/helpers.h"
 #include "common/widepath.h"
 
@@ -28,6 +29,8 @@ const char* FINDOPTIONSITEM_WHOLEWORDS_REG = "WholeWords";
 const char* FINDOPTIONSITEM_CASESENSITIVE_REG = "CaseSensitive";
 const char* FINDOPTIONSITEM_HEXMODE_REG = "HexMode";
 const char* FINDOPTIONSITEM_REGULAR_REG = "RegularExpresions";
+const char* FINDOPTIONSITEM_MULTIPLE_REG = "MultipleTexts";
+const char* FINDOPTIONSITEM_UNICODE_REG = "Unicode";
 const char* FINDOPTIONSITEM_AUTOLOAD_REG = "AutoLoad";
 const char* FINDOPTIONSITEM_NAMED_REG = "Named";
 const char* FINDOPTIONSITEM_LOOKIN_REG = "LookIn";
@@ -131,6 +134,8 @@ CFindOptionsItem::CFindOptionsItem()
     CaseSensitive = FALSE;
     HexMode = FALSE;
     RegularExpresions = FALSE;
+    MultipleTexts = FALSE;
+    Unicode = FALSE; // the extra pass is about 20x slower than CSearchData (salbench find), see the help
 
     AutoLoad = FALSE;
 
@@ -153,6 +158,8 @@ CFindOptionsItem::operator=(const CFindOptionsItem& s)
     CaseSensitive = s.CaseSensitive;
     HexMode = s.HexMode;
     RegularExpresions = s.RegularExpresions;
+    MultipleTexts = s.MultipleTexts;
+    Unicode = s.Unicode;
 
     AutoLoad = s.AutoLoad;
 
@@ -187,6 +194,10 @@ BOOL CFindOptionsItem::Save(HKEY hKey)
         SetValue(hKey, FINDOPTIONSITEM_HEXMODE_REG, REG_DWORD, &HexMode, sizeof(DWORD));
     if (RegularExpresions != def.RegularExpresions)
         SetValue(hKey, FINDOPTIONSITEM_REGULAR_REG, REG_DWORD, &RegularExpresions, sizeof(DWORD));
+    if (MultipleTexts != def.MultipleTexts)
+        SetValue(hKey, FINDOPTIONSITEM_MULTIPLE_REG, REG_DWORD, &MultipleTexts, sizeof(DWORD));
+    if (Unicode != def.Unicode)
+        SetValue(hKey, FINDOPTIONSITEM_UNICODE_REG, REG_DWORD, &Unicode, sizeof(DWORD));
     if (AutoLoad != def.AutoLoad)
         SetValue(hKey, FINDOPTIONSITEM_AUTOLOAD_REG, REG_DWORD, &AutoLoad, sizeof(DWORD));
     if (strcmp(NamedText, def.NamedText) != 0)
@@ -209,6 +220,8 @@ BOOL CFindOptionsItem::Load(HKEY hKey, DWORD cfgVersion)
     GetValue(hKey, FINDOPTIONSITEM_CASESENSITIVE_REG, REG_DWORD, &CaseSensitive, sizeof(DWORD));
     GetValue(hKey, FINDOPTIONSITEM_HEXMODE_REG, REG_DWORD, &HexMode, sizeof(DWORD));
     GetValue(hKey, FINDOPTIONSITEM_REGULAR_REG, REG_DWORD, &RegularExpresions, sizeof(DWORD));
+    GetValue(hKey, FINDOPTIONSITEM_MULTIPLE_REG, REG_DWORD, &MultipleTexts, sizeof(DWORD));
+    GetValue(hKey, FINDOPTIONSITEM_UNICODE_REG, REG_DWORD, &Unicode, sizeof(DWORD));
     GetValue(hKey, FINDOPTIONSITEM_AUTOLOAD_REG, REG_DWORD, &AutoLoad, sizeof(DWORD));
     GetValue(hKey, FINDOPTIONSITEM_NAMED_REG, REG_SZ, NamedText, NamedText.Size());
     GetValue(hKey, FINDOPTIONSITEM_LOOKIN_REG, REG_SZ, LookInText, LookInText.Size());
@@ -820,6 +833,16 @@ BOOL CDuplicateCandidates::GetMD5Digest(CGrepData* data, CFoundFilesData* file,
                                         NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
     if (hFile != INVALID_HANDLE_VALUE)
     {
+        // if the file did not change since its digest was computed last time, we don't need to read it
+        CHashCacheKey key;
+        BOOL haveKey = HashCache.GetKey(hFile, &key);
+        if (haveKey && HashCache.Find(&key, (BYTE*)file->Group))
+        {
+            HANDLES(CloseHandle(hFile));
+            *readSize += file->Size; // progress is updated together with the next file being read
+            return TRUE;
+        }
+
         BYTE buffer[DUPLICATES_BUFFER_SIZE];
         MD5 context;
         DWORD read; // number of bytes that were actually read
@@ -876,6 +899,8 @@ BOOL CDuplicateCandidates::GetMD5Digest(CGrepData* data, CFoundFilesData* file,
 
         context.finalize();
         memcpy((BYTE*)file->Group, context.digest, MD5_DIGEST_SIZE);
+        if (haveKey)
+            HashCache.Add(&key, context.digest);
 
         return TRUE;
     }
@@ -1168,30 +1193,356 @@ int SearchForward(CGrepData* data, char* txt, int size, int off)
     return -1;
 }
 
+// transcoded texts: maximum length of a character in bytes (UTF-8), views of the file overlap
+// by it twice so that characters around a text found at the view border can be decoded
+#define GREP_ENCODING_CONTEXT 4
+
+// returns TRUE if 't1' and 't2' are equal; ignores case the same way as CSearchData and
+// CMultiSearchData (byte by byte) when 'caseSensitive' is FALSE
+static BOOL EqualSearchedTexts(const std::string& t1, const std::string& t2, BOOL caseSensitive)
+{
+    if (t1.length() != t2.length())
+        return FALSE;
+    size_t k;
+    for (k = 0; k < t1.length(); k++)
+    {
+        BYTE c1 = (BYTE)t1[k];
+        BYTE c2 = (BYTE)t2[k];
+        if (caseSensitive ? c1 != c2 : LowerCase[c1] != LowerCase[c2])
+            return FALSE;
+    }
+    return TRUE;
+}
+
+// adds 'encoded' (the text 'wide' in 'encoding') to 'texts' unless it is empty, too long, equal
+// to 'ansi' (found by CSearchData) or to an already added text in the same encoding
+static void AddEncodedText(CGrepData* data, std::vector<std::string>& texts, const std::string& encoded,
+                           const std::wstring& wide, CGrepTextEncoding encoding, const std::string& ansi,
+                           BOOL caseSensitive)
+{
+    if (encoded.empty() || encoded.length() > MULTISEARCH_MAX_TEXT_LEN ||
+        texts.size() >= GREP_MAX_ENCODED_TEXTS || EqualSearchedTexts(encoded, ansi, caseSensitive))
+    {
+        return;
+    }
+    size_t i;
+    for (i = 0; i < texts.size(); i++)
+    {
+        if (data->EncodingOf[i] == encoding && EqualSearchedTexts(texts[i], encoded, caseSensitive))
+            return; // already searched
+    }
+    data->EncodingOf[texts.size()] = (BYTE)encoding;
+    std::wstring& lower = data->EncodedLower[texts.size()];
+    lower = wide;
+    if (!lower.empty())
+        CharLowerBuffW(&lower[0], (DWORD)lower.length());
+    texts.push_back(encoded);
+}
+
+static std::string WideToUTF8(const std::wstring& text)
+{
+    std::string out;
+    int len = WideCharToMultiByte(CP_UTF8, 0, text.c_str(), (int)text.length(), NULL, 0, NULL, NULL);
+    if (len > 0)
+    {
+        out.resize(len);
+        WideCharToMultiByte(CP_UTF8, 0, text.c_str(), (int)text.length(), &out[0], len, NULL, NULL);
+    }
+    return out;
+}
+
+// returns 'text' with precomposed characters split to base characters and combining marks
+// (e.g. UTF-8 files written on macOS)
+static std::wstring DecomposeText(const std::wstring& text)
+{
+    std::wstring out;
+    int len = FoldStringW(MAP_COMPOSITE, text.c_str(), (int)text.length(), NULL, 0);
+    if (len > 0)
+    {
+        out.resize(len);
+        FoldStringW(MAP_COMPOSITE, text.c_str(), (int)text.length(), &out[0], len);
+    }
+    return out;
+}
+
+static std::string WideToUTF16(const std::wstring& text, BOOL bigEndian)
+{
+    std::string out((const char*)text.c_str(), text.length() * sizeof(WCHAR));
+    if (bigEndian)
+    {
+        size_t i;
+        for (i = 0; i + 1 < out.length(); i += 2)
+            std::swap(out[i], out[i + 1]);
+    }
+    return out;
+}
+
+BOOL SetEncodedTexts(CGrepData* data, const char* text, WORD flags)
+{
+    BOOL caseSensitive = (flags & sfCaseSensitive) != 0;
+    std::string ansi = text;
+    std::vector<std::string> texts;
+
+    std::wstring forms[3];
+    int formsCount = 0;
+    forms[formsCount++] = AnsiToWide(text);
+    if (!caseSensitive && !forms[0].empty())
+    { // the automaton ignores case only of bytes (ANSI characters), non-ASCII characters
+        // in UTF-8 and UTF-16 are found at least in the text written in lower or upper case;
+        // the bytes of other characters matched this way are rejected by IsEncodedTextAt
+        std::wstring lower = forms[0];
+        CharLowerBuffW(&lower[0], (DWORD)lower.length());
+        std::wstring upper = forms[0];
+        CharUpperBuffW(&upper[0], (DWORD)upper.length());
+        forms[formsCount++] = lower;
+        forms[formsCount++] = upper;
+    }
+    int i;
+    for (i = 0; i < formsCount; i++)
+    {
+        std::wstring decomposed = DecomposeText(forms[i]);
+        AddEncodedText(data, texts, WideToUTF8(forms[i]), forms[i], gteUTF8, ansi, caseSensitive);
+        AddEncodedText(data, texts, WideToUTF8(decomposed), decomposed, gteUTF8, ansi, caseSensitive);
+        AddEncodedText(data, texts, WideToUTF16(forms[i], FALSE), forms[i], gteUTF16LE, ansi, caseSensitive);
+        AddEncodedText(data, texts, WideToUTF16(forms[i], TRUE), forms[i], gteUTF16BE, ansi, caseSensitive);
+    }
+    if (texts.empty())
+    {
+        data->Unicode = FALSE; // no other encoding differs from the text (or fits), CSearchData is enough
+        return TRUE;
+    }
+    return data->EncodedTexts.SetTexts(texts, flags);
+}
+
+// returns TRUE if the 'index'-th text of data->EncodedTexts found at 'pos' (IsAt returned TRUE)
+// is the searched text; the automaton ignores case byte by byte by the ANSI code page, so it also
+// matches parts of other characters (e.g. UTF-8 "\xC3\x8A" and "\xC3\x9A" in cp1252), the found
+// characters are therefore compared with the text in lower case
+static BOOL IsEncodedTextAt(CGrepData* data, const char* pos, int index)
+{
+    if (data->EncodedTexts.GetFlags() & sfCaseSensitive)
+        return TRUE; // the bytes are equal
+    int len = data->EncodedTexts.GetPatternLength(index);
+    WCHAR found[MULTISEARCH_MAX_TEXT_LEN];
+    int foundLen;
+    const BYTE* c = (const BYTE*)pos;
+    switch (data->EncodingOf[index])
+    {
+    case gteUTF16LE:
+    case gteUTF16BE:
+    {
+        foundLen = len / 2;
+        int i;
+        for (i = 0; i < foundLen; i++, c += 2)
+        {
+            found[i] = data->EncodingOf[index] == gteUTF16LE ? (WCHAR)(c[0] | (c[1] << 8))
+                                                             : (WCHAR)((c[0] << 8) | c[1]);
+        }
+        break;
+    }
+
+    default: // gteUTF8
+    {
+        foundLen = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, pos, len, found, MULTISEARCH_MAX_TEXT_LEN);
+        if (foundLen == 0)
+            return FALSE; // invalid sequence
+        break;
+    }
+    }
+    const std::wstring& lower = data->EncodedLower[index];
+    if (foundLen != (int)lower.length())
+        return FALSE;
+    CharLowerBuffW(found, foundLen);
+    return wmemcmp(found, lower.c_str(), foundLen) == 0;
+}
+
+// searches for any text from data->EncodedTexts, see SearchForward; returns the position of
+// the leftmost occurrence
+int SearchEncodedForward(CGrepData* data, char* txt, int size, int off)
+{
+    if (size < 0)
+        return -1;
+    int minLen = data->EncodedTexts.GetMinLength();
+    int maxLen = data->EncodedTexts.GetMaxLength();
+    int curOff = off, curSize = min(SEARCH_SIZE, size - curOff);
+    int foundLen;
+    while (!data->StopSearch && curSize >= minLen)
+    {
+        int found = data->EncodedTexts.SearchForward(txt + curOff, curSize, 0, foundLen);
+        // an occurrence near the end of the part may hide a longer text starting before it
+        // and continuing behind the part, such occurrence is found in the next part
+        if (found != -1 && (found + maxLen <= curSize || curOff + curSize >= size))
+            return curOff + found;
+        if (curOff + curSize >= size)
+            break; // not found
+        curOff += curSize - maxLen + 1;
+        curSize = min(SEARCH_SIZE, size - curOff);
+    }
+    return -1;
+}
+
+// returns TRUE if the character in 'encoding' is '_', a letter or a digit; the character ends at
+// 'pos' if 'before' is TRUE, otherwise it starts at 'pos'; 'beg' and 'end' limit the text
+static BOOL IsWordCharacter(const char* beg, const char* end, const char* pos, BOOL before, int encoding)
+{
+    switch (encoding)
+    {
+    case gteUTF16LE:
+    case gteUTF16BE:
+    {
+        const BYTE* c = (const BYTE*)(before ? pos - 2 : pos);
+        if (c < (const BYTE*)beg || c + 2 > (const BYTE*)end)
+            return FALSE; // incomplete character
+        WCHAR w = encoding == gteUTF16LE ? (WCHAR)(c[0] | (c[1] << 8)) : (WCHAR)((c[0] << 8) | c[1]);
+        return w == L'_' || IsCharAlphaNumericW(w);
+    }
+
+    case gteUTF8:
+    {
+        const char* s = pos;
+        const char* e = pos;
+        if (before)
+        {
+            do
+            {
+                s--;
+            } while (s > beg && pos - s < GREP_ENCODING_CONTEXT && (*s & 0xC0) == 0x80); // continuation bytes
+        }
+        else
+        {
+            do
+            {
+                e++;
+            } while (e < end && e - pos < GREP_ENCODING_CONTEXT && (*e & 0xC0) == 0x80);
+        }
+        WCHAR w[2];
+        if (MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, s, (int)(e - s), w, 2) != 1)
+            return FALSE; // invalid sequence or a character outside BMP
+        return w[0] == L'_' || IsCharAlphaNumericW(w[0]);
+    }
+
+    default: // gteANSI
+    {
+        BYTE c = (BYTE)*(before ? pos - 1 : pos);
+        return c == '_' || !IsNotAlphaNorNum[c];
+    }
+    }
+}
+
+// returns TRUE if the text of 'len' bytes in 'encoding' found at 'off' in the view 'txt' is
+// a whole word; 'fileStart' and 'fileEnd' are TRUE if the view starts or ends with the file;
+// a character around the text which does not fit in the view is tested in the neighbouring
+// view (views overlap), so FALSE is returned
+static BOOL IsWholeWord(const char* txt, DWORD viewSize, int off, int len, int encoding,
+                        BOOL fileStart, BOOL fileEnd)
+{
+    int context = encoding == gteUTF8 ? GREP_ENCODING_CONTEXT : encoding == gteANSI ? 1 : 2;
+    if (off > 0 || !fileStart) // not at the beginning of the file
+    {
+        if (off < context && !fileStart ||
+            IsWordCharacter(txt, txt + viewSize, txt + off, TRUE, encoding))
+        {
+            return FALSE;
+        }
+    }
+    int rest = (int)viewSize - (off + len);
+    if (rest > 0 || !fileEnd) // not at the end of the file
+    {
+        if (rest < context && !fileEnd ||
+            IsWordCharacter(txt, txt + viewSize, txt + off + len, FALSE, encoding))
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+// returns the beginning of the line containing 'pos', lines are split by the same rules as in
+// TestFileContentAux; does not go before 'beg' (beginning of a line), 'totalEnd' is the end of the view
+char* FindLineBeginning(char* beg, char* pos, char* totalEnd, BOOL EOL_CR, BOOL EOL_LF, BOOL EOL_CRLF)
+{
+    while (pos > beg)
+    {
+        char c = *(pos - 1);
+        if (c > '\r')
+        {
+            pos--;
+            continue;
+        }
+        if (c == 0)
+            break;
+        if (c == '\n' && (EOL_LF || EOL_CRLF && pos - 1 > beg && *(pos - 2) == '\r'))
+            break;
+        if (c == '\r' && EOL_CR && (!EOL_CRLF || pos < totalEnd && *pos != '\n'))
+            break; // CR at the end of the view may start CRLF, the line continues
+        pos--;
+    }
+    return pos;
+}
+
 //
 // ****************************************************************************
 
 BOOL TestFileContentAux(BOOL& ok, CQuadWord& fileOffset, const CQuadWord& totalSize,
-                        DWORD viewSize, const char* path, char* txt, CGrepData* data)
+                        DWORD viewSize, const char* path, char* txt, CGrepData* data,
+                        CLinearRegExp* regExp, CMultiSearchState* multiState)
 {
     __try
     {
-        if (data->Regular)
+        if (data->Multiple)
+        {
+            // the automaton continues from the state reached in the previous view of the file,
+            // so views need not overlap; the file is searched until all texts are found
+            BOOL all = FALSE;
+            DWORD off = 0;
+            while (!all && !data->StopSearch && off < viewSize)
+            {
+                DWORD size = min(viewSize - off, (DWORD)SEARCH_SIZE);
+                all = data->MultiSearchData.SearchAll(txt + off, (int)size, *multiState);
+                off += size;
+            }
+            fileOffset += CQuadWord(viewSize, 0);
+            if (all || fileOffset >= totalSize)
+                ok = multiState->FoundCount > 0;
+        }
+        else if (data->Regular)
         {
-            char *beg, *end, *nextBeg, *totalEnd, *endLimit;
+            // lines are not limited in length: a line continuing into the next view of the file
+            // is passed to the expression by parts (it keeps its state, see CLinearRegExp::MatchLine)
+            char *beg, *end, *nextBeg, *totalEnd;
             //      BOOL EOL_NULL = TRUE;
             BOOL EOL_CR = data->EOL_CR;
             BOOL EOL_LF = data->EOL_LF;
             BOOL EOL_CRLF = data->EOL_CRLF;
+            BOOL fileEnd = fileOffset + CQuadWord(viewSize, 0) >= totalSize; // the end of the file is in the file view
             beg = txt;
             totalEnd = txt + viewSize;
 
             while (!data->StopSearch && beg < totalEnd)
             {
+                if (!regExp->IsInLine() && regExp->HasRequiredText())
+                { // lines without the text required by every match are skipped
+                    int found = regExp->SearchRequiredText(beg, (int)(totalEnd - beg), 0);
+                    char* lineBeg = FindLineBeginning(beg, found != -1 ? beg + found : totalEnd, totalEnd,
+                                                      EOL_CR, EOL_LF, EOL_CRLF);
+                    if (found == -1)
+                    {
+                        if (fileEnd)
+                        {
+                            beg = totalEnd; // no other line can match
+                            break;
+                        }
+                        if (lineBeg > txt)
+                        { // the last line can continue in the next view segment, start the segment with it
+                            fileOffset += CQuadWord(DWORD(lineBeg - txt), 0);
+                            return TRUE; // continue with the next view segment
+                        }
+                        // the line fills the whole view segment, it is tested by parts
+                    }
+                    beg = lineBeg;
+                }
+
                 end = beg;
-                endLimit = beg + GREP_LINE_LEN;
-                if (endLimit > totalEnd)
-                    endLimit = totalEnd;
                 nextBeg = NULL;
                 do
                 {
@@ -1209,9 +1560,9 @@ BOOL TestFileContentAux(BOOL& ok, CQuadWord& fileOffset, const CQuadWord& totalS
                             else
                             {
                                 if (EOL_CR &&
-                                    (end + 1 < totalEnd ||                              // it was able to test that there is no LF there
-                                     !EOL_CRLF ||                                       // LF should not be considered an EOL
-                                     fileOffset + CQuadWord(viewSize, 0) >= totalSize)) // it is the end of the file
+                                    (end + 1 < totalEnd || // it was able to test that there is no LF there
+                                     !EOL_CRLF ||          // LF should not be considered an EOL
+                                     fileEnd))             // it is the end of the file
                                 {
                                     nextBeg = end + 1;
                                     break;
@@ -1228,55 +1579,28 @@ BOOL TestFileContentAux(BOOL& ok, CQuadWord& fileOffset, const CQuadWord& totalS
                         }
                         end++;
                     }
-                } while (end < endLimit);
+                } while (end < totalEnd);
                 if (nextBeg == NULL)
                     nextBeg = end;
 
-                if (end == endLimit &&                               // if no line ending character was found
-                    fileOffset + CQuadWord(viewSize, 0) < totalSize) // the end of the file is not in the file view
-                {                                                    // the line can continue beyond the boundary of the current view of the file
-                    fileOffset += CQuadWord(DWORD(beg - txt), 0);
+                if (end == totalEnd && !fileEnd) // no line ending character was found and the end of the file is not in the view
+                {                                // the line continues in the next view segment
+                    if (*(end - 1) == '\r' && EOL_CRLF && end - 1 > txt)
+                        end--; // CR may start CRLF, it is tested again in the next view segment
+                    if (regExp->MatchLine(beg, (int)(end - beg), FALSE))
+                    {
+                        ok = TRUE; // found
+                        break;
+                    }
+                    fileOffset += CQuadWord(DWORD(end - txt), 0);
                     return TRUE; // continue with the next view segment
                 }
 
                 // line beg->end
-                if (data->RegExp.SetLine(beg, end))
-                {
-                    int foundLen, start = 0;
-
-                GREP_REGEXP_NEXT:
-
-                    int found = data->RegExp.SearchForward(start, foundLen);
-                    if (found != -1)
-                    {
-                        if (data->WholeWords)
-                        {
-                            if ((found == 0 || *(beg + found - 1) != '_' && IsNotAlphaNorNum[*(beg + found - 1)]) &&
-                                (found + foundLen == (end - beg) ||
-                                 *(beg + found + foundLen) != '_' && IsNotAlphaNorNum[*(beg + found + foundLen)]))
-                            {
-                                ok = TRUE; // found
-                                break;
-                            }
-                            start = found + 1;
-                            if (start < end - beg)
-                                goto GREP_REGEXP_NEXT;
-                        }
-                        else
-                        {
-                            ok = TRUE; // found
-                            break;
-                        }
-                    }
-                }
-                else
+                if (regExp->MatchLine(beg, (int)(end - beg), TRUE))
                 {
-                    FIND_LOG_ITEM log;
-                    log.Flags = FLI_ERROR;
-                    log.Text = data->RegExp.GetLastErrorText();
-                    log.Path = NULL;
-                    SendMessage(data->HWindow, WM_USER_ADDLOG, (WPARAM)&log, 0);
-                    return FALSE; // do not search this file further
+                    ok = TRUE; // found
+                    break;
                 }
 
                 beg = nextBeg;
@@ -1285,6 +1609,58 @@ BOOL TestFileContentAux(BOOL& ok, CQuadWord& fileOffset, const CQuadWord& totalS
             if (beg >= totalEnd)
                 fileOffset += CQuadWord(viewSize, 0); // advance the offset to continue searching
         }
+        else if (data->Unicode)
+        {
+            // the text as typed is searched by CSearchData, its other encodings all at once by
+            // data->EncodedTexts; a whole word is tested by characters in the encoding of the found
+            // variant of the text
+            BOOL fileStart = fileOffset == CQuadWord(0, 0);
+            BOOL fileEnd = fileOffset + CQuadWord(viewSize, 0) >= totalSize;
+            int off = 0;
+            while (1)
+            {
+                off = SearchForward(data, txt, viewSize, off);
+                if (off == -1)
+                    break; // not found or terminated
+                if (!data->WholeWords ||
+                    IsWholeWord(txt, viewSize, off, data->SearchData.GetLength(), gteANSI, fileStart, fileEnd))
+                {
+                    ok = TRUE; // found
+                    break;
+                }
+                off++;
+            }
+            off = 0;
+            while (!ok)
+            {
+                off = SearchEncodedForward(data, txt, viewSize, off);
+                if (off == -1)
+                    break; // not found or terminated
+                // more variants can start here (e.g. UTF-8 with precomposed and decomposed characters)
+                int i;
+                for (i = 0; i < data->EncodedTexts.GetCount(); i++)
+                {
+                    if (data->EncodedTexts.IsAt(txt + off, (int)viewSize - off, i) &&
+                        IsEncodedTextAt(data, txt + off, i) &&
+                        (!data->WholeWords ||
+                         IsWholeWord(txt, viewSize, off, data->EncodedTexts.GetPatternLength(i),
+                                     data->EncodingOf[i], fileStart, fileEnd)))
+                    {
+                        ok = TRUE; // found
+                        break;
+                    }
+                }
+                off++;
+            }
+            if (!ok && !data->StopSearch) // not found and not interrupted
+            {
+                DWORD overlap = (DWORD)(data->EncodedTexts.GetMaxLength() + 2 * GREP_ENCODING_CONTEXT - 1);
+                if (!fileEnd && overlap < viewSize)
+                    fileOffset += CQuadWord(viewSize - overlap, 0);
+                else
+                    fileOffset = totalSize; // the text cannot be in the file anymore
+            }
+        }
         else
         {
             int off = 0;
@@ -1342,7 +1718,11 @@ BOOL TestFileContentAux(BOOL& ok, CQuadWord& fileOffset, const CQuadWord& totalS
     }
 }
 
-BOOL TestFileContent(DWORD sizeLow, DWORD sizeHigh, const char* path, CGrepData* data, BOOL isLink)
+// 'regExp' is used for searching regular expressions and 'multiState' for searching more texts
+// at once (each thread needs its own, see CGrepContentPool); found texts are then returned
+// by GetFoundTexts
+BOOL TestFileContent(DWORD sizeLow, DWORD sizeHigh, const char* path, CGrepData* data, BOOL isLink,
+                     CLinearRegExp* regExp, CMultiSearchState* multiState)
 {
     CQuadWord totalSize(sizeLow, sizeHigh);
     CQuadWord fileOffset(0, 0);
@@ -1351,6 +1731,10 @@ BOOL TestFileContent(DWORD sizeLow, DWORD sizeHigh, const char* path, CGrepData*
     BOOL ok = FALSE;
     if (totalSize > CQuadWord(0, 0) || isLink)
     {
+        if (data->Multiple)
+            multiState->Reset(data->MultiSearchData.GetCount());
+        if (data->Regular)
+            regExp->ResetLine(); // the file starts with a new line
         DWORD err = ERROR_SUCCESS;
         data->SearchingText->Set(path); // set the current file
         HANDLE hFile = HANDLES_Q(CreateFileW(AnsiToWide(path).c_str(), GENERIC_READ,
@@ -1390,7 +1774,7 @@ BOOL TestFileContent(DWORD sizeLow, DWORD sizeHigh, const char* path, CGrepData*
                             // let the file view be examined
                             DWORD diff = (DWORD)(fileOffset - mapFileOffset).Value;
                             BOOL err2 = !TestFileContentAux(ok, fileOffset, totalSize, viewSize - diff,
-                                                            path, txt + diff, data);
+                                                            path, txt + diff, data, regExp, multiState);
                             HANDLES(UnmapViewOfFile(txt));
                             if (err2 || ok)
                                 break;
@@ -1427,9 +1811,28 @@ BOOL TestFileContent(DWORD sizeLow, DWORD sizeHigh, const char* path, CGrepData*
     return ok;
 }
 
+// returns texts found by TestFileContent when searching for more texts at once
+// (separated by MULTISEARCH_SEPARATOR)
+void GetFoundTexts(CGrepData* data, const CMultiSearchState* multiState, std::string& foundTexts)
+{
+    foundTexts.clear();
+    int count = data->MultiSearchData.GetCount();
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        if (multiState->Found[i])
+        {
+            if (!foundTexts.empty())
+                foundTexts += MULTISEARCH_SEPARATOR;
+            foundTexts += data->MultiSearchData.GetPattern(i);
+        }
+    }
+}
+
+// 'foundTexts' (may be NULL) are texts found in the file when searching for more texts at once
 BOOL AddFoundItem(const char* path, const char* name, DWORD sizeLow, DWORD sizeHigh,
                   DWORD attr, const FILETIME* lastWrite, BOOL isDir, CGrepData* data,
-                  CDuplicateCandidates* duplicateCandidates)
+                  CDuplicateCandidates* duplicateCandidates, const char* foundTexts)
 {
     if (duplicateCandidates != NULL && isDir) // directories are irrelevant to us when searching for duplicates
         return TRUE;
@@ -1442,6 +1845,8 @@ BOOL AddFoundItem(const char* path, const char* name, DWORD sizeLow, DWORD sizeH
                                    attr, lastWrite, isDir);
         if (good)
         {
+            if (foundTexts != NULL)
+                foundData->FoundTexts = foundTexts;
             if (duplicateCandidates == NULL)
             {
                 // duplicateCandidates == NULL, adding the item to data->FoundFilesListView
@@ -1499,6 +1904,351 @@ BOOL AddFoundItem(const char* path, const char* name, DWORD sizeLow, DWORD sizeH
     return TRUE;
 }
 
+//
+// ****************************************************************************
+// CGrepContentPool
+//
+// tests contents of files on several threads at once: SearchDirectory (grep thread) only
+// enumerates directories and submits files matching the other criteria, pool threads
+// call TestFileContent and the grep thread adds the files containing the searched text
+// by AddFoundItem (so found files and duplicate candidates are still filled from one thread);
+// at most GREP_POOL_QUEUE_SIZE files are submitted and not yet added, if the queue is full,
+// the grep thread waits for the oldest ones; with CGrepData::KeepResultsOrder the found files
+// are added in the order of searching (the same as when testing on the grep thread),
+// otherwise as soon as their test is finished
+
+#define GREP_POOL_MAX_THREADS 8  // upper limit for the number of pool threads
+#define GREP_POOL_QUEUE_SIZE 256 // maximum number of submitted and not yet added files
+
+struct CGrepPoolItem
+{
+    char* FullName; // full name of the file (allocated together with Dir)
+    char* Dir;      // path for AddFoundItem (points behind FullName)
+    char* Name;     // file name (points into FullName)
+    DWORD SizeLow;
+    DWORD SizeHigh;
+    DWORD Attr;
+    FILETIME LastWrite;
+    BOOL Tested;            // TRUE = the test is finished (set by a pool thread)
+    BOOL Found;             // TRUE = the file contains the searched text
+    BOOL Reported;          // TRUE = the file was already passed to AddFoundItem
+    std::string FoundTexts; // texts found in the file when searching for more texts at once
+};
+
+class CGrepContentPool
+{
+protected:
+    CGrepData* Data;
+    CDuplicateCandidates* DuplicateCandidates;
+
+    CGrepPoolItem Items[GREP_POOL_QUEUE_SIZE]; // submitted files (ring buffer)
+    int Submitted;                             // number of submitted files
+    int Taken;                                 // number of files taken by pool threads (protected by CS)
+    int Finished;                              // number of files removed from the queue
+    volatile LONG TestedCount;                 // number of finished tests (InterlockedIncrement)
+    LONG LastTestedCount;                      // TestedCount at the last AddTested() call
+
+    CRITICAL_SECTION CS;     // protects Taken, Tested and Found
+    HANDLE WorkReady;        // semaphore: number of submitted files not taken by pool threads
+    HANDLE ItemTested;       // event (auto-reset): a pool thread finished a test
+    volatile BOOL Terminate; // TRUE = pool threads should finish
+
+    HANDLE Threads[GREP_POOL_MAX_THREADS];
+    CLinearRegExp* RegExps[GREP_POOL_MAX_THREADS]; // own expression for each thread (it holds the DFA and the state of the line)
+    int ThreadsCount;
+    volatile LONG StartedThreads; // for assigning RegExps to threads (InterlockedIncrement)
+
+public:
+    CGrepContentPool();
+    ~CGrepContentPool();
+
+    // starts pool threads; returns FALSE if the pool cannot be used (files are then tested
+    // directly by TestFileContent)
+    BOOL Start(CGrepData* data, CDuplicateCandidates* duplicateCandidates);
+
+    // submits file 'name' from directory 'path' ('end' points behind the backslash of the
+    // directory, the same as in SearchDirectory); returns FALSE if the file has to be tested directly
+    BOOL Submit(const char* path, const char* end, const char* name, const WIN32_FIND_DATAW* file);
+
+    // adds found files whose test is finished (see CGrepData::KeepResultsOrder); if 'wait' is
+    // TRUE, waits until all submitted files are tested
+    void AddTested(BOOL wait);
+
+    // stops pool threads, files which were not added yet are dropped
+    void Stop();
+
+protected:
+    void ThreadBody(CLinearRegExp* regExp);
+
+    static unsigned ThreadFBody(void* param);
+    static unsigned ThreadFEH(void* param);
+    static DWORD WINAPI ThreadF(void* param);
+};
+
+CGrepContentPool::CGrepContentPool()
+{
+    HANDLES(InitializeCriticalSection(&CS));
+    Data = NULL;
+    DuplicateCandidates = NULL;
+    memset(Items, 0, sizeof(Items));
+    Submitted = Taken = Finished = 0;
+    TestedCount = LastTestedCount = 0;
+    WorkReady = NULL;
+    ItemTested = NULL;
+    Terminate = FALSE;
+    ThreadsCount = 0;
+    StartedThreads = 0;
+    memset(RegExps, 0, sizeof(RegExps));
+}
+
+CGrepContentPool::~CGrepContentPool()
+{
+    Stop();
+    HANDLES(DeleteCriticalSection(&CS));
+}
+
+BOOL CGrepContentPool::Start(CGrepData* data, CDuplicateCandidates* duplicateCandidates)
+{
+    CALL_STACK_MESSAGE1("CGrepContentPool::Start()");
+    Data = data;
+    DuplicateCandidates = duplicateCandidates;
+
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    int maxThreads = min((int)si.dwNumberOfProcessors, GREP_POOL_MAX_THREADS);
+    if (maxThreads < 2)
+        return FALSE; // one CPU, testing on the grep thread is good enough
+
+    WorkReady = HANDLES(CreateSemaphore(NULL, 0, 0x7FFFFFFF, NULL));
+    ItemTested = HANDLES(CreateEvent(NULL, FALSE, FALSE, NULL));
+    if (WorkReady == NULL || ItemTested == NULL)
+    {
+        TRACE_E("CGrepContentPool::Start(): unable to create semaphore or event.");
+        Stop();
+        return FALSE;
+    }
+    while (ThreadsCount < maxThreads)
+    {
+        if (Data->Regular) // expressions are compiled here, the pool threads only search
+        {
+            CLinearRegExp* regExp = new CLinearRegExp;
+            if (regExp == NULL || !regExp->Set(Data->RegExp.GetPattern(), Data->RegExp.GetFlags()))
+            {
+                if (regExp == NULL)
+                    TRACE_E(LOW_MEMORY);
+                delete regExp;
+                break;
+            }
+            RegExps[ThreadsCount] = regExp;
+        }
+        DWORD threadID;
+        HANDLE thread = HANDLES(CreateThread(NULL, 0, ThreadF, this, 0, &threadID));
+        if (thread == NULL)
+        {
+            TRACE_E("CGrepContentPool::Start(): unable to start content search thread.");
+            delete RegExps[ThreadsCount];
+            RegExps[ThreadsCount] = NULL;
+            break;
+        }
+        Threads[ThreadsCount++] = thread;
+    }
+    if (ThreadsCount == 0)
+    {
+        Stop();
+        return FALSE;
+    }
+    return TRUE;
+}
+
+BOOL CGrepContentPool::Submit(const char* path, const char* end, const char* name, const WIN32_FIND_DATAW* file)
+{
+    while (Submitted - Finished >= GREP_POOL_QUEUE_SIZE) // the queue is full, wait for the oldest files
+    {
+        AddTested(FALSE);
+        if (Submitted - Finished < GREP_POOL_QUEUE_SIZE)
+            break;
+        WaitForSingleObject(ItemTested, 100);
+    }
+
+    // FullName is "path\name", Dir is the path without the trailing backslash (except root)
+    int dirLen = (int)(end - path);
+    int nameLen = (int)strlen(name);
+    int pathLen = dirLen > 3 ? dirLen - 1 : dirLen;
+    char* buf = (char*)malloc(dirLen + nameLen + 1 + pathLen + 1);
+    if (buf == NULL)
+    {
+        TRACE_E(LOW_MEMORY);
+        return FALSE;
+    }
+    CGrepPoolItem* item = &Items[Submitted % GREP_POOL_QUEUE_SIZE];
+    item->FullName = buf;
+    memcpy(buf, path, dirLen);
+    memcpy(buf + dirLen, name, nameLen + 1);
+    item->Name = buf + dirLen;
+    item->Dir = buf + dirLen + nameLen + 1;
+    memcpy(item->Dir, path, pathLen);
+    item->Dir[pathLen] = 0;
+    item->SizeLow = file->nFileSizeLow;
+    item->SizeHigh = file->nFileSizeHigh;
+    item->Attr = file->dwFileAttributes;
+    item->LastWrite = file->ftLastWriteTime;
+    item->Tested = FALSE;
+    item->Found = FALSE;
+    item->Reported = FALSE;
+    item->FoundTexts.clear();
+    Submitted++;
+    ReleaseSemaphore(WorkReady, 1, NULL);
+
+    AddTested(FALSE);
+    return TRUE;
+}
+
+void CGrepContentPool::AddTested(BOOL wait)
+{
+    while (1)
+    {
+        LONG testedCount = TestedCount;
+        if (testedCount != LastTestedCount) // something was tested since the last call
+        {
+            LastTestedCount = testedCount;
+            int i;
+            for (i = Finished; i < Submitted; i++)
+            {
+                CGrepPoolItem* item = &Items[i % GREP_POOL_QUEUE_SIZE];
+                HANDLES(EnterCriticalSection(&CS));
+                BOOL tested = item->Tested;
+                HANDLES(LeaveCriticalSection(&CS));
+                if (!tested)
+                {
+                    if (Data->KeepResultsOrder)
+                        break; // the following files must wait for this one
+                    continue;
+                }
+                if (item->Found && !item->Reported && !Data->StopSearch)
+                {
+                    AddFoundItem(item->Dir, item->Name, item->SizeLow, item->SizeHigh, item->Attr,
+                                 &item->LastWrite, FALSE, Data, DuplicateCandidates,
+                                 Data->Multiple ? item->FoundTexts.c_str() : NULL);
+                }
+                item->Reported = TRUE;
+                if (i == Finished) // the oldest file, remove it from the queue
+                {
+                    free(item->FullName);
+                    item->FullName = NULL;
+                    Finished++;
+                }
+            }
+        }
+        if (!wait || Finished == Submitted || Data->StopSearch)
+            break;
+        WaitForSingleObject(ItemTested, 100);
+    }
+}
+
+void CGrepContentPool::Stop()
+{
+    CALL_STACK_MESSAGE1("CGrepContentPool::Stop()");
+    if (ThreadsCount > 0)
+    {
+        Terminate = TRUE;
+        ReleaseSemaphore(WorkReady, ThreadsCount, NULL);
+        // pool threads send WM_USER_ADDLOG to the Find dialog, which processes messages while waiting for us
+        WaitForMultipleObjects(ThreadsCount, Threads, TRUE, INFINITE);
+        while (ThreadsCount > 0)
+        {
+            ThreadsCount--;
+            HANDLES(CloseHandle(Threads[ThreadsCount]));
+            delete RegExps[ThreadsCount];
+            RegExps[ThreadsCount] = NULL;
+        }
+    }
+    for (; Finished < Submitted; Finished++)
+    {
+        CGrepPoolItem* item = &Items[Finished % GREP_POOL_QUEUE_SIZE];
+        free(item->FullName);
+        item->FullName = NULL;
+    }
+    if (WorkReady != NULL)
+    {
+        HANDLES(CloseHandle(WorkReady));
+        WorkReady = NULL;
+    }
+    if (ItemTested != NULL)
+    {
+        HANDLES(CloseHandle(ItemTested));
+        ItemTested = NULL;
+    }
+}
+
+void CGrepContentPool::ThreadBody(CLinearRegExp* regExp)
+{
+    CMultiSearchState multiState;
+    while (1)
+    {
+        WaitForSingleObject(WorkReady, INFINITE);
+        if (Terminate)
+            break;
+        HANDLES(EnterCriticalSection(&CS));
+        CGrepPoolItem* item = &Items[Taken++ % GREP_POOL_QUEUE_SIZE];
+        HANDLES(LeaveCriticalSection(&CS));
+
+        BOOL found = FALSE;
+        if (!Data->StopSearch)
+        {
+            // links: file size is zero, TestFileContent obtains it via SalGetFileSize()
+            BOOL isLink = (item->Attr & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+            found = TestFileContent(item->SizeLow, item->SizeHigh, item->FullName, Data, isLink, regExp,
+                                    &multiState);
+            if (found && Data->Multiple)
+                GetFoundTexts(Data, &multiState, item->FoundTexts); // read by the grep thread after 'Tested' is set
+        }
+        HANDLES(EnterCriticalSection(&CS));
+        item->Found = found;
+        item->Tested = TRUE;
+        HANDLES(LeaveCriticalSection(&CS));
+        InterlockedIncrement(&TestedCount);
+        SetEvent(ItemTested);
+    }
+}
+
+unsigned CGrepContentPool::ThreadFBody(void* param)
+{
+    CALL_STACK_MESSAGE1("CGrepContentPool::ThreadFBody()");
+    SetThreadNameInVCAndTrace("GrepContent");
+    CGrepContentPool* pool = (CGrepContentPool*)param;
+    int index = (int)InterlockedIncrement(&pool->StartedThreads) - 1;
+    CLinearRegExp* regExp = pool->RegExps[index];
+    pool->ThreadBody(regExp != NULL ? regExp : &pool->Data->RegExp);
+    return 0;
+}
+
+unsigned CGrepContentPool::ThreadFEH(void* param)
+{
+#ifndef CALLSTK_DISABLE
+    __try
+    {
+#endif // CALLSTK_DISABLE
+        return ThreadFBody(param);
+#ifndef CALLSTK_DISABLE
+    }
+    __except (CCallStack::HandleException(GetExceptionInformation()))
+    {
+        TRACE_I("Thread GrepContent: calling ExitProcess(1).");
+        //    ExitProcess(1);
+        TerminateProcess(GetCurrentProcess(), 1); // harder exit (this call still performs some operations)
+        return 1;
+    }
+#endif // CALLSTK_DISABLE
+}
+
+DWORD WINAPI CGrepContentPool::ThreadF(void* param)
+{
+#ifndef CALLSTK_DISABLE
+    CCallStack stack;
+#endif // CALLSTK_DISABLE
+    return ThreadFEH(param);
+}
+
 // 'dirStack' stores directories for late grepping. Otherwise,
 // during searching in the current directory, recursive searching in subdirectories would occur. With this
 // trick all files and directories matching the criteria are found first and
@@ -1510,11 +2260,14 @@ BOOL AddFoundItem(const char* path, const char* name, DWORD sizeLow, DWORD sizeH
 // 'dirStack' is NULL.
 // If 'duplicateCandidates' != NULL, found items will be added to this array
 // instead of data->FoundFilesListView
+// If 'contentPool' != NULL, contents of files are tested by its threads and files
+// are added later by the pool; otherwise they are tested here
 void SearchDirectory(CPathBuffer& path, char* end, int startPathLen,
                      CMaskGroup* masksGroup, BOOL includeSubDirs, CGrepData* data,
                      TDirectArray<char*>* dirStack, int dirStackCount,
                      CDuplicateCandidates* duplicateCandidates,
-                     CFindIgnore* ignoreList, CPathBuffer& message)
+                     CFindIgnore* ignoreList, CPathBuffer& message,
+                     CGrepContentPool* contentPool)
 {
     SLOW_CALL_STACK_MESSAGE6("SearchDirectory(%s, , %d, %s, %d, , , %d, , )", path.Get(), startPathLen,
                              masksGroup->GetMasksString(), includeSubDirs, dirStackCount);
@@ -1596,11 +2349,17 @@ void SearchDirectory(CPathBuffer& path, char* end, int startPathLen,
                                     ok = FALSE; // a directory cannot be grepped
                                 else
                                 {
-                                    strcpy_s(end, path.Size() - (end - path), cFileNameA);
-                                    // links: file.nFileSizeLow == 0 && file.nFileSizeHigh == 0, the file size
-                                    // must be additionally obtained via SalGetFileSize()
-                                    BOOL isLink = (file.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
-                                    ok = TestFileContent(file.nFileSizeLow, file.nFileSizeHigh, path, data, isLink);
+                                    if (contentPool != NULL && contentPool->Submit(path, end, cFileNameA, &file))
+                                        ok = FALSE; // the pool tests the content and adds the file
+                                    else
+                                    {
+                                        strcpy_s(end, path.Size() - (end - path), cFileNameA);
+                                        // links: file.nFileSizeLow == 0 && file.nFileSizeHigh == 0, the file size
+                                        // must be additionally obtained via SalGetFileSize()
+                                        BOOL isLink = (file.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) != 0;
+                                        ok = TestFileContent(file.nFileSizeLow, file.nFileSizeHigh, path, data, isLink,
+                                                             &data->RegExp, &data->MultiSearchState);
+                                    }
                                 }
                             }
                             else
@@ -1615,9 +2374,12 @@ void SearchDirectory(CPathBuffer& path, char* end, int startPathLen,
                                 else
                                     *end = 0;
 
+                                std::string foundTexts;
+                                if (data->Grep && data->Multiple)
+                                    GetFoundTexts(data, &data->MultiSearchState, foundTexts);
                                 AddFoundItem(path, cFileNameA, file.nFileSizeLow, file.nFileSizeHigh,
                                              file.dwFileAttributes, &file.ftLastWriteTime, isDir, data,
-                                             duplicateCandidates);
+                                             duplicateCandidates, data->Grep && data->Multiple ? foundTexts.c_str() : NULL);
 
                                 if (end - path > 3)
                                     *(end - 1) = '\\';
@@ -1674,7 +2436,7 @@ void SearchDirectory(CPathBuffer& path, char* end, int startPathLen,
                             strcat_s(end, path.Size() - (end - path), "\\");
                             l++;
                             SearchDirectory(path, end + l, startPathLen, masksGroup, includeSubDirs, data, NULL,
-                                            0, duplicateCandidates, ignoreList, message);
+                                            0, duplicateCandidates, ignoreList, message, contentPool);
                         }
                     }
                     else
@@ -1708,6 +2470,9 @@ void SearchDirectory(CPathBuffer& path, char* end, int startPathLen,
         DWORD err = GetLastError();
         HANDLES(FindClose(find));
 
+        if (contentPool != NULL)
+            contentPool->AddTested(FALSE); // show found files also while searching directories without matching files
+
         if (testFindNextErr && err != ERROR_NO_MORE_FILES)
         {
             if (end - path > 3)
@@ -1740,7 +2505,7 @@ void SearchDirectory(CPathBuffer& path, char* end, int startPathLen,
                     strcpy_s(end, path.Size() - (end - path), newFileName);
                     strcat_s(end, path.Size() - (end - path), "\\");
                     SearchDirectory(path, end + strlen(end), startPathLen, masksGroup, includeSubDirs, data,
-                                    dirStack, dirStackCount, duplicateCandidates, ignoreList, message);
+                                    dirStack, dirStackCount, duplicateCandidates, ignoreList, message, contentPool);
                 }
             }
             // and release data from this level
@@ -1824,7 +2589,7 @@ void RefineData(CMaskGroup* masksGroup, CGrepData* data)
                 // links: refineData->Size == 0, the file size must be additionally obtained via SalGetFileSize()
                 BOOL isLink = (refineData->Attr & FILE_ATTRIBUTE_REPARSE_POINT) != 0; // size == 0, the file size must be obtained via SalGetFileSize()
                 ok = TestFileContent(refineData->Size.LoDWord, refineData->Size.HiDWord,
-                                     fullPath, data, isLink);
+                                     fullPath, data, isLink, &data->RegExp, &data->MultiSearchState);
             }
         }
 
@@ -1833,10 +2598,15 @@ void RefineData(CMaskGroup* masksGroup, CGrepData* data)
         if (data->Refine == 1 && ok ||
             data->Refine == 2 && !ok)
         {
+            // found texts come from this search or stay from the refined one if contents are not tested
+            std::string foundTexts;
+            if (data->Grep && data->Multiple && ok)
+                GetFoundTexts(data, &data->MultiSearchState, foundTexts);
             AddFoundItem(refineData->Path.c_str(), refineData->Name.c_str(),
                          refineData->Size.LoDWord, refineData->Size.HiDWord,
                          refineData->Attr, &refineData->LastWrite,
-                         refineData->IsDir, data, NULL);
+                         refineData->IsDir, data, NULL,
+                         data->Grep ? foundTexts.c_str() : refineData->FoundTexts.c_str());
         }
     }
 }
@@ -1895,6 +2665,23 @@ unsigned GrepThreadFBody(void* ptr)
             }
         }
 
+        // contents of files are tested on more threads, this thread enumerates directories
+        CGrepContentPool* contentPool = NULL;
+        if (!data->StopSearch && data->Grep)
+        {
+            contentPool = new CGrepContentPool;
+            if (contentPool == NULL)
+                TRACE_E(LOW_MEMORY); // the algorithm will run even without the pool
+            else
+            {
+                if (!contentPool->Start(data, duplicateCandidates))
+                {
+                    delete contentPool;
+                    contentPool = NULL;
+                }
+            }
+        }
+
         if (!data->StopSearch)
         {
             int i;
@@ -1942,7 +2729,7 @@ unsigned GrepThreadFBody(void* ptr)
 
                 CPathBuffer message;  // Heap-allocated for long path support
                 SearchDirectory(path, end, (int)(end - path), mg, includeSubDirs, data, dirStack, 0,
-                                duplicateCandidates, ignoreList, message);
+                                duplicateCandidates, ignoreList, message, contentPool);
 
                 if (ignoreList != NULL)
                     delete ignoreList;
@@ -1953,6 +2740,12 @@ unsigned GrepThreadFBody(void* ptr)
                     break;
             }
         }
+        if (contentPool != NULL)
+        {
+            if (!data->StopSearch)
+                contentPool->AddTested(TRUE); // wait for the remaining files
+            delete contentPool;
+        }
         if (duplicateCandidates != NULL)
         {
             if (!data->StopSearch)
@@ -30,10 +30,9 @@ extern BOOL IsNotAlpha[256];
 #define NAMED_TEXT_LEN MAX_PATH  // maximum text length in the combobox
 #define LOOKIN_TEXT_LEN MAX_PATH // maximum text length in the combobox
 #define GREP_TEXT_LEN 201        // maximum text length in the combobox; NOTE: should match FIND_TEXT_LEN
-#define GREP_LINE_LEN 10000      // maximum line length for regular expressions (viewer uses a different macro)
 
-// Length of the mapped view; must be greater than the length of a line for regexp + EOL +
-// AllocationGranularity
+// Length of the mapped view; must be greater than AllocationGranularity (a view starts up to
+// AllocationGranularity bytes before the searched offset)
 #define VOF_VIEW_SIZE 0x2800400 // 40 MB (more is risky, virtual memory may be limited) + 1 KB (space for a reasonable text line)
 
 // history for the Named combobox
@@ -140,21 +139,40 @@ public:
 #define FIND_DUPLICATES_SIZE 0x00000002    // same size
 #define FIND_DUPLICATES_CONTENT 0x00000004 // same content
 
+// encodings of the searched text (see CGrepData::EncodedTexts)
+enum CGrepTextEncoding
+{
+    gteANSI,    // text as typed (ANSI code page)
+    gteUTF8,    // UTF-8 (precomposed or decomposed characters)
+    gteUTF16LE, // UTF-16 little endian
+    gteUTF16BE, // UTF-16 big endian
+};
+
+#define GREP_MAX_ENCODED_TEXTS 16 // maximum number of variants of the searched text in EncodedTexts
+
 struct CGrepData
 {
-    BOOL FindDuplicates; // do we search for duplicates?
-    DWORD FindDupFlags;  // FIND_DUPLICATES_xxx; meaningful only if 'FindDuplicates' is TRUE
-    int Refine;          // 0: search new data, 1 & 2: search within found data; 1: intersect with old data; 2: subtract from old data
-    BOOL Grep;           // use grep?
-    BOOL WholeWords;     // match whole words only?
-    BOOL Regular;        // regular expression?
-    BOOL EOL_CRLF,       // EOL handling when searching regular expressions
+    BOOL FindDuplicates;   // do we search for duplicates?
+    DWORD FindDupFlags;    // FIND_DUPLICATES_xxx; meaningful only if 'FindDuplicates' is TRUE
+    int Refine;            // 0: search new data, 1 & 2: search within found data; 1: intersect with old data; 2: subtract from old data
+    BOOL Grep;             // use grep?
+    BOOL WholeWords;       // match whole words only?
+    BOOL Regular;          // regular expression?
+    BOOL Multiple;         // search for more texts at once (MultiSearchData)?
+    BOOL Unicode;          // search for the text also in UTF-8 and UTF-16 (EncodedTexts)?
+    BOOL KeepResultsOrder; // contents are tested on more threads: add found files in the order of searching?
+    BOOL EOL_CRLF,         // EOL handling when searching regular expressions
         EOL_CR,
         EOL_LF;
     //       EOL_NULL;              // unsupported by the regular expression parser :(
 
     CSearchData SearchData;
-    CRegularExpression RegExp;
+    CLinearRegExp RegExp;
+    CMultiSearchData MultiSearchData;
+    CMultiSearchState MultiSearchState;      // state of the multi-text search of files tested on the grep thread
+    CMultiSearchData EncodedTexts;                     // the searched text in UTF-8 and UTF-16, see SetEncodedTexts
+    BYTE EncodingOf[GREP_MAX_ENCODED_TEXTS];           // encoding (CGrepTextEncoding) of each text in EncodedTexts
+    std::wstring EncodedLower[GREP_MAX_ENCODED_TEXTS]; // characters of each text in EncodedTexts in lower case
     // advanced search
     DWORD AttributesMask;  // mask first
     DWORD AttributesValue; // then compare
@@ -174,6 +192,19 @@ struct CGrepData
     CSearchingString* SearchingText2; // [optional] second text on the right; used for "Total: 35%"
 };
 
+// transcodes 'text' (in the ANSI code page) to UTF-8 and UTF-16 and prepares data->EncodedTexts,
+// data->EncodingOf and data->EncodedLower for searching all these variants at once ('text' itself
+// is searched by data->SearchData); files are never converted, their bytes are matched against
+// every variant; clears data->Unicode if no variant differs from 'text'; returns FALSE on error
+// (see EncodedTexts.GetLastErrorText)
+BOOL SetEncodedTexts(CGrepData* data, const char* text, WORD flags);
+
+// search 'txt' of 'size' bytes from 'off' by parts for data->SearchData (SearchForward) or for
+// any text of data->EncodedTexts (SearchEncodedForward); return the position of the leftmost
+// occurrence or -1 (also when data->StopSearch is set)
+int SearchForward(CGrepData* data, char* txt, int size, int off);
+int SearchEncodedForward(CGrepData* data, char* txt, int size, int off);
+
 //*********************************************************************************
 //
 // CFindOptionsItem
@@ -193,6 +224,8 @@ public:
     int CaseSensitive;
     int HexMode;
     int RegularExpresions;
+    int MultipleTexts;
+    int Unicode;
 
     BOOL AutoLoad;
 
@@ -499,6 +532,7 @@ struct CFoundFilesData
 {
     std::string Name;
     std::string Path;
+    std::string FoundTexts; // texts found in the file when searching for more texts at once (separated by MULTISEARCH_SEPARATOR)
     CQuadWord Size;
     DWORD Attr;
     FILETIME LastWrite;
@@ -529,7 +563,7 @@ struct CFoundFilesData
     ~CFoundFilesData() = default;
     BOOL Set(const char* path, const char* name, const CQuadWord& size, DWORD attr,
              const FILETIME* lastWrite, BOOL isDir);
-    // if 'i' refers to Name or Path, returns a pointer to the corresponding variable
+    // if 'i' refers to Name, Path or FoundTexts, returns a pointer to the corresponding variable
     // otherwise fills the buffer 'text' (must be at least 50 characters long) with the appropriate value
     // and returns a pointer to 'text'
     // 'fileNameFormat' determines formatting of names of found items
@@ -543,6 +577,7 @@ protected:
     CRITICAL_SECTION DataCriticalSection; // critical section for accessing data
     CFindDialog* FindDialog;
     TIndirectArray<CFoundFilesData> DataForRefine;
+    BOOL FoundTextsColumn; // is the column with found texts (CFoundFilesData::FoundTexts) shown?
 
 public:
     int EnumFileNamesSourceUID; // UID of the source for name enumeration in viewers
@@ -554,6 +589,8 @@ public:
     virtual LRESULT WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam);
 
     BOOL InitColumns();
+    // shows or hides the last column with texts found when searching for more texts at once
+    void ShowFoundTextsColumn(BOOL show);
 
     void StoreItemsState();
     void RestoreItemsState();
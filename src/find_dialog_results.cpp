@@ -160,11 +160,14 @@ char* CFoundFilesData::GetText(int i, char* text, int fileNameFormat)
         break;
     }
 
-    default:
+    case 5:
     {
         GetAttrsString(text, Attr);
         break;
     }
+
+    default:
+        return const_cast<char*>(FoundTexts.c_str());
     }
     return text;
 }
@@ -178,7 +181,10 @@ CFoundFilesListView::CFoundFilesListView(HWND dlg, int ctrlID, CFindDialog* find
     : Data(1000, 500), DataForRefine(1, 1000), CWindow(dlg, ctrlID)
 {
     FindDialog = findDialog;
+    FoundTextsColumn = FALSE;
     HANDLES(InitializeCriticalSection(&DataCriticalSection));
+    Data.SetGrowGeometric(TRUE); // searching of whole disks can find millions of files
+    DataForRefine.SetGrowGeometric(TRUE);
 
     // add this panel to the array of sources for enumerating files in viewers
     EnumFileNamesAddSourceUID(HWindow, &EnumFileNamesSourceUID);
@@ -237,17 +243,12 @@ int CFoundFilesListView::Add(CFoundFilesData* item)
 BOOL CFoundFilesListView::TakeDataForRefine()
 {
     DataForRefine.DestroyMembers();
-    int i;
-    for (i = 0; i < Data.Count; i++)
+    DataForRefine.Add(Data.GetData(), Data.Count); // all items at once
+    if (!DataForRefine.IsGood())
     {
-        CFoundFilesData* refineData = Data[i];
-        DataForRefine.Add(refineData);
-        if (!DataForRefine.IsGood())
-        {
-            DataForRefine.ResetState();
-            DataForRefine.DetachMembers();
-            return FALSE;
-        }
+        DataForRefine.ResetState();
+        DataForRefine.DetachMembers();
+        return FALSE;
     }
     Data.DetachMembers();
     return TRUE;
@@ -1310,6 +1311,27 @@ BOOL CFoundFilesListView::InitColumns()
     return TRUE;
 }
 
+void CFoundFilesListView::ShowFoundTextsColumn(BOOL show)
+{
+    CALL_STACK_MESSAGE2("CFoundFilesListView::ShowFoundTextsColumn(%d)", show);
+    if (show == FoundTextsColumn)
+        return;
+    if (show)
+    {
+        LV_COLUMN lvc;
+        lvc.mask = LVCF_FMT | LVCF_TEXT | LVCF_SUBITEM | LVCF_WIDTH;
+        lvc.fmt = LVCFMT_LEFT;
+        lvc.pszText = LoadStr(IDS_FOUNDFILESCOLUMN7);
+        lvc.iSubItem = 6;
+        lvc.cx = ListView_GetStringWidth(HWindow, "XXXXXXXXXXXXXXXXXXXX") + 20;
+        if (ListView_InsertColumn(HWindow, 6, &lvc) == -1)
+            return;
+    }
+    else
+        ListView_DeleteColumn(HWindow, 6);
+    FoundTextsColumn = show;
+}
+
 //****************************************************************************
 //
 // CFindDialog
@@ -1664,6 +1686,8 @@ void CFindDialog::SetContentVisible(BOOL visible)
         ShowWindow(GetDlgItem(HWindow, IDC_FIND_CASE), visible);
         ShowWindow(GetDlgItem(HWindow, IDC_FIND_WHOLE), visible);
         ShowWindow(GetDlgItem(HWindow, IDC_FIND_REGULAR), visible);
+        ShowWindow(GetDlgItem(HWindow, IDC_FIND_MULTIPLE), visible);
+        ShowWindow(GetDlgItem(HWindow, IDC_FIND_UNICODE), visible);
 
         if (!visible)
         {
@@ -1674,6 +1698,8 @@ void CFindDialog::SetContentVisible(BOOL visible)
             EnableWindow(GetDlgItem(HWindow, IDC_FIND_CASE), FALSE);
             EnableWindow(GetDlgItem(HWindow, IDC_FIND_WHOLE), FALSE);
             EnableWindow(GetDlgItem(HWindow, IDC_FIND_REGULAR), FALSE);
+            EnableWindow(GetDlgItem(HWindow, IDC_FIND_MULTIPLE), FALSE);
+            EnableWindow(GetDlgItem(HWindow, IDC_FIND_UNICODE), FALSE);
         }
 
         if (!visible)
@@ -1748,6 +1774,8 @@ void CFindDialog::Transfer(CTransferInfo& ti)
     ti.CheckBox(IDC_FIND_CASE, Data.CaseSensitive);
     ti.CheckBox(IDC_FIND_WHOLE, Data.WholeWords);
     ti.CheckBox(IDC_FIND_REGULAR, Data.RegularExpresions);
+    ti.CheckBox(IDC_FIND_MULTIPLE, Data.MultipleTexts);
+    ti.CheckBox(IDC_FIND_UNICODE, Data.Unicode);
 }
 
 void CFindDialog::UpdateAdvancedText()
@@ -2002,7 +2030,10 @@ void CFindDialog::StartSearch(WORD command)
     UpdateListViewItems();
 
     if (Data.GrepText[0] == 0)
+    {
         GrepData.Grep = FALSE;
+        GrepData.Multiple = FALSE;
+    }
     else
     {
         GrepData.EOL_CRLF = Configuration.EOL_CRLF;
@@ -2010,11 +2041,29 @@ void CFindDialog::StartSearch(WORD command)
         GrepData.EOL_LF = Configuration.EOL_LF;
         //    GrepData.EOL_NULL = Configuration.EOL_NULL;   // can't handle this with regexp :(
         GrepData.Regular = Data.RegularExpresions;
-        GrepData.WholeWords = Data.WholeWords;
-        if (Data.RegularExpresions)
+        GrepData.Multiple = Data.MultipleTexts && !Data.RegularExpresions;
+        GrepData.WholeWords = Data.WholeWords && !GrepData.Multiple;
+        GrepData.Unicode = Data.Unicode && !Data.RegularExpresions && !GrepData.Multiple && !Data.HexMode;
+        GrepData.KeepResultsOrder = Configuration.FindKeepResultsOrder;
+        if (GrepData.Multiple)
+        {
+            if (!GrepData.MultiSearchData.SetList(Data.GrepText, (WORD)(sfForward |
+                                                                      (Data.CaseSensitive ? sfCaseSensitive : 0))))
+            {
+                std::wstring msg = FormatStrW(LoadStrW(IDS_INVALIDMULTISEARCH), AnsiToWide(Data.GrepText).c_str(),
+                                              AnsiToWide(GrepData.MultiSearchData.GetLastErrorText()).c_str());
+                gPrompter->ShowError(LoadStrW(IDS_ERRORFINDINGFILE), msg.c_str());
+                if (GrepData.Refine != 0)
+                    FoundFilesListView->DestroyDataForRefine();
+                return; // error
+            }
+            GrepData.Grep = TRUE;
+        }
+        else if (Data.RegularExpresions)
         {
             if (!GrepData.RegExp.Set(Data.GrepText, (WORD)(sfForward |
-                                                           (Data.CaseSensitive ? sfCaseSensitive : 0))))
+                                                           (Data.CaseSensitive ? sfCaseSensitive : 0) |
+                                                           (GrepData.WholeWords ? sfWholeWords : 0))))
             {
                 std::wstring msg;
                 if (GrepData.RegExp.GetPattern() != NULL)
@@ -2041,8 +2090,23 @@ void CFindDialog::StartSearch(WORD command)
                 GrepData.SearchData.Set(Data.GrepText, (WORD)(sfForward |
                                                               (Data.CaseSensitive ? sfCaseSensitive : 0)));
             GrepData.Grep = GrepData.SearchData.IsGood();
+            if (GrepData.Grep && GrepData.Unicode &&
+                !SetEncodedTexts(&GrepData, Data.GrepText, (WORD)(sfForward |
+                                                                  (Data.CaseSensitive ? sfCaseSensitive : 0))))
+            {
+                gPrompter->ShowError(LoadStrW(IDS_ERRORFINDINGFILE),
+                                     AnsiToWide(GrepData.EncodedTexts.GetLastErrorText()).c_str());
+                if (GrepData.Refine != 0)
+                    FoundFilesListView->DestroyDataForRefine();
+                return; // error
+            }
         }
     }
+    // found texts are shown for a multi-text search; refining without searching contents keeps them
+    if (GrepData.Grep && GrepData.Multiple)
+        FoundFilesListView->ShowFoundTextsColumn(TRUE);
+    else if (GrepData.Grep || GrepData.Refine == 0)
+        FoundFilesListView->ShowFoundTextsColumn(FALSE);
     SetFocus(FoundFilesListView->HWindow);
 
     BuildSerchForData();
@@ -2214,6 +2278,8 @@ void CFindDialog::EnableControls(BOOL nextIsButton)
             EnableWindow(GetDlgItem(HWindow, IDC_FIND_WHOLE), FALSE);
             EnableWindow(GetDlgItem(HWindow, IDC_FIND_CASE), FALSE);
             EnableWindow(GetDlgItem(HWindow, IDC_FIND_REGULAR), FALSE);
+            EnableWindow(GetDlgItem(HWindow, IDC_FIND_MULTIPLE), FALSE);
+            EnableWindow(GetDlgItem(HWindow, IDC_FIND_UNICODE), FALSE);
         }
         EnableWindow(GetDlgItem(HWindow, IDC_FIND_ADVANCED), FALSE);
 
@@ -2224,9 +2290,16 @@ void CFindDialog::EnableControls(BOOL nextIsButton)
     {
         HWND setFocus = NULL;
 
-        BOOL enableHexMode = !Data.RegularExpresions;
+        BOOL enableHexMode = !Data.RegularExpresions && !Data.MultipleTexts;
         if (!enableHexMode && GetDlgItem(HWindow, IDC_FIND_HEX) == focus)
             setFocus = GetDlgItem(HWindow, IDC_FIND_CONTAINING);
+        BOOL enableWholeWords = !Data.MultipleTexts; // texts are searched by the automaton without word boundaries
+        if (!enableWholeWords && GetDlgItem(HWindow, IDC_FIND_WHOLE) == focus)
+            setFocus = GetDlgItem(HWindow, IDC_FIND_CONTAINING);
+        // other encodings are searched only for a plain text
+        BOOL enableUnicode = !Data.RegularExpresions && !Data.MultipleTexts && !Data.HexMode;
+        if (!enableUnicode && GetDlgItem(HWindow, IDC_FIND_UNICODE) == focus)
+            setFocus = GetDlgItem(HWindow, IDC_FIND_CONTAINING);
 
         TBHeader->EnableItem(IDC_FIND_STOP, FALSE, FALSE);
 
@@ -2257,9 +2330,11 @@ void CFindDialog::EnableControls(BOOL nextIsButton)
             EnableWindow(GetDlgItem(HWindow, IDC_FIND_CONTAINING), TRUE);
             EnableWindow(GetDlgItem(HWindow, IDC_FIND_REGEXP_BROWSE), TRUE);
             EnableWindow(GetDlgItem(HWindow, IDC_FIND_HEX), enableHexMode);
-            EnableWindow(GetDlgItem(HWindow, IDC_FIND_WHOLE), TRUE);
+            EnableWindow(GetDlgItem(HWindow, IDC_FIND_WHOLE), enableWholeWords);
             EnableWindow(GetDlgItem(HWindow, IDC_FIND_CASE), TRUE);
             EnableWindow(GetDlgItem(HWindow, IDC_FIND_REGULAR), TRUE);
+            EnableWindow(GetDlgItem(HWindow, IDC_FIND_MULTIPLE), TRUE);
+            EnableWindow(GetDlgItem(HWindow, IDC_FIND_UNICODE), enableUnicode);
         }
         EnableWindow(GetDlgItem(HWindow, IDC_FIND_ADVANCED), TRUE);
 
@@ -2412,6 +2487,7 @@ void CFindDialog::UpdateInternalViewerData()
         dummyTI.CheckBox(IDC_FIND_CASE, GlobalFindDialog.CaseSensitive);
         dummyTI.CheckBox(IDC_FIND_HEX, GlobalFindDialog.HexMode);
         dummyTI.CheckBox(IDC_FIND_REGULAR, GlobalFindDialog.Regular);
+        dummyTI.CheckBox(IDC_FIND_MULTIPLE, GlobalFindDialog.Multiple);
         dummyTI.EditLine(IDC_FIND_CONTAINING, GlobalFindDialog.Text, FIND_TEXT_LEN);
 
         HistoryComboBox(NULL, dummyTI, 0, GlobalFindDialog.Text,
@@ -2851,7 +2927,8 @@ BOOL CFindDialog::ManageHiddenShortcuts(const MSG* msg)
             {
                 // check the hotkeys of monitored controls
                 int resID[] = {IDC_FIND_CONTAINING_TEXT, IDC_FIND_HEX, IDC_FIND_CASE,
-                               IDC_FIND_WHOLE, IDC_FIND_REGULAR, -1}; // (terminate with -1)
+                               IDC_FIND_WHOLE, IDC_FIND_REGULAR, IDC_FIND_MULTIPLE, IDC_FIND_UNICODE,
+                               -1}; // (terminate with -1)
                 int i;
                 for (i = 0; resID[i] != -1; i++)
                 {
@@ -3193,6 +3270,7 @@ CFindDialog::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
 
                 popup->CheckItem(CM_FIND_SHOWERRORS, FALSE, Configuration.ShowGrepErrors);
                 popup->CheckItem(CM_FIND_FULLROWSEL, FALSE, Configuration.FindFullRowSelect);
+                popup->CheckItem(CM_FIND_KEEPORDER, FALSE, Configuration.FindKeepResultsOrder);
                 // if the manage dialog is open, disable it in another window and also disable adding to the list
                 popup->EnableItem(CM_FIND_ADD_CURRENT, FALSE, !FindManageInUse);
                 popup->EnableItem(CM_FIND_MANAGE, FALSE, !FindManageInUse);
@@ -3283,8 +3361,10 @@ CFindDialog::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                 CheckDlgButton(HWindow, IDC_FIND_CASE, FALSE);
                 CheckDlgButton(HWindow, IDC_FIND_WHOLE, FALSE);
                 CheckDlgButton(HWindow, IDC_FIND_REGULAR, FALSE);
+                CheckDlgButton(HWindow, IDC_FIND_MULTIPLE, FALSE);
                 Data.HexMode = FALSE;
                 Data.RegularExpresions = FALSE;
+                Data.MultipleTexts = FALSE;
             }
             return TRUE;
         }
@@ -3384,6 +3464,7 @@ CFindDialog::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                 Data.HexMode = (IsDlgButtonChecked(HWindow, IDC_FIND_HEX) != BST_UNCHECKED);
                 if (Data.HexMode)
                     CheckDlgButton(HWindow, IDC_FIND_CASE, BST_CHECKED);
+                EnableControls();
                 return TRUE;
             }
             break;
@@ -3421,6 +3502,26 @@ CFindDialog::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                 {
                     Data.HexMode = FALSE;
                     CheckDlgButton(HWindow, IDC_FIND_HEX, FALSE);
+                    Data.MultipleTexts = FALSE;
+                    CheckDlgButton(HWindow, IDC_FIND_MULTIPLE, FALSE);
+                }
+                EnableControls();
+                return TRUE;
+            }
+            break;
+        }
+
+        case IDC_FIND_MULTIPLE:
+        {
+            if (HIWORD(wParam) == BN_CLICKED)
+            {
+                Data.MultipleTexts = (IsDlgButtonChecked(HWindow, IDC_FIND_MULTIPLE) != BST_UNCHECKED);
+                if (Data.MultipleTexts)
+                {
+                    Data.HexMode = FALSE;
+                    CheckDlgButton(HWindow, IDC_FIND_HEX, FALSE);
+                    Data.RegularExpresions = FALSE;
+                    CheckDlgButton(HWindow, IDC_FIND_REGULAR, FALSE);
                 }
                 EnableControls();
                 return TRUE;
@@ -3762,6 +3863,13 @@ MENU_TEMPLATE_ITEM FindLookInBrowseMenu[] =
             return TRUE;
         }
 
+        case CM_FIND_KEEPORDER:
+        {
+            // used from the next search, the running one keeps its order
+            Configuration.FindKeepResultsOrder = !Configuration.FindKeepResultsOrder;
+            return TRUE;
+        }
+
         case CM_FIND_MESSAGES:
         {
             if (TBHeader != NULL)
@@ -0,0 +1,276 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+#include "hashcache.h"
+#include "common/IFileSystem.h"
+#include "common/unicode/helpers.h"
+
+CHashCache HashCache;
+
+#define HASH_CACHE_SIGNATURE 0x31434853 // "SHC1"
+#define HASH_CACHE_VERSION 1
+#define HASH_CACHE_INIT_CAPACITY 4096 // power of two
+#define HASH_CACHE_SAVE_BUFFER (1024 * 1024) // Save() writes the file in chunks of this size (bytes)
+
+struct CHashCacheFileHeader
+{
+    DWORD Signature; // HASH_CACHE_SIGNATURE
+    DWORD Version;   // HASH_CACHE_VERSION
+    DWORD Count;     // number of CHashCacheItem records following the header
+};
+
+// returns the name of the cache file in 'path' (buffer of size MAX_PATH); if 'create' is TRUE,
+// our directory is created; returns FALSE if the path cannot be obtained
+static BOOL GetHashCacheFileName(char* path, BOOL create)
+{
+    if (SHGetFolderPath(NULL, CSIDL_LOCAL_APPDATA, NULL, 0 /* SHGFP_TYPE_CURRENT */, path) != S_OK ||
+        !SalPathAppend(path, "Sally", MAX_PATH))
+    {
+        return FALSE;
+    }
+    if (create)
+        SalLPCreateDirectory(path, NULL); // if it fails (e.g. already exists), we don't care...
+    return SalPathAppend(path, "Hash Cache.bin", MAX_PATH);
+}
+
+static inline BOOL IsFreeSlot(const CHashCacheItem* item)
+{
+    return item->Key.VolumeSerial == 0 && item->Key.FileIndexHigh == 0 && item->Key.FileIndexLow == 0;
+}
+
+CHashCache::CHashCache()
+{
+    HANDLES(InitializeCriticalSection(&CS));
+    Items = NULL;
+    Capacity = 0;
+    Count = 0;
+    Loaded = FALSE;
+    Dirty = FALSE;
+}
+
+CHashCache::~CHashCache()
+{
+    if (Items != NULL)
+        free(Items);
+    HANDLES(DeleteCriticalSection(&CS));
+}
+
+BOOL CHashCache::GetKey(HANDLE file, CHashCacheKey* key)
+{
+    BY_HANDLE_FILE_INFORMATION info;
+    if (!GetFileInformationByHandle(file, &info) ||
+        info.nFileIndexHigh == 0 && info.nFileIndexLow == 0 || // the file system has no file indexes
+        info.nFileSizeHigh == 0 && info.nFileSizeLow < HASH_CACHE_MIN_FILE_SIZE)
+    {
+        return FALSE;
+    }
+    key->VolumeSerial = info.dwVolumeSerialNumber;
+    key->FileIndexHigh = info.nFileIndexHigh;
+    key->FileIndexLow = info.nFileIndexLow;
+    key->FileSizeHigh = info.nFileSizeHigh;
+    key->FileSizeLow = info.nFileSizeLow;
+    key->LastWrite = info.ftLastWriteTime;
+    return TRUE;
+}
+
+CHashCacheItem* CHashCache::GetSlot(const CHashCacheKey* key)
+{
+    DWORD hash = key->VolumeSerial * 0x9E3779B1 ^ key->FileIndexLow * 0x85EBCA6B ^ key->FileIndexHigh * 0xC2B2AE35;
+    int mask = Capacity - 1;
+    int i = (int)(hash ^ (hash >> 15)) & mask;
+    while (1) // the table is never full (see Insert)
+    {
+        CHashCacheItem* item = &Items[i];
+        if (IsFreeSlot(item) ||
+            item->Key.VolumeSerial == key->VolumeSerial && item->Key.FileIndexHigh == key->FileIndexHigh &&
+                item->Key.FileIndexLow == key->FileIndexLow)
+        {
+            return item;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+BOOL CHashCache::Insert(const CHashCacheItem* item)
+{
+    if (Count >= HASH_CACHE_MAX_ITEMS)
+    {
+        TRACE_I("CHashCache::Insert(): the cache is full, emptying it.");
+        Clear();
+    }
+    if (2 * (Count + 1) > Capacity) // keep the table at most half full
+    {
+        int newCapacity = Capacity == 0 ? HASH_CACHE_INIT_CAPACITY : 2 * Capacity;
+        CHashCacheItem* newItems = (CHashCacheItem*)calloc(newCapacity, sizeof(CHashCacheItem));
+        if (newItems == NULL)
+        {
+            TRACE_E(LOW_MEMORY);
+            return FALSE;
+        }
+        CHashCacheItem* oldItems = Items;
+        int oldCapacity = Capacity;
+        Items = newItems;
+        Capacity = newCapacity;
+        int i;
+        for (i = 0; i < oldCapacity; i++)
+        {
+            if (!IsFreeSlot(&oldItems[i]))
+                *GetSlot(&oldItems[i].Key) = oldItems[i];
+        }
+        if (oldItems != NULL)
+            free(oldItems);
+    }
+    CHashCacheItem* slot = GetSlot(&item->Key);
+    if (IsFreeSlot(slot))
+        Count++;
+    *slot = *item; // a new file or a changed one (other size or last write time)
+    return TRUE;
+}
+
+void CHashCache::Clear()
+{
+    if (Items != NULL)
+        free(Items);
+    Items = NULL;
+    Capacity = 0;
+    Count = 0;
+    Dirty = TRUE;
+}
+
+void CHashCache::Load()
+{
+    Loaded = TRUE;
+    char fileName[MAX_PATH];
+    if (!GetHashCacheFileName(fileName, FALSE))
+        return;
+    HANDLE file = HANDLES_Q(CreateFileW(AnsiToWide(fileName).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                                        FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+    if (file == INVALID_HANDLE_VALUE)
+        return; // the cache was not saved yet
+
+    CHashCacheFileHeader header;
+    DWORD read;
+    DWORD fileSize = GetFileSize(file, NULL);
+    if (ReadFile(file, &header, sizeof(header), &read, NULL) && read == sizeof(header) &&
+        header.Signature == HASH_CACHE_SIGNATURE && header.Version == HASH_CACHE_VERSION &&
+        header.Count <= HASH_CACHE_MAX_ITEMS &&
+        fileSize == sizeof(header) + header.Count * sizeof(CHashCacheItem))
+    {
+        CHashCacheItem* items = (CHashCacheItem*)malloc(max(header.Count, 1) * sizeof(CHashCacheItem));
+        if (items != NULL)
+        {
+            if (ReadFile(file, items, header.Count * sizeof(CHashCacheItem), &read, NULL) &&
+                read == header.Count * sizeof(CHashCacheItem))
+            {
+                DWORD i;
+                for (i = 0; i < header.Count; i++)
+                {
+                    if (!IsFreeSlot(&items[i]) && !Insert(&items[i]))
+                        break; // low memory
+                }
+            }
+            free(items);
+        }
+        else
+            TRACE_E(LOW_MEMORY);
+    }
+    else
+        TRACE_E("CHashCache::Load(): invalid cache file " << fileName);
+    HANDLES(CloseHandle(file));
+    Dirty = FALSE;
+}
+
+BOOL CHashCache::Find(const CHashCacheKey* key, BYTE* digest)
+{
+    BOOL ret = FALSE;
+    HANDLES(EnterCriticalSection(&CS));
+    if (!Loaded)
+        Load();
+    if (Capacity > 0)
+    {
+        CHashCacheItem* item = GetSlot(key);
+        if (!IsFreeSlot(item) && memcmp(&item->Key, key, sizeof(CHashCacheKey)) == 0) // also the same size and last write time
+        {
+            memcpy(digest, item->Digest, HASH_CACHE_DIGEST_SIZE);
+            ret = TRUE;
+        }
+    }
+    HANDLES(LeaveCriticalSection(&CS));
+    return ret;
+}
+
+void CHashCache::Add(const CHashCacheKey* key, const BYTE* digest)
+{
+    CHashCacheItem item;
+    item.Key = *key;
+    memcpy(item.Digest, digest, HASH_CACHE_DIGEST_SIZE);
+    HANDLES(EnterCriticalSection(&CS));
+    if (!Loaded)
+        Load();
+    if (Insert(&item))
+        Dirty = TRUE;
+    HANDLES(LeaveCriticalSection(&CS));
+}
+
+void CHashCache::Save()
+{
+    HANDLES(EnterCriticalSection(&CS));
+    char fileName[MAX_PATH];
+    char* buffer = NULL;
+    if (Dirty && GetHashCacheFileName(fileName, TRUE) &&
+        (buffer = (char*)malloc(HASH_CACHE_SAVE_BUFFER)) == NULL)
+    {
+        TRACE_E(LOW_MEMORY);
+    }
+    if (buffer != NULL)
+    {
+        HANDLE file = HANDLES_Q(CreateFileW(AnsiToWide(fileName).c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                                            FILE_ATTRIBUTE_NORMAL, NULL));
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            // the header and the items are collected in 'buffer' and written in big chunks
+            // (one WriteFile per item would mean up to HASH_CACHE_MAX_ITEMS calls at exit)
+            CHashCacheFileHeader* header = (CHashCacheFileHeader*)buffer;
+            header->Signature = HASH_CACHE_SIGNATURE;
+            header->Version = HASH_CACHE_VERSION;
+            header->Count = Count;
+            DWORD used = sizeof(CHashCacheFileHeader);
+            DWORD written;
+            BOOL ok = TRUE;
+            int i;
+            for (i = 0; ok && i < Capacity; i++)
+            {
+                if (!IsFreeSlot(&Items[i]))
+                {
+                    if (used + sizeof(CHashCacheItem) > HASH_CACHE_SAVE_BUFFER) // the buffer is full
+                    {
+                        ok = WriteFile(file, buffer, used, &written, NULL) && written == used;
+                        used = 0;
+                    }
+                    memcpy(buffer + used, &Items[i], sizeof(CHashCacheItem));
+                    used += sizeof(CHashCacheItem);
+                }
+            }
+            if (ok && used > 0)
+                ok = WriteFile(file, buffer, used, &written, NULL) && written == used;
+            HANDLES(CloseHandle(file));
+            if (ok)
+                Dirty = FALSE;
+            else
+            {
+                DWORD err = GetLastError();
+                TRACE_E("CHashCache::Save(): unable to write file " << fileName << ", error: " << GetErrorText(err));
+                gFileSystem->DeleteFile(AnsiToWide(fileName).c_str()); // an incomplete file would be rejected by Load() anyway
+            }
+        }
+        free(buffer);
+    }
+    HANDLES(LeaveCriticalSection(&CS));
+}
+
+void ReleaseHashCache()
+{
+    HashCache.Save();
+}
@@ -0,0 +1,73 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#pragma once
+
+//
+// ****************************************************************************
+// CHashCache
+//
+// persistent cache of MD5 digests of file contents used by Compare Directories (by content)
+// and Find Duplicate Files; the digest of a file stays valid while the file (volume serial
+// number + file index) keeps its size and last write time, so comparing unchanged files costs
+// only reading of their metadata; the cache is stored in "Hash Cache.bin" in our directory
+// under CSIDL_LOCAL_APPDATA (file indexes are meaningful only on this machine)
+
+#define HASH_CACHE_DIGEST_SIZE 16      // size of the stored digest (MD5)
+#define HASH_CACHE_MAX_ITEMS 262144    // when exceeded, the cache is emptied and starts filling again
+#define HASH_CACHE_MIN_FILE_SIZE 65536 // smaller files are read faster than looked up, they are not cached
+
+struct CHashCacheKey
+{
+    DWORD VolumeSerial;
+    DWORD FileIndexHigh;
+    DWORD FileIndexLow;
+    DWORD FileSizeHigh;
+    DWORD FileSizeLow;
+    FILETIME LastWrite;
+};
+
+struct CHashCacheItem
+{
+    CHashCacheKey Key;
+    BYTE Digest[HASH_CACHE_DIGEST_SIZE];
+};
+
+class CHashCache
+{
+protected:
+    CRITICAL_SECTION CS;  // the cache is used from the main thread (Compare Directories) and from the Find threads
+    CHashCacheItem* Items; // open-addressing hash table (slot with zero VolumeSerial and FileIndex is free)
+    int Capacity;          // number of slots in Items (power of two)
+    int Count;             // number of used slots
+    BOOL Loaded;           // TRUE = the cache file was already read (it is read on the first use)
+    BOOL Dirty;            // TRUE = the cache must be saved (see Save())
+
+public:
+    CHashCache();
+    ~CHashCache();
+
+    // fills 'key' with the identity of the open file 'file'; returns FALSE if the file cannot be
+    // cached (it is too small or the file system does not provide file indexes)
+    static BOOL GetKey(HANDLE file, CHashCacheKey* key);
+
+    // looks for the digest of the file with 'key'; returns TRUE and the digest in 'digest' if found
+    BOOL Find(const CHashCacheKey* key, BYTE* digest);
+
+    // stores the digest of the file with 'key'
+    void Add(const CHashCacheKey* key, const BYTE* digest);
+
+    // writes the cache to disk if it has changed; called on exit of Salamander
+    void Save();
+
+protected:
+    void Load();                              // must be called inside CS
+    BOOL Insert(const CHashCacheItem* item);  // must be called inside CS; returns FALSE on low memory
+    CHashCacheItem* GetSlot(const CHashCacheKey* key); // slot with 'key' or a free slot for it
+    void Clear();
+};
+
+extern CHashCache HashCache;
+
+// saves and releases the cache (called on exit of Salamander)
+void ReleaseHashCache();
@@ -5885,6 +5885,12 @@ MENU_TEMPLATE_ITEM AddToSystemMenu[] =
         break;
     }
 
+    case WM_USER_RESUMECOPIES:
+    {
+        ResumeInterruptedCopies(HWindow);
+        break;
+    }
+
     case WM_USER_USERMENUICONS_READY:
     {
         CUserMenuIconDataArr* bkgndReaderData = (CUserMenuIconDataArr*)wParam;
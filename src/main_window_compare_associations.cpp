@@ -12,6 +12,8 @@
 #include "cfgdlg.h"
 #include "dialogs.h"
 #include "common/widepath.h"
+#include "md5.h"
+#include "hashcache.h"
 
 void GetFileDateAndTimeFromPanel(DWORD validFileData, CPluginDataInterfaceEncapsulation* pluginData,
                                  const CFileData* f, BOOL isDir, SYSTEMTIME* st, BOOL* validDate,
@@ -282,6 +284,193 @@ void AddProgressSizeWithLimit(CCmpDirProgressDialog* progressDlg, DWORD read, CQ
     }
 }
 
+// overlapped comparison (files on different disks): size of the chunk read from each file at once
+#define COMPARE_OVERLAPPED_CHUNK (1024 * 1024)
+// overlapped comparison: how often (in milliseconds) the progress dialog gets a chance to repaint while waiting for the reads
+#define COMPARE_OVERLAPPED_WAIT 100
+
+// overlapped comparison: starts reading the chunk at 'offset' from 'file' into 'buffer'; returns
+// FALSE on error (see GetLastError()); '*pending' receives TRUE if the read must be finished by
+// FinishCompareRead(), FALSE if the end of the file was reached immediately (nothing was read)
+BOOL StartCompareRead(HANDLE file, char* buffer, OVERLAPPED* overlapped, HANDLE event,
+                      const CQuadWord& offset, BOOL* pending)
+{
+    memset(overlapped, 0, sizeof(OVERLAPPED));
+    overlapped->Offset = offset.LoDWord;
+    overlapped->OffsetHigh = offset.HiDWord;
+    overlapped->hEvent = event;
+    *pending = TRUE;
+    if (!ReadFile(file, buffer, COMPARE_OVERLAPPED_CHUNK, NULL, overlapped))
+    {
+        DWORD err = GetLastError();
+        if (err == ERROR_HANDLE_EOF)
+            *pending = FALSE;
+        else
+        {
+            if (err != ERROR_IO_PENDING)
+            {
+                *pending = FALSE;
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+// overlapped comparison: waits for the read started by StartCompareRead() and returns the number
+// of bytes read in 'read'; the progress dialog is repainted while waiting; returns FALSE on error
+// (see GetLastError()) or if the user cancels the comparison ('*canceled' is TRUE then, the read
+// is still in progress)
+BOOL FinishCompareRead(CCmpDirProgressDialog* progressDlg, HANDLE file, OVERLAPPED* overlapped,
+                       DWORD* read, BOOL* canceled)
+{
+    while (WaitForSingleObject(overlapped->hEvent, COMPARE_OVERLAPPED_WAIT) == WAIT_TIMEOUT)
+    {
+        if (!progressDlg->Continue()) // give the dialog a chance to repaint
+        {
+            *canceled = TRUE;
+            return FALSE;
+        }
+    }
+    if (!GetOverlappedResult(file, overlapped, read, TRUE))
+    {
+        if (GetLastError() != ERROR_HANDLE_EOF)
+            return FALSE;
+        *read = 0;
+    }
+    return TRUE;
+}
+
+// compares the content of 'hFile1' and 'hFile2' opened with FILE_FLAG_OVERLAPPED: both files are
+// read at the same time and the next chunks are already being read while the previous ones are
+// compared, so for files on different disks (or network shares) both devices are used at full
+// speed; if 'md5' is not NULL, the compared content of 'hFile1' is added to it; return values and
+// parameters are the same as for CompareFilesByContent()
+BOOL CompareFilesByContentOverlapped(CCmpDirProgressDialog* progressDlg, HANDLE hFile1, HANDLE hFile2,
+                                     const char* file1, const char* file2, const CQuadWord& bothFileSize,
+                                     CQuadWord* fileProgressTotal, MD5* md5, BOOL* different, BOOL* canceled)
+{
+    HANDLE files[2] = {hFile1, hFile2};
+    const char* names[2] = {file1, file2};
+    char* buffers[2][2];  // [file][chunk]: while one chunk of each file is compared, the other one is being read
+    OVERLAPPED overlapped[2];
+    HANDLE events[2];
+    BOOL pending[2] = {FALSE, FALSE}; // TRUE = a read of the file is in progress
+    DWORD read[2];
+    CQuadWord offset(0, 0);
+    int cur = 0;     // index of the chunk being compared
+    int errFile = 0; // index of the file which could not be read
+    int f;
+
+    BOOL ret = FALSE;
+    char* memory = (char*)malloc(4 * COMPARE_OVERLAPPED_CHUNK);
+    events[0] = HANDLES(CreateEvent(NULL, TRUE, FALSE, NULL));
+    events[1] = HANDLES(CreateEvent(NULL, TRUE, FALSE, NULL));
+    if (memory == NULL || events[0] == NULL || events[1] == NULL)
+    {
+        TRACE_E(LOW_MEMORY);
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        goto READ_ERROR;
+    }
+    for (f = 0; f < 2; f++)
+    {
+        buffers[f][0] = memory + (2 * f) * COMPARE_OVERLAPPED_CHUNK;
+        buffers[f][1] = memory + (2 * f + 1) * COMPARE_OVERLAPPED_CHUNK;
+    }
+
+    for (f = 0; f < 2; f++)
+    {
+        if (!StartCompareRead(files[f], buffers[f][cur], &overlapped[f], events[f], offset, &pending[f]))
+        {
+            errFile = f;
+            goto READ_ERROR;
+        }
+    }
+    while (TRUE)
+    {
+        for (f = 0; f < 2; f++)
+        {
+            read[f] = 0;
+            if (pending[f])
+            {
+                if (!FinishCompareRead(progressDlg, files[f], &overlapped[f], &read[f], canceled))
+                {
+                    if (*canceled)
+                        goto CLEANUP;
+                    pending[f] = FALSE;
+                    errFile = f;
+                    goto READ_ERROR;
+                }
+                pending[f] = FALSE;
+            }
+            AddProgressSizeWithLimit(progressDlg, read[f], fileProgressTotal, bothFileSize);
+        }
+
+        if (read[0] == COMPARE_OVERLAPPED_CHUNK && read[1] == COMPARE_OVERLAPPED_CHUNK)
+        { // start reading the next chunks, they will be read while the current ones are compared
+            for (f = 0; f < 2; f++)
+            {
+                if (!StartCompareRead(files[f], buffers[f][1 - cur], &overlapped[f], events[f],
+                                      offset + CQuadWord(COMPARE_OVERLAPPED_CHUNK, 0), &pending[f]))
+                {
+                    errFile = f;
+                    goto READ_ERROR;
+                }
+            }
+        }
+
+        if (read[0] != read[1] || // files are now of different length => content differs
+            read[0] > 0 && memcmp(buffers[0][cur], buffers[1][cur], read[0]) != 0)
+        { // file contents differ, no point in continuing reading
+            *different = TRUE;
+            ret = TRUE;
+            break;
+        }
+        if (md5 != NULL && read[0] > 0)
+            md5->update((unsigned char*)buffers[0][cur], read[0]);
+        if (read[0] != COMPARE_OVERLAPPED_CHUNK)
+        { // end of both files, files are identical
+            *different = FALSE;
+            ret = TRUE;
+            break;
+        }
+        if (!progressDlg->Continue()) // give the dialog a chance to repaint
+        {
+            *canceled = TRUE;
+            break;
+        }
+        offset += CQuadWord(COMPARE_OVERLAPPED_CHUNK, 0);
+        cur = 1 - cur;
+    }
+    goto CLEANUP;
+
+READ_ERROR:
+    {
+        DWORD err = GetLastError();
+        std::wstring msg = FormatStrW(LoadStrW(IDS_ERROR_READING_FILE), AnsiToWide(names[errFile]).c_str(), GetErrorTextW(err));
+        progressDlg->FlushDataToControls();
+        if (gPrompter->ConfirmError(LoadStrW(IDS_ERRORTITLE), msg.c_str()).type == PromptResult::kCancel)
+            *canceled = TRUE;
+    }
+
+CLEANUP:
+
+    for (f = 0; f < 2; f++)
+    {
+        if (pending[f]) // the read into our buffer must finish before the buffer is released
+        {
+            CancelIo(files[f]);
+            DWORD dummy;
+            GetOverlappedResult(files[f], &overlapped[f], &dummy, TRUE);
+        }
+        if (events[f] != NULL)
+            HANDLES(CloseHandle(events[f]));
+    }
+    if (memory != NULL)
+        free(memory);
+    return ret;
+}
+
 BOOL CompareFilesByContent(HWND hWindow, CCmpDirProgressDialog* progressDlg,
                            const char* file1, const char* file2, const CQuadWord& bothFileSize,
                            BOOL* different, BOOL* canceled)
@@ -292,10 +481,14 @@ BOOL CompareFilesByContent(HWND hWindow, CCmpDirProgressDialog* progressDlg,
 
     //  DWORD totalTi = GetTickCount();
 
+    // files on different disks are read at the same time (see CompareFilesByContentOverlapped), files
+    // on one disk are read alternately in big parts (reading both at once would only make the disk seek)
+    BOOL overlapped = !HasTheSameRootPath(file1, file2);
+    DWORD flags = FILE_FLAG_SEQUENTIAL_SCAN | (overlapped ? FILE_FLAG_OVERLAPPED : 0);
     HANDLE hFile1 = HANDLES_Q(CreateFileW(AnsiToWide(file1).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
-                                         NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL));
+                                         NULL, OPEN_EXISTING, flags, NULL));
     HANDLE hFile2 = hFile1 != INVALID_HANDLE_VALUE ? HANDLES_Q(CreateFileW(AnsiToWide(file2).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
-                                                                          NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL))
+                                                                          NULL, OPEN_EXISTING, flags, NULL))
                                                    : INVALID_HANDLE_VALUE;
     DWORD err = GetLastError();
 
@@ -315,7 +508,31 @@ BOOL CompareFilesByContent(HWND hWindow, CCmpDirProgressDialog* progressDlg,
     {
         if (hFile2 != INVALID_HANDLE_VALUE)
         {
-            if (!*canceled)
+            // if digests of both unchanged files are known from previous comparisons (or from Find
+            // Duplicates), the files need not be read; otherwise the digest of the files is computed
+            // during the comparison so it is known next time if the files are identical
+            CHashCacheKey key1, key2;
+            BYTE digest1[HASH_CACHE_DIGEST_SIZE];
+            BYTE digest2[HASH_CACHE_DIGEST_SIZE];
+            MD5 context;
+            MD5* md5 = NULL;
+            if (!*canceled && HashCache.GetKey(hFile1, &key1) && HashCache.GetKey(hFile2, &key2))
+            {
+                if (HashCache.Find(&key1, digest1) && HashCache.Find(&key2, digest2))
+                {
+                    *different = memcmp(digest1, digest2, HASH_CACHE_DIGEST_SIZE) != 0;
+                    ret = TRUE;
+                }
+                else
+                    md5 = &context;
+            }
+
+            if (!ret && !*canceled && overlapped) // 'ret' is TRUE if the result is known from the cache
+            {
+                ret = CompareFilesByContentOverlapped(progressDlg, hFile1, hFile2, file1, file2, bothFileSize,
+                                                      &fileProgressTotal, md5, different, canceled);
+            }
+            else if (!ret && !*canceled)
             {
                 char* buffer1 = (char*)malloc(COMPARE_BUFFER_SIZE);
                 //        char *buffer2 = (char *)malloc(COMPARE_BUFFER_SIZE);
@@ -376,6 +593,8 @@ BOOL CompareFilesByContent(HWND hWindow, CCmpDirProgressDialog* progressDlg,
                     }
                     if (readErr || *canceled)
                         break;
+                    if (md5 != NULL && read1 > 0)
+                        md5->update((unsigned char*)buffer1, read1);
                     readingIsFast1 = WindowsVistaAndLater &&                                                                                           // on W2K/XP this should not speed things up, so we will not tempt fate
                                      GetTickCount() - readBegTime < (DWORD)(((unsigned __int64)read1 * COMPARE_BUF_TIME_LIMIT) / COMPARE_BUFFER_SIZE); // measure the speed so it is over 1 MB/s
                                                                                                                                                        /*
@@ -502,6 +721,12 @@ BOOL CompareFilesByContent(HWND hWindow, CCmpDirProgressDialog* progressDlg,
                 free(buffer1);
                 //        free(buffer2);
             }
+            if (md5 != NULL && ret && !*different)
+            { // the files are identical, both have the digest of 'file1'
+                md5->finalize();
+                HashCache.Add(&key1, md5->digest);
+                HashCache.Add(&key2, md5->digest);
+            }
             HANDLES(CloseHandle(hFile2));
         }
         else
@@ -305,6 +305,7 @@ const char* CONFIG_CHD_SHOWCLOUDSTOR = "Change Drive Show Cloud Storages";
 const char* CONFIG_CHD_SHOWNET = "Change Drive Network";
 const char* CONFIG_CURRRENTTIPINDEX = "Current Tip Index";
 const char* CONFIG_SEARCHFILECONTENT = "Search File Content";
+const char* CONFIG_FINDKEEPRESULTSORDER = "Find Keep Results Order";
 const char* CONFIG_FINDOPTIONS_REG = "Find Options";
 const char* CONFIG_FINDIGNORE_REG = "Find Ignore";
 #ifdef _WIN64
@@ -437,6 +438,7 @@ const char* VIEWER_FINDCASESENSITIVE_REG = "Case Sensitive";
 const char* VIEWER_FINDTEXT_REG = "Find Text";
 const char* VIEWER_FINDHEXMODE_REG = "HEX-mode";
 const char* VIEWER_FINDREGEXP_REG = "Regular Expression";
+const char* VIEWER_FINDMULTIPLE_REG = "Multiple Texts";
 const char* VIEWER_CONFIGCRLF_REG = "EOL CRLF";
 const char* VIEWER_CONFIGCR_REG = "EOL CR";
 const char* VIEWER_CONFIGLF_REG = "EOL LF";
@@ -1744,6 +1746,8 @@ void CMainWindow::SaveConfig(HWND parent)
                          &Configuration.ChangeDriveShowNet, sizeof(DWORD));
                 SetValue(actKey, CONFIG_SEARCHFILECONTENT, REG_DWORD,
                          &Configuration.SearchFileContent, sizeof(DWORD));
+                SetValue(actKey, CONFIG_FINDKEEPRESULTSORDER, REG_DWORD,
+                         &Configuration.FindKeepResultsOrder, sizeof(DWORD));
                 SetValue(actKey, CONFIG_LASTPLUGINVER, REG_DWORD,
                          &Configuration.LastPluginVer, sizeof(DWORD));
                 SetValue(actKey, CONFIG_LASTPLUGINVER_OP, REG_DWORD,
@@ -2075,6 +2079,8 @@ void CMainWindow::SaveConfig(HWND parent)
                 SetValue(actKey, VIEWER_FINDTEXT_REG, REG_SZ, GlobalFindDialog.Text, -1);
                 SetValue(actKey, VIEWER_FINDHEXMODE_REG, REG_DWORD,
                          &GlobalFindDialog.HexMode, sizeof(DWORD));
+                SetValue(actKey, VIEWER_FINDMULTIPLE_REG, REG_DWORD,
+                         &GlobalFindDialog.Multiple, sizeof(DWORD));
 
                 SetValue(actKey, VIEWER_CONFIGCRLF_REG, REG_DWORD,
                          &Configuration.EOL_CRLF, sizeof(DWORD));
@@ -3291,6 +3297,8 @@ BOOL CMainWindow::LoadConfig(BOOL importingOldConfig, const CCommandLineParams*
                      &Configuration.ChangeDriveShowNet, sizeof(DWORD));
             GetValue(actKey, CONFIG_SEARCHFILECONTENT, REG_DWORD,
                      &Configuration.SearchFileContent, sizeof(DWORD));
+            GetValue(actKey, CONFIG_FINDKEEPRESULTSORDER, REG_DWORD,
+                     &Configuration.FindKeepResultsOrder, sizeof(DWORD));
             GetValue(actKey, CONFIG_LASTPLUGINVER, REG_DWORD,
                      &Configuration.LastPluginVer, sizeof(DWORD));
             GetValue(actKey, CONFIG_LASTPLUGINVER_OP, REG_DWORD,
@@ -3725,6 +3733,8 @@ BOOL CMainWindow::LoadConfig(BOOL importingOldConfig, const CCommandLineParams*
                      GlobalFindDialog.Text, FIND_TEXT_LEN);
             GetValue(actKey, VIEWER_FINDHEXMODE_REG, REG_DWORD,
                      &GlobalFindDialog.HexMode, sizeof(DWORD));
+            GetValue(actKey, VIEWER_FINDMULTIPLE_REG, REG_DWORD,
+                     &GlobalFindDialog.Multiple, sizeof(DWORD));
 
             GetValue(actKey, VIEWER_CONFIGCRLF_REG, REG_DWORD,
                      &Configuration.EOL_CRLF, sizeof(DWORD));
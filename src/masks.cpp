@@ -287,6 +287,313 @@ BOOL AgreeQSMask(const char* filename, BOOL hasExtension, const char* mask, BOOL
     return AgreeQSMaskAux(filename, hasExtension, filename, mask, wholeString, offset);
 }
 
+//*****************************************************************************
+//
+// CMaskAutomaton
+//
+
+#define MASK_AUTOMATON_HASH_SIZE (2 * MASK_AUTOMATON_MAX_STATES) // size of the hash table of states used during Build (power of two)
+
+// adds position 'pos' to the set 'set' together with positions which can be reached from it
+// without reading a character ('*' can represent an empty string)
+static void AddMaskPosition(DWORD* set, const char* posChars, int pos)
+{
+    while (1)
+    {
+        set[pos >> 5] |= 1 << (pos & 31);
+        if (posChars[pos] != '*')
+            break;
+        pos++;
+    }
+}
+
+// the same test as in AgreeMask: does character 'c' of the name match character 'm' of the mask?
+static inline BOOL MaskCharAgrees(char m, BYTE c, BOOL extendedMode)
+{
+    return LowerCase[c] == LowerCase[(BYTE)m] || m == '?' ||
+           extendedMode && m == '#' && c >= '0' && c <= '9';
+}
+
+static DWORD GetMaskPositionsHash(const DWORD* set, int words)
+{
+    DWORD hash = 0;
+    int i;
+    for (i = 0; i < words; i++)
+        hash = (hash ^ set[i]) * 0x01000193;
+    return hash;
+}
+
+CMaskAutomaton::CMaskAutomaton()
+{
+    ClassCount = 0;
+    StateCount = 0;
+    Transitions = NULL;
+    Accept = NULL;
+    DeadState = -1;
+}
+
+CMaskAutomaton::~CMaskAutomaton()
+{
+    Release();
+}
+
+void CMaskAutomaton::Release()
+{
+    if (Transitions != NULL)
+        free(Transitions);
+    if (Accept != NULL)
+        free(Accept);
+    Transitions = NULL;
+    Accept = NULL;
+    ClassCount = 0;
+    StateCount = 0;
+    DeadState = -1;
+}
+
+BOOL CMaskAutomaton::Build(TDirectArray<char*>& masks, BOOL extendedMode)
+{
+    CALL_STACK_MESSAGE1("CMaskAutomaton::Build(,)");
+    Release();
+
+    // positions in masks: all characters of masks including the terminating nulls (= end of mask)
+    int posCount = 0;
+    int maskCount = 0;
+    int i;
+    for (i = 0; i < masks.Count; i++)
+    {
+        if (masks[i] != NULL && ((CMaskItemFlags*)masks[i])->Optimize == MASK_OPTIMIZE_NONE)
+        {
+            posCount += (int)strlen(masks[i] + 1) + 1;
+            maskCount++;
+        }
+    }
+    if (maskCount == 0)
+        return FALSE;
+
+    int words = (posCount + 31) / 32; // size of a set of positions in DWORDs
+    char* posChars = (char*)malloc(posCount);
+    BYTE* posAccept = (BYTE*)malloc(posCount);
+    int* starts = (int*)malloc(maskCount * sizeof(int));
+    DWORD* sets = (DWORD*)malloc(MASK_AUTOMATON_MAX_STATES * words * sizeof(DWORD)); // sets of positions of states
+    int* hashTable = (int*)malloc(MASK_AUTOMATON_HASH_SIZE * sizeof(int));
+    DWORD* next = (DWORD*)malloc(words * sizeof(DWORD));
+    BOOL ret = FALSE;
+    if (posChars == NULL || posAccept == NULL || starts == NULL || sets == NULL || hashTable == NULL || next == NULL)
+    {
+        TRACE_E(LOW_MEMORY);
+        goto EXIT;
+    }
+
+    // copy masks and compute which masks match if the name ends at each position (the rest of the mask
+    // can represent an empty string; see the end of AgreeMask for the special case of "*.*")
+    int pos;
+    pos = 0;
+    maskCount = 0;
+    for (i = 0; i < masks.Count; i++)
+    {
+        CMaskItemFlags* flags = (CMaskItemFlags*)masks[i];
+        if (flags == NULL || flags->Optimize != MASK_OPTIMIZE_NONE)
+            continue;
+        const char* mask = masks[i] + 1;
+        int l = (int)strlen(mask) + 1;
+        memcpy(posChars + pos, mask, l);
+        starts[maskCount++] = pos;
+        int j;
+        for (j = 0; j < l; j++)
+        {
+            const char* rest = mask + j;
+            if (*rest == '*')
+                rest++;
+            BYTE accept = 0;
+            if (*rest == 0)
+                accept = MASK_AUTOMATON_INCLUDE_EXT | MASK_AUTOMATON_INCLUDE_NOEXT;
+            else
+            {
+                if (rest[0] == '.' && (rest[1] == 0 || rest[1] == '*' && rest[2] == 0))
+                    accept = MASK_AUTOMATON_INCLUDE_NOEXT;
+            }
+            posAccept[pos + j] = flags->Exclude ? (accept << 2) : accept; // MASK_AUTOMATON_INCLUDE_xxx -> MASK_AUTOMATON_EXCLUDE_xxx
+        }
+        pos += l;
+    }
+
+    // byte classes: bytes equal to some literal of masks (ignoring case), digits (if '#' is used)
+    // and all other bytes
+    BYTE isLiteral[256];
+    BYTE classRep[256]; // a byte representing each class
+    int classOfLower[256];
+    BOOL digitMask;
+    int digitClass, otherClass;
+    memset(isLiteral, 0, sizeof(isLiteral));
+    digitMask = FALSE;
+    for (i = 0; i < posCount; i++)
+    {
+        BYTE m = (BYTE)posChars[i];
+        if (m == 0 || m == '*' || m == '?')
+            continue;
+        if (extendedMode && m == '#')
+        {
+            digitMask = TRUE;
+            isLiteral['#'] = 1; // '#' in the name is matched by '#' in the mask too
+        }
+        else
+            isLiteral[LowerCase[m]] = 1;
+    }
+    for (i = 0; i < 256; i++)
+        classOfLower[i] = -1;
+    digitClass = -1;
+    otherClass = -1;
+    for (i = 0; i < 256; i++)
+    {
+        int* cls;
+        if (i != 0 && isLiteral[LowerCase[i]])
+            cls = &classOfLower[LowerCase[i]];
+        else
+        {
+            if (digitMask && i >= '0' && i <= '9')
+                cls = &digitClass;
+            else
+                cls = &otherClass;
+        }
+        if (*cls == -1)
+        {
+            *cls = ClassCount;
+            classRep[ClassCount++] = (BYTE)i;
+        }
+        ByteClass[i] = (BYTE)*cls;
+    }
+
+    Transitions = (int*)malloc(MASK_AUTOMATON_MAX_STATES * ClassCount * sizeof(int));
+    Accept = (BYTE*)malloc(MASK_AUTOMATON_MAX_STATES);
+    if (Transitions == NULL || Accept == NULL)
+    {
+        TRACE_E(LOW_MEMORY);
+        goto EXIT;
+    }
+
+    // subset construction: the initial state contains beginnings of all masks
+    memset(sets, 0, words * sizeof(DWORD));
+    for (i = 0; i < maskCount; i++)
+        AddMaskPosition(sets, posChars, starts[i]);
+    for (i = 0; i < MASK_AUTOMATON_HASH_SIZE; i++)
+        hashTable[i] = -1;
+    hashTable[GetMaskPositionsHash(sets, words) & (MASK_AUTOMATON_HASH_SIZE - 1)] = 0;
+    StateCount = 1;
+
+    int state;
+    for (state = 0; state < StateCount; state++)
+    {
+        const DWORD* set = sets + state * words;
+        BYTE accept = 0;
+        int w;
+        for (w = 0; w < words; w++)
+        {
+            DWORD bits = set[w];
+            unsigned long bit;
+            while (_BitScanForward(&bit, bits))
+            {
+                accept |= posAccept[w * 32 + bit];
+                bits &= bits - 1;
+            }
+        }
+        Accept[state] = accept;
+
+        int cls;
+        for (cls = 0; cls < ClassCount; cls++)
+        {
+            memset(next, 0, words * sizeof(DWORD));
+            for (w = 0; w < words; w++)
+            {
+                DWORD bits = set[w];
+                unsigned long bit;
+                while (_BitScanForward(&bit, bits))
+                {
+                    int p = w * 32 + bit;
+                    char m = posChars[p];
+                    if (m == '*')
+                        AddMaskPosition(next, posChars, p); // '*' represents one more character
+                    else
+                    {
+                        if (m != 0 && MaskCharAgrees(m, classRep[cls], extendedMode))
+                            AddMaskPosition(next, posChars, p + 1);
+                    }
+                    bits &= bits - 1;
+                }
+            }
+
+            // find the state with this set of positions or add a new one
+            int slot = GetMaskPositionsHash(next, words) & (MASK_AUTOMATON_HASH_SIZE - 1);
+            while (hashTable[slot] != -1 && memcmp(sets + hashTable[slot] * words, next, words * sizeof(DWORD)) != 0)
+                slot = (slot + 1) & (MASK_AUTOMATON_HASH_SIZE - 1);
+            if (hashTable[slot] == -1)
+            {
+                if (StateCount >= MASK_AUTOMATON_MAX_STATES)
+                {
+                    TRACE_I("CMaskAutomaton::Build(): too many states, masks will be tried one by one.");
+                    goto EXIT;
+                }
+                memcpy(sets + StateCount * words, next, words * sizeof(DWORD));
+                hashTable[slot] = StateCount++;
+            }
+            Transitions[state * ClassCount + cls] = hashTable[slot];
+        }
+    }
+
+    // state without positions: no mask can match, the rest of the name need not be read
+    memset(next, 0, words * sizeof(DWORD));
+    for (state = 0; state < StateCount; state++)
+    {
+        if (memcmp(sets + state * words, next, words * sizeof(DWORD)) == 0)
+        {
+            DeadState = state;
+            break;
+        }
+    }
+
+    // release unused parts of arrays (cannot fail when shrinking, but check anyway)
+    int* trans;
+    trans = (int*)realloc(Transitions, StateCount * ClassCount * sizeof(int));
+    if (trans != NULL)
+        Transitions = trans;
+    BYTE* acc;
+    acc = (BYTE*)realloc(Accept, StateCount);
+    if (acc != NULL)
+        Accept = acc;
+    ret = TRUE;
+
+EXIT:
+    if (posChars != NULL)
+        free(posChars);
+    if (posAccept != NULL)
+        free(posAccept);
+    if (starts != NULL)
+        free(starts);
+    if (sets != NULL)
+        free(sets);
+    if (hashTable != NULL)
+        free(hashTable);
+    if (next != NULL)
+        free(next);
+    if (!ret)
+        Release();
+    return ret;
+}
+
+void CMaskAutomaton::Match(const char* fileName, BOOL hasExtension, BOOL* include, BOOL* exclude) const
+{
+    int state = 0;
+    const BYTE* s = (const BYTE*)fileName;
+    while (*s != 0)
+    {
+        state = Transitions[state * ClassCount + ByteClass[*s++]];
+        if (state == DeadState)
+            break;
+    }
+    BYTE accept = Accept[state];
+    *include = (accept & (hasExtension ? MASK_AUTOMATON_INCLUDE_EXT : MASK_AUTOMATON_INCLUDE_NOEXT)) != 0;
+    *exclude = (accept & (hasExtension ? MASK_AUTOMATON_EXCLUDE_EXT : MASK_AUTOMATON_EXCLUDE_NOEXT)) != 0;
+}
+
 //*****************************************************************************
 //
 // CMaskGroup
@@ -300,6 +607,7 @@ CMaskGroup::CMaskGroup()
     ExtendedMode = FALSE;
     MasksHashArray = NULL;
     MasksHashArraySize = 0;
+    Automaton = NULL;
 }
 
 CMaskGroup::CMaskGroup(const char* masks, BOOL extendedMode)
@@ -307,6 +615,7 @@ CMaskGroup::CMaskGroup(const char* masks, BOOL extendedMode)
 {
     MasksHashArray = NULL;
     MasksHashArraySize = 0;
+    Automaton = NULL;
     SetMasksString(masks, extendedMode);
 }
 
@@ -328,6 +637,7 @@ void CMaskGroup::Release()
     }
     PreparedMasks.DestroyMembers();
     ReleaseMasksHashArray();
+    ReleaseAutomaton();
 }
 
 CMaskGroup&
@@ -348,6 +658,15 @@ CMaskGroup::operator=(const CMaskGroup& s)
     return *this;
 }
 
+void CMaskGroup::ReleaseAutomaton()
+{
+    if (Automaton != NULL)
+    {
+        delete Automaton;
+        Automaton = NULL;
+    }
+}
+
 void CMaskGroup::ReleaseMasksHashArray()
 {
     if (MasksHashArray != NULL)
@@ -438,6 +757,7 @@ BOOL CMaskGroup::PrepareMasks(int& errorPos, const char* masksString)
             free(PreparedMasks[i]);
     PreparedMasks.DestroyMembers();
     ReleaseMasksHashArray();
+    ReleaseAutomaton();
 
     const char* useMasksString = masksString == NULL ? MasksString : masksString;
     const char* s = useMasksString;
@@ -664,6 +984,25 @@ BOOL CMaskGroup::PrepareMasks(int& errorPos, const char* masksString)
             MasksHashArraySize = 0;
         }
     }
+
+    // masks which cannot be optimized are matched by one automaton (if there are enough of them)
+    int unoptimizedMasks = 0;
+    for (i = 0; i < PreparedMasks.Count; i++)
+    {
+        if (PreparedMasks[i] != NULL && ((CMaskItemFlags*)PreparedMasks[i])->Optimize == MASK_OPTIMIZE_NONE)
+            unoptimizedMasks++;
+    }
+    if (unoptimizedMasks >= MASK_AUTOMATON_MIN_MASKS)
+    {
+        Automaton = new CMaskAutomaton;
+        if (Automaton == NULL)
+            TRACE_E(LOW_MEMORY);
+        else
+        {
+            if (!Automaton->Build(PreparedMasks, ExtendedMode))
+                ReleaseAutomaton(); // masks will be tried one by one
+        }
+    }
     NeedPrepare = FALSE;
     return TRUE;
 }
@@ -691,6 +1030,14 @@ BOOL CMaskGroup::AgreeMasks(const char* fileName, const char* fileExt)
         TRACE_E("CMaskGroup::AgreeMasks: Unexpected situation: fileName starts with '.' but fileExt points to end of name: " << fileName);
         ext = fileName + 1;
     }
+    BOOL automatonInclude = FALSE; // TRUE = some include mask matched by Automaton matches
+    if (Automaton != NULL)
+    {
+        BOOL automatonExclude;
+        Automaton->Match(fileName, *fileExt != 0, &automatonInclude, &automatonExclude);
+        if (automatonExclude)
+            return FALSE;
+    }
     int i;
     for (i = 0; i < PreparedMasks.Count; i++)
     {
@@ -698,6 +1045,8 @@ BOOL CMaskGroup::AgreeMasks(const char* fileName, const char* fileExt)
         if (mask != NULL)
         {
             CMaskItemFlags* flags = (CMaskItemFlags*)mask;
+            if (Automaton != NULL && flags->Optimize == MASK_OPTIMIZE_NONE)
+                continue; // already matched by Automaton
             if (flags->Exclude == 1)
             {
                 if (flags->Optimize == MASK_OPTIMIZE_ALL) // *.*; *
@@ -715,6 +1064,8 @@ BOOL CMaskGroup::AgreeMasks(const char* fileName, const char* fileExt)
             }
             else
             {
+                if (automatonInclude) // exclude masks are before include masks, all of them were tested
+                    return TRUE;
                 if (flags->Optimize == MASK_OPTIMIZE_ALL) // *.*; *
                     return TRUE;
                 if (flags->Optimize == MASK_OPTIMIZE_EXTENSION) // *.xxxx
@@ -730,6 +1081,8 @@ BOOL CMaskGroup::AgreeMasks(const char* fileName, const char* fileExt)
             }
         }
     }
+    if (automatonInclude)
+        return TRUE;
     if (MasksHashArray != NULL) // there are still some masks in the hash array
     {
         DWORD hash = 0;
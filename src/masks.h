@@ -66,6 +66,54 @@ struct CMaskItemFlags
                            // exclude masks are stored before include masks in PreparedMasks array
 };
 
+//*****************************************************************************
+//
+// CMaskAutomaton
+//
+// Deterministic automaton built from all masks of a group which cannot be optimized (see
+// MASK_OPTIMIZE_NONE), include and exclude masks together; one pass over the name tells
+// whether some include mask and some exclude mask matches, the result is the same as calling
+// AgreeMask for each mask. Bytes are divided into classes (bytes which cannot be told apart by
+// any mask share one class) and states are sets of mask positions; when the group would need
+// more than MASK_AUTOMATON_MAX_STATES states, Build fails and masks are tried one by one.
+// The automaton is read-only after Build, so AgreeMasks may be called from more threads.
+
+#define MASK_AUTOMATON_MIN_MASKS 3     // for fewer masks, AgreeMask is fast enough
+#define MASK_AUTOMATON_MAX_STATES 1024 // limit for the number of states of the automaton
+
+// flags of CMaskAutomaton::Accept: which masks match if the name ends in the given state
+#define MASK_AUTOMATON_INCLUDE_EXT 0x01   // some include mask matches a name with an extension
+#define MASK_AUTOMATON_INCLUDE_NOEXT 0x02 // some include mask matches a name without an extension
+#define MASK_AUTOMATON_EXCLUDE_EXT 0x04   // some exclude mask matches a name with an extension
+#define MASK_AUTOMATON_EXCLUDE_NOEXT 0x08 // some exclude mask matches a name without an extension
+
+class CMaskAutomaton
+{
+protected:
+    BYTE ByteClass[256]; // class of each byte of the name
+    int ClassCount;      // number of byte classes
+    int StateCount;      // number of states; state 0 is the initial one
+    int* Transitions;    // [StateCount * ClassCount]: next state for the state and the byte class
+    BYTE* Accept;        // [StateCount]: MASK_AUTOMATON_xxx flags valid at the end of the name
+    int DeadState;       // state from which no mask can match (-1 if there is no such state)
+
+public:
+    CMaskAutomaton();
+    ~CMaskAutomaton();
+
+    // builds the automaton from masks with CMaskItemFlags::Optimize == MASK_OPTIMIZE_NONE in
+    // 'masks' (format see CMaskItemFlags); returns FALSE if the automaton would be too big
+    // or on low memory
+    BOOL Build(TDirectArray<char*>& masks, BOOL extendedMode);
+
+    // returns in 'include' and 'exclude' whether 'fileName' matches some include or exclude
+    // mask the automaton was built from; 'hasExtension' see AgreeMask
+    void Match(const char* fileName, BOOL hasExtension, BOOL* include, BOOL* exclude) const;
+
+protected:
+    void Release();
+};
+
 struct CMasksHashEntry
 {
     CMaskItemFlags* Mask;  // internal mask representation, see CMaskItemFlags for the format
@@ -83,6 +131,8 @@ protected:
     CMasksHashEntry* MasksHashArray; // if not NULL, it is a hash array containing all masks with MASK_OPTIMIZE_EXTENSION format (only those with CMaskItemFlags::Exclude==0)
     int MasksHashArraySize;          // size of MasksHashArray (twice the number of stored masks)
 
+    CMaskAutomaton* Automaton; // if not NULL, all masks with MASK_OPTIMIZE_NONE format are matched by this automaton
+
 public:
     CMaskGroup();
     CMaskGroup(const char* masks, BOOL extendedMode = FALSE);
@@ -122,4 +172,7 @@ public:
 protected:
     // releases the hash array MasksHashArray
     void ReleaseMasksHashArray();
+
+    // releases Automaton
+    void ReleaseAutomaton();
 };
@@ -326,6 +326,7 @@ MENU_TEMPLATE_ITEM FindMenuTemplate[] =
         {MNTT_PB, IDS_FFMENU_OPTIONS, MNTS_B | MNTS_I | MNTS_A, CML_FIND_OPTIONS, -1, 0, NULL},
         {MNTT_IT, IDS_FFMENU_OPT_SHOWERRORS, MNTS_B | MNTS_I | MNTS_A, CM_FIND_SHOWERRORS, -1, 0, NULL},
         {MNTT_IT, IDS_FFMENU_OPT_FULLROWSEL, MNTS_B | MNTS_I | MNTS_A, CM_FIND_FULLROWSEL, -1, 0, NULL},
+        {MNTT_IT, IDS_FFMENU_OPT_KEEPORDER, MNTS_B | MNTS_I | MNTS_A, CM_FIND_KEEPORDER, -1, 0, NULL},
         {MNTT_IT, IDS_FFMENU_OPT_IGNORE, MNTS_B | MNTS_I | MNTS_A, CM_FIND_IGNORE, -1, 0, NULL},
 
         {MNTT_SP, -1, MNTS_B | MNTS_I | MNTS_A, 0, -1, 0, NULL},
@@ -38,6 +38,8 @@
 #include <math.h>
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <algorithm>
 
 // Long path support (Phase 1)
 #include "common/widepath.h"
@@ -89,7 +91,9 @@
 #include "str.h"
 #include "callstk.h"
 #include "moore.h"
+#include "multisearch.h"
 #include "regexp.h"
+#include "linregexp.h"
 #include "filter.h"
 #include "regwork.h"
 
@@ -36,7 +36,13 @@ protected:
 public:
     // j.r. is increasing the delta to 800 because when entering larger directories (several thousand files)
     // Enlarge() starts to really eat CPU according to the profiler
-    CFilesArray(int base = 200, int delta = 800) : TDirectArray<CFileData>(base, delta) { DeleteData = TRUE; }
+    // listings are enlarged geometrically, so reading of directories with hundreds of thousands
+    // of files does not move the array again and again
+    CFilesArray(int base = 200, int delta = 800) : TDirectArray<CFileData>(base, delta)
+    {
+        DeleteData = TRUE;
+        SetGrowGeometric(TRUE);
+    }
     ~CFilesArray() { Destroy(); }
 
     void SetDeleteData(BOOL deleteData) { DeleteData = deleteData; }
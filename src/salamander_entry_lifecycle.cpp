@@ -27,6 +27,7 @@
 #include "ui/IPrompter.h"
 #include "editwnd.h"
 #include "find.h"
+#include "hashcache.h"
 #include "zip.h"
 #include "pack.h"
 #include "cache.h"
@@ -60,7 +61,9 @@ extern "C"
 #include "execute.h"
 #include "drivelst.h"
 
+#ifndef SAL_BENCH // salbench.exe is a console application with main()
 #pragma comment(linker, "/ENTRY:MyEntryPoint") // we want our own application entry point
+#endif // SAL_BENCH
 
 #pragma comment(lib, "uxtheme.lib")
 
@@ -4615,6 +4618,10 @@ FIND_NEW_SLG_FILE:
                     if (IsSLGIncomplete[0] != 0 && Configuration.ShowSLGIncomplete)
                         PostMessage(MainWindow->HWindow, WM_USER_SLGINCOMPLETE, 0, 0);
 
+                    // offer to resume Copy/Move operations interrupted in the previous session (journals are on disk)
+                    if (ExistInterruptedCopies())
+                        PostMessage(MainWindow->HWindow, WM_USER_RESUMECOPIES, 0, 0);
+
                     //--- application loop
                     CALL_STACK_MESSAGE1("WinMainBody::message_loop");
                     DWORD activateParamsRequestUID = 0;
@@ -4947,6 +4954,7 @@ FIND_NEW_SLG_FILE:
     ReleaseWinLib();
     ReleaseMenuWheelHook();
     ReleaseFind();
+    ReleaseHashCache();
     ReleaseCheckThreads();
     ReleasePreloadedStrings();
     ReleaseShellib();
@@ -0,0 +1,106 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+#include "salbench.h"
+
+#define BENCH_ARRAY_REPEAT 3 // each fill is repeated, the best time is printed
+
+// ways of growing the array of a listing
+enum CBenchArrayGrowth
+{
+    bagLinear,    // by Delta (CFilesArray before SetGrowGeometric)
+    bagGeometric, // SetGrowGeometric(TRUE) (CFilesArray)
+    bagReserve,   // Reserve() of the known count (archive and plugin listings, Find results)
+    bagCount
+};
+
+static const char* BenchArrayGrowthNames[bagCount] = {"linear", "geometric", "reserve"};
+
+// array of a listing (the same Base and Delta as CFilesArray) which tells how much it was enlarged
+class CBenchFilesArray : public TDirectArray<CFileData>
+{
+public:
+    CBenchFilesArray() : TDirectArray<CFileData>(200, 800) {}
+
+    int GetAvailable() const { return Available; }
+};
+
+struct CBenchArrayResult
+{
+    double Time;   // time of the fill
+    int Enlarges;  // number of enlargements of the array
+    int Moves;     // number of enlargements which moved the array to another address
+    int Available; // allocated size of the array at the end
+};
+
+// adds 'count' items to an empty array grown by 'growth'; returns FALSE on low memory
+static BOOL FillBenchArray(CBenchArrayGrowth growth, int count, CBenchArrayResult& res)
+{
+    CFileData item;
+    memset(&item, 0, sizeof(item));
+
+    CBenchFilesArray array;
+    double start = GetBenchTime();
+    if (growth == bagGeometric)
+        array.SetGrowGeometric(TRUE);
+    if (growth == bagReserve)
+        array.Reserve(count);
+    res.Enlarges = 0;
+    res.Moves = 0;
+    int available = array.GetAvailable();
+    const CFileData* data = array.GetData();
+    for (int i = 0; i < count; i++)
+    {
+        item.PluginData = i; // let the items differ
+        array.Add(item);
+        if (!array.IsGood())
+        {
+            fprintf(stderr, "salbench: out of memory\n");
+            return FALSE;
+        }
+        if (array.GetAvailable() != available)
+        {
+            res.Enlarges++;
+            if (array.GetData() != data)
+                res.Moves++;
+            available = array.GetAvailable();
+            data = array.GetData();
+        }
+    }
+    res.Time = GetBenchTime() - start;
+    res.Available = available;
+    array.DetachMembers(); // the items own nothing
+    return TRUE;
+}
+
+BOOL RunArraySuite(CBenchContext& ctx)
+{
+    printf("\nTDirectArray<CFileData> (base 200, delta 800 like CFilesArray), %d bytes per item:\n",
+           (int)sizeof(CFileData));
+    printf("  %9s %-10s %10s %10s %8s %8s %10s\n", "items", "growth", "time ms", "items/s", "enlarges", "moves",
+           "alloc MB");
+    static const int counts[] = {10000, 100000, 1000000};
+    for (int c = 0; c < _countof(counts); c++)
+    {
+        int count = counts[c] * ctx.Scale;
+        for (int growth = 0; growth < bagCount; growth++)
+        {
+            CBenchArrayResult best;
+            for (int r = 0; r < BENCH_ARRAY_REPEAT; r++)
+            {
+                CBenchArrayResult res;
+                if (!FillBenchArray((CBenchArrayGrowth)growth, count, res))
+                    return FALSE;
+                if (r == 0 || res.Time < best.Time)
+                    best = res;
+            }
+            double time = max(best.Time, 0.000001);
+            printf("  %9d %-10s %10.2f %10.0f %8d %8d %10.1f\n", count, BenchArrayGrowthNames[growth], time * 1000,
+                   count / time, best.Enlarges, best.Moves,
+                   (double)best.Available * sizeof(CFileData) / (1024 * 1024));
+        }
+    }
+    return TRUE;
+}
@@ -0,0 +1,110 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+#include "cfgdlg.h"
+#include "find.h"
+#include "salbench.h"
+
+#define BENCH_FIND_TEXT 16777216 // size of the searched texts (multiplied by the scale)
+#define BENCH_FIND_REPEAT 3      // each search is repeated, the best time is printed
+
+// searches the whole 'txt' the way TestFileContentAux searches a view of a file which does not
+// contain the text: by data->SearchData and with the Unicode option also by data->EncodedTexts;
+// returns the time or a negative number if the text was found
+static double SearchBenchText(CGrepData* data, char* txt, int size, BOOL unicode)
+{
+    double best = 0;
+    for (int r = 0; r < BENCH_FIND_REPEAT; r++)
+    {
+        double start = GetBenchTime();
+        if (SearchForward(data, txt, size, 0) != -1 ||
+            (unicode && SearchEncodedForward(data, txt, size, 0) != -1))
+        {
+            return -1;
+        }
+        double time = GetBenchTime() - start;
+        if (r == 0 || time < best)
+            best = time;
+    }
+    return max(best, 0.000001);
+}
+
+BOOL RunFindSuite(CBenchContext& ctx)
+{
+    printf("\nFind, content of files without the text (the text as typed, then the Unicode option):\n");
+
+    // an ANSI text file and the same text in UTF-16LE, the searched texts are not in them
+    int size = BENCH_FIND_TEXT * ctx.Scale;
+    char* ansiText = (char*)malloc(size);
+    char* utf16Text = (char*)malloc(size);
+    if (ansiText == NULL || utf16Text == NULL)
+    {
+        fprintf(stderr, "salbench: out of memory\n");
+        free(ansiText);
+        free(utf16Text);
+        return FALSE;
+    }
+    static const char textChars[] = "etaoinshrdlucmfwypvbgk ETAOINSHRDL\r\n.,"; // without q, z, j and diacritics
+    SetBenchRandomSeed(1);
+    for (int i = 0; i < size; i++)
+        ansiText[i] = textChars[GetBenchRandom(_countof(textChars) - 1)];
+    for (int i = 0; i + 1 < size; i += 2)
+    {
+        utf16Text[i] = ansiText[i / 2];
+        utf16Text[i + 1] = 0;
+    }
+
+    struct CFindText
+    {
+        const char* Text;
+        const char* Name;
+        BOOL CaseSensitive;
+    };
+    static const CFindText findTexts[] = {
+        {"Salamander", "\"Salamander\"", FALSE},
+        {"Salamander", "\"Salamander\" case", TRUE},
+        {"Gr\xFC\xDF" "e", "\"Gr\\xFC\\xDFe\"", FALSE}, // "Grüße" in cp1250 and cp1252
+        {"qzj", "\"qzj\"", FALSE},
+    };
+    printf("  %-22s %-6s %9s %12s %12s %9s\n", "text", "file", "variants", "as typed MB/s", "Unicode MB/s",
+           "slowdown");
+    BOOL ok = TRUE;
+    for (int t = 0; ok && t < _countof(findTexts); t++)
+    {
+        CGrepData* data = new CGrepData;
+        data->StopSearch = FALSE;
+        data->WholeWords = FALSE;
+        data->Unicode = TRUE;
+        WORD flags = (WORD)(sfForward | (findTexts[t].CaseSensitive ? sfCaseSensitive : 0));
+        data->SearchData.Set(findTexts[t].Text, flags);
+        if (!data->SearchData.IsGood() || !SetEncodedTexts(data, findTexts[t].Text, flags))
+        {
+            fprintf(stderr, "salbench: cannot set the searched text %s\n", findTexts[t].Name);
+            delete data;
+            ok = FALSE;
+            break;
+        }
+        int variants = data->Unicode ? data->EncodedTexts.GetCount() : 0;
+        for (int f = 0; f < 2; f++)
+        {
+            char* txt = f == 0 ? ansiText : utf16Text;
+            double plainTime = SearchBenchText(data, txt, size, FALSE);
+            double unicodeTime = data->Unicode ? SearchBenchText(data, txt, size, TRUE) : plainTime;
+            if (plainTime < 0 || unicodeTime < 0)
+            {
+                fprintf(stderr, "salbench: %s found in the text\n", findTexts[t].Name);
+                ok = FALSE;
+                break;
+            }
+            printf("  %-22s %-6s %9d %12.0f %12.0f %8.2fx\n", findTexts[t].Name, f == 0 ? "ANSI" : "UTF-16",
+                   variants, size / plainTime / (1024 * 1024), size / unicodeTime / (1024 * 1024),
+                   unicodeTime / plainTime);
+        }
+        delete data;
+    }
+    free(ansiText);
+    free(utf16Text);
+    return ok;
+}
@@ -0,0 +1,201 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+#include "salbench.h"
+
+#define BENCH_MASKS_GROUPS 4000  // number of random mask groups of the equivalence check
+#define BENCH_MASKS_NAMES 250    // number of random names tried for each group
+#define BENCH_MASKS_MAX_REPORT 5 // number of printed mismatches
+
+static void RandomString(char* buf, const char* alphabet, int minLen, int maxLen)
+{
+    int len = minLen + GetBenchRandom(maxLen - minLen + 1);
+    int alphabetLen = (int)strlen(alphabet);
+    for (int i = 0; i < len; i++)
+        buf[i] = alphabet[GetBenchRandom(alphabetLen)];
+    buf[len] = 0;
+}
+
+// prepared mask of CBenchMaskGroup
+struct CBenchMask
+{
+    char Mask[20]; // the mask after PrepareMask
+    int Optimize;  // MASK_OPTIMIZE_xxx chosen the same way as CMaskGroup::PrepareMasks
+    BOOL Exclude;
+};
+
+// reference matching of a mask group: each mask separately by AgreeMask (or by the extension
+// for "*.xxx", like CMaskGroup::AgreeMasks), i.e. CMaskGroup::AgreeMasks without CMaskAutomaton
+class CBenchMaskGroup
+{
+public:
+    std::vector<CBenchMask> Masks;
+    BOOL ExtendedMode;
+
+    void Add(const char* mask, BOOL exclude)
+    {
+        CBenchMask m;
+        PrepareMask(m.Mask, mask);
+        m.Exclude = exclude;
+        m.Optimize = MASK_OPTIMIZE_NONE;
+        if (strcmp(m.Mask, "*") == 0 || strcmp(m.Mask, "*.*") == 0)
+            m.Optimize = MASK_OPTIMIZE_ALL;
+        else if (m.Mask[0] == '*' && m.Mask[1] == '.' && m.Mask[2] != 0 &&
+                 strcspn(m.Mask + 2, ExtendedMode ? "*?#." : "*?.") == strlen(m.Mask + 2))
+        {
+            m.Optimize = MASK_OPTIMIZE_EXTENSION;
+        }
+        Masks.push_back(m);
+    }
+
+    // number of masks matched by CMaskAutomaton in CMaskGroup
+    int GetAutomatonMasks()
+    {
+        int count = 0;
+        for (size_t i = 0; i < Masks.size(); i++)
+            if (Masks[i].Optimize == MASK_OPTIMIZE_NONE)
+                count++;
+        return count;
+    }
+
+    BOOL Agree(const char* fileName)
+    {
+        // the extension is searched the same way as in CMaskGroup::AgreeMasks
+        int len = (int)strlen(fileName);
+        const char* fileExt = fileName + len;
+        while (--fileExt >= fileName && *fileExt != '.')
+            ;
+        fileExt = fileExt < fileName ? fileName + len : fileExt + 1;
+        const char* ext = fileExt;
+        if (*ext == 0 && *fileName == '.' && *(ext - 1) != '.')
+            ext = fileName + 1;
+
+        BOOL include = TRUE; // without include masks, "*" is used
+        for (size_t i = 0; i < Masks.size(); i++)
+        {
+            if (!Masks[i].Exclude)
+            {
+                include = FALSE;
+                break;
+            }
+        }
+        for (size_t i = 0; i < Masks.size(); i++)
+        {
+            const CBenchMask& m = Masks[i];
+            BOOL agree;
+            if (m.Optimize == MASK_OPTIMIZE_ALL)
+                agree = TRUE;
+            else if (m.Optimize == MASK_OPTIMIZE_EXTENSION)
+                agree = StrICmp(ext, m.Mask + 2) == 0;
+            else
+                agree = AgreeMask(fileName, m.Mask, *fileExt != 0, ExtendedMode);
+            if (agree && m.Exclude)
+                return FALSE;
+            if (agree)
+                include = TRUE;
+        }
+        return include;
+    }
+};
+
+BOOL RunMasksSuite(CBenchContext& ctx)
+{
+    // masks and names of the same few characters (incl. upper case, digits and letters
+    // with diacritics in the ANSI code page), so that they match often enough
+    static const char* maskChars = "aAb.1*?#\xE1";
+    static const char* nameChars = "aAbB.19\xE1\xC1";
+
+    printf("\nmask groups (CMaskGroup::AgreeMasks with CMaskAutomaton against AgreeMask):\n");
+    SetBenchRandomSeed(1);
+    int automatonGroups = 0;
+    int mismatches = 0;
+    __int64 checks = 0;
+    char groupStr[MAX_GROUPMASK];
+    char mask[20];
+    char name[20];
+    for (int g = 0; g < BENCH_MASKS_GROUPS; g++)
+    {
+        CBenchMaskGroup reference;
+        reference.ExtendedMode = (g & 1) != 0;
+        int count = 3 + GetBenchRandom(6);
+        int excludeFrom = GetBenchRandom(3) == 0 ? GetBenchRandom(count) : count; // masks behind '|' are excluded
+        groupStr[0] = 0;
+        for (int m = 0; m < count; m++)
+        {
+            RandomString(mask, maskChars, 1, 7);
+            reference.Add(mask, m >= excludeFrom);
+            if (m > 0)
+                strcat(groupStr, m == excludeFrom ? "|" : ";");
+            else if (excludeFrom == 0)
+                strcat(groupStr, "|");
+            strcat(groupStr, mask);
+        }
+
+        CMaskGroup group(groupStr, reference.ExtendedMode);
+        int errorPos;
+        if (!group.PrepareMasks(errorPos))
+        {
+            fprintf(stderr, "salbench: cannot prepare mask group \"%s\" (error at %d)\n", groupStr, errorPos);
+            return FALSE;
+        }
+        if (reference.GetAutomatonMasks() >= MASK_AUTOMATON_MIN_MASKS)
+            automatonGroups++;
+
+        for (int n = 0; n < BENCH_MASKS_NAMES; n++)
+        {
+            RandomString(name, nameChars, 1, 12);
+            BOOL expected = reference.Agree(name);
+            checks++;
+            if (group.AgreeMasks(name, NULL) != expected)
+            {
+                if (mismatches++ < BENCH_MASKS_MAX_REPORT)
+                {
+                    fprintf(stderr, "salbench: mask group \"%s\"%s, name \"%s\": AgreeMasks returns %s\n", groupStr,
+                            reference.ExtendedMode ? " (extended)" : "", name, expected ? "FALSE" : "TRUE");
+                }
+            }
+        }
+    }
+    printf("  %I64d names in %d groups (%d with the automaton): %d mismatches\n", checks, BENCH_MASKS_GROUPS,
+           automatonGroups, mismatches);
+    if (mismatches > 0)
+        return FALSE;
+
+    // speed of a group of many masks which cannot be optimized
+    static const char* speedGroup = "*.c??;*.h??;*.tx?;*.do?;*.x?s;readme*;*.bak*;*~*;~*;*.o#;*.r##;*.7?;*.?z;*.t?z;*.j*g";
+    CMaskGroup group(speedGroup, TRUE);
+    CBenchMaskGroup reference;
+    reference.ExtendedMode = TRUE;
+    char speedMasks[MAX_GROUPMASK];
+    lstrcpyn(speedMasks, speedGroup, MAX_GROUPMASK);
+    for (char* s = strtok(speedMasks, ";"); s != NULL; s = strtok(NULL, ";"))
+        reference.Add(s, FALSE);
+    int errorPos;
+    if (!group.PrepareMasks(errorPos))
+    {
+        fprintf(stderr, "salbench: cannot prepare mask group \"%s\" (error at %d)\n", speedGroup, errorPos);
+        return FALSE;
+    }
+    static const char* speedNames[] = {"document.docx", "main.cpp", "readme.txt", "archive.tar.gz", "photo.jpeg",
+                                       "data.r01", "notes.bak", "setup.exe", "library.dll", "Makefile"};
+    int loops = 200000 * ctx.Scale;
+    int matches = 0;
+    double start = GetBenchTime();
+    for (int i = 0; i < loops; i++)
+        matches += group.AgreeMasks(speedNames[i % _countof(speedNames)], NULL);
+    double automatonTime = max(GetBenchTime() - start, 0.000001);
+    start = GetBenchTime();
+    for (int i = 0; i < loops; i++)
+        matches -= reference.Agree(speedNames[i % _countof(speedNames)]);
+    double referenceTime = max(GetBenchTime() - start, 0.000001);
+    printf("  %d names against %d masks: automaton %.0f names/s, AgreeMask %.0f names/s (%.2fx)\n", loops,
+           (int)reference.Masks.size(), loops / automatonTime, loops / referenceTime, referenceTime / automatonTime);
+    if (matches != 0)
+    {
+        fprintf(stderr, "salbench: the speed group matches differently\n");
+        return FALSE;
+    }
+    return TRUE;
+}
@@ -0,0 +1,246 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+#include "salbench.h"
+
+#if defined(_M_IX86) || defined(_M_X64) // the same condition as SEARCH_VECTOR_X86 in moore.cpp
+#define BENCH_MOORE_VECTOR
+#ifndef PF_AVX2_INSTRUCTIONS_AVAILABLE
+#define PF_AVX2_INSTRUCTIONS_AVAILABLE 40
+#endif
+#endif
+
+#define BENCH_MOORE_PATTERNS 3000      // number of random patterns of the equivalence check
+#define BENCH_MOORE_ALIGNMENTS 32      // texts start at all offsets from an aligned buffer up to this one
+#define BENCH_MOORE_MAX_TEXT 200       // maximum length of the random texts (longer than two AVX2 blocks)
+#define BENCH_MOORE_MAX_REPORT 5       // number of printed mismatches
+#define BENCH_MOORE_SPEED_TEXT 16777216 // size of the text of the speed test (multiplied by the scale)
+
+// search paths of CSearchData
+enum CBenchSearchPath
+{
+    bspForward,  // SearchForward (the path chosen by CSearchData)
+    bspScalar,   // SearchForwardScalar (Boyer-Moore only)
+    bspSSE2,     // SearchForwardSSE2 + Boyer-Moore for the rest of the text
+    bspAVX2,     // SearchForwardAVX2 + Boyer-Moore for the rest of the text
+    bspBackward, // SearchBackward
+    bspCount
+};
+
+static const char* BenchSearchPathNames[bspCount] = {"SearchForward", "Boyer-Moore", "SSE2", "AVX2", "SearchBackward"};
+
+// makes the protected search paths of CSearchData callable one by one
+class CBenchSearchData : public CSearchData
+{
+public:
+    // returns FALSE if the vectorized search is not used for the pattern (see InitializeFilter)
+    BOOL HasFilter() const { return FirstBytesCount > 0; }
+
+    int Search(CBenchSearchPath path, const char* text, int length, int start)
+    {
+        int found = -1;
+        switch (path)
+        {
+        case bspForward:
+            return SearchForward(text, length, start);
+        case bspScalar:
+            return SearchForwardScalar(text, length, start);
+#ifdef BENCH_MOORE_VECTOR
+        case bspSSE2: // like SearchForwardVector
+            found = SearchForwardSSE2(text, length, start);
+            break;
+        case bspAVX2:
+            found = SearchForwardAVX2(text, length, start);
+            break;
+#endif // BENCH_MOORE_VECTOR
+        case bspBackward:
+            return SearchBackward(text, length);
+        }
+        return found != -1 ? found : SearchForwardScalar(text, length, start);
+    }
+};
+
+// the simplest search: compares the pattern at each position of the text
+static int SearchReference(const char* text, int length, int start, const char* pattern, int patternLength,
+                           BOOL caseSensitive, BOOL forward)
+{
+    int pos = forward ? start : length - patternLength;
+    for (; forward ? pos + patternLength <= length : pos >= 0; pos += forward ? 1 : -1)
+    {
+        int i;
+        for (i = 0; i < patternLength; i++)
+        {
+            BYTE t = (BYTE)text[pos + i];
+            BYTE p = (BYTE)pattern[i];
+            if (caseSensitive ? t != p : LowerCase[t] != LowerCase[p])
+                break;
+        }
+        if (i == patternLength)
+            return pos;
+    }
+    return -1;
+}
+
+static BOOL CanUseAVX2()
+{
+#ifdef BENCH_MOORE_VECTOR
+    return IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE);
+#else  // BENCH_MOORE_VECTOR
+    return FALSE;
+#endif // BENCH_MOORE_VECTOR
+}
+
+static BOOL CanUsePath(CBenchSearchPath path)
+{
+#ifdef BENCH_MOORE_VECTOR
+    return path != bspAVX2 || CanUseAVX2();
+#else  // BENCH_MOORE_VECTOR
+    return path != bspSSE2 && path != bspAVX2;
+#endif // BENCH_MOORE_VECTOR
+}
+
+BOOL RunMooreSuite(CBenchContext& ctx)
+{
+    // a few characters (incl. case variants, a letter with diacritics and zero), so that the
+    // candidates of the filter are frequent and the pattern is found often enough
+    static const char textChars[] = "aAbB\xE1\xC1x";
+    static const int textCharsCount = _countof(textChars); // incl. the terminating zero
+
+    printf("\nCSearchData (SSE2, AVX2 and Boyer-Moore against a simple search%s):\n",
+           CanUseAVX2() ? "" : ", no AVX2 on this CPU");
+    SetBenchRandomSeed(1);
+    char* buffer = (char*)malloc(BENCH_MOORE_ALIGNMENTS + BENCH_MOORE_MAX_TEXT + 32);
+    if (buffer == NULL)
+    {
+        fprintf(stderr, "salbench: out of memory\n");
+        return FALSE;
+    }
+    char* alignedBuffer = (char*)(((ULONG_PTR)buffer + 31) & ~(ULONG_PTR)31);
+    int mismatches = 0;
+    __int64 checks[bspCount] = {0};
+    char pattern[20];
+    for (int p = 0; p < BENCH_MOORE_PATTERNS; p++)
+    {
+        int patternLength = 1 + GetBenchRandom(p % 4 == 0 ? 3 : _countof(pattern) - 1); // short patterns often
+        for (int i = 0; i < patternLength; i++)
+            pattern[i] = textChars[GetBenchRandom(textCharsCount)];
+        pattern[patternLength] = 0;
+        BOOL caseSensitive = (p & 1) != 0;
+        CBenchSearchData forward;
+        forward.Set(pattern, patternLength, sfForward | (caseSensitive ? sfCaseSensitive : 0));
+        CBenchSearchData backward;
+        backward.Set(pattern, patternLength, caseSensitive ? sfCaseSensitive : 0);
+        if (!forward.IsGood() || !backward.IsGood())
+        {
+            fprintf(stderr, "salbench: cannot set the search pattern\n");
+            free(buffer);
+            return FALSE;
+        }
+
+        // every alignment of the text, every length of the tail behind the last vector block
+        for (int align = 0; align < BENCH_MOORE_ALIGNMENTS; align++)
+        {
+            char* text = alignedBuffer + align;
+            int length = GetBenchRandom(BENCH_MOORE_MAX_TEXT + 1);
+            for (int i = 0; i < length; i++)
+                text[i] = textChars[GetBenchRandom(textCharsCount)];
+            // in half of the texts the pattern is put near the end (in the tail)
+            if ((align & 1) && length >= patternLength)
+                memcpy(text + length - patternLength - GetBenchRandom(min(length - patternLength, 40) + 1), pattern,
+                       patternLength);
+            int start = GetBenchRandom(min(length, 40) + 1);
+
+            for (int path = 0; path < bspCount; path++)
+            {
+                if (!CanUsePath((CBenchSearchPath)path) ||
+                    ((path == bspSSE2 || path == bspAVX2) && !forward.HasFilter()))
+                {
+                    continue;
+                }
+                BOOL isForward = path != bspBackward;
+                int expected = SearchReference(text, length, isForward ? start : 0, pattern, patternLength,
+                                               caseSensitive, isForward);
+                int found = isForward ? forward.Search((CBenchSearchPath)path, text, length, start)
+                                      : backward.Search(bspBackward, text, length, 0);
+                checks[path]++;
+                if (found != expected && mismatches++ < BENCH_MOORE_MAX_REPORT)
+                {
+                    fprintf(stderr, "salbench: %s of a pattern of %d bytes%s (text of %d bytes at offset %d, "
+                                    "start %d) returns %d instead of %d\n",
+                            BenchSearchPathNames[path], patternLength, caseSensitive ? " (case sensitive)" : "",
+                            length, align, start, found, expected);
+                }
+            }
+        }
+    }
+    free(buffer);
+    for (int path = 0; path < bspCount; path++)
+    {
+        if (checks[path] > 0)
+            printf("  %-14s %I64d searches\n", BenchSearchPathNames[path], checks[path]);
+    }
+    printf("  %d mismatches\n", mismatches);
+    if (mismatches > 0)
+        return FALSE;
+
+    // speed: the pattern is not in the text, so the whole text is searched
+    int textLength = BENCH_MOORE_SPEED_TEXT * ctx.Scale;
+    char* text = (char*)malloc(textLength);
+    if (text == NULL)
+    {
+        fprintf(stderr, "salbench: out of memory\n");
+        return FALSE;
+    }
+    static const char speedChars[] = "etaoinshrdlucmfwypvbgk ETAOINSHRDL\r\n.,"; // roughly a text file without q, z, j
+    for (int i = 0; i < textLength; i++)
+        text[i] = speedChars[GetBenchRandom(_countof(speedChars) - 1)];
+
+    struct CSpeedPattern
+    {
+        const char* Pattern;
+        WORD Flags;
+    };
+    static const CSpeedPattern speedPatterns[] = {
+        {"q", sfForward | sfCaseSensitive},
+        {"Salamander", sfForward | sfCaseSensitive},
+        {"Salamander", sfForward},
+        {"qzj", sfForward},
+        {"Open Salamander Authors", sfForward},
+    };
+    printf("  %-26s", "MB/s (pattern not found)");
+    for (int path = bspScalar; path <= bspAVX2; path++)
+        printf(" %12s", BenchSearchPathNames[path]);
+    printf("\n");
+    for (int s = 0; s < _countof(speedPatterns); s++)
+    {
+        CBenchSearchData data;
+        data.Set(speedPatterns[s].Pattern, speedPatterns[s].Flags);
+        char name[40];
+        sprintf(name, "\"%s\"%s", speedPatterns[s].Pattern,
+                (speedPatterns[s].Flags & sfCaseSensitive) ? " case" : "");
+        printf("  %-26s", name);
+        for (int path = bspScalar; path <= bspAVX2; path++)
+        {
+            if (!CanUsePath((CBenchSearchPath)path) || (path != bspScalar && !data.HasFilter()))
+            {
+                printf(" %12s", "-");
+                continue;
+            }
+            double start = GetBenchTime();
+            int found = data.Search((CBenchSearchPath)path, text, textLength, 0);
+            double time = max(GetBenchTime() - start, 0.000001);
+            if (found != -1)
+            {
+                fprintf(stderr, "salbench: \"%s\" found in the speed text\n", speedPatterns[s].Pattern);
+                free(text);
+                return FALSE;
+            }
+            printf(" %12.0f", textLength / time / (1024 * 1024));
+        }
+        printf("\n");
+    }
+    free(text);
+    return TRUE;
+}
@@ -0,0 +1,275 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+#include "common/MemoryFileEnumerator.h"
+#include "salbench.h"
+
+#define BENCH_WRITE_BUFFER (1024 * 1024) // size of the buffer for writing the files of the trees
+
+const char* GetBenchTreeShapeName(CBenchTreeShape shape)
+{
+    switch (shape)
+    {
+    case btsTinyFiles:
+        return "tiny";
+    case btsHugeFiles:
+        return "huge";
+    case btsDeepTree:
+        return "deep";
+    case btsUnicode:
+        return "unicode";
+    }
+    return "?";
+}
+
+void CBenchTree::Clear()
+{
+    Items.clear();
+    Files = 0;
+    Dirs = 0;
+    Bytes = 0;
+}
+
+void CBenchTree::Generate(CBenchTreeShape shape, int scale)
+{
+    Clear();
+
+    wchar_t name[200];
+    std::wstring path;
+    CBenchTreeItem item;
+    switch (shape)
+    {
+    case btsTinyFiles: // 20 directories with 500 files of 1-4 KB
+    {
+        for (int d = 0; d < 20 * scale; d++)
+        {
+            swprintf_s(name, L"tiny%03d", d);
+            item.Name = name;
+            item.IsDir = TRUE;
+            item.Size = 0;
+            Items.push_back(item);
+            for (int f = 0; f < 500; f++)
+            {
+                swprintf_s(name, L"tiny%03d\\file%05d.txt", d, f);
+                item.Name = name;
+                item.IsDir = FALSE;
+                item.Size = 1024 + (d * 500 + f) * 397 % 3072;
+                Items.push_back(item);
+            }
+        }
+        break;
+    }
+
+    case btsHugeFiles: // 4 files of 64 MB
+    {
+        item.Name = L"huge";
+        item.IsDir = TRUE;
+        item.Size = 0;
+        Items.push_back(item);
+        for (int f = 0; f < 4; f++)
+        {
+            swprintf_s(name, L"huge\\huge%d.bin", f);
+            item.Name = name;
+            item.IsDir = FALSE;
+            item.Size = (unsigned __int64)scale * 64 * 1024 * 1024;
+            Items.push_back(item);
+        }
+        break;
+    }
+
+    case btsDeepTree: // chains of 40 nested directories with 5 files of 8 KB on each level
+    {
+        for (int c = 0; c < scale; c++)
+        {
+            swprintf_s(name, L"deep%d", c);
+            path = name;
+            for (int level = 0; level < 40; level++)
+            {
+                swprintf_s(name, L"\\level%02d_of_deep_tree", level);
+                path += name;
+                item.Name = path;
+                item.IsDir = TRUE;
+                item.Size = 0;
+                Items.push_back(item);
+                for (int f = 0; f < 5; f++)
+                {
+                    swprintf_s(name, L"\\file%d.dat", f);
+                    item.Name = path + name;
+                    item.IsDir = FALSE;
+                    item.Size = 8 * 1024;
+                    Items.push_back(item);
+                }
+            }
+        }
+        break;
+    }
+
+    case btsUnicode: // 10 directories with 200 files of 2 KB with names in various scripts
+    {
+        static const wchar_t* fileNames[] = {
+            L"\x017Elu\x0165ou\x010Dk\x00FD k\x016F\x0148 %04d.txt", // Czech
+            L"\x0444\x0430\x0439\x043B %04d.txt",                    // Cyrillic
+            L"\x03B1\x03C1\x03C7\x03B5\x03AF\x03BF %04d.txt",        // Greek
+            L"\x6587\x4EF6 %04d.txt",                                // CJK
+            L"\xD83D\xDCC1 folder %04d.txt",                         // surrogate pair
+        };
+        for (int d = 0; d < 10 * scale; d++)
+        {
+            swprintf_s(name, L"\x0161koln\x00ED %03d", d);
+            std::wstring dir = name;
+            item.Name = dir;
+            item.IsDir = TRUE;
+            item.Size = 0;
+            Items.push_back(item);
+            for (int f = 0; f < 200; f++)
+            {
+                swprintf_s(name, fileNames[f % _countof(fileNames)], f);
+                item.Name = dir + L"\\" + name;
+                item.IsDir = FALSE;
+                item.Size = 2048;
+                Items.push_back(item);
+            }
+        }
+        break;
+    }
+    }
+
+    for (size_t i = 0; i < Items.size(); i++)
+    {
+        if (Items[i].IsDir)
+            Dirs++;
+        else
+        {
+            Files++;
+            Bytes += Items[i].Size;
+        }
+    }
+}
+
+BOOL CBenchTree::Write(const wchar_t* root) const
+{
+    char* buffer = (char*)malloc(BENCH_WRITE_BUFFER);
+    if (buffer == NULL)
+    {
+        fprintf(stderr, "salbench: out of memory\n");
+        return FALSE;
+    }
+    for (int i = 0; i < BENCH_WRITE_BUFFER; i++)
+        buffer[i] = (char)(i * 7 + (i >> 12));
+
+    BOOL ok = TRUE;
+    std::wstring rootW = std::wstring(L"\\\\?\\") + root + L"\\"; // the deep tree needs long paths
+    for (size_t i = 0; ok && i < Items.size(); i++)
+    {
+        const CBenchTreeItem& item = Items[i];
+        std::wstring path = rootW + item.Name;
+        if (item.IsDir)
+        {
+            if (!CreateDirectoryW(path.c_str(), NULL))
+            {
+                fprintf(stderr, "salbench: cannot create directory %ls (error %u)\n", path.c_str(), GetLastError());
+                ok = FALSE;
+            }
+            continue;
+        }
+
+        HANDLE file = HANDLES_Q(CreateFileW(path.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS,
+                                            FILE_ATTRIBUTE_NORMAL, NULL));
+        if (file == INVALID_HANDLE_VALUE)
+        {
+            fprintf(stderr, "salbench: cannot create file %ls (error %u)\n", path.c_str(), GetLastError());
+            ok = FALSE;
+            continue;
+        }
+        unsigned __int64 rest = item.Size;
+        while (rest > 0)
+        {
+            DWORD size = (DWORD)min(rest, (unsigned __int64)BENCH_WRITE_BUFFER);
+            DWORD written;
+            if (!WriteFile(file, buffer, size, &written, NULL) || written != size)
+            {
+                fprintf(stderr, "salbench: cannot write file %ls (error %u)\n", path.c_str(), GetLastError());
+                ok = FALSE;
+                break;
+            }
+            rest -= size;
+        }
+        HANDLES(CloseHandle(file));
+    }
+    free(buffer);
+    return ok;
+}
+
+void CBenchTree::Write(MemoryFileTree& tree, const wchar_t* root) const
+{
+    std::wstring rootW = std::wstring(root) + L"\\";
+    for (size_t i = 0; i < Items.size(); i++)
+    {
+        const CBenchTreeItem& item = Items[i];
+        if (item.IsDir)
+            tree.AddDirectory((rootW + item.Name).c_str());
+        else
+            tree.AddFile((rootW + item.Name).c_str(), item.Size);
+    }
+}
+
+void CBenchTree::AddToSnapshot(CSelectionSnapshot& snapshot, BOOL dirs, BOOL files, BOOL deleteOrder) const
+{
+    for (size_t n = 0; n < Items.size(); n++)
+    {
+        const CBenchTreeItem& item = Items[deleteOrder ? Items.size() - 1 - n : n];
+        if (item.IsDir ? !dirs : !files)
+            continue;
+
+        CSnapshotItem snapItem;
+        int len = WideCharToMultiByte(CP_ACP, 0, item.Name.c_str(), (int)item.Name.length(), NULL, 0, NULL, NULL);
+        snapItem.Name.resize(len);
+        if (len > 0)
+            WideCharToMultiByte(CP_ACP, 0, item.Name.c_str(), (int)item.Name.length(), &snapItem.Name[0], len, NULL, NULL);
+        snapItem.NameW = item.Name; // always, the ANSI name of btsUnicode is lossy
+        snapItem.IsDir = item.IsDir != FALSE;
+        snapItem.Size = item.Size;
+        snapItem.Attr = item.IsDir ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_ARCHIVE;
+        GetSystemTimeAsFileTime(&snapItem.LastWrite);
+        snapshot.Items.push_back(snapItem);
+    }
+}
+
+BOOL RemoveBenchDir(const wchar_t* root)
+{
+    std::wstring dir = root;
+    if (dir.compare(0, 4, L"\\\\?\\") != 0)
+        dir = L"\\\\?\\" + dir;
+
+    BOOL ok = TRUE;
+    WIN32_FIND_DATAW data;
+    HANDLE find = HANDLES_Q(FindFirstFileW((dir + L"\\*").c_str(), &data));
+    if (find != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if (wcscmp(data.cFileName, L".") == 0 || wcscmp(data.cFileName, L"..") == 0)
+                continue;
+            std::wstring path = dir + L"\\" + data.cFileName;
+            if (data.dwFileAttributes & FILE_ATTRIBUTE_READONLY)
+                SetFileAttributesW(path.c_str(), data.dwFileAttributes & ~FILE_ATTRIBUTE_READONLY);
+            if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+                (data.dwFileAttributes & FILE_ATTRIBUTE_REPARSE_POINT) == 0)
+            {
+                if (!RemoveBenchDir(path.c_str()))
+                    ok = FALSE;
+            }
+            else if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? !RemoveDirectoryW(path.c_str())
+                                                                        : !DeleteFileW(path.c_str()))
+            {
+                ok = FALSE;
+            }
+        } while (FindNextFileW(find, &data));
+        HANDLES(FindClose(find));
+    }
+    if (!RemoveDirectoryW(dir.c_str()) && GetLastError() != ERROR_FILE_NOT_FOUND)
+        ok = FALSE;
+    return ok;
+}
@@ -0,0 +1,393 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+#include "worker.h"
+#include "common/IFileSystem.h"
+#include "common/IWorkerObserver.h"
+#include "common/BuildScript.h"
+#include "common/MemoryFileSystem.h"
+#include "common/unicode/helpers.h"
+#include "salbench.h"
+
+//
+// ****************************************************************************
+// CCountingFileSystem
+//
+// forwards all calls to another IFileSystem and counts them (the worker threads
+// call it in parallel, so the counter is interlocked)
+
+class CCountingFileSystem : public IFileSystem
+{
+public:
+    volatile LONG Calls; // number of calls since the last reset
+
+    CCountingFileSystem(IFileSystem* fs)
+    {
+        FS = fs;
+        Calls = 0;
+    }
+
+    bool FileExists(const wchar_t* path) override { return Count(), FS->FileExists(path); }
+    bool DirectoryExists(const wchar_t* path) override { return Count(), FS->DirectoryExists(path); }
+    FileResult GetFileInfo(const wchar_t* path, FileInfo& info) override { return Count(), FS->GetFileInfo(path, info); }
+    DWORD GetFileAttributes(const wchar_t* path) override { return Count(), FS->GetFileAttributes(path); }
+    FileResult SetFileAttributes(const wchar_t* path, DWORD attributes) override { return Count(), FS->SetFileAttributes(path, attributes); }
+    FileResult DeleteFile(const wchar_t* path) override { return Count(), FS->DeleteFile(path); }
+    FileResult MoveFile(const wchar_t* source, const wchar_t* target) override { return Count(), FS->MoveFile(source, target); }
+    FileResult CopyFile(const wchar_t* source, const wchar_t* target, bool failIfExists) override { return Count(), FS->CopyFile(source, target, failIfExists); }
+    FileResult CreateDirectory(const wchar_t* path) override { return Count(), FS->CreateDirectory(path); }
+    FileResult RemoveDirectory(const wchar_t* path) override { return Count(), FS->RemoveDirectory(path); }
+
+    HANDLE CreateFile(const wchar_t* path, DWORD desiredAccess, DWORD shareMode,
+                      LPSECURITY_ATTRIBUTES securityAttributes, DWORD creationDisposition,
+                      DWORD flagsAndAttributes, HANDLE templateFile) override
+    {
+        Count();
+        return FS->CreateFile(path, desiredAccess, shareMode, securityAttributes, creationDisposition,
+                              flagsAndAttributes, templateFile);
+    }
+
+    HANDLE FindFirstFile(const wchar_t* path, WIN32_FIND_DATAW* findData) override { return Count(), FS->FindFirstFile(path, findData); }
+    BOOL FindNextFile(HANDLE findHandle, WIN32_FIND_DATAW* findData) override { return Count(), FS->FindNextFile(findHandle, findData); }
+    HANDLE OpenFileForRead(const wchar_t* path, DWORD shareMode) override { return Count(), FS->OpenFileForRead(path, shareMode); }
+    HANDLE CreateFileForWrite(const wchar_t* path, bool failIfExists) override { return Count(), FS->CreateFileForWrite(path, failIfExists); }
+    void CloseHandle(HANDLE h) override { Count(), FS->CloseHandle(h); }
+
+protected:
+    IFileSystem* FS;
+
+    void Count() { InterlockedIncrement(&Calls); }
+};
+
+//
+// ****************************************************************************
+// CBenchWorkerObserver
+//
+// observer of the benchmarked scripts: no progress, every question of the worker is an error
+// of the benchmark (the trees are fresh, nothing can be overwritten), so it is printed and the
+// script is cancelled
+
+class CBenchWorkerObserver : public IWorkerObserver
+{
+public:
+    int Errors; // number of the errors reported by the worker
+
+    CBenchWorkerObserver()
+    {
+        Errors = 0;
+        Cancelled = false;
+    }
+
+    void SetOperationInfo(CProgressData* data) override {}
+    void SetProgress(int operationPercent, int summaryPercent) override {}
+    void SetProgressWithoutSuspend(int operationPercent, int summaryPercent) override {}
+    void WaitIfSuspended() override {}
+    bool IsCancelled() const override { return Cancelled; }
+    void SetError(bool error) override
+    {
+        if (error)
+            Cancelled = true;
+    }
+    void NotifyDone() override {}
+    HWND GetParentWindow() const override { return NULL; }
+
+    int AskFileError(const char* title, const char* fileName, const char* errorText) override { return Error(fileName, errorText); }
+    int AskFileErrorById(int titleId, const char* fileName, DWORD win32Error) override { return Error(fileName, GetErrorText(win32Error)); }
+    int AskFileErrorByIds(int titleId, const char* fileName, int errorTextId) override { return Error(fileName, LoadStr(errorTextId)); }
+    int AskOverwrite(const char* sourceName, const char* sourceInfo,
+                     const char* targetName, const char* targetInfo) override { return Error(targetName, "target file exists"); }
+    int AskHiddenOrSystem(const char* title, const char* fileName, const char* actionText) override { return Error(fileName, actionText); }
+    int AskHiddenOrSystemById(int titleId, const char* fileName, int actionId) override { return Error(fileName, LoadStr(actionId)); }
+    int AskCannotMove(const char* errorText, const char* fileName,
+                      const char* destPath, bool isDirectory) override { return Error(fileName, errorText); }
+    int AskCannotMoveErr(const char* sourceName, const char* targetName,
+                         DWORD win32Error, bool isDirectory) override { return Error(sourceName, GetErrorText(win32Error)); }
+    void NotifyError(const char* title, const char* fileName, const char* errorText) override { Error(fileName, errorText); }
+    void NotifyErrorById(int titleId, const char* fileName, int detailId) override { Error(fileName, LoadStr(detailId)); }
+    int AskADSReadError(const char* fileName, const char* adsName) override { return Error(fileName, "cannot read ADS"); }
+    int AskADSOverwrite(const char* sourceName, const char* sourceInfo,
+                        const char* targetName, const char* targetInfo) override { return Error(targetName, "target ADS exists"); }
+    int AskADSOpenError(const char* fileName, const char* adsName, const char* errorText) override { return Error(fileName, errorText); }
+    int AskADSOpenErrorById(int titleId, const char* fileName, DWORD win32Error) override { return Error(fileName, GetErrorText(win32Error)); }
+    int AskSetAttrsError(const char* fileName, DWORD failedAttrs, DWORD currentAttrs) override { return Error(fileName, "cannot set attributes"); }
+    int AskCopyPermError(const char* sourceFile, const char* targetFile, const char* errorText) override { return Error(sourceFile, errorText); }
+    int AskCopyDirTimeError(const char* dirName, DWORD errorCode) override { return Error(dirName, GetErrorText(errorCode)); }
+    int AskEncryptionLoss(bool isEncrypted, const char* fileName, bool isDir) override { return Error(fileName, "encryption would be lost"); }
+
+protected:
+    bool Cancelled;
+
+    int Error(const char* fileName, const char* text)
+    {
+        fprintf(stderr, "salbench: worker error: %s: %s\n", fileName, text);
+        Errors++;
+        Cancelled = true;
+        return IDCANCEL;
+    }
+};
+
+//
+// ****************************************************************************
+// running of the scripts
+
+struct CBenchScriptResult
+{
+    double Time;              // duration of RunWorkerDirect in seconds
+    CWorkerDirectStats Stats; // statistics from RunWorkerDirect
+    LONG FsCalls;             // number of IFileSystem calls
+    ULONGLONG IoOperations;   // number of I/O operations of the process (reads, writes and others)
+};
+
+static ULONGLONG GetIoOperations()
+{
+    IO_COUNTERS io;
+    if (!GetProcessIoCounters(GetCurrentProcess(), &io))
+        return 0;
+    return io.ReadOperationCount + io.WriteOperationCount + io.OtherOperationCount;
+}
+
+// builds one script from 'snapshots' (in this order) and runs it by RunWorkerDirect with
+// 'fs' as the worker file system; returns FALSE on error (already printed)
+static BOOL RunBenchScript(const CSelectionSnapshot* snapshots, int count, CCountingFileSystem& fs,
+                           CBenchScriptResult& res)
+{
+    COperations* script = new COperations(1000, 500, NULL, NULL, NULL);
+    CBuildConfig config;
+    CBuildScriptState state;
+    for (int i = 0; i < count; i++)
+    {
+        if (!BuildScriptFromSnapshot(snapshots[i], config, state, script))
+        {
+            fprintf(stderr, "salbench: cannot build the script\n");
+            FreeScript(script);
+            return FALSE;
+        }
+    }
+    script->CanUseRecycleBin = FALSE; // BuildScriptFromSnapshot leaves the default TRUE, the bin is not measured
+
+    CBenchWorkerObserver observer;
+    IFileSystem* oldFileSystem = gFileSystem;
+    gFileSystem = &fs;
+    fs.Calls = 0;
+    ULONGLONG ioOperations = GetIoOperations();
+    double start = GetBenchTime();
+    BOOL ok = RunWorkerDirect(script, observer, NULL, NULL, &res.Stats);
+    res.Time = GetBenchTime() - start;
+    res.IoOperations = GetIoOperations() - ioOperations;
+    res.FsCalls = fs.Calls;
+    gFileSystem = oldFileSystem;
+
+    FreeScript(script);
+    if (!ok && observer.Errors == 0)
+        fprintf(stderr, "salbench: the script has failed\n");
+    return ok;
+}
+
+static void PrintResultHeader()
+{
+    printf("%-8s %-7s %-7s %8s %9s %8s %10s %8s %10s %10s %9s\n", "shape", "fs", "op", "files", "MB",
+           "time(s)", "files/s", "MB/s", "fs calls/f", "I/O ops/f", "peak(MB)");
+}
+
+static void PrintResult(CBenchTreeShape shape, const char* fs, const char* op, const CBenchScriptResult& res)
+{
+    int files = res.Stats.Files;
+    double mb = (double)res.Stats.FileBytes.Value / (1024 * 1024);
+    double time = max(res.Time, 0.000001);
+    printf("%-8s %-7s %-7s %8d %9.1f %8.3f %10.0f %8.1f %10.2f %10.2f %9.1f\n", GetBenchTreeShapeName(shape), fs, op,
+           files, mb, res.Time, files / time, mb / time, files > 0 ? (double)res.FsCalls / files : 0.0,
+           files > 0 ? (double)res.IoOperations / files : 0.0, (double)res.Stats.PeakWorkingSet / (1024 * 1024));
+}
+
+static void InitSnapshot(CSelectionSnapshot& snapshot, EActionType action, const std::string& source,
+                         const std::string& target)
+{
+    snapshot.Action = action;
+    snapshot.SourcePath = source;
+    snapshot.SourcePathW = AnsiToWide(source.c_str());
+    snapshot.TargetPath = target;
+    snapshot.TargetPathW = AnsiToWide(target.c_str());
+    snapshot.Mask = "*.*";
+}
+
+//
+// ****************************************************************************
+// suites
+
+BOOL RunWorkerDiskSuite(CBenchContext& ctx)
+{
+    std::wstring sourceW = ctx.WorkDirW + L"\\source";
+    std::wstring targetW = ctx.WorkDirW + L"\\target";
+    std::string source = ctx.WorkDir + "\\source";
+    std::string target = ctx.WorkDir + "\\target";
+    CCountingFileSystem fs(GetWin32FileSystem());
+
+    printf("\nworker on disk (%s):\n", ctx.WorkDir.c_str());
+    PrintResultHeader();
+    BOOL ok = TRUE;
+    for (int shape = 0; ok && shape < btsCount; shape++)
+    {
+        CBenchTree tree;
+        tree.Generate((CBenchTreeShape)shape, ctx.Scale);
+        RemoveBenchDir(sourceW.c_str());
+        RemoveBenchDir(targetW.c_str());
+        if (!CreateDirectoryW(sourceW.c_str(), NULL) || !CreateDirectoryW(targetW.c_str(), NULL))
+        {
+            fprintf(stderr, "salbench: cannot create directories in %s (error %u)\n", ctx.WorkDir.c_str(), GetLastError());
+            return FALSE;
+        }
+        ok = tree.Write(sourceW.c_str());
+
+        CBenchScriptResult res;
+        if (ok) // copy the source into the target
+        {
+            CSelectionSnapshot copy;
+            InitSnapshot(copy, EActionType::Copy, source, target);
+            tree.AddToSnapshot(copy, TRUE, TRUE, FALSE);
+            ok = RunBenchScript(&copy, 1, fs, res);
+            if (ok)
+                PrintResult((CBenchTreeShape)shape, "disk", "copy", res);
+        }
+        if (ok) // delete the copy
+        {
+            CSelectionSnapshot del;
+            InitSnapshot(del, EActionType::Delete, target, "");
+            tree.AddToSnapshot(del, TRUE, TRUE, TRUE);
+            ok = RunBenchScript(&del, 1, fs, res);
+            if (ok)
+                PrintResult((CBenchTreeShape)shape, "disk", "delete", res);
+        }
+        if (ok) // move the source into the target; BuildScriptFromSnapshot moves directories
+        {       // without their contents, so the target directories are created by copying them
+            CSelectionSnapshot move[2];
+            InitSnapshot(move[0], EActionType::Copy, source, target);
+            tree.AddToSnapshot(move[0], TRUE, FALSE, FALSE);
+            InitSnapshot(move[1], EActionType::Move, source, target);
+            tree.AddToSnapshot(move[1], FALSE, TRUE, FALSE);
+            ok = RunBenchScript(move, 2, fs, res);
+            if (ok)
+                PrintResult((CBenchTreeShape)shape, "disk", "move", res);
+        }
+    }
+    RemoveBenchDir(sourceW.c_str());
+    RemoveBenchDir(targetW.c_str());
+    return ok;
+}
+
+BOOL RunWorkerMemorySuite(CBenchContext& ctx)
+{
+    // only the delete script runs completely through IFileSystem, the copy loops read and write
+    // the handles directly and the directories are created by CreateDirectoryW (see worker.cpp)
+    std::wstring rootW = ctx.WorkDirW + L"\\memory"; // exists only in 'memTree'
+    std::string root = ctx.WorkDir + "\\memory";
+    MemoryFileTree memTree;
+    MemoryFileSystem memFs(&memTree);
+    CCountingFileSystem fs(&memFs);
+
+    printf("\nworker in memory (the delete script only):\n");
+    PrintResultHeader();
+    BOOL ok = TRUE;
+    for (int shape = 0; ok && shape < btsCount; shape++)
+    {
+        CBenchTree tree;
+        tree.Generate((CBenchTreeShape)shape, ctx.Scale);
+        memTree.Clear();
+        memTree.AddDirectory(rootW.c_str());
+        size_t rootCount = memTree.GetCount();
+        tree.Write(memTree, rootW.c_str());
+
+        CBenchScriptResult res;
+        CSelectionSnapshot del;
+        InitSnapshot(del, EActionType::Delete, root, "");
+        tree.AddToSnapshot(del, TRUE, TRUE, TRUE);
+        ok = RunBenchScript(&del, 1, fs, res);
+        if (ok && memTree.GetCount() != rootCount)
+        {
+            fprintf(stderr, "salbench: %d items were not deleted\n", (int)(memTree.GetCount() - rootCount));
+            ok = FALSE;
+        }
+        if (ok)
+            PrintResult((CBenchTreeShape)shape, "memory", "delete", res);
+    }
+    memTree.Clear();
+    return ok;
+}
+
+BOOL RunDeleteScalingSuite(CBenchContext& ctx)
+{
+    // the parallel delete is for runs of small items, the huge files would measure nothing new
+    static const CBenchTreeShape shapes[] = {btsTinyFiles, btsDeepTree, btsUnicode};
+    std::wstring diskRootW = ctx.WorkDirW + L"\\scaling";
+    std::string diskRoot = ctx.WorkDir + "\\scaling";
+    std::wstring memRootW = ctx.WorkDirW + L"\\memory"; // exists only in 'memTree'
+    std::string memRoot = ctx.WorkDir + "\\memory";
+    MemoryFileTree memTree;
+    MemoryFileSystem memFs(&memTree);
+    CCountingFileSystem diskFs(GetWin32FileSystem());
+    CCountingFileSystem memoryFs(&memFs);
+
+    printf("\nparallel delete scaling (1 thread = DoDeleteFile and DoDeleteDir without the pool):\n");
+    printf("%-8s %-7s %7s %8s %8s %10s %8s\n", "shape", "fs", "threads", "files", "time(s)", "files/s", "speedup");
+    BOOL ok = TRUE;
+    for (int s = 0; ok && s < _countof(shapes); s++)
+    {
+        CBenchTree tree;
+        tree.Generate(shapes[s], ctx.Scale);
+        for (int memory = 0; ok && memory < 2; memory++)
+        {
+            double serialTime = 0;
+            for (int threads = 1; ok && threads <= PARALLEL_DELETE_MAX_THREADS; threads *= 2)
+            {
+                size_t rootCount = 0;
+                if (memory)
+                {
+                    memTree.Clear();
+                    memTree.AddDirectory(memRootW.c_str());
+                    rootCount = memTree.GetCount();
+                    tree.Write(memTree, memRootW.c_str());
+                }
+                else
+                {
+                    RemoveBenchDir(diskRootW.c_str());
+                    if (!CreateDirectoryW(diskRootW.c_str(), NULL))
+                    {
+                        fprintf(stderr, "salbench: cannot create directory %s (error %u)\n", diskRoot.c_str(), GetLastError());
+                        return FALSE;
+                    }
+                    if (!tree.Write(diskRootW.c_str()))
+                    {
+                        ok = FALSE;
+                        break;
+                    }
+                }
+
+                CBenchScriptResult res;
+                CSelectionSnapshot del;
+                InitSnapshot(del, EActionType::Delete, memory ? memRoot : diskRoot, "");
+                tree.AddToSnapshot(del, TRUE, TRUE, TRUE);
+                WorkerDirectThreads = threads;
+                ok = RunBenchScript(&del, 1, memory ? memoryFs : diskFs, res);
+                WorkerDirectThreads = 0;
+                if (ok && memory && memTree.GetCount() != rootCount)
+                {
+                    fprintf(stderr, "salbench: %d items were not deleted\n", (int)(memTree.GetCount() - rootCount));
+                    ok = FALSE;
+                }
+                if (ok)
+                {
+                    double time = max(res.Time, 0.000001);
+                    if (threads == 1)
+                        serialTime = time;
+                    printf("%-8s %-7s %7d %8d %8.3f %10.0f %7.2fx\n", GetBenchTreeShapeName(shapes[s]),
+                           memory ? "memory" : "disk", threads, res.Stats.Files, res.Time, res.Stats.Files / time,
+                           serialTime / time);
+                }
+            }
+        }
+    }
+    RemoveBenchDir(diskRootW.c_str());
+    memTree.Clear();
+    return ok;
+}
@@ -0,0 +1,187 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+// salbench — console benchmarks of the worker and of the hot paths of Sally; it links the
+// sources of sally.exe (built with SAL_BENCH, see CMakeLists.txt) and runs the selected suites:
+//
+//   salbench [-dir <work directory>] [-scale <n>] [suite ...]
+//
+// the work directory (default %TEMP%\salbench) gets the synthetic trees, it must have a path in
+// ANSI characters; the results go to stdout, the exit code is 1 if some suite failed
+
+#include "precomp.h"
+
+#include "worker.h"
+#include "salbench.h"
+
+struct CBenchSuiteInfo
+{
+    const char* Name;
+    const char* Description;
+    FBenchSuite Run;
+};
+
+static const CBenchSuiteInfo BenchSuites[] = {
+    {"disk", "copy, move and delete of the synthetic trees on disk by RunWorkerDirect", RunWorkerDiskSuite},
+    {"memory", "delete of the synthetic trees in the in-memory file system by RunWorkerDirect", RunWorkerMemorySuite},
+    {"scaling", "delete on disk and in memory with 1 to 8 threads of the parallel delete pool", RunDeleteScalingSuite},
+    {"array", "TDirectArray of listings: growth by Delta, geometric growth and Reserve", RunArraySuite},
+    {"masks", "random mask groups and names: the mask automaton against AgreeMask, and its speed", RunMasksSuite},
+    {"search", "CSearchData: SSE2, AVX2 and Boyer-Moore against a simple search, and their speed", RunMooreSuite},
+    {"find", "Find in file content: the text as typed, and with the extra pass of the Unicode option", RunFindSuite},
+};
+
+double GetBenchTime()
+{
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / frequency.QuadPart;
+}
+
+static DWORD BenchRandomSeed = 1;
+
+void SetBenchRandomSeed(DWORD seed)
+{
+    BenchRandomSeed = seed;
+}
+
+int GetBenchRandom(int range)
+{
+    BenchRandomSeed = BenchRandomSeed * 1103515245 + 12345;
+    return (int)((BenchRandomSeed >> 8) % (DWORD)range);
+}
+
+static void PrintUsage()
+{
+    printf("usage: salbench [-dir <work directory>] [-scale <n>] [suite ...]\n\nsuites (default all):\n");
+    for (int i = 0; i < _countof(BenchSuites); i++)
+        printf("  %-8s %s\n", BenchSuites[i].Name, BenchSuites[i].Description);
+}
+
+// the part of WinMainBody needed by the worker (no windows, no configuration: the defaults of
+// Configuration are used)
+static void InitBench()
+{
+    SetErrorMode(SetErrorMode(0) | SEM_FAILCRITICALERRORS);
+    MainThreadID = GetCurrentThreadId();
+    HInstance = GetModuleHandle(NULL);
+    SetTraceProcessName("salbench");
+    SetThreadNameInVCAndTrace("Main");
+
+    NtDLL = HANDLES(LoadLibrary("NTDLL.DLL"));
+    if (NtDLL == NULL)
+        TRACE_E("Unable to load library ntdll.dll."); // not a fatal error
+
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    AllocationGranularity = si.dwAllocationGranularity;
+
+    WindowsVistaAndLater = SalIsWindowsVersionOrGreater(6, 0, 0);
+    WindowsXP64AndLater = SalIsWindowsVersionOrGreater(5, 2, 0);
+    Windows7AndLater = SalIsWindowsVersionOrGreater(6, 1, 0);
+    Windows8AndLater = SalIsWindowsVersionOrGreater(6, 2, 0);
+    Windows8_1AndLater = SalIsWindowsVersionOrGreater(6, 3, 0);
+    Windows10AndLater = SalIsWindowsVersionOrGreater(10, 0, 0);
+
+    // texts of the errors reported by the worker, salbench lies next to sally.exe
+    char path[MAX_PATH];
+    if (GetModuleFileName(NULL, path, MAX_PATH) != 0 && CutDirectory(path) &&
+        SalPathAppend(path, "lang\\english.slg", MAX_PATH))
+    {
+        HLanguage = HANDLES_Q(LoadLibraryEx(path, NULL, LOAD_LIBRARY_AS_DATAFILE));
+    }
+
+    InitWorker();
+}
+
+static void ReleaseBench()
+{
+    ReleaseWorker();
+    if (HLanguage != NULL)
+        HANDLES(FreeLibrary(HLanguage));
+    HLanguage = NULL;
+    if (NtDLL != NULL)
+        HANDLES(FreeLibrary(NtDLL));
+    NtDLL = NULL;
+}
+
+int main(int argc, char* argv[])
+{
+#ifndef CALLSTK_DISABLE
+    CCallStack stack;
+#endif // CALLSTK_DISABLE
+
+    CBenchContext ctx;
+    ctx.Scale = 1;
+    ctx.Failed = FALSE;
+    std::vector<const CBenchSuiteInfo*> suites;
+    int i;
+    for (i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-dir") == 0 && i + 1 < argc)
+            ctx.WorkDir = argv[++i];
+        else if (strcmp(argv[i], "-scale") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+            ctx.Scale = atoi(argv[++i]);
+        else
+        {
+            int s;
+            for (s = 0; s < _countof(BenchSuites) && strcmp(argv[i], BenchSuites[s].Name) != 0; s++)
+                ;
+            if (s == _countof(BenchSuites))
+            {
+                PrintUsage();
+                return 2;
+            }
+            suites.push_back(&BenchSuites[s]);
+        }
+    }
+    if (suites.empty())
+    {
+        for (i = 0; i < _countof(BenchSuites); i++)
+            suites.push_back(&BenchSuites[i]);
+    }
+
+    if (ctx.WorkDir.empty())
+    {
+        char temp[MAX_PATH];
+        if (GetTempPath(MAX_PATH, temp) == 0 || !SalPathAppend(temp, "salbench", MAX_PATH))
+        {
+            fprintf(stderr, "salbench: cannot get the temporary directory, use -dir\n");
+            return 2;
+        }
+        ctx.WorkDir = temp;
+    }
+    while (ctx.WorkDir.length() > 3 && ctx.WorkDir.back() == '\\')
+        ctx.WorkDir.pop_back();
+    int len = MultiByteToWideChar(CP_ACP, 0, ctx.WorkDir.c_str(), -1, NULL, 0);
+    ctx.WorkDirW.resize(len);
+    MultiByteToWideChar(CP_ACP, 0, ctx.WorkDir.c_str(), -1, &ctx.WorkDirW[0], len);
+    ctx.WorkDirW.resize(len - 1);
+    if (!CreateDirectoryW(ctx.WorkDirW.c_str(), NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+    {
+        fprintf(stderr, "salbench: cannot create work directory %s (error %u)\n", ctx.WorkDir.c_str(), GetLastError());
+        return 2;
+    }
+
+    InitBench();
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    printf("salbench: %u processors, scale %d, work directory %s\n", si.dwNumberOfProcessors, ctx.Scale,
+           ctx.WorkDir.c_str());
+
+    for (i = 0; i < (int)suites.size(); i++)
+    {
+        if (!suites[i]->Run(ctx))
+        {
+            fprintf(stderr, "salbench: suite %s has failed\n", suites[i]->Name);
+            ctx.Failed = TRUE;
+        }
+    }
+
+    ReleaseBench();
+    RemoveDirectoryW(ctx.WorkDirW.c_str()); // only if it is empty (it is not ours otherwise)
+    return ctx.Failed ? 1 : 0;
+}
@@ -0,0 +1,97 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+#pragma once
+
+#include "common/CSelectionSnapshot.h"
+
+class MemoryFileTree;
+
+// shapes of the synthetic trees (see CBenchTree::Generate)
+enum CBenchTreeShape
+{
+    btsTinyFiles, // many tiny files in a few directories
+    btsHugeFiles, // a few huge files
+    btsDeepTree,  // deep nesting, the paths are longer than MAX_PATH
+    btsUnicode,   // names outside of the ANSI code page (incl. surrogate pairs)
+    btsCount
+};
+
+const char* GetBenchTreeShapeName(CBenchTreeShape shape);
+
+struct CBenchTreeItem
+{
+    std::wstring Name;     // path relative to the root of the tree
+    BOOL IsDir;            // TRUE for directories
+    unsigned __int64 Size; // size of the file (0 for directories)
+};
+
+// synthetic directory tree; Items are in pre-order (a directory is right before its subtree),
+// so the reversed order is the order of deleting
+class CBenchTree
+{
+public:
+    std::vector<CBenchTreeItem> Items;
+    int Files;
+    int Dirs;
+    unsigned __int64 Bytes; // sum of the sizes of the files
+
+    CBenchTree() { Clear(); }
+
+    void Clear();
+
+    // generates the items of tree 'shape'; 'scale' multiplies the number of items (or the sizes
+    // of the files for btsHugeFiles)
+    void Generate(CBenchTreeShape shape, int scale);
+
+    // creates the tree on disk in existing directory 'root'; returns FALSE on error (already
+    // printed to stderr)
+    BOOL Write(const wchar_t* root) const;
+
+    // adds the tree into 'tree' under directory 'root'
+    void Write(MemoryFileTree& tree, const wchar_t* root) const;
+
+    // appends the directories ('dirs' is TRUE) and/or the files ('files' is TRUE) to the items
+    // of 'snapshot'; 'deleteOrder' is TRUE = the subtrees before their directories
+    void AddToSnapshot(CSelectionSnapshot& snapshot, BOOL dirs, BOOL files, BOOL deleteOrder) const;
+};
+
+// removes directory 'root' with its whole subtree from disk (cleanup of the suites); returns
+// FALSE if something could not be removed
+BOOL RemoveBenchDir(const wchar_t* root);
+
+// settings of the run (from the command line)
+struct CBenchContext
+{
+    std::wstring WorkDirW; // work directory on disk (ANSI characters only, the scripts use ANSI paths too)
+    std::string WorkDir;   // WorkDirW in ANSI
+    int Scale;             // multiplies the sizes of the synthetic trees
+    BOOL Failed;           // TRUE if some suite failed (the exit code of salbench is 1)
+};
+
+// suite of benchmarks, returns FALSE on error (already printed)
+typedef BOOL (*FBenchSuite)(CBenchContext& ctx);
+
+// worker suites (see benchworker.cpp)
+BOOL RunWorkerDiskSuite(CBenchContext& ctx);
+BOOL RunWorkerMemorySuite(CBenchContext& ctx);
+BOOL RunDeleteScalingSuite(CBenchContext& ctx);
+
+// growth of TDirectArray: by Delta, geometric, Reserve (see bencharray.cpp)
+BOOL RunArraySuite(CBenchContext& ctx);
+
+// Find: the text as typed and the extra pass of the Unicode option (see benchfind.cpp)
+BOOL RunFindSuite(CBenchContext& ctx);
+
+// CMaskGroup::AgreeMasks against AgreeMask (see benchmasks.cpp)
+BOOL RunMasksSuite(CBenchContext& ctx);
+
+// vectorized CSearchData against Boyer-Moore and a simple search (see benchmoore.cpp)
+BOOL RunMooreSuite(CBenchContext& ctx);
+
+// returns the current value of the performance counter in seconds
+double GetBenchTime();
+
+// pseudo-random numbers for the equivalence checks; the same seed gives the same sequence,
+// so a failed check can be repeated
+void SetBenchRandomSeed(DWORD seed);
+int GetBenchRandom(int range); // returns a number from 0 to 'range' - 1
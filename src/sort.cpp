@@ -258,6 +258,239 @@ int RegSetStrCmpEx(const char* s1, int l1, const char* s2, int l2, BOOL* numeric
     }
 }
 
+//
+//*****************************************************************************
+// Sorting by precomputed keys
+//
+// For bigger ranges, the sort functions below do not swap whole CFileData structures and do
+// not compare names from scratch in each step: a compact key (primary value + beginning of the
+// case-folded name or extension) is computed for each item once, an array of keys is sorted and
+// the items are then moved to their places at once. Items are compared by their CFileData (see
+// LessXxx functions) only when their keys do not decide, so the resulting order is the same.
+//
+
+#define SORT_KEYS_MIN_COUNT 64 // smaller ranges are sorted directly, building of keys would not pay off
+#define SORT_KEY_PREFIX_SIZE 8 // number of characters of name (or extension) stored in the key
+
+struct CSortKey
+{
+    unsigned __int64 Primary;          // time, size or attributes (zero when sorting by name or extension)
+    BYTE Prefix[SORT_KEY_PREFIX_SIZE]; // LowerCase[] of the beginning of name (extension), see BuildSortKeyPrefix
+    BYTE PrefixLen;                    // number of valid characters in 'Prefix'
+    int Index;                         // index of the item in the sorted range
+};
+
+struct CSortKeysContext
+{
+    CFileData* Items;    // sorted range ('Index' of CSortKey is relative to it)
+    CLessFunction Less;  // comparison of items if their keys are equal
+    BOOL Reverse;        // reverse order of names
+    BOOL PrimaryReverse; // reverse order of 'Primary' values
+};
+
+// value of attributes for sorting by attributes (we sort alphabetically by displayed attribute
+// letters, as explorer and speed commander do)
+static DWORD GetAttrSortValue(DWORD attr)
+{
+    // if we support displaying another attribute,
+    // need to extend the DISPLAYED_ATTRIBUTES mask
+    DWORD value = 0;
+    if (attr & FILE_ATTRIBUTE_ARCHIVE)
+        value |= 0x00000001;
+    if (attr & FILE_ATTRIBUTE_COMPRESSED)
+        value |= 0x00000002;
+    if (attr & FILE_ATTRIBUTE_ENCRYPTED)
+        value |= 0x00000004;
+    if (attr & FILE_ATTRIBUTE_HIDDEN)
+        value |= 0x00000008;
+    if (attr & FILE_ATTRIBUTE_READONLY)
+        value |= 0x00000010;
+    if (attr & FILE_ATTRIBUTE_SYSTEM)
+        value |= 0x00000020;
+    if (attr & FILE_ATTRIBUTE_TEMPORARY)
+        value |= 0x00000040;
+    return value;
+}
+
+// stores the beginning of string 's' (length 'len') into the prefix of 'key'; the prefix is
+// chosen so that the first difference of two prefixes decides also RegSetStrICmpEx() (and
+// RegSetStrCmpEx() is used only for strings equal when ignoring case): with numbers detection
+// the prefix ends before the first digit (or dot), it is not used with regional settings at all
+static void BuildSortKeyPrefix(CSortKey* key, const char* s, int len, BOOL stopAtDigits, BOOL stopAtDots)
+{
+    int i = 0;
+    if (!Configuration.SortUsesLocale)
+    {
+        for (; i < len && i < SORT_KEY_PREFIX_SIZE; i++)
+        {
+            char c = s[i];
+            if (stopAtDigits && c >= '0' && c <= '9' || stopAtDots && c == '.')
+                break;
+            key->Prefix[i] = LowerCase[c];
+        }
+    }
+    key->PrefixLen = (BYTE)i;
+}
+
+static BOOL LessSortKey(const CSortKey& k1, const CSortKey& k2, const CSortKeysContext* ctx)
+{
+    if (k1.Primary != k2.Primary)
+        return ctx->PrimaryReverse ? k1.Primary > k2.Primary : k1.Primary < k2.Primary;
+    int len = k1.PrefixLen < k2.PrefixLen ? k1.PrefixLen : k2.PrefixLen;
+    for (int i = 0; i < len; i++)
+    {
+        if (k1.Prefix[i] != k2.Prefix[i])
+            return ctx->Reverse ? k1.Prefix[i] > k2.Prefix[i] : k1.Prefix[i] < k2.Prefix[i];
+    }
+    return ctx->Less(ctx->Items[k1.Index], ctx->Items[k2.Index], ctx->Reverse); // keys do not decide
+}
+
+static void SortKeysAux(CSortKey* keys, int left, int right, const CSortKeysContext* ctx)
+{
+
+LABEL_SortKeysAux:
+
+    int i = left, j = right;
+    CSortKey pivot = keys[(i + j) / 2];
+
+    do
+    {
+        while (LessSortKey(keys[i], pivot, ctx) && i < right)
+            i++;
+        while (LessSortKey(pivot, keys[j], ctx) && j > left)
+            j--;
+
+        if (i <= j)
+        {
+            CSortKey swap = keys[i];
+            keys[i] = keys[j];
+            keys[j] = swap;
+            i++;
+            j--;
+        }
+    } while (i <= j);
+
+    // smaller part goes to recursion, the other one is processed via "goto" (max. log(N) recursion depth)
+    if (left < j)
+    {
+        if (i < right)
+        {
+            if (j - left < right - i)
+            {
+                SortKeysAux(keys, left, j, ctx);
+                left = i;
+                goto LABEL_SortKeysAux;
+            }
+            else
+            {
+                SortKeysAux(keys, i, right, ctx);
+                right = j;
+                goto LABEL_SortKeysAux;
+            }
+        }
+        else
+        {
+            right = j;
+            goto LABEL_SortKeysAux;
+        }
+    }
+    else
+    {
+        if (i < right)
+        {
+            left = i;
+            goto LABEL_SortKeysAux;
+        }
+    }
+}
+
+// sorts items 'left' to 'right' of 'files' by precomputed keys; returns FALSE if the range is
+// too small or there is not enough memory, the caller then sorts the range directly
+static BOOL SortByKeys(CFilesArray& files, int left, int right, CSortType sortType, BOOL reverse)
+{
+    int count = right - left + 1;
+    if (count < SORT_KEYS_MIN_COUNT)
+        return FALSE;
+
+    CSortKey* keys = (CSortKey*)malloc(count * sizeof(CSortKey));
+    CFileData* sorted = (CFileData*)malloc(count * sizeof(CFileData));
+    if (keys == NULL || sorted == NULL)
+    {
+        TRACE_E(LOW_MEMORY);
+        if (keys != NULL)
+            free(keys);
+        if (sorted != NULL)
+            free(sorted);
+        return FALSE;
+    }
+
+    CSortKeysContext ctx;
+    ctx.Items = files.GetData() + left;
+    ctx.Reverse = reverse;
+    ctx.PrimaryReverse = reverse;
+    switch (sortType)
+    {
+    case stName:
+        ctx.Less = LessNameExt;
+        break;
+    case stExtension:
+        ctx.Less = LessExtName;
+        break;
+    case stTime:
+    {
+        ctx.Less = LessTimeNameExt;
+        ctx.PrimaryReverse = reverse ^ Configuration.SortNewerOnTop;
+        break;
+    }
+    case stSize:
+        ctx.Less = LessSizeNameExt;
+        break;
+    default: // stAttr
+        ctx.Less = LessAttrNameExt;
+        break;
+    }
+
+    BOOL stopAtDigits = Configuration.SortDetectNumbers;
+    BOOL stopAtDots = stopAtDigits && WindowsVistaAndLater && !SystemPolicies.GetNoDotBreakInLogicalCompare(); // see StrCmpLogicalEx
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        const CFileData* f = &ctx.Items[i];
+        CSortKey* key = &keys[i];
+        key->Index = i;
+        switch (sortType)
+        {
+        case stTime:
+            key->Primary = ((unsigned __int64)f->LastWrite.dwHighDateTime << 32) | f->LastWrite.dwLowDateTime;
+            break;
+        case stSize:
+            key->Primary = f->Size.Value;
+            break;
+        case stAttr:
+            key->Primary = GetAttrSortValue(f->Attr);
+            break;
+        default:
+            key->Primary = 0;
+            break;
+        }
+        if (sortType == stExtension)
+            BuildSortKeyPrefix(key, f->Ext, f->NameLen - (int)(f->Ext - f->Name), stopAtDigits, stopAtDots);
+        else
+            BuildSortKeyPrefix(key, f->Name, f->NameLen, stopAtDigits, stopAtDots);
+    }
+
+    SortKeysAux(keys, 0, count - 1, &ctx);
+
+    // move items to their places (CFileData is moved by memmove in TDirectArray too)
+    for (i = 0; i < count; i++)
+        memcpy(&sorted[i], &ctx.Items[keys[i].Index], sizeof(CFileData));
+    memcpy(ctx.Items, sorted, count * sizeof(CFileData));
+
+    free(sorted);
+    free(keys);
+    return TRUE;
+}
+
 //
 //*****************************************************************************
 // QuickSort   1.key Name, 2.key Ext
@@ -399,7 +632,8 @@ LABEL_SortNameExtAux:
 
 void SortNameExt(CFilesArray& files, int left, int right, BOOL reverse)
 {
-    SortNameExtAux(files, left, right, reverse);
+    if (!SortByKeys(files, left, right, stName, reverse))
+        SortNameExtAux(files, left, right, reverse);
 }
 
 //
@@ -507,7 +741,8 @@ LABEL_SortExtNameAux:
 
 void SortExtName(CFilesArray& files, int left, int right, BOOL reverse)
 {
-    SortExtNameAux(files, left, right, reverse);
+    if (!SortByKeys(files, left, right, stExtension, reverse))
+        SortExtNameAux(files, left, right, reverse);
 }
 
 //
@@ -590,7 +825,8 @@ LABEL_SortTimeNameExtAux:
 
 void SortTimeNameExt(CFilesArray& files, int left, int right, BOOL reverse)
 {
-    SortTimeNameExtAux(files, left, right, reverse);
+    if (!SortByKeys(files, left, right, stTime, reverse))
+        SortTimeNameExtAux(files, left, right, reverse);
 }
 
 //
@@ -672,7 +908,8 @@ LABEL_SortSizeNameExtAux:
 
 void SortSizeNameExt(CFilesArray& files, int left, int right, BOOL reverse)
 {
-    SortSizeNameExtAux(files, left, right, reverse);
+    if (!SortByKeys(files, left, right, stSize, reverse))
+        SortSizeNameExtAux(files, left, right, reverse);
 }
 
 //
@@ -688,41 +925,9 @@ BOOL LessAttrNameExt(const CFileData& f1, const CFileData& f2, BOOL reverse)
     //  if (f1.Attr & FILE_ATTRIBUTE_READONLY) f1Attr |= 0x80000000;
     //  if (f2.Attr & FILE_ATTRIBUTE_READONLY) f2Attr |= 0x80000000;
 
-    // if we support displaying another attribute,
-    // need to extend the DISPLAYED_ATTRIBUTES mask
-
     // we switch to alphabetical sorting, as explorer and speed commander have
-    DWORD f1Attr = 0;
-    DWORD f2Attr = 0;
-    if (f1.Attr & FILE_ATTRIBUTE_ARCHIVE)
-        f1Attr |= 0x00000001;
-    if (f1.Attr & FILE_ATTRIBUTE_COMPRESSED)
-        f1Attr |= 0x00000002;
-    if (f1.Attr & FILE_ATTRIBUTE_ENCRYPTED)
-        f1Attr |= 0x00000004;
-    if (f1.Attr & FILE_ATTRIBUTE_HIDDEN)
-        f1Attr |= 0x00000008;
-    if (f1.Attr & FILE_ATTRIBUTE_READONLY)
-        f1Attr |= 0x00000010;
-    if (f1.Attr & FILE_ATTRIBUTE_SYSTEM)
-        f1Attr |= 0x00000020;
-    if (f1.Attr & FILE_ATTRIBUTE_TEMPORARY)
-        f1Attr |= 0x00000040;
-
-    if (f2.Attr & FILE_ATTRIBUTE_ARCHIVE)
-        f2Attr |= 0x00000001;
-    if (f2.Attr & FILE_ATTRIBUTE_COMPRESSED)
-        f2Attr |= 0x00000002;
-    if (f2.Attr & FILE_ATTRIBUTE_ENCRYPTED)
-        f2Attr |= 0x00000004;
-    if (f2.Attr & FILE_ATTRIBUTE_HIDDEN)
-        f2Attr |= 0x00000008;
-    if (f2.Attr & FILE_ATTRIBUTE_READONLY)
-        f2Attr |= 0x00000010;
-    if (f2.Attr & FILE_ATTRIBUTE_SYSTEM)
-        f2Attr |= 0x00000020;
-    if (f2.Attr & FILE_ATTRIBUTE_TEMPORARY)
-        f2Attr |= 0x00000040;
+    DWORD f1Attr = GetAttrSortValue(f1.Attr);
+    DWORD f2Attr = GetAttrSortValue(f2.Attr);
 
     //--- first by Attr
     if (f1Attr != f2Attr)
@@ -796,7 +1001,358 @@ LABEL_SortAttrNameExtAux:
 
 void SortAttrNameExt(CFilesArray& files, int left, int right, BOOL reverse)
 {
-    SortAttrNameExtAux(files, left, right, reverse);
+    if (!SortByKeys(files, left, right, stAttr, reverse))
+        SortAttrNameExtAux(files, left, right, reverse);
+}
+
+//
+//*****************************************************************************
+// CSortOrderCache
+//
+
+struct CSortOrderPos
+{
+    const char* Name; // CFileData::Name of the item (NULL = free slot)
+    int Pos;          // index of the item in the sorted listing (dirs without ".." followed by files)
+};
+
+// first slot to try for 'name' in the hash table of 'size' (power of two) slots
+static inline int GetSortOrderSlot(const char* name, int size)
+{
+    return (int)(((DWORD)((UINT_PTR)name >> 3) * 0x9E3779B1) >> 7) & (size - 1);
+}
+
+static DWORD GetSortConfig(BOOL sortDirsByName)
+{
+    return (Configuration.SortUsesLocale ? 0x01 : 0) |
+           (Configuration.SortDetectNumbers ? 0x02 : 0) |
+           (Configuration.SortNewerOnTop ? 0x04 : 0) |
+           (sortDirsByName ? 0x08 : 0) |
+           (SystemPolicies.GetNoDotBreakInLogicalCompare() ? 0x10 : 0);
+}
+
+// returns index of the first sorted directory (".." is not sorted, see SortFilesAndDirectories)
+static int GetFirstSortedDir(CFilesArray* dirs)
+{
+    return dirs->Count > 0 && dirs->At(0).NameLen == 2 && dirs->At(0).Name[0] == '.' && dirs->At(0).Name[1] == '.' ? 1 : 0;
+}
+
+// directories are sorted by name regardless of the reverse order, see SortFilesAndDirectories
+static BOOL AreDirsReversed(CSortType sortType, BOOL reverseSort, BOOL sortDirsByName)
+{
+    return reverseSort && (sortType != stTime || !sortDirsByName);
+}
+
+CSortOrderCache::CSortOrderCache()
+{
+    for (int i = 0; i <= stAttr; i++)
+        Orders[i] = NULL;
+    Files = NULL;
+    Dirs = NULL;
+    FilesCount = 0;
+    DirsCount = 0;
+    Config = 0;
+}
+
+void CSortOrderCache::Invalidate()
+{
+    for (int i = 0; i <= stAttr; i++)
+    {
+        if (Orders[i] != NULL)
+        {
+            free(Orders[i]);
+            Orders[i] = NULL;
+        }
+    }
+    Files = NULL;
+    Dirs = NULL;
+}
+
+void CSortOrderCache::Store(CFilesArray* files, CFilesArray* dirs, CSortType sortType, BOOL reverseSort, BOOL sortDirsByName)
+{
+    int firstDir = GetFirstSortedDir(dirs);
+    DWORD config = GetSortConfig(sortDirsByName);
+    if (Files != files || Dirs != dirs || FilesCount != files->Count || DirsCount != dirs->Count - firstDir ||
+        Config != config)
+    { // other listing or other sort options, old orders are useless
+        Invalidate();
+        Files = files;
+        Dirs = dirs;
+        FilesCount = files->Count;
+        DirsCount = dirs->Count - firstDir;
+        Config = config;
+    }
+    if (Orders[sortType] == NULL)
+    {
+        Orders[sortType] = (char**)malloc(max(DirsCount + FilesCount, 1) * sizeof(char*));
+        if (Orders[sortType] == NULL)
+        {
+            TRACE_E(LOW_MEMORY);
+            return;
+        }
+    }
+    char** order = Orders[sortType];
+    BOOL dirsReversed = AreDirsReversed(sortType, reverseSort, sortDirsByName);
+    int i;
+    for (i = 0; i < DirsCount; i++)
+        order[i] = dirs->At(firstDir + (dirsReversed ? DirsCount - 1 - i : i)).Name;
+    for (i = 0; i < FilesCount; i++)
+        order[DirsCount + i] = files->At(reverseSort ? FilesCount - 1 - i : i).Name;
+}
+
+BOOL CSortOrderCache::Restore(CFilesArray* files, CFilesArray* dirs, CSortType sortType, BOOL reverseSort, BOOL sortDirsByName)
+{
+    int firstDir = GetFirstSortedDir(dirs);
+    if (Orders[sortType] == NULL || Files != files || Dirs != dirs || FilesCount != files->Count ||
+        DirsCount != dirs->Count - firstDir || Config != GetSortConfig(sortDirsByName))
+    {
+        return FALSE;
+    }
+
+    // hash table: name of item -> its index in the sorted listing (reverse order is the remembered
+    // order read from the end)
+    int count = DirsCount + FilesCount;
+    int size = 16;
+    while (size < 2 * count)
+        size *= 2;
+    CSortOrderPos* table = (CSortOrderPos*)calloc(size, sizeof(CSortOrderPos));
+    CFileData* sorted = (CFileData*)malloc(max(count, 1) * sizeof(CFileData));
+    if (table == NULL || sorted == NULL)
+    {
+        TRACE_E(LOW_MEMORY);
+        if (table != NULL)
+            free(table);
+        if (sorted != NULL)
+            free(sorted);
+        return FALSE;
+    }
+    char** order = Orders[sortType];
+    BOOL dirsReversed = AreDirsReversed(sortType, reverseSort, sortDirsByName);
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        int slot = GetSortOrderSlot(order[i], size);
+        while (table[slot].Name != NULL)
+            slot = (slot + 1) & (size - 1);
+        table[slot].Name = order[i];
+        if (i < DirsCount)
+            table[slot].Pos = dirsReversed ? DirsCount - 1 - i : i;
+        else
+            table[slot].Pos = DirsCount + (reverseSort ? count - 1 - i : i - DirsCount);
+    }
+
+    // move items to their places; if any item is unknown, the listing changed and the order is useless
+    BOOL ok = TRUE;
+    for (i = 0; ok && i < count; i++)
+    {
+        CFileData* f = i < DirsCount ? &dirs->At(firstDir + i) : &files->At(i - DirsCount);
+        int slot = GetSortOrderSlot(f->Name, size);
+        while (table[slot].Name != NULL && table[slot].Name != f->Name)
+            slot = (slot + 1) & (size - 1);
+        if (table[slot].Name == NULL || (table[slot].Pos < DirsCount) != (i < DirsCount))
+            ok = FALSE;
+        else
+            memcpy(&sorted[table[slot].Pos], f, sizeof(CFileData));
+    }
+    if (ok)
+    {
+        if (DirsCount > 0)
+            memcpy(&dirs->At(firstDir), sorted, DirsCount * sizeof(CFileData));
+        if (FilesCount > 0)
+            memcpy(&files->At(0), sorted + DirsCount, FilesCount * sizeof(CFileData));
+    }
+    else
+    {
+        TRACE_E("CSortOrderCache::Restore(): listing has changed, invalidating sort orders.");
+        Invalidate();
+    }
+    free(sorted);
+    free(table);
+    return ok;
+}
+
+//
+//*****************************************************************************
+// Sorting of refreshed listing
+//
+
+#define SORT_PREVIOUS_MIN_COUNT 256 // smaller listings are simply sorted again
+
+typedef void (*CSortFunction)(CFilesArray& files, int left, int right, BOOL reverse);
+
+DWORD GetFileNameHashIgnCase(const char* name, int len)
+{
+    DWORD hash = 2166136261u; // FNV-1a
+    for (int i = 0; i < len; i++)
+        hash = (hash ^ LowerCase[(BYTE)name[i]]) * 16777619u;
+    return hash;
+}
+
+// functions used for sorting of dirs ('dirs' is TRUE) or files by 'sortType', must correspond
+// to SortFilesAndDirectories
+static void GetSortFunctions(CSortType sortType, BOOL dirs, BOOL reverseSort, BOOL sortDirsByName,
+                             CSortFunction* sort, CLessFunction* less, BOOL* reverse)
+{
+    *reverse = reverseSort;
+    switch (sortType)
+    {
+    case stExtension:
+        *sort = SortExtName;
+        *less = LessExtName;
+        break;
+    case stTime:
+    {
+        if (dirs && sortDirsByName)
+        {
+            *sort = SortNameExt;
+            *less = LessNameExt;
+            *reverse = FALSE;
+        }
+        else
+        {
+            *sort = SortTimeNameExt;
+            *less = LessTimeNameExt;
+        }
+        break;
+    }
+    case stSize:
+        *sort = SortSizeNameExt;
+        *less = LessSizeNameExt;
+        break;
+    case stAttr:
+        *sort = SortAttrNameExt;
+        *less = LessAttrNameExt;
+        break;
+    default: // stName
+        *sort = SortNameExt;
+        *less = LessNameExt;
+        break;
+    }
+}
+
+// sorts items of 'files' from index 'first' using items of 'oldFiles' from index 'oldFirst'
+// (previous listing sorted by 'less' and 'reverse'): items which did not change (same name,
+// time, size and attributes) keep their previous order, added and changed items are sorted
+// separately and merged into them; returns FALSE if there are too many changes or the previous
+// listing is not sorted this way ('files' is not changed then)
+static BOOL SortByPreviousListing(CFilesArray* files, int first, CFilesArray* oldFiles, int oldFirst,
+                                  CSortFunction sort, CLessFunction less, BOOL reverse)
+{
+    int count = files->Count - first;
+    int oldCount = oldFiles->Count - oldFirst;
+    if (count < SORT_PREVIOUS_MIN_COUNT || oldCount < count / 2)
+        return FALSE; // sorting is cheap or the listing changed too much
+
+    // hash table: name of new item -> its index + 1
+    int size = 16;
+    while (size < 2 * count)
+        size *= 2;
+    int* table = (int*)calloc(size, sizeof(int));
+    BYTE* used = (BYTE*)calloc(count, sizeof(BYTE));
+    CFileData* sorted = (CFileData*)malloc(count * sizeof(CFileData));
+    if (table == NULL || used == NULL || sorted == NULL)
+    {
+        TRACE_E(LOW_MEMORY);
+        if (table != NULL)
+            free(table);
+        if (used != NULL)
+            free(used);
+        if (sorted != NULL)
+            free(sorted);
+        return FALSE;
+    }
+    CFileData* items = &files->At(first);
+    int i;
+    for (i = 0; i < count; i++)
+    {
+        int slot = (int)GetFileNameHashIgnCase(items[i].Name, items[i].NameLen) & (size - 1);
+        while (table[slot] != 0)
+            slot = (slot + 1) & (size - 1);
+        table[slot] = i + 1;
+    }
+
+    // unchanged items in the previous order
+    int unchanged = 0;
+    BOOL ok = TRUE;
+    for (i = 0; ok && i < oldCount; i++)
+    {
+        const CFileData* old = &oldFiles->At(oldFirst + i);
+        int slot = (int)GetFileNameHashIgnCase(old->Name, old->NameLen) & (size - 1);
+        while (table[slot] != 0)
+        {
+            int index = table[slot] - 1;
+            const CFileData* f = &items[index];
+            if (f->NameLen == old->NameLen && memcmp(f->Name, old->Name, f->NameLen) == 0)
+            {
+                if (!used[index] && f->Size == old->Size && f->Attr == old->Attr &&
+                    CompareFileTime(&f->LastWrite, &old->LastWrite) == 0)
+                {
+                    if (unchanged > 0 && less(*f, sorted[unchanged - 1], reverse))
+                        ok = FALSE; // previous listing was sorted otherwise (e.g. sort options changed)
+                    used[index] = 1;
+                    sorted[unchanged++] = *f;
+                }
+                break;
+            }
+            slot = (slot + 1) & (size - 1);
+        }
+    }
+    if (ok && (count - unchanged) * 8 > count)
+        ok = FALSE; // too many changes, sorting of the whole listing is faster
+
+    if (ok)
+    {
+        // added and changed items are sorted behind unchanged items and then merged with them
+        int changed = unchanged;
+        for (i = 0; i < count; i++)
+        {
+            if (!used[i])
+                sorted[changed++] = items[i];
+        }
+        memcpy(items, sorted, count * sizeof(CFileData));
+        if (count - unchanged > 1)
+        {
+            sort(*files, first + unchanged, files->Count - 1, reverse);
+            memcpy(sorted + unchanged, items + unchanged, (count - unchanged) * sizeof(CFileData));
+        }
+        int a = 0;
+        int b = unchanged;
+        for (i = 0; i < count; i++)
+        {
+            if (b < count && (a >= unchanged || less(sorted[b], sorted[a], reverse)))
+                items[i] = sorted[b++];
+            else
+                items[i] = sorted[a++];
+        }
+    }
+    free(sorted);
+    free(used);
+    free(table);
+    return ok;
+}
+
+void SortRefreshedFilesAndDirectories(CFilesArray* files, CFilesArray* dirs, CFilesArray* oldFiles,
+                                      CFilesArray* oldDirs, CSortType sortType, BOOL reverseSort,
+                                      BOOL sortDirsByName)
+{
+    CALL_STACK_MESSAGE1("SortRefreshedFilesAndDirectories()");
+
+    CSortFunction sort;
+    CLessFunction less;
+    BOOL reverse;
+    int firstDir = GetFirstSortedDir(dirs);
+    if (dirs->Count - firstDir > 1)
+    {
+        GetSortFunctions(sortType, TRUE, reverseSort, sortDirsByName, &sort, &less, &reverse);
+        if (!SortByPreviousListing(dirs, firstDir, oldDirs, GetFirstSortedDir(oldDirs), sort, less, reverse))
+            sort(*dirs, firstDir, dirs->Count - 1, reverse);
+    }
+    if (files->Count > 1)
+    {
+        GetSortFunctions(sortType, FALSE, reverseSort, sortDirsByName, &sort, &less, &reverse);
+        if (!SortByPreviousListing(files, 0, oldFiles, 0, sort, less, reverse))
+            sort(*files, 0, files->Count - 1, reverse);
+    }
 }
 
 //
@@ -19,6 +19,52 @@ enum CSortType
 void SortFilesAndDirectories(CFilesArray* files, CFilesArray* dirs,
                              CSortType sortType, BOOL reverseSort, BOOL sortDirsByName);
 
+// sorts 'files' and 'dirs' like SortFilesAndDirectories(); 'oldFiles' and 'oldDirs' is the previous
+// listing of the same path sorted the same way (see RefreshDirectory): when only a small part of
+// the listing has changed, unchanged items keep their previous order and only added and changed
+// items are sorted and merged into them
+void SortRefreshedFilesAndDirectories(CFilesArray* files, CFilesArray* dirs, CFilesArray* oldFiles,
+                                      CFilesArray* oldDirs, CSortType sortType, BOOL reverseSort,
+                                      BOOL sortDirsByName);
+
+// hash of file name ignoring letter case (equal names ignoring case have equal hashes)
+DWORD GetFileNameHashIgnCase(const char* name, int len);
+
+//
+// ****************************************************************************
+// CSortOrderCache
+//
+// remembers orders of a panel listing for already used sort types, so switching back to such
+// sort type (or to its reverse) only moves the items to their places without sorting (see
+// CFilesWindow::ChangeSortType); orders are kept as arrays of CFileData::Name pointers (they
+// identify the items, the items themselves are moved by sorting), they are valid until the
+// listing changes (see Invalidate()) or until sort options change
+
+class CSortOrderCache
+{
+protected:
+    char** Orders[stAttr + 1]; // for each sort type: names of dirs (without "..") followed by names of files in the non-reverse order; NULL = order is not known
+    CFilesArray* Files;        // listing the orders belong to
+    CFilesArray* Dirs;
+    int FilesCount;
+    int DirsCount;
+    DWORD Config; // sort options the orders were made with, see GetSortConfig()
+
+public:
+    CSortOrderCache();
+    ~CSortOrderCache() { Invalidate(); }
+
+    // forgets all orders; must be called when items of the listing are added, removed or changed
+    void Invalidate();
+
+    // remembers the order of 'files' and 'dirs' just sorted by SortFilesAndDirectories()
+    void Store(CFilesArray* files, CFilesArray* dirs, CSortType sortType, BOOL reverseSort, BOOL sortDirsByName);
+
+    // sorts 'files' and 'dirs' using a remembered order; returns FALSE if the order is not known
+    // (the listing is not changed then and it must be sorted by SortFilesAndDirectories())
+    BOOL Restore(CFilesArray* files, CFilesArray* dirs, CSortType sortType, BOOL reverseSort, BOOL sortDirsByName);
+};
+
 void SortNameExt(CFilesArray& files, int left, int right, BOOL reverse);
 void SortExtName(CFilesArray& files, int left, int right, BOOL reverse);
 void SortTimeNameExt(CFilesArray& files, int left, int right, BOOL reverse);
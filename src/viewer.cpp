@@ -329,6 +329,7 @@ void CFindSetDialog::Transfer(CTransferInfo& ti)
 {
     ti.CheckBox(IDC_FINDHEX, HexMode);
     ti.CheckBox(IDC_VIEWREGEXP, Regular);
+    ti.CheckBox(IDC_VIEWMULTIPLE, Multiple);
     HistoryComboBox(HWindow, ti, IDC_FINDTEXT, Text, FIND_TEXT_LEN, !Regular && HexMode,
                     VIEWER_HISTORY_SIZE, ViewerHistory);
     if (ti.Type == ttDataToWindow)
@@ -373,8 +374,10 @@ CFindSetDialog::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
     {
         CancelHexMode = HexMode;
         CancelRegular = Regular;
-        EnableWindow(GetDlgItem(HWindow, IDC_FINDHEX), !Regular);
-        if (Regular)
+        CancelMultiple = Multiple;
+        EnableWindow(GetDlgItem(HWindow, IDC_FINDHEX), !Regular && !Multiple);
+        EnableWindow(GetDlgItem(HWindow, IDC_WHOLEWORDS), !Multiple);
+        if (Regular || Multiple)
             CheckDlgButton(HWindow, IDC_FINDHEX, BST_UNCHECKED);
         ChangeToArrowButton(HWindow, IDC_REGEXP_BROWSE);
 
@@ -403,6 +406,7 @@ CFindSetDialog::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
         {
             HexMode = CancelHexMode; // keep Cancel correct
             Regular = CancelRegular;
+            Multiple = CancelMultiple;
             break;
         }
 
@@ -431,9 +435,30 @@ CFindSetDialog::DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
         case IDC_VIEWREGEXP:
         {
             Regular = (IsDlgButtonChecked(HWindow, IDC_VIEWREGEXP) != BST_UNCHECKED);
-            EnableWindow(GetDlgItem(HWindow, IDC_FINDHEX), !Regular);
             if (Regular)
+            {
+                Multiple = FALSE;
+                CheckDlgButton(HWindow, IDC_VIEWMULTIPLE, BST_UNCHECKED);
+                EnableWindow(GetDlgItem(HWindow, IDC_WHOLEWORDS), TRUE);
+            }
+            EnableWindow(GetDlgItem(HWindow, IDC_FINDHEX), !Regular && !Multiple);
+            if (Regular)
+                CheckDlgButton(HWindow, IDC_FINDHEX, BST_UNCHECKED);
+            break;
+        }
+
+        case IDC_VIEWMULTIPLE:
+        {
+            Multiple = (IsDlgButtonChecked(HWindow, IDC_VIEWMULTIPLE) != BST_UNCHECKED);
+            if (Multiple)
+            {
+                Regular = FALSE;
+                CheckDlgButton(HWindow, IDC_VIEWREGEXP, BST_UNCHECKED);
+                HexMode = FALSE;
                 CheckDlgButton(HWindow, IDC_FINDHEX, BST_UNCHECKED);
+            }
+            EnableWindow(GetDlgItem(HWindow, IDC_FINDHEX), !Regular && !Multiple);
+            EnableWindow(GetDlgItem(HWindow, IDC_WHOLEWORDS), !Multiple);
             break;
         }
 
@@ -53,7 +53,8 @@ public:
         WholeWords,
         CaseSensitive,
         HexMode,
-        Regular;
+        Regular,
+        Multiple; // more texts at once (see CMultiSearchData::SetList)
 
     char Text[FIND_TEXT_LEN];
 
@@ -65,6 +66,7 @@ public:
         CaseSensitive = FALSE;
         HexMode = FALSE;
         Regular = FALSE;
+        Multiple = FALSE;
         Text[0] = 0;
     }
 
@@ -75,6 +77,7 @@ public:
         CaseSensitive = d.CaseSensitive;
         HexMode = d.HexMode;
         Regular = d.Regular;
+        Multiple = d.Multiple;
         memmove(Text, d.Text, FIND_TEXT_LEN);
         return *this;
     }
@@ -85,7 +88,8 @@ protected:
     virtual INT_PTR DialogProc(UINT uMsg, WPARAM wParam, LPARAM lParam);
 
     int CancelHexMode, // only for the Cancel button to work correctly
-        CancelRegular;
+        CancelRegular,
+        CancelMultiple;
 };
 
 // ****************************************************************************
@@ -137,6 +141,10 @@ public:
             {
                 RegExp.Set(FindDialog.Text, 0);
             }
+            else if (FindDialog.Multiple)
+            {
+                MultiSearch.SetList(FindDialog.Text, 0); // an error is reported when searching
+            }
             else
             {
                 if (FindDialog.HexMode)
@@ -332,7 +340,8 @@ protected:
 
     CFindSetDialog FindDialog;
     CSearchData SearchData;
-    CRegularExpression RegExp;
+    CLinearRegExp RegExp;
+    CMultiSearchData MultiSearch;
     __int64 FindOffset,              // seek from which to search
         LastFindSeekY,               // seek of the first screen line after searching, for detecting back-and-forth movement
         LastFindOffset;              // seek from which to search (set after searching), for detecting back-and-forth movement
@@ -1063,69 +1063,61 @@ CViewerWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                                         break;
                                     if (len == lineEnd - lineBegin)
                                     {
-                                        if (RegExp.SetLine((char*)(Buffer + (lineBegin - Seek)),
-                                                           (char*)(Buffer + (lineEnd - Seek))))
-                                        {
-                                            int start;
-                                            if (FindOffset > lineBegin)
-                                                start = (int)(FindOffset - lineBegin);
-                                            else
-                                                start = 0;
-                                            int foundLen;
+                                        RegExp.SetLine((char*)(Buffer + (lineBegin - Seek)),
+                                                       (char*)(Buffer + (lineEnd - Seek)));
+                                        int start;
+                                        if (FindOffset > lineBegin)
+                                            start = (int)(FindOffset - lineBegin);
+                                        else
+                                            start = 0;
+                                        int foundLen;
 
                                         REGEXP_FIND_NEXT_FORWARD:
 
-                                            found = RegExp.SearchForward(start, foundLen);
+                                        found = RegExp.SearchForward(start, foundLen);
 
-                                            if (found != -1 && FindDialog.WholeWords)
+                                        if (found != -1 && FindDialog.WholeWords)
+                                        {
+                                            BOOL fail = FALSE;
+                                            if (found > 0)
                                             {
-                                                BOOL fail = FALSE;
-                                                if (found > 0)
+                                                if (Prepare(&hFile, lineBegin + found - 1, 1, fatalErr) == 1 && !fatalErr)
                                                 {
-                                                    if (Prepare(&hFile, lineBegin + found - 1, 1, fatalErr) == 1 && !fatalErr)
-                                                    {
-                                                        char c = *(Buffer + (lineBegin + found - 1 - Seek));
-                                                        fail |= (c == '_' || IsCharAlpha(c) || IsCharAlphaNumeric(c));
-                                                    }
-                                                    if (fatalErr)
-                                                        break;
-                                                }
-                                                if (found + foundLen < lineEnd - lineBegin &&
-                                                    Prepare(&hFile, lineBegin + found + foundLen, 1, fatalErr) == 1 && !fatalErr)
-                                                {
-                                                    char c = *(Buffer + (lineBegin + found + foundLen - Seek));
+                                                    char c = *(Buffer + (lineBegin + found - 1 - Seek));
                                                     fail |= (c == '_' || IsCharAlpha(c) || IsCharAlphaNumeric(c));
                                                 }
                                                 if (fatalErr)
                                                     break;
-                                                if (fail)
-                                                {
-                                                    start = found + 1;
-                                                    if (start < lineEnd - lineBegin)
-                                                        goto REGEXP_FIND_NEXT_FORWARD;
-                                                    found = -1;
-                                                }
                                             }
-
-                                            if (found != -1)
+                                            if (found + foundLen < lineEnd - lineBegin &&
+                                                Prepare(&hFile, lineBegin + found + foundLen, 1, fatalErr) == 1 && !fatalErr)
                                             {
-                                                if (foundLen == 0)
-                                                {
-                                                    gPrompter->ShowInfo(HWindow, LoadStrW(IDS_FINDTITLE), LoadStrW(IDS_EMPTYMATCH));
-                                                    noNotFound = TRUE;
-                                                    break;
-                                                }
-                                                StartSelection = lineBegin + found;
-                                                FindOffset = EndSelection = StartSelection + foundLen;
-                                                SelectionIsFindResult = TRUE;
-                                                break; // found!
+                                                char c = *(Buffer + (lineBegin + found + foundLen - Seek));
+                                                fail |= (c == '_' || IsCharAlpha(c) || IsCharAlphaNumeric(c));
+                                            }
+                                            if (fatalErr)
+                                                break;
+                                            if (fail)
+                                            {
+                                                start = found + 1;
+                                                if (start < lineEnd - lineBegin)
+                                                    goto REGEXP_FIND_NEXT_FORWARD;
+                                                found = -1;
                                             }
                                         }
-                                        else // error - low memory
+
+                                        if (found != -1)
                                         {
-                                            gPrompter->ShowError(HWindow, LoadStrW(IDS_FINDTITLE), AnsiToWide(RegExp.GetLastErrorText()).c_str());
-                                            noNotFound = TRUE;
-                                            break;
+                                            if (foundLen == 0)
+                                            {
+                                                gPrompter->ShowInfo(HWindow, LoadStrW(IDS_FINDTITLE), LoadStrW(IDS_EMPTYMATCH));
+                                                noNotFound = TRUE;
+                                                break;
+                                            }
+                                            StartSelection = lineBegin + found;
+                                            FindOffset = EndSelection = StartSelection + foundLen;
+                                            SelectionIsFindResult = TRUE;
+                                            break; // found!
                                         }
                                     }
                                     else
@@ -1173,69 +1165,61 @@ CViewerWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                                         break;
                                     if (len == lineEnd - lineBegin)
                                     {
-                                        if (RegExp.SetLine((char*)(Buffer + (lineBegin - Seek)),
-                                                           (char*)(Buffer + (lineEnd - Seek))))
-                                        {
-                                            int length;
-                                            if (FindOffset < lineEnd)
-                                                length = (int)(FindOffset - lineBegin);
-                                            else
-                                                length = (int)(lineEnd - lineBegin);
-                                            int foundLen;
+                                        RegExp.SetLine((char*)(Buffer + (lineBegin - Seek)),
+                                                       (char*)(Buffer + (lineEnd - Seek)));
+                                        int length;
+                                        if (FindOffset < lineEnd)
+                                            length = (int)(FindOffset - lineBegin);
+                                        else
+                                            length = (int)(lineEnd - lineBegin);
+                                        int foundLen;
 
                                         REGEXP_FIND_NEXT_BACKWARD:
 
-                                            found = RegExp.SearchBackward(length, foundLen);
+                                        found = RegExp.SearchBackward(length, foundLen);
 
-                                            if (found != -1 && FindDialog.WholeWords)
+                                        if (found != -1 && FindDialog.WholeWords)
+                                        {
+                                            BOOL fail = FALSE;
+                                            if (found > 0)
                                             {
-                                                BOOL fail = FALSE;
-                                                if (found > 0)
-                                                {
-                                                    if (Prepare(&hFile, lineBegin + found - 1, 1, fatalErr) == 1 && !fatalErr)
-                                                    {
-                                                        char c = *(Buffer + (lineBegin + found - 1 - Seek));
-                                                        fail |= (c == '_' || IsCharAlpha(c) || IsCharAlphaNumeric(c));
-                                                    }
-                                                    if (fatalErr)
-                                                        break;
-                                                }
-                                                if (found + foundLen < lineEnd - lineBegin &&
-                                                    Prepare(&hFile, lineBegin + found + foundLen, 1, fatalErr) == 1 && !fatalErr)
+                                                if (Prepare(&hFile, lineBegin + found - 1, 1, fatalErr) == 1 && !fatalErr)
                                                 {
-                                                    char c = *(Buffer + (lineBegin + found + foundLen - Seek));
+                                                    char c = *(Buffer + (lineBegin + found - 1 - Seek));
                                                     fail |= (c == '_' || IsCharAlpha(c) || IsCharAlphaNumeric(c));
                                                 }
                                                 if (fatalErr)
                                                     break;
-                                                if (fail)
-                                                {
-                                                    length = found + foundLen - 1;
-                                                    if (length > 0)
-                                                        goto REGEXP_FIND_NEXT_BACKWARD;
-                                                    found = -1;
-                                                }
                                             }
-
-                                            if (found != -1)
+                                            if (found + foundLen < lineEnd - lineBegin &&
+                                                Prepare(&hFile, lineBegin + found + foundLen, 1, fatalErr) == 1 && !fatalErr)
                                             {
-                                                if (foundLen == 0)
-                                                {
-                                                    gPrompter->ShowInfo(HWindow, LoadStrW(IDS_FINDTITLE), LoadStrW(IDS_EMPTYMATCH));
-                                                    noNotFound = TRUE;
-                                                    break;
-                                                }
-                                                FindOffset = StartSelection = lineBegin + found;
-                                                EndSelection = StartSelection + foundLen;
-                                                SelectionIsFindResult = TRUE;
-                                                break; // found!
+                                                char c = *(Buffer + (lineBegin + found + foundLen - Seek));
+                                                fail |= (c == '_' || IsCharAlpha(c) || IsCharAlphaNumeric(c));
+                                            }
+                                            if (fatalErr)
+                                                break;
+                                            if (fail)
+                                            {
+                                                length = found + foundLen - 1;
+                                                if (length > 0)
+                                                    goto REGEXP_FIND_NEXT_BACKWARD;
+                                                found = -1;
                                             }
                                         }
-                                        else // error - low memory
+
+                                        if (found != -1)
                                         {
-                                            gPrompter->ShowError(HWindow, LoadStrW(IDS_FINDTITLE), AnsiToWide(RegExp.GetLastErrorText()).c_str());
-                                            noNotFound = TRUE;
-                                            break;
+                                            if (foundLen == 0)
+                                            {
+                                                gPrompter->ShowInfo(HWindow, LoadStrW(IDS_FINDTITLE), LoadStrW(IDS_EMPTYMATCH));
+                                                noNotFound = TRUE;
+                                                break;
+                                            }
+                                            FindOffset = StartSelection = lineBegin + found;
+                                            EndSelection = StartSelection + foundLen;
+                                            SelectionIsFindResult = TRUE;
+                                            break; // found!
                                         }
                                     }
                                     else
@@ -1270,9 +1254,32 @@ CViewerWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
             }
             else
             {
-                SearchData.SetFlags(flags);
-                if (SearchData.IsGood())
+                // more texts at once: found texts differ in length, so the parts of the file overlap
+                // by the longest text and the selection uses the length of the found one
+                BOOL multiple = FindDialog.Multiple;
+                BOOL good;
+                if (multiple)
+                {
+                    good = MultiSearch.SetFlags(flags);
+                    if (!good)
+                    {
+                        std::wstring msg = FormatStrW(LoadStrW(IDS_INVALIDMULTISEARCH), AnsiToWide(FindDialog.Text).c_str(),
+                                                      AnsiToWide(MultiSearch.GetLastErrorText()).c_str());
+                        gPrompter->ShowError(HWindow, LoadStrW(IDS_FINDTITLE), msg.c_str());
+                        noNotFound = TRUE;
+                    }
+                }
+                else
                 {
+                    SearchData.SetFlags(flags);
+                    good = SearchData.IsGood();
+                }
+                if (good)
+                {
+                    int minLen = multiple ? MultiSearch.GetMinLength() : SearchData.GetLength();
+                    int maxLen = multiple ? MultiSearch.GetMaxLength() : SearchData.GetLength();
+                    BOOL wholeWords = FindDialog.WholeWords && !multiple;
+                    int foundLen = maxLen;
                     if (forward)
                     {
                         while (1)
@@ -1280,11 +1287,23 @@ CViewerWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                             __int64 len = Prepare(&hFile, FindOffset, FIND_LINE_LEN, fatalErr);
                             if (fatalErr)
                                 break;
-                            if (len >= SearchData.GetLength())
+                            if (len >= minLen)
                             {
-                                found = SearchData.SearchForward((char*)(Buffer + (FindOffset - Seek)),
-                                                                 (int)len, 0);
-                                if (found != -1 && FindDialog.WholeWords)
+                                if (multiple)
+                                {
+                                    found = MultiSearch.SearchForward((char*)(Buffer + (FindOffset - Seek)),
+                                                                      (int)len, 0, foundLen);
+                                    // a longer text starting at 'found' or before it may continue behind
+                                    // the part, search again from the next part (overlapping by 'maxLen')
+                                    if (found != -1 && found + maxLen > len && len == FIND_LINE_LEN)
+                                        found = -1;
+                                }
+                                else
+                                {
+                                    found = SearchData.SearchForward((char*)(Buffer + (FindOffset - Seek)),
+                                                                     (int)len, 0);
+                                }
+                                if (found != -1 && wholeWords)
                                 {
                                     BOOL fail = FALSE;
                                     if (FindOffset + found > 0)
@@ -1297,28 +1316,28 @@ CViewerWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                                         if (fatalErr)
                                             break;
                                     }
-                                    if (Prepare(&hFile, FindOffset + found + SearchData.GetLength(), 1, fatalErr) == 1 && !fatalErr)
+                                    if (Prepare(&hFile, FindOffset + found + foundLen, 1, fatalErr) == 1 && !fatalErr)
                                     {
-                                        char c = *(Buffer + (FindOffset + found + SearchData.GetLength() - Seek));
+                                        char c = *(Buffer + (FindOffset + found + foundLen - Seek));
                                         fail |= (c == '_' || IsCharAlpha(c) || IsCharAlphaNumeric(c));
                                     }
                                     if (fatalErr)
                                         break;
                                     if (fail)
                                     {
-                                        len = found + SearchData.GetLength();
+                                        len = found + maxLen;
                                         found = -1;
                                     }
                                 }
                                 if (found != -1)
                                 {
                                     StartSelection = FindOffset + found;
-                                    FindOffset = EndSelection = StartSelection + SearchData.GetLength();
+                                    FindOffset = EndSelection = StartSelection + foundLen;
                                     SelectionIsFindResult = TRUE;
                                     break;
                                 }
-                                len -= SearchData.GetLength() - 1;
-                                if (len >= 0)
+                                len -= maxLen - 1;
+                                if (len > 0) // zero only for texts of different lengths at the end of the file
                                     FindOffset += len;
                                 else
                                     break; // end of file
@@ -1354,10 +1373,13 @@ CViewerWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                             len = Prepare(&hFile, off, len, fatalErr);
                             if (fatalErr)
                                 break;
-                            if (len >= SearchData.GetLength())
+                            if (len >= minLen)
                             {
-                                found = SearchData.SearchBackward((char*)(Buffer + (off - Seek)), (int)len);
-                                if (found != -1 && FindDialog.WholeWords)
+                                if (multiple)
+                                    found = MultiSearch.SearchBackward((char*)(Buffer + (off - Seek)), (int)len, foundLen);
+                                else
+                                    found = SearchData.SearchBackward((char*)(Buffer + (off - Seek)), (int)len);
+                                if (found != -1 && wholeWords)
                                 {
                                     BOOL fail = FALSE;
                                     if (off + found > 0)
@@ -1370,9 +1392,9 @@ CViewerWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                                         if (fatalErr)
                                             break;
                                     }
-                                    if (Prepare(&hFile, off + found + SearchData.GetLength(), 1, fatalErr) == 1 && !fatalErr)
+                                    if (Prepare(&hFile, off + found + foundLen, 1, fatalErr) == 1 && !fatalErr)
                                     {
-                                        char c = *(Buffer + (off + found + SearchData.GetLength() - Seek));
+                                        char c = *(Buffer + (off + found + foundLen - Seek));
                                         fail |= (c == '_' || IsCharAlpha(c) || IsCharAlphaNumeric(c));
                                     }
                                     if (fatalErr)
@@ -1386,12 +1408,12 @@ CViewerWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                                 if (found != -1)
                                 {
                                     FindOffset = StartSelection = off + found;
-                                    EndSelection = StartSelection + SearchData.GetLength();
+                                    EndSelection = StartSelection + foundLen;
                                     SelectionIsFindResult = TRUE;
                                     break;
                                 }
-                                len -= SearchData.GetLength() - 1;
-                                if (len >= 0)
+                                len -= maxLen - 1;
+                                if (len > 0)
                                     FindOffset -= len;
                                 else
                                     break; // beginning of file
@@ -1440,7 +1462,7 @@ CViewerWindow::WindowProc(UINT uMsg, WPARAM wParam, LPARAM lParam)
                 FindOffset = oldFindOffset;
                 if (!noNotFound)
                 {
-                    std::wstring msg = FormatStrW(LoadStrW(FindDialog.Regular ? IDS_FIND_NOREGEXPMATCH : IDS_FIND_NOMATCH), AnsiToWide(FindDialog.Text).c_str());
+                    std::wstring msg = FormatStrW(LoadStrW(FindDialog.Regular ? IDS_FIND_NOREGEXPMATCH : FindDialog.Multiple ? IDS_FIND_NOMULTIMATCH : IDS_FIND_NOMATCH), AnsiToWide(FindDialog.Text).c_str());
                     gPrompter->ShowInfo(HWindow, LoadStrW(IDS_FINDTITLE), msg.c_str());
                 }
             }
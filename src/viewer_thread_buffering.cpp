@@ -269,6 +269,30 @@ const char* RegExpErrorText(CRegExpErrors err)
     }
 }
 
+//*****************************************************************************
+//
+// MultiSearchErrorText
+//
+// error messages from multisearch.cpp
+//
+
+const char* MultiSearchErrorText(CMultiSearchErrors err)
+{
+    switch (err)
+    {
+    case mseLowMemory:
+        return LoadStr(IDS_MULTISEARCHERROR1);
+    case mseEmpty:
+        return LoadStr(IDS_MULTISEARCHERROR2);
+    case mseTooBig:
+        return LoadStr(IDS_MULTISEARCHERROR3);
+    case mseListFile:
+        return LoadStr(IDS_MULTISEARCHERROR4);
+    default:
+        return "";
+    }
+}
+
 //
 //*****************************************************************************
 // CViewerWindow
@@ -11,11 +11,13 @@
 #include "common/IFileSystem.h"
 #include "common/IWorkerObserver.h"
 #include "DialogWorkerObserver.h"
+#include "dirreader.h"
 #include "common/unicode/helpers.h"
 #include "common/unicode/PathIdentityPolicy.h"
 
 #include <aclapi.h>
 #include <ntsecapi.h>
+#include <psapi.h>
 
 // these functions have no header, we must load them dynamically
 NTQUERYINFORMATIONFILE DynNtQueryInformationFile = NULL;
@@ -256,7 +258,7 @@ void CTransferSpeedMeter::AdjustProgressBufferLimit(DWORD* progressBufferLimit,
             totalTime = 10; // treat 0 ms as 10 ms (approx. the GetTickCount() step)
         unsigned __int64 speed = (size * 1000) / totalTime;
         DWORD bufLimit = ASYNC_SLOW_COPY_BUF_SIZE;
-        while (bufLimit < ASYNC_COPY_BUF_SIZE)
+        while (bufLimit < ASYNC_COPY_MAX_BUF_SIZE)
         {
             // determined experimentally that Windows 7 loves a 32 KB buffer size; with it the utilization curve
             // of the network link is usually nicely smooth, whereas with 64 KB it jumps like crazy
@@ -280,8 +282,8 @@ void CTransferSpeedMeter::AdjustProgressBufferLimit(DWORD* progressBufferLimit,
                 bufLimit *= 2;
             }
         }
-        if (bufLimit > ASYNC_COPY_BUF_SIZE)
-            bufLimit = ASYNC_COPY_BUF_SIZE;
+        if (bufLimit > ASYNC_COPY_MAX_BUF_SIZE)
+            bufLimit = ASYNC_COPY_MAX_BUF_SIZE;
         *progressBufferLimit = bufLimit;
 #ifdef WORKER_COPY_DEBUG_MSG
         TRACE_I("AdjustProgressBufferLimit(): speed=" << speed / 1024.0 << " KB/s, size=" << size << " B, packets=" << packets << ", new buffer limit=" << bufLimit);
@@ -948,6 +950,8 @@ COperations::COperations(int base, int delta, const char* waitInQueueSubject, co
     PreserveDirTime = FALSE;
     SourcePathIsNetwork = FALSE;
     CopyAttrs = FALSE;
+    VerifyCopy = FALSE;
+    DeltaCopy = FALSE;
     StartOnIdle = FALSE;
     ShowStatus = FALSE;
     IsCopyOperation = FALSE;
@@ -969,6 +973,8 @@ COperations::COperations(int base, int delta, const char* waitInQueueSubject, co
     WaitInQueueSubject = waitInQueueSubject ? waitInQueueSubject : "";
     WaitInQueueFrom = waitInQueueFrom ? waitInQueueFrom : "";
     WaitInQueueTo = waitInQueueTo ? waitInQueueTo : "";
+    QueueDevices.SourceRoot[0] = 0;
+    QueueDevices.TargetRoot[0] = 0;
     HANDLES(InitializeCriticalSection(&StatusCS));
     TransferredFileSize = CQuadWord(0, 0);
     ProgressSize = CQuadWord(0, 0);
@@ -983,6 +989,30 @@ COperations::COperations(int base, int delta, const char* waitInQueueSubject, co
     LastProgBufLimTestTime = GetTickCount() - 1000;
     LastFileBlockCount = 0;
     LastFileStartTime = GetTickCount();
+    HANDLES(InitializeCriticalSection(&PipeCS));
+    Pipelined = FALSE;
+    PipePublished = NULL;
+    PipeConsumed = NULL;
+    PublishedCount = 0;
+    ConsumedCount = 0;
+    BuildEnded = FALSE;
+    BuildFailed = FALSE;
+    WorkerEnded = FALSE;
+    LastDirs[0] = LastDirs[1] = NULL;
+    ResumeIndex = 0;
+    ResumeOffset = CQuadWord(0, 0);
+    Journal = NULL;
+    NamesLowMemory = FALSE;
+}
+
+COperations::~COperations()
+{
+    if (PipePublished != NULL)
+        HANDLES(CloseHandle(PipePublished));
+    if (PipeConsumed != NULL)
+        HANDLES(CloseHandle(PipeConsumed));
+    HANDLES(DeleteCriticalSection(&PipeCS));
+    HANDLES(DeleteCriticalSection(&StatusCS));
 }
 
 void COperations::SetTFS(const CQuadWord& TFS)
@@ -1292,6 +1322,313 @@ void COperations::GetSpeedLimit(BOOL* useSpeedLimit, DWORD* speedLimit)
     HANDLES(LeaveCriticalSection(&StatusCS));
 }
 
+BOOL COperations::BeginPipelinedBuild()
+{
+    if (Pipelined)
+        return TRUE;
+    if (PipePublished == NULL)
+        PipePublished = HANDLES(CreateEvent(NULL, FALSE, FALSE, NULL)); // "nonsignaled" state, auto
+    if (PipeConsumed == NULL)
+        PipeConsumed = HANDLES(CreateEvent(NULL, FALSE, FALSE, NULL)); // "nonsignaled" state, auto
+    if (PipePublished == NULL || PipeConsumed == NULL)
+    {
+        TRACE_E("COperations::BeginPipelinedBuild(): unable to create events!");
+        return FALSE;
+    }
+    // the worker is not running yet, so no critical section is needed here
+    TotalSize = CQuadWord(0, 0);
+    PublishedCount = 0;
+    ConsumedCount = 0;
+    BuildEnded = FALSE;
+    BuildFailed = FALSE;
+    WorkerEnded = FALSE;
+    int count = Count - 1; // the last operation can still be deleted by BuildScriptDir
+    while (PublishedCount < count)
+        TotalSize += m_ops[PublishedCount++].Size;
+    Pipelined = TRUE;
+    return TRUE;
+}
+
+void COperations::CancelPipelinedBuild()
+{
+    // the worker was not started, so BuildScriptMain will compute TotalSize from scratch
+    Pipelined = FALSE;
+    TotalSize = CQuadWord(0, 0);
+    PublishedCount = 0;
+}
+
+BOOL COperations::PublishOperations(BOOL* tooFarAhead)
+{
+    *tooFarAhead = FALSE;
+    if (!Pipelined)
+        return TRUE;
+
+    HANDLES(EnterCriticalSection(&PipeCS));
+    int count = Count - 1; // the last operation can still be deleted by BuildScriptDir
+    BOOL published = PublishedCount < count;
+    while (PublishedCount < count)
+        TotalSize += m_ops[PublishedCount++].Size;
+    BOOL workerEnded = WorkerEnded;
+    *tooFarAhead = Count - ConsumedCount > SCRIPT_PIPE_MAX_AHEAD;
+    HANDLES(LeaveCriticalSection(&PipeCS));
+    if (published)
+        SetEvent(PipePublished);
+    return !workerEnded;
+}
+
+void COperations::WaitForWorker(DWORD timeout)
+{
+    // the main thread is waiting here, so keep processing sent messages (other threads may
+    // be waiting in SendMessage to our windows)
+    if (MsgWaitForMultipleObjects(1, &PipeConsumed, FALSE, timeout, QS_SENDMESSAGE) == WAIT_OBJECT_0 + 1)
+    {
+        MSG msg;
+        PeekMessage(&msg, NULL, 0, 0, PM_NOREMOVE); // dispatches the sent messages
+    }
+}
+
+void COperations::EndPipelinedBuild(BOOL success)
+{
+    if (!Pipelined)
+        return;
+
+    HANDLES(EnterCriticalSection(&PipeCS));
+    if (success)
+    {
+        while (PublishedCount < Count)
+            TotalSize += m_ops[PublishedCount++].Size;
+    }
+    else
+        BuildFailed = TRUE; // the user cancelled the build or it failed, the worker stops at the next operation
+    BuildEnded = TRUE; // WARNING: from now on the worker may free the script at any time
+    HANDLE pipePublished = PipePublished;
+    HANDLES(LeaveCriticalSection(&PipeCS));
+    SetEvent(pipePublished);
+}
+
+const char* COperations::GetSharedDir(const char* dir, int len)
+{
+    // files of one directory follow each other in the script, so it is enough to remember the last
+    // source and target directory
+    for (int i = 0; i < 2; i++)
+    {
+        const char* last = LastDirs[i];
+        if (last != NULL && strncmp(last, dir, len) == 0 && last[len] == 0)
+        {
+            LastDirs[i] = LastDirs[0];
+            LastDirs[0] = last;
+            return last;
+        }
+    }
+    DirNames.emplace_back(dir, len);
+    LastDirs[1] = LastDirs[0];
+    LastDirs[0] = DirNames.back().c_str();
+    return LastDirs[0];
+}
+
+// shortens 'name' (and 'nameW' if it is not empty) to the name of the file behind 'dirLen' characters
+static void CutToFileName(char*& name, int dirLen, std::wstring& nameW)
+{
+    int len = (int)strlen(name + dirLen);
+    memmove(name, name + dirLen, len + 1);
+    char* shorter = (char*)realloc(name, len + 1);
+    if (shorter != NULL)
+        name = shorter; // otherwise keep the original (longer) block
+
+    size_t backslash = nameW.rfind(L'\\');
+    if (backslash != std::wstring::npos)
+    {
+        nameW.erase(0, backslash + 1);
+        nameW.shrink_to_fit();
+    }
+}
+
+void COperations::SetCompactNames(COperation& op)
+{
+    if (op.CompactNames || !op.OwnsSourceName || !op.OwnsTargetName)
+        return;
+
+    const char* sourceDir = NULL;
+    if (op.SourceName != NULL)
+    {
+        const char* s = strrchr(op.SourceName, '\\');
+        if (s == NULL)
+            return; // not a full name, keep it
+        sourceDir = GetSharedDir(op.SourceName, (int)(s + 1 - op.SourceName));
+    }
+    const char* targetDir = NULL;
+    if (op.TargetName != NULL)
+    {
+        const char* s = strrchr(op.TargetName, '\\');
+        if (s == NULL)
+            return; // not a full name, keep it
+        targetDir = GetSharedDir(op.TargetName, (int)(s + 1 - op.TargetName));
+    }
+    if (sourceDir == NULL && targetDir == NULL)
+        return;
+
+    if (sourceDir != NULL)
+        CutToFileName(op.SourceName, (int)strlen(sourceDir), op.SourceNameW);
+    if (targetDir != NULL)
+        CutToFileName(op.TargetName, (int)strlen(targetDir), op.TargetNameW);
+    op.SourceDir = sourceDir;
+    op.TargetDir = targetDir;
+    op.CompactNames = true;
+}
+
+// returns allocated 'dir' + 'name' or NULL on low memory
+static char* JoinDirAndName(const char* dir, const char* name)
+{
+    int dirLen = (int)strlen(dir);
+    int nameLen = (int)strlen(name);
+    char* fullName = (char*)malloc(dirLen + nameLen + 1);
+    if (fullName != NULL)
+    {
+        memcpy(fullName, dir, dirLen);
+        memcpy(fullName + dirLen, name, nameLen + 1);
+    }
+    return fullName;
+}
+
+BOOL COperations::SetFullNames(COperation* op)
+{
+    char* sourceName = NULL;
+    char* targetName = NULL;
+    if (op->SourceDir != NULL && (sourceName = JoinDirAndName(op->SourceDir, op->SourceName)) == NULL ||
+        op->TargetDir != NULL && (targetName = JoinDirAndName(op->TargetDir, op->TargetName)) == NULL)
+    {
+        TRACE_E(LOW_MEMORY);
+        if (sourceName != NULL)
+            free(sourceName);
+        return FALSE;
+    }
+
+    // the wide names hold the Unicode names of the files (see SetSourceNameW), empty wide names are
+    // created from the ANSI names below
+    if (sourceName != NULL)
+    {
+        free(op->SourceName);
+        op->SourceName = sourceName;
+        if (!op->SourceNameW.empty())
+        {
+            std::wstring fileNameW;
+            fileNameW.swap(op->SourceNameW);
+            op->SetSourceNameW(op->SourceDir, fileNameW);
+        }
+    }
+    if (targetName != NULL)
+    {
+        free(op->TargetName);
+        op->TargetName = targetName;
+        if (!op->TargetNameW.empty())
+        {
+            std::wstring fileNameW;
+            fileNameW.swap(op->TargetNameW);
+            op->SetTargetNameW(op->TargetDir, fileNameW);
+        }
+    }
+    op->CompactNames = false;
+    op->PopulateWidePathsFromAnsi();
+    return TRUE;
+}
+
+void COperations::ReleaseNames(COperation* op)
+{
+    if (op->CompactNames || op->SourceDir == NULL && op->TargetDir == NULL)
+        return; // names are not restored from compact form (they are freed together with the script)
+
+    if (op->SourceName != NULL)
+        free(op->SourceName);
+    op->SourceName = NULL;
+    std::wstring().swap(op->SourceNameW);
+    if (op->TargetName != NULL)
+        free(op->TargetName);
+    op->TargetName = NULL;
+    std::wstring().swap(op->TargetNameW);
+    op->SourceDir = NULL;
+    op->TargetDir = NULL;
+}
+
+COperation* COperations::GetOperation(int index, IWorkerObserver* observer, BOOL wait, BOOL fullNames)
+{
+    NamesLowMemory = FALSE;
+    if (!Pipelined)
+    {
+        if (index >= Count)
+            return NULL;
+        COperation* op = &m_ops[index];
+        if (fullNames && op->CompactNames && !SetFullNames(op))
+        {
+            NamesLowMemory = TRUE;
+            return NULL;
+        }
+        return op;
+    }
+
+    while (1)
+    {
+        COperation* op = NULL;
+        HANDLES(EnterCriticalSection(&PipeCS));
+        if (index > ConsumedCount)
+            ConsumedCount = index;
+        if (index < PublishedCount && !BuildFailed)
+            op = &m_ops[index]; // std::deque: the address stays valid while further operations are added
+        BOOL buildEnded = BuildEnded;
+        HANDLES(LeaveCriticalSection(&PipeCS));
+        SetEvent(PipeConsumed);
+
+        if (op != NULL) // published operations are used only by the worker, the names may be restored outside PipeCS
+        {
+            if (fullNames && op->CompactNames && !SetFullNames(op))
+            {
+                NamesLowMemory = TRUE;
+                return NULL;
+            }
+            return op;
+        }
+        if (!wait || buildEnded || observer != NULL && observer->IsCancelled())
+            return NULL; // no more operations (or not yet)
+        WaitForSingleObject(PipePublished, 200);
+    }
+}
+
+COperation* COperations::GetStoredOperation(int index, BOOL* complete)
+{
+    if (!Pipelined)
+    {
+        *complete = TRUE;
+        return index < Count ? &m_ops[index] : NULL;
+    }
+
+    HANDLES(EnterCriticalSection(&PipeCS));
+    COperation* op = index < PublishedCount && !BuildFailed ? &m_ops[index] : NULL;
+    *complete = BuildEnded && !BuildFailed;
+    HANDLES(LeaveCriticalSection(&PipeCS));
+    return op;
+}
+
+void COperations::WorkerHasEnded()
+{
+    if (!Pipelined)
+        return;
+
+    HANDLES(EnterCriticalSection(&PipeCS));
+    WorkerEnded = TRUE;
+    HANDLES(LeaveCriticalSection(&PipeCS));
+    SetEvent(PipeConsumed);
+
+    // the main thread may still be adding operations, wait until it ends the build
+    while (1)
+    {
+        HANDLES(EnterCriticalSection(&PipeCS));
+        BOOL buildEnded = BuildEnded;
+        HANDLES(LeaveCriticalSection(&PipeCS));
+        if (buildEnded)
+            break;
+        WaitForSingleObject(PipePublished, 200);
+    }
+}
+
 //
 // ****************************************************************************
 // CAsyncCopyParams
@@ -1299,8 +1636,9 @@ void COperations::GetSpeedLimit(BOOL* useSpeedLimit, DWORD* speedLimit)
 
 struct CAsyncCopyParams
 {
-    void* Buffers[8];         // allocated buffers of size ASYNC_COPY_BUF_SIZE bytes
-    OVERLAPPED Overlapped[8]; // structures for asynchronous operations
+    void* Buffers[ASYNC_COPY_MAX_BLOCKS];         // allocated buffers (the first 8 have at least ASYNC_COPY_BUF_SIZE bytes)
+    DWORD BufferSizes[ASYNC_COPY_MAX_BLOCKS];     // sizes of the buffers in 'Buffers'
+    OVERLAPPED Overlapped[ASYNC_COPY_MAX_BLOCKS]; // structures for asynchronous operations
 
     BOOL UseAsyncAlg; // TRUE = use the asynchronous algorithm (data must be allocated), FALSE = old synchronous algorithm (allocate nothing)
 
@@ -1311,6 +1649,10 @@ struct CAsyncCopyParams
 
     void Init(BOOL useAsyncAlg);
 
+    // makes sure the first 'numOfBlocks' buffers have at least 'bufSize' bytes; returns FALSE on
+    // low memory (the default 8 buffers of ASYNC_COPY_BUF_SIZE bytes are still usable)
+    BOOL AllocBuffers(int numOfBlocks, DWORD bufSize);
+
     BOOL Failed() { return HasFailed; }
 
     DWORD GetOverlappedFlag() { return UseAsyncAlg ? FILE_FLAG_OVERLAPPED : 0; }
@@ -1318,12 +1660,14 @@ struct CAsyncCopyParams
     OVERLAPPED* InitOverlapped(int i);                                    // zeroes and returns Overlapped[i]
     OVERLAPPED* InitOverlappedWithOffset(int i, const CQuadWord& offset); // zeroes it, sets 'offset', and returns Overlapped[i]
     OVERLAPPED* GetOverlapped(int i) { return &Overlapped[i]; }
-    void SetOverlappedToEOF(int i, const CQuadWord& offset); // sets Overlapped[i] to the state after finishing asynchronous reading that detected EOF
+    void SetOverlappedToEOF(int i, const CQuadWord& offset);              // sets Overlapped[i] to the state after finishing asynchronous reading that detected EOF
+    void SetOverlappedToDone(int i, const CQuadWord& offset, DWORD bytes); // sets Overlapped[i] to the state after successfully transferring 'bytes' bytes
 };
 
 CAsyncCopyParams::CAsyncCopyParams()
 {
     memset(Buffers, 0, sizeof(Buffers));
+    memset(BufferSizes, 0, sizeof(BufferSizes));
     memset(Overlapped, 0, sizeof(Overlapped));
     UseAsyncAlg = FALSE;
     HasFailed = FALSE;
@@ -1334,9 +1678,13 @@ void CAsyncCopyParams::Init(BOOL useAsyncAlg)
     UseAsyncAlg = useAsyncAlg;
     if (UseAsyncAlg && Buffers[0] == NULL)
     {
-        for (int i = 0; i < 8; i++)
+        for (int i = 0; i < ASYNC_COPY_MAX_BLOCKS; i++)
         {
-            Buffers[i] = malloc(ASYNC_COPY_BUF_SIZE);
+            if (i < 8)
+            {
+                Buffers[i] = malloc(ASYNC_COPY_BUF_SIZE);
+                BufferSizes[i] = ASYNC_COPY_BUF_SIZE;
+            }
             Overlapped[i].hEvent = HANDLES(CreateEvent(NULL, TRUE, FALSE, NULL));
             if (Overlapped[i].hEvent == NULL)
             {
@@ -1348,9 +1696,30 @@ void CAsyncCopyParams::Init(BOOL useAsyncAlg)
     }
 }
 
+BOOL CAsyncCopyParams::AllocBuffers(int numOfBlocks, DWORD bufSize)
+{
+    for (int i = 0; i < numOfBlocks; i++)
+    {
+        if (BufferSizes[i] < bufSize)
+        {
+            void* buf = malloc(bufSize); // the old buffer is released only if the new one is allocated
+            if (buf == NULL)
+            {
+                TRACE_E(LOW_MEMORY);
+                return FALSE;
+            }
+            if (Buffers[i] != NULL)
+                free(Buffers[i]);
+            Buffers[i] = buf;
+            BufferSizes[i] = bufSize;
+        }
+    }
+    return TRUE;
+}
+
 CAsyncCopyParams::~CAsyncCopyParams()
 {
-    for (int i = 0; i < 8; i++)
+    for (int i = 0; i < ASYNC_COPY_MAX_BLOCKS; i++)
     {
         if (Buffers[i] != NULL)
             free(Buffers[i]);
@@ -1397,6 +1766,191 @@ void CAsyncCopyParams::SetOverlappedToEOF(int i, const CQuadWord& offset)
     SetEvent(Overlapped[i].hEvent);
 }
 
+void CAsyncCopyParams::SetOverlappedToDone(int i, const CQuadWord& offset, DWORD bytes)
+{
+    if (!UseAsyncAlg)
+        TRACE_C("CAsyncCopyParams::SetOverlappedToDone(): unexpected call, UseAsyncAlg is FALSE!");
+    Overlapped[i].Internal = 0 /* STATUS_SUCCESS */;
+    Overlapped[i].InternalHigh = bytes;
+    Overlapped[i].Offset = offset.LoDWord;
+    Overlapped[i].OffsetHigh = offset.HiDWord;
+    // Overlapped[i].Pointer = 0;  // this is a union, Pointer overlaps with Offset and OffsetHigh
+    SetEvent(Overlapped[i].hEvent);
+}
+
+//
+// ****************************************************************************
+// CAsyncCopyTuner
+//
+// looks for the block size and the number of blocks giving the best speed of the asynchronous copy
+// for each pair of source and target volumes: large files are copied with not yet measured settings
+// next to the best known ones (hill climbing), measured speeds are kept for the rest of the session
+
+static const DWORD AsyncCopyTunerBufSizes[] = {ASYNC_COPY_BUF_SIZE, 2 * 1024 * 1024, 4 * 1024 * 1024, ASYNC_COPY_MAX_BUF_SIZE};
+static const int AsyncCopyTunerBlockCounts[] = {8, 12, ASYNC_COPY_MAX_BLOCKS};
+
+#define ASYNC_COPY_TUNER_MAX_VOLUMES 50 // maximum number of remembered volume pairs (others use the default settings)
+
+struct CAsyncCopyTunerVolumes
+{
+    char SourceRoot[MAX_PATH];
+    char TargetRoot[MAX_PATH];
+    DWORD Speed[_countof(AsyncCopyTunerBufSizes)][_countof(AsyncCopyTunerBlockCounts)]; // measured speed in KB/s (0 = not measured yet)
+    int BestSize;                                                                       // best settings found so far: index into AsyncCopyTunerBufSizes
+    int BestCount;                                                                      // best settings found so far: index into AsyncCopyTunerBlockCounts
+};
+
+class CAsyncCopyTuner
+{
+protected:
+    CRITICAL_SECTION CS; // used by all workers
+    TIndirectArray<CAsyncCopyTunerVolumes> Volumes;
+
+public:
+    CAsyncCopyTuner() : Volumes(10, 10) {}
+
+    void Init() { HANDLES(InitializeCriticalSection(&CS)); }
+    void Release()
+    {
+        Volumes.DestroyMembers();
+        HANDLES(DeleteCriticalSection(&CS));
+    }
+
+    // returns the block size and the number of blocks for copying 'op'; 'measure' is TRUE if the
+    // speed of the copy will be reported by ReportSpeed() (not yet measured settings may be returned)
+    void GetSettings(COperation* op, BOOL measure, DWORD* bufSize, int* numOfBlocks);
+
+    // reports that 'bytes' of 'op' were copied in 'time' ms with the settings from GetSettings()
+    void ReportSpeed(COperation* op, DWORD bufSize, int numOfBlocks, const CQuadWord& bytes, DWORD time);
+
+protected:
+    // returns the data for the volumes of 'op', adds them if 'add' is TRUE; NULL = not found/low memory
+    CAsyncCopyTunerVolumes* FindVolumes(COperation* op, BOOL add);
+
+    // returns TRUE if 'size' and 'count' are valid indexes and the blocks do not need too much memory
+    static BOOL IsAllowed(int size, int count)
+    {
+        return size >= 0 && size < _countof(AsyncCopyTunerBufSizes) &&
+               count >= 0 && count < _countof(AsyncCopyTunerBlockCounts) &&
+               (unsigned __int64)AsyncCopyTunerBufSizes[size] * AsyncCopyTunerBlockCounts[count] <= ASYNC_COPY_MAX_IN_FLIGHT;
+    }
+};
+
+CAsyncCopyTuner AsyncCopyTuner;
+
+CAsyncCopyTunerVolumes* CAsyncCopyTuner::FindVolumes(COperation* op, BOOL add)
+{
+    char sourceRoot[MAX_PATH];
+    char targetRoot[MAX_PATH];
+    GetRootPath(sourceRoot, op->SourceName);
+    GetRootPath(targetRoot, op->TargetName);
+    for (int i = 0; i < Volumes.Count; i++)
+    {
+        CAsyncCopyTunerVolumes* vol = Volumes[i];
+        if (StrICmp(vol->SourceRoot, sourceRoot) == 0 && StrICmp(vol->TargetRoot, targetRoot) == 0)
+            return vol;
+    }
+    if (!add || Volumes.Count >= ASYNC_COPY_TUNER_MAX_VOLUMES)
+        return NULL;
+
+    CAsyncCopyTunerVolumes* vol = new CAsyncCopyTunerVolumes;
+    if (vol == NULL)
+    {
+        TRACE_E(LOW_MEMORY);
+        return NULL;
+    }
+    memset(vol, 0, sizeof(CAsyncCopyTunerVolumes)); // default settings: ASYNC_COPY_BUF_SIZE and 8 blocks
+    strcpy(vol->SourceRoot, sourceRoot);
+    strcpy(vol->TargetRoot, targetRoot);
+    Volumes.Add(vol);
+    if (!Volumes.IsGood())
+    {
+        Volumes.ResetState();
+        delete vol;
+        return NULL;
+    }
+    return vol;
+}
+
+void CAsyncCopyTuner::GetSettings(COperation* op, BOOL measure, DWORD* bufSize, int* numOfBlocks)
+{
+    HANDLES(EnterCriticalSection(&CS));
+    int size = 0; // default settings
+    int count = 0;
+    CAsyncCopyTunerVolumes* vol = FindVolumes(op, measure);
+    if (vol != NULL)
+    {
+        size = vol->BestSize;
+        count = vol->BestCount;
+        if (measure && vol->Speed[size][count] != 0)
+        { // the best settings are measured, try their neighbours not measured yet (larger ones first)
+            static const int steps[4][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+            for (int i = 0; i < 4; i++)
+            {
+                int s = vol->BestSize + steps[i][0];
+                int c = vol->BestCount + steps[i][1];
+                if (IsAllowed(s, c) && vol->Speed[s][c] == 0)
+                {
+                    size = s;
+                    count = c;
+                    break;
+                }
+            }
+        }
+    }
+    HANDLES(LeaveCriticalSection(&CS));
+    *bufSize = AsyncCopyTunerBufSizes[size];
+    *numOfBlocks = AsyncCopyTunerBlockCounts[count];
+}
+
+void CAsyncCopyTuner::ReportSpeed(COperation* op, DWORD bufSize, int numOfBlocks, const CQuadWord& bytes, DWORD time)
+{
+    if (time == 0)
+        return;
+    unsigned __int64 speed64 = (bytes.Value * 1000 / 1024) / time;
+    DWORD speed = speed64 == 0 ? 1 : (speed64 < 0xFFFFFFFF ? (DWORD)speed64 : 0xFFFFFFFF);
+
+    HANDLES(EnterCriticalSection(&CS));
+    CAsyncCopyTunerVolumes* vol = FindVolumes(op, FALSE);
+    int size = 0;
+    while (size < _countof(AsyncCopyTunerBufSizes) && AsyncCopyTunerBufSizes[size] != bufSize)
+        size++;
+    int count = 0;
+    while (count < _countof(AsyncCopyTunerBlockCounts) && AsyncCopyTunerBlockCounts[count] != numOfBlocks)
+        count++;
+    if (vol != NULL && IsAllowed(size, count))
+    {
+        DWORD* measured = &vol->Speed[size][count];
+        *measured = *measured == 0 ? speed : (DWORD)(((unsigned __int64)*measured + speed) / 2);
+
+        // measurements are noisy (other traffic, file system), the best settings are replaced only by
+        // clearly faster ones (at least by 5%)
+        int bestSize = vol->BestSize;
+        int bestCount = vol->BestCount;
+        unsigned __int64 bestSpeed = vol->Speed[bestSize][bestCount];
+        bestSpeed += bestSpeed / 20;
+        for (int s = 0; s < _countof(AsyncCopyTunerBufSizes); s++)
+        {
+            for (int c = 0; c < _countof(AsyncCopyTunerBlockCounts); c++)
+            {
+                if (vol->Speed[s][c] > bestSpeed)
+                {
+                    bestSpeed = vol->Speed[s][c];
+                    bestSize = s;
+                    bestCount = c;
+                }
+            }
+        }
+        if (bestSize != vol->BestSize || bestCount != vol->BestCount)
+        {
+            TRACE_I("CAsyncCopyTuner: " << vol->SourceRoot << " -> " << vol->TargetRoot << ": using " << AsyncCopyTunerBufSizes[bestSize] / 1024 << " KB x " << AsyncCopyTunerBlockCounts[bestCount] << " blocks (" << bestSpeed << " KB/s)");
+            vol->BestSize = bestSize;
+            vol->BestCount = bestCount;
+        }
+    }
+    HANDLES(LeaveCriticalSection(&CS));
+}
+
 // **********************************************************************************
 
 BOOL HaveWriteOwnerRight = FALSE; // does the process have the WRITE_OWNER right?
@@ -1408,10 +1962,12 @@ void InitWorker()
         DynNtQueryInformationFile = (NTQUERYINFORMATIONFILE)GetProcAddress(NtDLL, "NtQueryInformationFile"); // has no header
         DynNtFsControlFile = (NTFSCONTROLFILE)GetProcAddress(NtDLL, "NtFsControlFile");                      // has no header
     }
+    AsyncCopyTuner.Init();
 }
 
 void ReleaseWorker()
 {
+    AsyncCopyTuner.Release();
     DynNtQueryInformationFile = NULL;
     DynNtFsControlFile = NULL;
 }
@@ -1464,6 +2020,7 @@ struct CWorkerState
     BOOL SkipAllDirOver;
     BOOL SkipAllFileOutLossEncr;
     BOOL SkipAllDirCrLossEncr;
+    BOOL SkipAllFileVerify;
 
     BOOL IgnoreAllADSReadErr;
     BOOL IgnoreAllADSOpenOutErr;
@@ -1488,6 +2045,8 @@ struct CWorkerState
     int CnfrmSHFileDel;
     int UseRecycleBin;
     BOOL UseAsyncCopyAlg;
+    int SmallFileCopyThreads;  // number of threads for copying runs of small files (CSmallFileCopyPool); < 2 = do not use the pool
+    int ParallelDeleteThreads; // number of threads for deleting runs of files and directories (CParallelDeletePool); < 2 = do not use the pool
     CMaskGroup RecycleMasks;
 
     // Initialize all skip/confirm flags to FALSE and copy config values
@@ -1510,13 +2069,17 @@ struct CWorkerState
                                                                 FileOutLossEncrAll = SkipAllDirCrLossEncr =
                                                                     DirCrLossEncrAll = IgnoreAllGetFileTimeErr =
                                                                         IgnoreAllSetFileTimeErr = SkipAllGetFileTime =
-                                                                            SkipAllSetFileTime = FALSE;
+                                                                            SkipAllSetFileTime = SkipAllFileVerify = FALSE;
         CnfrmFileOver = Configuration.CnfrmFileOver;
         CnfrmDirOver = Configuration.CnfrmDirOver;
         CnfrmSHFileOver = Configuration.CnfrmSHFileOver;
         CnfrmSHFileDel = Configuration.CnfrmSHFileDel;
         UseRecycleBin = Configuration.UseRecycleBin;
         UseAsyncCopyAlg = Windows7AndLater && Configuration.UseAsyncCopyAlg;
+        SYSTEM_INFO si;
+        GetSystemInfo(&si);
+        SmallFileCopyThreads = min(max((int)si.dwNumberOfProcessors, 2), SMALLFILE_COPY_MAX_THREADS); // the threads mostly wait for I/O, so use at least two even on a single CPU
+        ParallelDeleteThreads = min(max((int)si.dwNumberOfProcessors, 2), PARALLEL_DELETE_MAX_THREADS);
         RecycleMasks.SetMasksString(Configuration.RecycleMasks.GetMasksString(),
                                     Configuration.RecycleMasks.GetExtendedMode());
         int errorPos;
@@ -1664,11 +2227,9 @@ BOOL IsDirectoryEmptyW(const wchar_t* name) // directories/subdirectories contai
         dir += L'\\';
     std::wstring pattern = dir + L"*";
 
-    IFileSystem* fileSystem = GetWorkerFileSystem();
     WIN32_FIND_DATAW fileData;
-    HANDLE search = fileSystem != NULL ? fileSystem->FindFirstFile(pattern.c_str(), &fileData)
-                                       : INVALID_HANDLE_VALUE;
-    if (search != INVALID_HANDLE_VALUE)
+    CDirectoryReader dirReader; // reads the directory in batches (closed by the destructor)
+    if (dirReader.OpenW(pattern.c_str(), &fileData, GetWorkerFileSystem()))
     {
         do
         {
@@ -1681,18 +2242,11 @@ BOOL IsDirectoryEmptyW(const wchar_t* name) // directories/subdirectories contai
             {
                 std::wstring subDir = dir + fileData.cFileName;
                 if (!IsDirectoryEmptyW(subDir.c_str())) // the subdirectory is not empty
-                {
-                    HANDLES(FindClose(search));
                     return FALSE;
-                }
             }
             else
-            {
-                HANDLES(FindClose(search)); // a file exists here
-                return FALSE;
-            }
-        } while (fileSystem != NULL && fileSystem->FindNextFile(search, &fileData));
-        HANDLES(FindClose(search));
+                return FALSE; // a file exists here
+        } while (dirReader.FindNext(&fileData));
     }
     return TRUE;
 }
@@ -3602,51 +4156,216 @@ void SetTFSandPSforSkippedFile(COperation* op, CQuadWord& lastTransferredFileSiz
     script->SetTFSandProgressSize(lastTransferredFileSize, pSize);
 }
 
-// Synchronous copy loop. All Win32 calls (ReadFile, WriteFile, GetFileSize, SetFilePointer,
-// SetEndOfFile, CloseHandle) operate on open HANDLEs — handle-based, no path wrapping needed.
-void DoCopyFileLoopOrig(HANDLE& in, HANDLE& out, void* buffer, int& limitBufferSize,
-                        COperations* script, CWorkerState& workerState, BOOL wholeFileAllocated,
-                        COperation* op, const CQuadWord& totalDone, BOOL& copyError, BOOL& skipCopy,
-                        IWorkerObserver& observer, CQuadWord& operationDone, CQuadWord& fileSize,
-                        int bufferSize, int& allocWholeFileOnStart, BOOL& copyAgain)
+//
+// ****************************************************************************
+// CSparseCopy
+//
+// blocks of the copied file containing only zeros (VM disk images, database files) are not written,
+// the target file is made sparse instead (when the first such block comes), so the zero runs cost
+// neither the time of writing nor the space on the target disk
+
+#define SPARSE_COPY_MIN_FILE_SIZE CQuadWord(16 * 1024 * 1024, 0) // smaller files are copied the usual way (unless the source file is sparse)
+#define SPARSE_COPY_MIN_BLOCK_SIZE (64 * 1024)                   // smaller holes free no space on NTFS (size of the compression unit)
+
+// returns TRUE if all 'size' bytes at 'data' are zeros
+BOOL IsZeroBlock(const void* data, DWORD size)
 {
-    int autoRetryAttemptsSNAP = 0;
-    DWORD read;
-    DWORD written;
-    // Direct Win32: performance-critical synchronous copy loop (ReadFile/WriteFile on open HANDLEs)
-    while (1)
+    // 64 bytes per pass without branches inside (the compiler turns it into vector instructions)
+    const unsigned __int64* p = (const unsigned __int64*)data;
+    const unsigned __int64* end = p + (size / 64) * 8;
+    for (; p < end; p += 8)
     {
-        if (ReadFile(in, buffer, limitBufferSize, &read, NULL))
-        {
-            autoRetryAttemptsSNAP = 0;
-            if (read == 0)
-                break;                                                     // EOF
-            if (!script->ChangeSpeedLimit)                                 // when the speed limit can change, this is not a suitable wait point
-                observer.WaitIfSuspended(); // if we should be in suspend mode, wait ...
-            if (observer.IsCancelled())
-            {
-                copyError = TRUE; // goto COPY_ERROR
-                return;
-            }
+        if ((p[0] | p[1] | p[2] | p[3] | p[4] | p[5] | p[6] | p[7]) != 0)
+            return FALSE;
+    }
+    const BYTE* b = (const BYTE*)p;
+    const BYTE* bEnd = (const BYTE*)data + size;
+    for (; b < bEnd; b++)
+    {
+        if (*b != 0)
+            return FALSE;
+    }
+    return TRUE;
+}
 
-            while (1)
-            {
-                if (WriteFile(out, buffer, read, &written, NULL) &&
-                    read == written)
-                {
-                    break;
-                }
+class CSparseCopy
+{
+protected:
+    BOOL Enabled;           // TRUE = blocks of zeros are not written to the target file
+    BOOL IsSparse;          // TRUE = the target file was made sparse
+    BOOL AllocatedFile;     // TRUE = the whole target file was allocated before the copy (skipped zero runs must be freed)
+    BOOL OverlappedFile;    // TRUE = the target file is open for asynchronous operations (FILE_FLAG_OVERLAPPED)
+    OVERLAPPED Overlapped;  // for DeviceIoControl on asynchronous target file (Overlapped.hEvent is created when needed)
+    CQuadWord ZeroRunStart; // zero run not written to the target file: its start ...
+    CQuadWord ZeroRunEnd;   // ... and end (ZeroRunStart == ZeroRunEnd: no run)
 
-            WRITE_ERROR:
+public:
+    CSparseCopy(COperation* op, const CQuadWord& fileSize, BOOL allocatedFile, BOOL overlappedFile)
+    {
+        Enabled = fileSize >= SPARSE_COPY_MIN_FILE_SIZE || (op->Attr & FILE_ATTRIBUTE_SPARSE_FILE) != 0;
+        IsSparse = FALSE;
+        AllocatedFile = allocatedFile;
+        OverlappedFile = overlappedFile;
+        memset(&Overlapped, 0, sizeof(Overlapped));
+        ZeroRunStart.SetUI64(0);
+        ZeroRunEnd.SetUI64(0);
+    }
+    ~CSparseCopy()
+    {
+        if (Overlapped.hEvent != NULL)
+            HANDLES(CloseHandle(Overlapped.hEvent));
+    }
 
-                DWORD err;
-                err = GetLastError();
+    // returns TRUE if the block of 'size' bytes at 'data' going to 'offset' in the target file 'out'
+    // is not to be written (the block contains only zeros and the target file is sparse); blocks
+    // must come in the order of their offsets
+    BOOL SkipBlock(HANDLE out, const void* data, DWORD size, const CQuadWord& offset);
 
-                observer.WaitIfSuspended(); // if we should be in suspend mode, wait ...
-                if (observer.IsCancelled())
-                {
-                    copyError = TRUE; // goto COPY_ERROR
-                    return;
+    // called after the last block: frees the last zero run and extends the target file 'out' to
+    // 'fileSize' if it ends with a skipped zero run; returns FALSE on error (see GetLastError())
+    BOOL Finish(HANDLE out, const CQuadWord& fileSize);
+
+protected:
+    BOOL Control(HANDLE out, DWORD code, void* inBuffer, DWORD inBufferSize);
+    void FreeZeroRun(HANDLE out);
+};
+
+BOOL CSparseCopy::Control(HANDLE out, DWORD code, void* inBuffer, DWORD inBufferSize)
+{
+    // Direct Win32: handle-based FSCTL on open HANDLE — wrapping not needed
+    DWORD bytes;
+    if (!OverlappedFile)
+        return DeviceIoControl(out, code, inBuffer, inBufferSize, NULL, 0, &bytes, NULL);
+
+    // Overlapped of the blocks of CAsyncCopyParams are in use during the copy, so use own structure
+    if (Overlapped.hEvent == NULL)
+    {
+        Overlapped.hEvent = HANDLES(CreateEvent(NULL, TRUE, FALSE, NULL));
+        if (Overlapped.hEvent == NULL)
+            return FALSE;
+    }
+    Overlapped.Internal = 0;
+    Overlapped.InternalHigh = 0;
+    Overlapped.Offset = 0;
+    Overlapped.OffsetHigh = 0;
+    return (DeviceIoControl(out, code, inBuffer, inBufferSize, NULL, 0, NULL, &Overlapped) ||
+            GetLastError() == ERROR_IO_PENDING) &&
+           GetOverlappedResult(out, &Overlapped, &bytes, TRUE);
+}
+
+void CSparseCopy::FreeZeroRun(HANDLE out)
+{
+    // a hole behind the written data of the sparse file needs nothing, but clusters allocated before
+    // the copy (see 'wholeFileAllocated' in DoCopyFile) stay allocated until they are zeroed this way
+    if (AllocatedFile)
+    {
+        FILE_ZERO_DATA_INFORMATION zeroData;
+        zeroData.FileOffset.QuadPart = ZeroRunStart.Value;
+        zeroData.BeyondFinalZero.QuadPart = ZeroRunEnd.Value;
+        if (!Control(out, FSCTL_SET_ZERO_DATA, &zeroData, sizeof(zeroData)))
+        { // the run reads as zeros anyway (it was never written), only the space is not saved
+            DWORD err = GetLastError();
+            TRACE_I("CSparseCopy::FreeZeroRun(): FSCTL_SET_ZERO_DATA failed: " << GetErrorText(err));
+        }
+    }
+    ZeroRunStart = ZeroRunEnd;
+}
+
+BOOL CSparseCopy::SkipBlock(HANDLE out, const void* data, DWORD size, const CQuadWord& offset)
+{
+    if (!Enabled || size < SPARSE_COPY_MIN_BLOCK_SIZE || !IsZeroBlock(data, size))
+    {
+        if (ZeroRunStart != ZeroRunEnd) // the block ends the zero run
+            FreeZeroRun(out);
+        return FALSE;
+    }
+    if (!IsSparse)
+    {
+        if (!Control(out, FSCTL_SET_SPARSE, NULL, 0))
+        { // e.g. FAT or a network disk without sparse files, copy the zeros the usual way
+            DWORD err = GetLastError();
+            TRACE_I("CSparseCopy::SkipBlock(): FSCTL_SET_SPARSE failed: " << GetErrorText(err));
+            Enabled = FALSE;
+            return FALSE;
+        }
+        IsSparse = TRUE;
+    }
+    if (ZeroRunStart == ZeroRunEnd || ZeroRunEnd != offset)
+        ZeroRunStart = offset;
+    ZeroRunEnd = offset + CQuadWord(size, 0);
+    return TRUE;
+}
+
+BOOL CSparseCopy::Finish(HANDLE out, const CQuadWord& fileSize)
+{
+    if (ZeroRunStart == ZeroRunEnd)
+        return TRUE;
+    // the target file ends with a hole: the allocated file already has the right size, otherwise
+    // the file ends behind the last written block
+    if (!AllocatedFile && ZeroRunEnd == fileSize &&
+        (!SalSetFilePointer(out, fileSize) || !SetEndOfFile(out)))
+    {
+        return FALSE; // the zero run is kept, so the next call tries it again (after Retry)
+    }
+    FreeZeroRun(out);
+    return TRUE;
+}
+
+// Synchronous copy loop. All Win32 calls (ReadFile, WriteFile, GetFileSize, SetFilePointer,
+// SetEndOfFile, CloseHandle) operate on open HANDLEs — handle-based, no path wrapping needed.
+void DoCopyFileLoopOrig(HANDLE& in, HANDLE& out, void* buffer, int& limitBufferSize,
+                        COperations* script, CWorkerState& workerState, BOOL wholeFileAllocated,
+                        COperation* op, const CQuadWord& totalDone, BOOL& copyError, BOOL& skipCopy,
+                        IWorkerObserver& observer, CQuadWord& operationDone, CQuadWord& fileSize,
+                        int bufferSize, int& allocWholeFileOnStart, BOOL& copyAgain, DWORD* dataCrc)
+{
+    int autoRetryAttemptsSNAP = 0;
+    DWORD read;
+    DWORD written;
+    CSparseCopy sparse(op, fileSize, wholeFileAllocated, FALSE);
+    // Direct Win32: performance-critical synchronous copy loop (ReadFile/WriteFile on open HANDLEs)
+    while (1)
+    {
+        if (ReadFile(in, buffer, limitBufferSize, &read, NULL))
+        {
+            autoRetryAttemptsSNAP = 0;
+            if (read == 0)
+                break;                                                     // EOF
+            if (!script->ChangeSpeedLimit)                                 // when the speed limit can change, this is not a suitable wait point
+                observer.WaitIfSuspended(); // if we should be in suspend mode, wait ...
+            if (observer.IsCancelled())
+            {
+                copyError = TRUE; // goto COPY_ERROR
+                return;
+            }
+
+            while (1)
+            {
+                if (sparse.SkipBlock(out, buffer, read, operationDone)) // zeros only: leave a hole in the sparse target file
+                {
+                    written = read;
+                    if (SalSetFilePointer(out, operationDone + CQuadWord(read, 0)))
+                        break;
+                }
+                else
+                {
+                    if (WriteFile(out, buffer, read, &written, NULL) &&
+                        read == written)
+                    {
+                        break;
+                    }
+                }
+
+            WRITE_ERROR:
+
+                DWORD err;
+                err = GetLastError();
+
+                observer.WaitIfSuspended(); // if we should be in suspend mode, wait ...
+                if (observer.IsCancelled())
+                {
+                    copyError = TRUE; // goto COPY_ERROR
+                    return;
                 }
 
                 if (workerState.SkipAllFileWrite)
@@ -3723,9 +4442,13 @@ void DoCopyFileLoopOrig(HANDLE& in, HANDLE& out, void* buffer, int& limitBufferS
 
             if (!script->ChangeSpeedLimit)                                 // when the speed limit can change, this is not a suitable wait point
                 observer.WaitIfSuspended(); // if we should be in suspend mode, wait ...
+            if (dataCrc != NULL) // data for the verification of the copy
+                *dataCrc = UpdateCrc32(buffer, read, *dataCrc);
             operationDone += CQuadWord(read, 0);
             observer.SetProgressWithoutSuspend(CaclProg(operationDone, op->Size),
                                                  CaclProg(totalDone + operationDone, script->TotalSize));
+            if (script->Journal != NULL)
+                script->Journal->SetFileOffset(operationDone);
 
             if (script->ChangeSpeedLimit)                                  // speed limit may change; this is the right place to wait until the
             {                                                              // worker resumes and fetches a fresh copy buffer size
@@ -3812,6 +4535,44 @@ void DoCopyFileLoopOrig(HANDLE& in, HANDLE& out, void* buffer, int& limitBufferS
         }
     }
 
+    while (!sparse.Finish(out, operationDone)) // the target file ends with a hole, set its size
+    {
+        DWORD err = GetLastError();
+        observer.WaitIfSuspended(); // if we should be in suspend mode, wait ...
+        if (observer.IsCancelled())
+        {
+            copyError = TRUE; // goto COPY_ERROR
+            return;
+        }
+
+        if (workerState.SkipAllFileWrite)
+        {
+            skipCopy = TRUE; // goto SKIP_COPY
+            return;
+        }
+
+        int ret = observer.AskFileErrorById(IDS_ERRORWRITINGFILE, op->TargetName, err);
+        switch (ret)
+        {
+        case IDRETRY:
+            break; // Finish keeps the zero run, try to set the size of the file again
+
+        case IDB_SKIPALL:
+            workerState.SkipAllFileWrite = TRUE;
+        case IDB_SKIP:
+        {
+            skipCopy = TRUE; // goto SKIP_COPY
+            return;
+        }
+
+        default: // IDCANCEL
+        {
+            copyError = TRUE; // goto COPY_ERROR
+            return;
+        }
+        }
+    }
+
     if (wholeFileAllocated) // we pre-allocated the complete file layout (meaning the allocation was useful; for example, the file cannot be empty)
     {
         if (operationDone < fileSize) // and the source file shrank
@@ -3872,6 +4633,208 @@ void DoCopyFileLoopOrig(HANDLE& in, HANDLE& out, void* buffer, int& limitBufferS
     }
 }
 
+// delta copy (see COperations::DeltaCopy): smaller files are simply copied, rewriting them is cheap
+#define DELTA_COPY_MIN_FILE_SIZE (8 * 1024 * 1024)
+// delta copy: after comparing this amount of data, the share of changed blocks is evaluated;
+// if most of the file differs, comparing is pointless and the rest of the file is just written
+#define DELTA_COPY_CHECK_SIZE (64 * 1024 * 1024)
+
+// returns TRUE if the existing target file of 'op' can be updated in place by DoCopyFileLoopDelta()
+BOOL IsDeltaCopyPossible(COperation* op, COperations* script, BOOL copyAsEncrypted)
+{
+    if (!script->DeltaCopy || op->FileSize < CQuadWord(DELTA_COPY_MIN_FILE_SIZE, 0) ||
+        copyAsEncrypted ||                                                                             // the target file must be created again to become encrypted
+        script->CopyAttrs && (op->Attr & (FILE_ATTRIBUTE_COMPRESSED | FILE_ATTRIBUTE_ENCRYPTED)) != 0) // the same for Compressed and Encrypted attributes
+    {
+        return FALSE;
+    }
+
+    WIN32_FIND_DATAW data;
+    HANDLE find = op->FindFirstTarget(&data);
+    if (find == INVALID_HANDLE_VALUE)
+        return FALSE; // the target file does not exist
+    HANDLES(FindClose(find));
+
+    char cFileNameA[MAX_PATH];
+    WideCharToMultiByte(CP_ACP, 0, data.cFileName, -1, cFileNameA, MAX_PATH, NULL, NULL);
+    if (StrICmp(SalPathFindFileName(op->TargetName), cFileNameA) != 0 ||                      // just a DOS-name match, the file would not be overwritten
+        (data.dwFileAttributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_ENCRYPTED)) != 0) // a directory or the encryption of the target file would stay
+    {
+        return FALSE;
+    }
+    // the target file should hold a big part of the source data (e.g. an older version of a log file
+    // is shorter, but its content is the beginning of the source file)
+    CQuadWord tgtSize(data.nFileSizeLow, data.nFileSizeHigh);
+    return tgtSize + tgtSize >= op->FileSize;
+}
+
+// Delta copy loop: 'out' is the existing target file opened for reading and writing, blocks of
+// the source file are compared with the blocks of the target file at the same offsets and only
+// the differing blocks are written, the rest of the target file is truncated at the end;
+// the progress and the speed meters count all bytes of the source file (compared or written)
+void DoCopyFileLoopDelta(HANDLE& in, HANDLE& out, void* buffer, int& limitBufferSize,
+                         COperations* script, CWorkerState& workerState, COperation* op,
+                         const CQuadWord& totalDone, BOOL& copyError, BOOL& skipCopy,
+                         IWorkerObserver& observer, CQuadWord& operationDone, int bufferSize,
+                         BOOL& copyAgain, DWORD* dataCrc)
+{
+    CQuadWord tgtSize; // size of the target data to compare with (zero = write everything)
+    tgtSize.LoDWord = GetFileSize(out, &tgtSize.HiDWord);
+    if (tgtSize.LoDWord == INVALID_FILE_SIZE && GetLastError() != NO_ERROR)
+        tgtSize.Set(0, 0);
+    char* tgtBuffer = (char*)malloc(bufferSize);
+    if (tgtBuffer == NULL)
+    {
+        TRACE_E(LOW_MEMORY);
+        tgtSize.Set(0, 0);
+    }
+    CQuadWord changedBytes(0, 0); // bytes written to the target file
+    DWORD read;
+    DWORD written;
+    DWORD tgtRead;
+    DWORD err = NO_ERROR;
+    int errTextID = 0;       // 0 = no error, otherwise IDS_ERRORREADINGFILE or IDS_ERRORWRITINGFILE
+    BOOL srcReadErr = FALSE; // TRUE = the error occurred while reading the source file
+    while (1)
+    {
+        if (!ReadFile(in, buffer, limitBufferSize, &read, NULL))
+        {
+            err = GetLastError();
+            errTextID = IDS_ERRORREADINGFILE;
+            srcReadErr = TRUE;
+            break;
+        }
+        if (read == 0)
+            break;                                                     // EOF
+        if (!script->ChangeSpeedLimit)                                 // when the speed limit can change, this is not a suitable wait point
+            observer.WaitIfSuspended(); // if we should be in suspend mode, wait ...
+        if (observer.IsCancelled())
+        {
+            copyError = TRUE; // goto COPY_ERROR
+            break;
+        }
+
+        BOOL same = FALSE;
+        if (operationDone < tgtSize)
+        {
+            if (!ReadFile(out, tgtBuffer, read, &tgtRead, NULL))
+            {
+                err = GetLastError();
+                errTextID = IDS_ERRORREADINGFILE;
+                break;
+            }
+            same = tgtRead == read && memcmp(buffer, tgtBuffer, read) == 0;
+            if (!same && !SalSetFilePointer(out, operationDone)) // return to the beginning of the block
+            {
+                err = GetLastError();
+                errTextID = IDS_ERRORWRITINGFILE;
+                break;
+            }
+        }
+        if (!same)
+        {
+            if (!WriteFile(out, buffer, read, &written, NULL) || read != written)
+            {
+                err = GetLastError();
+                if (err == NO_ERROR)
+                    err = ERROR_DISK_FULL;
+                errTextID = IDS_ERRORWRITINGFILE;
+                break;
+            }
+            changedBytes += CQuadWord(read, 0);
+        }
+
+        script->AddBytesToSpeedMetersAndTFSandPS(read, FALSE, bufferSize, &limitBufferSize);
+
+        if (!script->ChangeSpeedLimit)                                 // when the speed limit can change, this is not a suitable wait point
+            observer.WaitIfSuspended(); // if we should be in suspend mode, wait ...
+        if (dataCrc != NULL) // data for the verification of the copy
+            *dataCrc = UpdateCrc32(buffer, read, *dataCrc);
+        operationDone += CQuadWord(read, 0);
+        observer.SetProgressWithoutSuspend(CaclProg(operationDone, op->Size),
+                                             CaclProg(totalDone + operationDone, script->TotalSize));
+        if (script->Journal != NULL)
+            script->Journal->SetFileOffset(operationDone);
+
+        if (tgtSize.Value > 0 && operationDone >= CQuadWord(DELTA_COPY_CHECK_SIZE, 0) &&
+            changedBytes + changedBytes > operationDone) // most of the data differs, just write the rest
+        {
+            TRACE_I("DoCopyFileLoopDelta(): too many changed blocks, the rest of the file is just written: " << op->TargetName);
+            tgtSize.Set(0, 0);
+        }
+
+        if (script->ChangeSpeedLimit)                                  // speed limit may change; this is the right place to wait until the
+        {                                                              // worker resumes and fetches a fresh copy buffer size
+            observer.WaitIfSuspended(); // if we should be in suspend mode, wait ...
+            script->GetNewBufSize(&limitBufferSize, bufferSize);
+        }
+    }
+    if (tgtBuffer != NULL)
+        free(tgtBuffer);
+
+    if (!copyError && errTextID == 0 && !SetEndOfFile(out)) // the target file was longer than the source file
+    {
+        err = GetLastError();
+        errTextID = IDS_ERRORWRITINGFILE;
+    }
+    if (errTextID == 0)
+        return;
+
+    observer.WaitIfSuspended(); // if we should be in suspend mode, wait ...
+    if (observer.IsCancelled())
+    {
+        copyError = TRUE; // goto COPY_ERROR
+        return;
+    }
+
+    if (srcReadErr ? workerState.SkipAllFileRead : workerState.SkipAllFileWrite)
+    {
+        skipCopy = TRUE; // goto SKIP_COPY
+        return;
+    }
+
+    int ret;
+    ret = observer.AskFileErrorById(errTextID, srcReadErr ? op->SourceName : op->TargetName, err);
+    switch (ret)
+    {
+    case IDRETRY: // start again, the blocks already written are just compared this time
+    {
+        HANDLES(CloseHandle(in));
+        HANDLES(CloseHandle(out));
+        copyAgain = TRUE; // goto COPY_AGAIN;
+        break;
+    }
+
+    case IDB_SKIPALL:
+    {
+        if (srcReadErr)
+            workerState.SkipAllFileRead = TRUE;
+        else
+            workerState.SkipAllFileWrite = TRUE;
+    }
+    case IDB_SKIP:
+    {
+        skipCopy = TRUE; // goto SKIP_COPY
+        break;
+    }
+
+    case IDCANCEL:
+    {
+        copyError = TRUE; // goto COPY_ERROR
+        break;
+    }
+    }
+}
+
+// delta copy: the target file updated in place existed before the copy, so unlike a file created by
+// the copy it is never deleted when the copy fails, is skipped or cancelled; the user is told that
+// the file was kept (its content may be only partially updated)
+void ReportDeltaTargetKept(COperation* op, IWorkerObserver& observer)
+{
+    TRACE_I("DoCopyFile(): existing file updated in place was kept after an unfinished copy: " << op->TargetName);
+    observer.NotifyErrorById(IDS_ERRORWRITINGFILE, op->TargetName, IDS_DELTACOPYKEPT);
+}
+
 enum CCopy_BlkState
 {
     cbsFree,       // block not in use
@@ -3894,20 +4857,24 @@ struct CCopy_Context
 {
     CAsyncCopyParams* AsyncPar;
 
-    CCopy_ForceOp ForceOp;        // TRUE = must read now, FALSE = must write now
-    BOOL ReadingDone;             // TRUE = the source file has been fully read
-    CCopy_BlkState BlockState[8]; // block state
-    DWORD BlockDataLen[8];        // for each block: expected data (cbsReading + cbsTestingEOF), valid data (cbsWriting)
-    CQuadWord BlockOffset[8];     // for each block: block offset in the source/target file (also stored in the 'AsyncPar' OVERLAPPED)
-    DWORD BlockTime[8];           // for each block: "time" when the last async operation in this block started
-    DWORD CurTime;                // "time" counter for 'BlockTime', handles wrap-around (though unlikely)
-    int FreeBlocks;               // current number of free blocks (cbsFree)
-    int FreeBlockIndex;           // candidate index of a free block (cbsFree); must be verified
-    int ReadingBlocks;            // current number of blocks being read(cbsReading and cbsTestingEOF)
-    int WritingBlocks;            // current number of blocks being written (cbsWriting)
-    CQuadWord ReadOffset;         // offset for reading the next block from the source file (previous one is already in progress)
-    CQuadWord WriteOffset;        // offset for writing the next block to the target file (previous one is already in progress)
-    int AutoRetryAttemptsSNAP;    // number of automatic Retry attempts (max 3): SNAP servers sporadically return ERROR_NETNAME_DELETED while reading, Retry button reportedly helps, so trigger it automatically
+    CCopy_ForceOp ForceOp;                            // TRUE = must read now, FALSE = must write now
+    BOOL ReadingDone;                                 // TRUE = the source file has been fully read
+    CCopy_BlkState BlockState[ASYNC_COPY_MAX_BLOCKS]; // block state
+    DWORD BlockDataLen[ASYNC_COPY_MAX_BLOCKS];        // for each block: expected data (cbsReading + cbsTestingEOF), valid data (cbsWriting)
+    CQuadWord BlockOffset[ASYNC_COPY_MAX_BLOCKS];     // for each block: block offset in the source/target file (also stored in the 'AsyncPar' OVERLAPPED)
+    DWORD BlockTime[ASYNC_COPY_MAX_BLOCKS];           // for each block: "time" when the last async operation in this block started
+    int NumOfBlocks;                                  // number of blocks in use (the rest of the arrays stays cbsFree)
+    DWORD CurTime;                                    // "time" counter for 'BlockTime', handles wrap-around (though unlikely)
+    int FreeBlocks;                                   // current number of free blocks (cbsFree)
+    int FreeBlockIndex;                               // candidate index of a free block (cbsFree); must be verified
+    int ReadingBlocks;                                // current number of blocks being read(cbsReading and cbsTestingEOF)
+    int WritingBlocks;                                // current number of blocks being written (cbsWriting)
+    CQuadWord ReadOffset;                             // offset for reading the next block from the source file (previous one is already in progress)
+    CQuadWord WriteOffset;                            // offset for writing the next block to the target file (previous one is already in progress)
+    int AutoRetryAttemptsSNAP;                        // number of automatic Retry attempts (max 3): SNAP servers sporadically return ERROR_NETNAME_DELETED while reading, Retry button reportedly helps, so trigger it automatically
+    DWORD* DataCrc;                                   // NULL or CRC-32 of the data written to the target file (for the verification of the copy)
+    CQuadWord DataCrcOffset;                          // offset of the first byte not yet added to 'DataCrc'
+    CSparseCopy* Sparse;                              // blocks of zeros are not written (see CSparseCopy)
 
     // selected DoCopyFileLoopAsync parameters to avoid passing a long argument list everywhere
     CWorkerState* DlgData;
@@ -3923,7 +4890,8 @@ struct CCopy_Context
 
     CCopy_Context(CAsyncCopyParams* asyncPar, int numOfBlocks, CWorkerState* workerState, COperation* op,
                   IWorkerObserver& observer, HANDLE* in, HANDLE* out, BOOL wholeFileAllocated, COperations* script,
-                  CQuadWord* operationDone, const CQuadWord* totalDone, const CQuadWord* lastTransferredFileSize)
+                  CQuadWord* operationDone, const CQuadWord* totalDone, const CQuadWord* lastTransferredFileSize,
+                  DWORD* dataCrc, CSparseCopy* sparse)
     {
         AsyncPar = asyncPar;
         ForceOp = fopNotUsed;
@@ -3934,13 +4902,17 @@ struct CCopy_Context
         memset(BlockDataLen, 0, sizeof(BlockDataLen));
         memset(BlockOffset, 0, sizeof(BlockOffset));
         memset(BlockTime, 0, sizeof(BlockTime));
+        NumOfBlocks = numOfBlocks;
         FreeBlocks = numOfBlocks;
         FreeBlockIndex = 0;
         ReadingBlocks = 0;
         WritingBlocks = 0;
-        ReadOffset.SetUI64(0);
-        WriteOffset.SetUI64(0);
+        ReadOffset = *operationDone; // non-zero only when continuing in a resumed file (see OpenResumedTargetFile)
+        WriteOffset = *operationDone;
         AutoRetryAttemptsSNAP = 0;
+        DataCrc = dataCrc;
+        DataCrcOffset = *operationDone;
+        Sparse = sparse;
 
         DlgData = workerState;
         Op = op;
@@ -3959,6 +4931,18 @@ struct CCopy_Context
         return ReadingDone && FreeBlocks == numOfBlocks;
     }
 
+    // returns the offset in front of which the target file is completely written (no write in progress there)
+    CQuadWord GetWrittenOffset()
+    {
+        CQuadWord offset = WriteOffset;
+        for (int i = 0; i < NumOfBlocks; i++)
+        {
+            if (BlockState[i] == cbsWriting && BlockOffset[i] < offset)
+                offset = BlockOffset[i];
+        }
+        return offset;
+    }
+
     BOOL StartReading(int blkIndex, DWORD readSize, DWORD* err, BOOL testEOF);
     BOOL StartWriting(int blkIndex, DWORD* err);
     int FindBlock(CCopy_BlkState state);
@@ -4069,12 +5053,24 @@ BOOL CCopy_Context::StartWriting(int blkIndex, DWORD* err)
 #endif // ASYNC_COPY_DEBUG_MSG
 
     // Direct Win32: performance-critical async copy loop (overlapped WriteFile on open HANDLE)
-    if (!WriteFile(*Out, AsyncPar->Buffers[blkIndex], BlockDataLen[blkIndex], NULL,
-                   AsyncPar->InitOverlappedWithOffset(blkIndex, WriteOffset)) &&
-        GetLastError() != ERROR_IO_PENDING)
-    { // a write error occurred; handle it
-        *err = GetLastError();
-        return FALSE;
+    if (Sparse->SkipBlock(*Out, AsyncPar->Buffers[blkIndex], BlockDataLen[blkIndex], WriteOffset))
+        AsyncPar->SetOverlappedToDone(blkIndex, WriteOffset, BlockDataLen[blkIndex]); // zeros only: leave a hole in the sparse target file
+    else
+    {
+        if (!WriteFile(*Out, AsyncPar->Buffers[blkIndex], BlockDataLen[blkIndex], NULL,
+                       AsyncPar->InitOverlappedWithOffset(blkIndex, WriteOffset)) &&
+            GetLastError() != ERROR_IO_PENDING)
+        { // a write error occurred; handle it
+            *err = GetLastError();
+            return FALSE;
+        }
+    }
+    // blocks are written in the order of their offsets, the data for the verification are added at the same order
+    // (blocks written again after Retry are already added)
+    if (DataCrc != NULL && BlockOffset[blkIndex] == DataCrcOffset)
+    {
+        *DataCrc = UpdateCrc32(AsyncPar->Buffers[blkIndex], BlockDataLen[blkIndex], *DataCrc);
+        DataCrcOffset += CQuadWord(BlockDataLen[blkIndex], 0);
     }
     // if the write was completed synchronously (or via cache, which we cannot detect),
     // we must read something now; otherwise reading may idle and slow down the whole operation
@@ -4102,7 +5098,7 @@ BOOL CCopy_Context::StartWriting(int blkIndex, DWORD* err)
 
 int CCopy_Context::FindBlock(CCopy_BlkState state)
 {
-    for (int i = 0; i < _countof(BlockState); i++)
+    for (int i = 0; i < NumOfBlocks; i++)
         if (BlockState[i] == state)
             return i;
     TRACE_C("CCopy_Context::FindBlock(): unable to find block with required state (" << (int)state << ").");
@@ -4230,7 +5226,7 @@ void CCopy_Context::CancelOpPhase2(int errBlkIndex)
         if (BlockState[i] == cbsRead && BlockOffset[i] == ReadOffset) // block read directly after ReadOffset
         {
             ReadOffset.Value += BlockDataLen[i];
-            i = -1; // start the search from the beginning again (with 8 blocks this is affordable, max 36 loop iterations)
+            i = -1; // start the search from the beginning again (with at most ASYNC_COPY_MAX_BLOCKS blocks this is affordable)
         }
     }
 
@@ -4512,8 +5508,9 @@ BOOL CCopy_Context::HandleSuspModeAndCancel(BOOL* copyError)
 void DoCopyFileLoopAsync(CAsyncCopyParams* asyncPar, HANDLE& in, HANDLE& out, void* buffer, int& limitBufferSize,
                          COperations* script, CWorkerState& workerState, BOOL wholeFileAllocated, COperation* op,
                          const CQuadWord& totalDone, BOOL& copyError, BOOL& skipCopy, IWorkerObserver& observer,
-                         CQuadWord& operationDone, CQuadWord& fileSize, int bufferSize,
-                         int& allocWholeFileOnStart, BOOL& copyAgain, const CQuadWord& lastTransferredFileSize)
+                         CQuadWord& operationDone, CQuadWord& fileSize, int bufferSize, int numOfBlocks,
+                         int& allocWholeFileOnStart, BOOL& copyAgain, const CQuadWord& lastTransferredFileSize,
+                         DWORD* dataCrc)
 {
     CQuadWord allocFileSize = fileSize;
     DWORD err = NO_ERROR;
@@ -4526,12 +5523,10 @@ void DoCopyFileLoopAsync(CAsyncCopyParams* asyncPar, HANDLE& in, HANDLE& out, vo
     if ((op->OpFlags & OPFL_TGTPATH_IS_NET) && !DisableLocalBuffering(asyncPar, out, &err))
         TRACE_E("DoCopyFileLoopAsync(): IOCTL_LMR_DISABLE_LOCAL_BUFFERING failed for network target file: " << op->TargetName << ", error: " << GetErrorText(err));
 
-    // copy loop parameters
-    int numOfBlocks = 8;
-
     // Copy operation context (prevents passing heaps of parameters to helper functions, now context methods)
+    CSparseCopy sparse(op, fileSize, wholeFileAllocated, TRUE);
     CCopy_Context ctx(asyncPar, numOfBlocks, &workerState, op, observer, &in, &out, wholeFileAllocated, script,
-                      &operationDone, &totalDone, &lastTransferredFileSize);
+                      &operationDone, &totalDone, &lastTransferredFileSize, dataCrc, &sparse);
     BOOL doCopy = TRUE;
     while (doCopy)
     {
@@ -4664,6 +5659,8 @@ void DoCopyFileLoopAsync(CAsyncCopyParams* asyncPar, HANDLE& in, HANDLE& out, vo
                         operationDone += CQuadWord(bytes, 0);
                         observer.SetProgressWithoutSuspend(CaclProg(operationDone, op->Size),
                                                  CaclProg(totalDone + operationDone, script->TotalSize));
+                        if (script->Journal != NULL) // writes complete out of order, only the contiguous part counts
+                            script->Journal->SetFileOffset(ctx.GetWrittenOffset());
 
                         if (script->ChangeSpeedLimit)                                  // the speed limit is likely to change, this is a "suitable" place to wait until the
                         {                                                              // worker resumes so we can get the buffer size for copying again
@@ -4766,6 +5763,13 @@ void DoCopyFileLoopAsync(CAsyncCopyParams* asyncPar, HANDLE& in, HANDLE& out, vo
     if (ctx.ReadOffset != ctx.WriteOffset || operationDone != ctx.WriteOffset)
         TRACE_C("DoCopyFileLoopAsync(): unexpected situation after copy: ReadOffset != WriteOffset || operationDone != ctx.WriteOffset");
 
+    while (!sparse.Finish(out, operationDone)) // the target file ends with a hole, set its size
+    {
+        if (!ctx.HandleWritingErr(-1, GetLastError(), &copyError, &skipCopy, &copyAgain, allocFileSize, CQuadWord(0, 0)))
+            return; // cancel/skip(skip-all)/retry-complete
+                    // retry-resume
+    }
+
     if (wholeFileAllocated) // we allocated the full size of the file (meaning the allocation made sense, e.g. the file cannot be empty)
     {
         if (operationDone < allocFileSize) // and the source file shrank, trim it here
@@ -4843,42 +5847,131 @@ void DoCopyFileLoopAsync(CAsyncCopyParams* asyncPar, HANDLE& in, HANDLE& out, vo
     }
 }
 
-// Copy I/O wrapping assessment:
-// - Path-based calls (open, delete, set attrs): wrapped via COperation methods (OpenSourceFile,
-//   OpenTargetFile, CreateTargetFileEx, DeleteTargetFile, SetTargetAttributes, GetTargetAttributes)
-// - Handle-based calls (GetFileSize, SetFilePointer, SetEndOfFile, GetFileTime, SetFileTime):
-//   operate on open HANDLEs, no path involved — wrapping provides no Unicode/long-path benefit
-// - Inner loop I/O (ReadFile, WriteFile, GetOverlappedResult): performance-critical hot path,
-//   must stay as direct Win32 calls to avoid virtual dispatch overhead per block
-// - ADS stream I/O (DoCopyADS): uses wide paths with ":streamname" suffix, not main-file paths —
-//   COperation wrapping not applicable
-// - DeviceIoControl (compression, network buffering): handle-based, wrapping not needed
-BOOL DoCopyFile(COperation* op, IWorkerObserver& observer, void* buffer,
-                COperations* script, CQuadWord& totalDone,
-                DWORD clearReadonlyMask, BOOL* skip, BOOL lantasticCheck,
-                int& mustDeleteFileBeforeOverwrite, int& allocWholeFileOnStart,
-                CWorkerState& workerState, BOOL copyADS, BOOL copyAsEncrypted,
-                BOOL isMove, CAsyncCopyParams*& asyncPar)
+// opens the target file of 'op' left behind by an interrupted operation (see CCopyJournal) and checks that
+// the data in front of 'offset' match the source file 'in' (the tail is checked, see CheckTailOfOutFile);
+// on success returns the target file with the file pointers of 'in' and the target file at 'offset' (the
+// rest of the target file is cut off); otherwise deletes the target file (it is a partial copy made by us,
+// the file is copied from scratch) and returns INVALID_HANDLE_VALUE
+HANDLE OpenResumedTargetFile(COperation* op, CAsyncCopyParams* asyncPar, HANDLE in, const CQuadWord& fileSize,
+                             const CQuadWord& offset)
 {
-    if (script->CopyAttrs && copyAsEncrypted)
-        TRACE_E("DoCopyFile(): unexpected parameter value: copyAsEncrypted is TRUE when script->CopyAttrs is TRUE!");
-
-    // if the path ends with a space/dot, it is invalid and we must not copy it,
-    // CreateFile would trim the spaces/dots and copy a different file or under a different name
-    BOOL invalidSrcName = op->IsSourceNameInvalid();
-    BOOL invalidTgtName = op->IsTargetNameInvalid();
+    HANDLE out = op->OpenTargetFile(GENERIC_READ | GENERIC_WRITE, 0, OPEN_EXISTING,
+                                    asyncPar->GetOverlappedFlag() | FILE_FLAG_SEQUENTIAL_SCAN);
+    if (out == INVALID_HANDLE_VALUE)
+        return INVALID_HANDLE_VALUE; // the target file does not exist (e.g. it was deleted after Cancel)
 
-    // optimization: skipping all "older and identical" files is about 4x faster,
-    // slowing down when the file is newer is 5%, so it should be well worth it
-    // (it is safe to assume the user enables "Overwrite Older" when the skips occur)
-    BOOL tgtNameCaseCorrected = FALSE; // TRUE = the letter case in the target name was already adjusted to match the existing target file (so overwriting does not change it)
-    WIN32_FIND_DATAW dataIn, dataOut;
-    if ((op->OpFlags & OPFL_OVERWROLDERALRTESTED) == 0 &&
-        !invalidSrcName && !invalidTgtName && script->OverwriteOlder)
+    CQuadWord size;
+    size.LoDWord = GetFileSize(out, &size.HiDWord);
+    if ((size.LoDWord != INVALID_FILE_SIZE || GetLastError() == NO_ERROR) &&
+        size >= offset && fileSize >= offset &&
+        CheckTailOfOutFile(asyncPar->UseAsyncAlg ? asyncPar : NULL, in, out, offset, offset, FALSE) &&
+        SalSetFilePointer(out, offset) && SetEndOfFile(out) && SalSetFilePointer(in, offset))
     {
-        HANDLE find;
-        find = op->FindFirstTarget(&dataOut);
-        if (find != INVALID_HANDLE_VALUE)
+        TRACE_I("OpenResumedTargetFile(): continuing copy of " << op->SourceName << " at offset " << offset.Value);
+        return out;
+    }
+    HANDLES(CloseHandle(out));
+    op->ClearTargetReadOnly();
+    op->DeleteTargetFile();
+    return INVALID_HANDLE_VALUE;
+}
+
+#define VERIFY_BUF_SIZE (4 * 1024 * 1024) // size of the block for reading the target file back during the verification
+
+// reads the copied target file of 'op' back (unbuffered, so that the data come from the disk and
+// not from the system cache) and compares its CRC-32 and size with 'dataCrc' and 'fileSize' (CRC-32
+// and size of the data written); returns FALSE on read error ('err' receives the error code, for
+// cancellation it is ERROR_CANCELLED), otherwise returns TRUE and 'same' says whether the data match
+BOOL VerifyCopiedFile(COperation* op, DWORD dataCrc, const CQuadWord& fileSize, IWorkerObserver& observer,
+                      BOOL* same, DWORD* err)
+{
+    *same = FALSE;
+    *err = NO_ERROR;
+    HANDLE file = op->OpenTargetFile(GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING,
+                                     FILE_FLAG_SEQUENTIAL_SCAN | FILE_FLAG_NO_BUFFERING);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        *err = GetLastError();
+        return FALSE;
+    }
+    // FILE_FLAG_NO_BUFFERING requires a sector-aligned buffer, VirtualAlloc returns a page-aligned one
+    void* buf = VirtualAlloc(NULL, VERIFY_BUF_SIZE, MEM_COMMIT, PAGE_READWRITE);
+    if (buf == NULL)
+    {
+        *err = GetLastError();
+        HANDLES(CloseHandle(file));
+        return FALSE;
+    }
+
+    DWORD crc = 0;
+    CQuadWord size(0, 0);
+    BOOL ok = TRUE;
+    while (1)
+    {
+        DWORD read;
+        if (!ReadFile(file, buf, VERIFY_BUF_SIZE, &read, NULL))
+        {
+            *err = GetLastError();
+            ok = FALSE;
+            break;
+        }
+        if (read == 0)
+            break; // EOF
+        crc = UpdateCrc32(buf, read, crc);
+        size += CQuadWord(read, 0);
+
+        observer.WaitIfSuspended(); // if we should be in suspend mode, wait ...
+        if (observer.IsCancelled())
+        {
+            *err = ERROR_CANCELLED;
+            ok = FALSE;
+            break;
+        }
+    }
+    VirtualFree(buf, 0, MEM_RELEASE);
+    HANDLES(CloseHandle(file));
+
+    if (ok)
+        *same = crc == dataCrc && size == fileSize;
+    return ok;
+}
+
+// Copy I/O wrapping assessment:
+// - Path-based calls (open, delete, set attrs): wrapped via COperation methods (OpenSourceFile,
+//   OpenTargetFile, CreateTargetFileEx, DeleteTargetFile, SetTargetAttributes, GetTargetAttributes)
+// - Handle-based calls (GetFileSize, SetFilePointer, SetEndOfFile, GetFileTime, SetFileTime):
+//   operate on open HANDLEs, no path involved — wrapping provides no Unicode/long-path benefit
+// - Inner loop I/O (ReadFile, WriteFile, GetOverlappedResult): performance-critical hot path,
+//   must stay as direct Win32 calls to avoid virtual dispatch overhead per block
+// - ADS stream I/O (DoCopyADS): uses wide paths with ":streamname" suffix, not main-file paths —
+//   COperation wrapping not applicable
+// - DeviceIoControl (compression, network buffering): handle-based, wrapping not needed
+BOOL DoCopyFile(COperation* op, IWorkerObserver& observer, void* buffer,
+                COperations* script, CQuadWord& totalDone,
+                DWORD clearReadonlyMask, BOOL* skip, BOOL lantasticCheck,
+                int& mustDeleteFileBeforeOverwrite, int& allocWholeFileOnStart,
+                CWorkerState& workerState, BOOL copyADS, BOOL copyAsEncrypted,
+                BOOL isMove, CAsyncCopyParams*& asyncPar)
+{
+    if (script->CopyAttrs && copyAsEncrypted)
+        TRACE_E("DoCopyFile(): unexpected parameter value: copyAsEncrypted is TRUE when script->CopyAttrs is TRUE!");
+
+    // if the path ends with a space/dot, it is invalid and we must not copy it,
+    // CreateFile would trim the spaces/dots and copy a different file or under a different name
+    BOOL invalidSrcName = op->IsSourceNameInvalid();
+    BOOL invalidTgtName = op->IsTargetNameInvalid();
+
+    // optimization: skipping all "older and identical" files is about 4x faster,
+    // slowing down when the file is newer is 5%, so it should be well worth it
+    // (it is safe to assume the user enables "Overwrite Older" when the skips occur)
+    BOOL tgtNameCaseCorrected = FALSE; // TRUE = the letter case in the target name was already adjusted to match the existing target file (so overwriting does not change it)
+    WIN32_FIND_DATAW dataIn, dataOut;
+    if ((op->OpFlags & OPFL_OVERWROLDERALRTESTED) == 0 &&
+        !invalidSrcName && !invalidTgtName && script->OverwriteOlder)
+    {
+        HANDLE find;
+        find = op->FindFirstTarget(&dataOut);
+        if (find != INVALID_HANDLE_VALUE)
         {
             HANDLES(FindClose(find));
 
@@ -4932,7 +6025,9 @@ BOOL DoCopyFile(COperation* op, IWorkerObserver& observer, void* buffer,
     // - the asynchronous algorithm makes sense only over the network + when source/target is fast or network-based
     // - with the old algorithm, copying on Win7 over the network is easily 2x-3x slower for downloads,
     //   almost 2x slower for uploads, and about 30% slower for network-to-network copies
-    BOOL useAsyncAlg = workerState.UseAsyncCopyAlg &&
+    // - the delta copy (updating the existing target file in place) always uses the synchronous algorithm
+    BOOL deltaCopy = !invalidSrcName && !invalidTgtName && IsDeltaCopyPossible(op, script, copyAsEncrypted);
+    BOOL useAsyncAlg = !deltaCopy && workerState.UseAsyncCopyAlg &&
                        op->FileSize.Value > 0 && // empty files are copied synchronously (no data)
                        ((op->OpFlags & OPFL_SRCPATH_IS_NET) && ((op->OpFlags & OPFL_TGTPATH_IS_NET) ||
                                                                 (op->OpFlags & OPFL_TGTPATH_IS_FAST)) ||
@@ -4953,6 +6048,7 @@ BOOL DoCopyFile(COperation* op, IWorkerObserver& observer, void* buffer,
     CQuadWord operationDone;
     CQuadWord lastTransferredFileSize;
     script->GetTFSandResetTrSpeedIfNeeded(&lastTransferredFileSize);
+    BOOL deltaConfirmed = FALSE; // TRUE = the overwrite of the existing target file was confirmed, COPY_AGAIN updates it in place right away
 
 COPY_AGAIN:
 
@@ -4963,6 +6059,9 @@ COPY_AGAIN:
         *skip = FALSE;
 
     int bufferSize;
+    int numOfBlocks = 8;       // number of blocks for the asynchronous copy
+    BOOL measureSpeed = FALSE; // TRUE = report the speed of the asynchronous copy to AsyncCopyTuner
+    DWORD dataCrc = 0;         // CRC-32 of the data written to the target file (for script->VerifyCopy)
     if (useAsyncAlg)
     {
         if (op->FileSize.Value <= 512 * 1024)
@@ -4972,7 +6071,25 @@ COPY_AGAIN:
         else if (op->FileSize.Value <= 8 * 1024 * 1024)
             bufferSize = ASYNC_COPY_BUF_SIZE_8MB;
         else
+        {
             bufferSize = ASYNC_COPY_BUF_SIZE;
+            BOOL useSpeedLimit;
+            DWORD speedLimit;
+            script->GetSpeedLimit(&useSpeedLimit, &speedLimit);
+            if (!useSpeedLimit) // the speed limit works with the default blocks (see HIGH_SPEED_LIMIT)
+            {
+                DWORD tunedBufSize;
+                int tunedNumOfBlocks;
+                BOOL measure = op->FileSize.Value >= ASYNC_COPY_TUNE_MIN_FILE_SIZE;
+                AsyncCopyTuner.GetSettings(op, measure, &tunedBufSize, &tunedNumOfBlocks);
+                if (asyncPar->AllocBuffers(tunedNumOfBlocks, tunedBufSize))
+                {
+                    bufferSize = tunedBufSize;
+                    numOfBlocks = tunedNumOfBlocks;
+                    measureSpeed = measure;
+                }
+            }
+        }
     }
     else
         bufferSize = script->RemovableSrcDisk || script->RemovableTgtDisk ? REMOVABLE_DISK_COPY_BUFFER : OPERATION_BUFFER;
@@ -4997,6 +6114,21 @@ COPY_AGAIN:
             HANDLE out;
             BOOL lossEncryptionAttr = FALSE;
             BOOL skipAllocWholeFileOnStart = FALSE;
+
+            // resumed operation: continue in the target file left behind by the interrupted operation
+            // (the data for the verification of the copy would be incomplete, so not with script->VerifyCopy)
+            HANDLE resumedOut;
+            resumedOut = INVALID_HANDLE_VALUE;
+            if (script->ResumeOffset.Value > 0 && !invalidTgtName && !script->VerifyCopy)
+                resumedOut = OpenResumedTargetFile(op, asyncPar, in, fileSize, script->ResumeOffset);
+            // delta copy: the existing target file is updated in place; the first attempt goes through the usual
+            // overwrite confirmations (see CREATE_ERROR), a repeated attempt (COPY_AGAIN) opens the file directly
+            HANDLE deltaOut;
+            deltaOut = INVALID_HANDLE_VALUE;
+            if (deltaCopy && deltaConfirmed && resumedOut == INVALID_HANDLE_VALUE)
+                deltaOut = op->OpenTargetFile(GENERIC_READ | GENERIC_WRITE, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN);
+            BOOL deltaLoop;
+            deltaLoop = FALSE;
             while (1)
             {
             OPEN_TGT_FILE:
@@ -5005,7 +6137,21 @@ COPY_AGAIN:
                 DWORD fileAttrs = asyncPar->GetOverlappedFlag() | FILE_FLAG_SEQUENTIAL_SCAN |
                                   (!lossEncryptionAttr && copyAsEncrypted ? FILE_ATTRIBUTE_ENCRYPTED : 0) |
                                   (script->CopyAttrs ? (op->Attr & (FILE_ATTRIBUTE_COMPRESSED | (lossEncryptionAttr ? 0 : FILE_ATTRIBUTE_ENCRYPTED))) : 0);
-                if (!invalidTgtName)
+                if (resumedOut != INVALID_HANDLE_VALUE)
+                {
+                    out = resumedOut;
+                    resumedOut = INVALID_HANDLE_VALUE;
+                    operationDone = script->ResumeOffset;
+                    script->SetTFSandProgressSize(lastTransferredFileSize + operationDone, totalDone + operationDone);
+                    observer.SetProgress(CaclProg(operationDone, op->Size), CaclProg(totalDone + operationDone, script->TotalSize));
+                }
+                else if (deltaOut != INVALID_HANDLE_VALUE)
+                {
+                    out = deltaOut;
+                    deltaOut = INVALID_HANDLE_VALUE;
+                    deltaLoop = TRUE;
+                }
+                else if (!invalidTgtName)
                 {
                     // GENERIC_READ for 'out' slows asynchronous copying from disk to network (measured 95 MB/s instead of 111 MB/s on Win7 x64 GLAN)
                     // Use CreateTargetFileEx for Unicode filename support (uses wide path when available)
@@ -5088,9 +6234,13 @@ COPY_AGAIN:
 
                 COPY:
 
+                    dataCrc = 0;
+
                     // if possible, allocate the required space for the file (prevents disk fragmentation + smoother writes to floppies)
                     BOOL wholeFileAllocated = FALSE;
-                    if (!skipAllocWholeFileOnStart &&               // last time failed, so the same would probably happen now
+                    if (operationDone.Value == 0 &&                 // not when continuing in a resumed file
+                        !deltaLoop &&                               // not when updating the existing file in place
+                        !skipAllocWholeFileOnStart &&               // last time failed, so the same would probably happen now
                         allocWholeFileOnStart != 2 /* no */ &&      // allocating the whole file is not forbidden
                         fileSize > CQuadWord(limitBufferSize, 0) && // allocation is pointless below the copy buffer size
                         fileSize < CQuadWord(0, 0x80000000))        // file size is positive number (otherwise seeking is impossible - numbers above 8EB, so likely never happens)
@@ -5144,19 +6294,37 @@ COPY_AGAIN:
                     BOOL copyError = FALSE;
                     BOOL skipCopy = FALSE;
                     BOOL copyAgain = FALSE;
-                    if (useAsyncAlg)
+                    if (deltaLoop)
+                    {
+                        DoCopyFileLoopDelta(in, out, buffer, limitBufferSize, script, workerState, op,
+                                            totalDone, copyError, skipCopy, observer, operationDone,
+                                            bufferSize, copyAgain, script->VerifyCopy ? &dataCrc : NULL);
+                    }
+                    else if (useAsyncAlg)
                     {
+                        DWORD copyStartTime = GetTickCount();
                         DoCopyFileLoopAsync(asyncPar, in, out, buffer, limitBufferSize, script, workerState, wholeFileAllocated, op,
                                             totalDone, copyError, skipCopy, observer, operationDone, fileSize,
-                                            bufferSize, allocWholeFileOnStart, copyAgain, lastTransferredFileSize);
+                                            bufferSize, numOfBlocks, allocWholeFileOnStart, copyAgain, lastTransferredFileSize,
+                                            script->VerifyCopy ? &dataCrc : NULL);
                         // NOTE: neither 'in' nor 'out' has the file pointer (SetFilePointer) positioned at the end of the file,
                         //       'out' has it set only when (copyError || skipCopy)
+
+                        if (measureSpeed && !copyError && !skipCopy && !copyAgain)
+                        {
+                            DWORD copyTime = GetTickCount() - copyStartTime;
+                            BOOL useSpeedLimit;
+                            DWORD speedLimit;
+                            script->GetSpeedLimit(&useSpeedLimit, &speedLimit);
+                            if (!useSpeedLimit && copyTime >= ASYNC_COPY_TUNE_MIN_TIME) // the speed limit might have been turned on during the copy
+                                AsyncCopyTuner.ReportSpeed(op, bufferSize, numOfBlocks, operationDone, copyTime);
+                        }
                     }
                     else
                     {
                         DoCopyFileLoopOrig(in, out, buffer, limitBufferSize, script, workerState, wholeFileAllocated, op,
                                            totalDone, copyError, skipCopy, observer, operationDone, fileSize,
-                                           bufferSize, allocWholeFileOnStart, copyAgain);
+                                           bufferSize, allocWholeFileOnStart, copyAgain, script->VerifyCopy ? &dataCrc : NULL);
                     }
 
                     if (copyError)
@@ -5171,7 +6339,10 @@ COPY_AGAIN:
                                 SetEndOfFile(out); // otherwise on a floppy the remaining part of the file would be written
                             HANDLES(CloseHandle(out));
                         }
-                        op->DeleteTargetFile();
+                        if (deltaLoop)
+                            ReportDeltaTargetKept(op, observer);
+                        else
+                            op->DeleteTargetFile();
                         return FALSE;
                     }
                     if (skipCopy)
@@ -5189,7 +6360,10 @@ COPY_AGAIN:
                                 SetEndOfFile(out); // otherwise on a floppy the remaining part of the file would be written
                             HANDLES(CloseHandle(out));
                         }
-                        op->DeleteTargetFile();
+                        if (deltaLoop)
+                            ReportDeltaTargetKept(op, observer);
+                        else
+                            op->DeleteTargetFile();
                         observer.SetProgress(0, CaclProg(totalDone, script->TotalSize));
                         if (skip != NULL)
                             *skip = TRUE;
@@ -5306,7 +6480,8 @@ COPY_AGAIN:
                             if (out != NULL)
                                 HANDLES(CloseHandle(out));
                             out = NULL;
-                            if (op->DeleteTargetFile() == 0)
+                            if (!deltaLoop && // the file updated in place already holds the data of the source file, only its ADS are missing
+                                op->DeleteTargetFile() == 0)
                             {
                                 DWORD err = GetLastError();
                                 TRACE_E("DoCopyFile(): Unable to remove newly created file: " << op->TargetName << ", error: " << GetErrorText(err));
@@ -5384,7 +6559,8 @@ COPY_AGAIN:
                             {
                             case IDRETRY:
                             {
-                                if (op->DeleteTargetFile() == 0)
+                                if (!deltaLoop && // the file updated in place is compared and updated again
+                                    op->DeleteTargetFile() == 0)
                                 {
                                     DWORD err2 = GetLastError();
                                     TRACE_E("DoCopyFile(): Unable to remove newly created file: " << op->TargetName << ", error: " << GetErrorText(err2));
@@ -5403,6 +6579,59 @@ COPY_AGAIN:
                         }
 
                         op->SetTargetAttributes(script->CopyAttrs ? attr : (attr | FILE_ATTRIBUTE_ARCHIVE));
+                        out = NULL;
+
+                        if (script->VerifyCopy) // read the target file back and compare it with the data written
+                        {
+                            BOOL same;
+                            DWORD err;
+                            while (!VerifyCopiedFile(op, dataCrc, operationDone, observer, &same, &err) || !same)
+                            {
+                                observer.WaitIfSuspended(); // if we should be in suspend mode, wait ...
+                                if (observer.IsCancelled())
+                                    goto COPY_ERROR_2;
+
+                                if (workerState.SkipAllFileVerify)
+                                    goto SKIP_VERIFY;
+
+                                int ret;
+                                ret = IDCANCEL;
+                                if (err != NO_ERROR)
+                                    ret = observer.AskFileErrorById(IDS_ERRORVERIFYINGFILE, op->TargetName, err);
+                                else
+                                    ret = observer.AskFileErrorByIds(IDS_ERRORVERIFYINGFILE, op->TargetName, IDS_VERIFYMISMATCH);
+                                switch (ret)
+                                {
+                                case IDRETRY:
+                                {
+                                    if (err != NO_ERROR)
+                                        break; // reading failed, read the target file again
+
+                                    op->ClearTargetReadOnly(); // the data differ, copy the file again
+                                    if (!deltaLoop && // the file updated in place is compared and updated again
+                                        op->DeleteTargetFile() == 0)
+                                    {
+                                        DWORD err2 = GetLastError();
+                                        TRACE_E("DoCopyFile(): Unable to remove newly created file: " << op->TargetName << ", error: " << GetErrorText(err2));
+                                    }
+                                    goto COPY_AGAIN;
+                                }
+
+                                case IDB_SKIPALL:
+                                    workerState.SkipAllFileVerify = TRUE;
+                                case IDB_SKIP:
+                                {
+                                SKIP_VERIFY:
+
+                                    op->ClearTargetReadOnly(); // the file must not be read-only if it is to be deleted
+                                    goto SKIP_COPY;
+                                }
+
+                                case IDCANCEL:
+                                    goto COPY_ERROR_2;
+                                }
+                            }
+                        }
                     }
 
                     if (script->CopyAttrs) // verify whether the source file attributes were preserved
@@ -5434,8 +6663,13 @@ COPY_AGAIN:
                             {
                             COPY_ERROR_2:
 
-                                op->ClearTargetReadOnly(); // the file must not be read-only if it is to be deleted
-                                op->DeleteTargetFile();
+                                if (deltaLoop)
+                                    ReportDeltaTargetKept(op, observer);
+                                else
+                                {
+                                    op->ClearTargetReadOnly(); // the file must not be read-only if it is to be deleted
+                                    op->DeleteTargetFile();
+                                }
                                 return FALSE;
                             }
                             }
@@ -5665,6 +6899,28 @@ COPY_AGAIN:
                             BOOL targetCannotOpenForWrite = FALSE;
                             while (1)
                             {
+                                if (deltaCopy && mustDeleteFileBeforeOverwrite != 1 /* yes */) // the end of the file is cut off by SetEndOfFile
+                                { // delta copy: the overwrite is confirmed, update the existing file in place (see IsDeltaCopyPossible)
+                                    BOOL chAttr = FALSE;
+                                    if (attr != INVALID_FILE_ATTRIBUTES &&
+                                        (attr & (FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM)))
+                                    { // the same as for overwriting below, the attributes are set again when the copy is done
+                                        chAttr = TRUE;
+                                        op->SetTargetAttributes(0);
+                                    }
+                                    out = op->OpenTargetFile(GENERIC_READ | GENERIC_WRITE, 0, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN);
+                                    if (out != INVALID_HANDLE_VALUE)
+                                    {
+                                        deltaLoop = TRUE;
+                                        deltaConfirmed = TRUE;
+                                        break; // goto COPY
+                                    }
+                                    if (chAttr)
+                                        op->SetTargetAttributes(attr);
+                                    deltaCopy = FALSE; // cannot be opened for update, overwrite it the usual way
+                                    continue;
+                                }
+
                                 if (targetCannotOpenForWrite || mustDeleteFileBeforeOverwrite == 1 /* yes */)
                                 { // the file must be deleted first
                                     BOOL chAttr = op->ClearTargetReadOnly(attr);
@@ -6444,6 +7700,29 @@ BOOL DoMoveFile(COperation* op, IWorkerObserver& observer, void* buffer,
     }
 }
 
+// deletes file 'nameW' through the worker file system; used by DoDeleteFile and by the parallel
+// delete (see CParallelDeletePool::DeleteItem); returns ERROR_SUCCESS or the error code
+DWORD DeleteFileAux(const wchar_t* nameW)
+{
+    IFileSystem* fileSystem = GetWorkerFileSystem();
+    if (fileSystem == NULL)
+        return ERROR_INVALID_FUNCTION;
+    FileResult res = fileSystem->DeleteFile(nameW);
+    return res.success ? ERROR_SUCCESS : res.errorCode;
+}
+
+// removes empty directory 'nameRmDirW' (already with a backslash at the end if needed, see
+// MakeCopyWithBackslashIfNeededW) through the worker file system; used by DoDeleteDir and by
+// the parallel delete (see CParallelDeletePool::DeleteItem); returns ERROR_SUCCESS or the error code
+DWORD RemoveDirectoryAux(const wchar_t* nameRmDirW)
+{
+    IFileSystem* fileSystem = GetWorkerFileSystem();
+    if (fileSystem == NULL)
+        return ERROR_INVALID_FUNCTION;
+    FileResult res = fileSystem->RemoveDirectory(nameRmDirW);
+    return res.success ? ERROR_SUCCESS : res.errorCode;
+}
+
 BOOL DoDeleteFile(IWorkerObserver& observer, char* name, const CQuadWord& size, COperations* script,
                   CQuadWord& totalDone, DWORD attr, CWorkerState& workerState,
                   const std::wstring& nameW = std::wstring())
@@ -6566,23 +7845,7 @@ BOOL DoDeleteFile(IWorkerObserver& observer, char* name, const CQuadWord& size,
             else
             {
                 std::wstring effectiveNameW = !nameW.empty() ? nameW : AnsiToWide(name);
-                if (deleteNameIsNul)
-                {
-                    IFileSystem* fileSystem = GetWorkerFileSystem();
-                    if (fileSystem == NULL)
-                        err = ERROR_INVALID_FUNCTION;
-                    else
-                    {
-                        FileResult deleteRes = fileSystem->DeleteFile(effectiveNameW.c_str());
-                        if (!deleteRes.success)
-                            err = deleteRes.errorCode;
-                    }
-                }
-                else
-                {
-                    if (!DeleteFileW(effectiveNameW.c_str()))
-                        err = GetLastError();
-                }
+                err = DeleteFileAux(effectiveNameW.c_str());
             }
         }
         else
@@ -7177,10 +8440,7 @@ BOOL DoDeleteDir(IWorkerObserver& observer, char* name, const CQuadWord& size, C
             }
         }
         else
-        {
-            if (!RemoveDirectoryW(nameRmDirW.c_str()))
-                err = GetLastError();
-        }
+            err = RemoveDirectoryAux(nameRmDirW.c_str());
 
         if (err == ERROR_SUCCESS)
         {
@@ -8107,94 +9367,812 @@ BOOL DoChangeAttrs(IWorkerObserver& observer, char* name, const CQuadWord& size,
     }
 }
 
-unsigned ThreadWorkerBody(void* parameter)
+//
+// ****************************************************************************
+// CSmallFileCopyPool
+//
+// copies runs of consecutive small files (ocCopyFile) on several threads at once; the pool
+// handles only the trouble-free case (the target does not exist yet and no error occurs),
+// every other file is left untouched (a partially written target is deleted) and it is
+// then copied by DoCopyFile in the worker thread, so all questions and error messages
+// are still shown one at a time and in the script order; the run never crosses other
+// operations, so ocCopyDirTime is always applied after all files of its directory
+
+struct CSmallFileCopyItem
 {
-    CALL_STACK_MESSAGE1("ThreadWorkerBody()");
-    SetThreadNameInVCAndTrace("Worker");
-    TRACE_I("Begin");
+    COperation* Op;
+    BOOL Copied; // TRUE = copied by the pool, FALSE = must be copied by DoCopyFile (set in DoneCS)
+};
 
-    CWorkerData* data = (CWorkerData*)parameter;
-    //--- create a local copy of the data
-    HANDLE wContinue = data->WContinue;
-    CWorkerState workerState;
-    workerState.Init();
-    COperations* script = data->Script;
-    if (script->TotalSize == CQuadWord(0, 0))
+class CSmallFileCopyPool
+{
+protected:
+    COperations* Script;
+    IWorkerObserver* Observer;
+    DWORD ClearReadonlyMask;
+
+    TDirectArray<CSmallFileCopyItem> Items; // current run of small files
+    int RunFirst;                           // script index of the first operation of the current run
+    int RunEnd;                             // script index behind the last operation of the current run
+    volatile LONG NextItem;                 // index of the next item in Items to be taken by a pool thread (InterlockedIncrement)
+    int JournalDone;                        // number of items at the start of the run already reported to the journal
+
+    CRITICAL_SECTION DoneCS; // critical section protecting DoneSize, LastStarted and CSmallFileCopyItem::Copied
+    CQuadWord DoneSize;      // sum of op->Size of the files already copied by the pool
+    int LastStarted;         // index in Items of the file started last (only for the progress dialog)
+
+public:
+    CSmallFileCopyPool() : Items(100, 400)
     {
-        script->TotalSize = CQuadWord(1, 0); // guard against division by zero
-                                             // TRACE_E("ThreadWorkerBody(): script->TotalSize may not be zero!");  // when building the script we do not set the "synchronizing one", which caused issues in Calculate Occupied Space
+        HANDLES(InitializeCriticalSection(&DoneCS));
+        Script = NULL;
+        Observer = NULL;
+        ClearReadonlyMask = 0;
+        RunFirst = RunEnd = 0;
+        NextItem = 0;
+        JournalDone = 0;
+        LastStarted = -1;
     }
 
-    if (script->CopySecurity)
-        GainWriteOwnerAccess();
+    ~CSmallFileCopyPool() { HANDLES(DeleteCriticalSection(&DoneCS)); }
 
-    CDialogWorkerObserver dialogObserver(data->HProgressDlg, data->WorkerNotSuspended,
-                                         data->CancelWorker, data->OperationProgress,
-                                         data->SummaryProgress);
-    IWorkerObserver& observer = dialogObserver;
-    void* buffer = data->Buffer;
-    BOOL bufferIsAllocated = data->BufferIsAllocated;
-    CChangeAttrsData* attrsData = (CChangeAttrsData*)data->Buffer;
-    DWORD clearReadonlyMask = data->ClearReadonlyMask;
-    CConvertData convertData;
-    if (data->ConvertData != NULL) // make a copy of the data for Convert
+    // returns TRUE if the operation with script index 'index' was already copied by the pool
+    BOOL IsCopied(int index)
     {
-        convertData = *data->ConvertData;
+        return index >= RunFirst && index < RunEnd && Items[index - RunFirst].Copied;
     }
-    SetEvent(wContinue); // data ready; resume the main thread or the progress-dialog thread
-                         //---
-    observer.SetProgress(0, 0);
-    script->InitSpeedMeters(FALSE);
 
-    CPathBuffer lastLantasticCheckRoot; // Heap-allocated for long path support; last path root checked for Lantastic ("" = nothing checked yet)
-    lastLantasticCheckRoot[0] = 0;
-    BOOL lastIsLantasticPath = FALSE;                                                                                  // result of checking root lastLantasticCheckRoot
-    int mustDeleteFileBeforeOverwrite = 0; /* need test */                                                             // (added for SNAP server - NSA drive - SetEndOfFile fails - 0/1/2 = need-test/yes/no
-    int allocWholeFileOnStart = 0; /* need test */                                                                     // safety measure (e.g. SNAP servers - NSA drives - may fail); cannot risk a broken Copy - 0/1/2 = need-test/yes/no
-    int setDirTimeAfterMove = script->PreserveDirTime && script->SourcePathIsNetwork ? 0 /* need test */ : 2 /* no */; // e.g. on Samba, moving/renaming a directory changes its date and time - 0/1/2 = need-test/yes/no
+    // if script index 'index' lies behind the current run, looks for a new run of small files
+    // starting at 'index' and copies it using 'threads' threads; adds the sizes of the copied
+    // files to 'totalDone'; may be called only from the worker thread
+    void CopyRun(COperations* script, int index, IWorkerObserver& observer, CWorkerState& workerState,
+                 DWORD clearReadonlyMask, CQuadWord& totalDone, CProgressData& pd,
+                 char* lastLantasticCheckRoot, BOOL& lastIsLantasticPath);
 
-    BOOL Error = FALSE;
-    CQuadWord totalDone;
-    totalDone = CQuadWord(0, 0);
-    CProgressData pd;
-    BOOL novellRenamePatch = FALSE; // TRUE when the read-only attribute must be cleared before MoveFile (required on Novell)
-    char* tgtBuffer = NULL;         // conversion buffer for ocConvert
-    CAsyncCopyParams* asyncPar = NULL;
-    if (buffer != NULL)
-    {
-        // operation label strings are loaded in workerState.Init()
+protected:
+    BOOL IsSmallFileOp(COperation* op, char* lastLantasticCheckRoot, BOOL& lastIsLantasticPath);
+    BOOL CopySmallFile(COperation* op, void* buffer);
+    // reports the files copied so far at the start of the run as done to the journal of the
+    // script (if any), so an interrupted run is resumed behind them; worker thread only
+    void ReportDoneToJournal();
+    void ThreadBody();
 
-        TRACE_I("Worker: script->Count=" << script->Count << ", IsCancelled=" << observer.IsCancelled());
-        int i;
-        for (i = 0; !observer.IsCancelled() && i < script->Count; i++)
-        {
-            COperation* op = &script->At(i);
+    static unsigned ThreadFBody(void* param);
+    static unsigned ThreadFEH(void* param);
+    static DWORD WINAPI ThreadF(void* param);
+};
 
-            switch (op->Opcode)
-            {
-            case ocCopyFile:
-            {
-                pd.Operation = workerState.OpStrCopying;
-                pd.Source = op->SourceName;
-                pd.Preposition = workerState.OpStrCopyingPrep;
-                pd.Target = op->TargetName;
-                observer.SetOperationInfo(&pd);
+BOOL CSmallFileCopyPool::IsSmallFileOp(COperation* op, char* lastLantasticCheckRoot, BOOL& lastIsLantasticPath)
+{
+    return op->Opcode == ocCopyFile &&
+           op->FileSize <= CQuadWord(SMALLFILE_COPY_MAX_SIZE, 0) &&
+           (op->OpFlags & (OPFL_COPY_ADS | OPFL_AS_ENCRYPTED)) == 0 &&
+           !op->IsSourceNameInvalid() && !op->IsTargetNameInvalid() &&
+           !IsLantasticDrive(op->TargetName, lastLantasticCheckRoot, lastIsLantasticPath);
+}
 
-                observer.SetProgress(0, CaclProg(totalDone, script->TotalSize));
+void CSmallFileCopyPool::CopyRun(COperations* script, int index, IWorkerObserver& observer, CWorkerState& workerState,
+                                 DWORD clearReadonlyMask, CQuadWord& totalDone, CProgressData& pd,
+                                 char* lastLantasticCheckRoot, BOOL& lastIsLantasticPath)
+{
+    if (index < RunEnd)
+        return; // still inside the current run
 
-                BOOL lantasticCheck = IsLantasticDrive(op->TargetName, lastLantasticCheckRoot, lastIsLantasticPath);
+    Items.DestroyMembers();
+    RunFirst = RunEnd = index;
 
-                Error = !DoCopyFile(op, observer, buffer, script, totalDone,
-                                    clearReadonlyMask, NULL, lantasticCheck, mustDeleteFileBeforeOverwrite,
-                                    allocWholeFileOnStart, workerState,
-                                    (op->OpFlags & OPFL_COPY_ADS) != 0,
-                                    (op->OpFlags & OPFL_AS_ENCRYPTED) != 0,
-                                    FALSE, asyncPar);
-                break;
-            }
+    BOOL useSpeedLimit;
+    DWORD speedLimit;
+    script->GetSpeedLimit(&useSpeedLimit, &speedLimit);
+    if (workerState.SmallFileCopyThreads < 2 ||
+        script->CopyAttrs || script->CopySecurity ||            // attributes and security may need questions, leave it to DoCopyFile
+        script->VerifyCopy ||                                   // the verification is done by DoCopyFile only
+        script->RemovableSrcDisk || script->RemovableTgtDisk || // parallel access would only slow down removable media
+        useSpeedLimit)                                          // the speed limit is applied by DoCopyFile only
+    {
+        return;
+    }
 
-            case ocMoveDir:
-            case ocMoveFile:
+    int end = index;
+    COperation* op;
+    while (end - index < SMALLFILE_COPY_MAX_RUN &&
+           (op = script->GetOperation(end, &observer, FALSE)) != NULL && // only operations already published by a pipelined build
+           IsSmallFileOp(op, lastLantasticCheckRoot, lastIsLantasticPath))
+    {
+        end++;
+    }
+    if (end - index < SMALLFILE_COPY_MIN_RUN)
+        return; // too short a run, DoCopyFile will handle it
+
+    int i;
+    for (i = index; i < end; i++)
+    {
+        CSmallFileCopyItem item;
+        item.Op = script->GetOperation(i, &observer, FALSE);
+        item.Copied = FALSE;
+        Items.Add(item);
+        if (!Items.IsGood())
+        {
+            Items.ResetState();
+            Items.DestroyMembers();
+            return; // low memory, DoCopyFile will handle it
+        }
+    }
+    RunEnd = end;
+
+    Script = script;
+    Observer = &observer;
+    ClearReadonlyMask = clearReadonlyMask;
+    NextItem = 0;
+    JournalDone = 0;
+    DoneSize = CQuadWord(0, 0);
+    LastStarted = -1;
+
+    HANDLE threads[SMALLFILE_COPY_MAX_THREADS];
+    int threadsCount = 0;
+    int maxThreads = min(workerState.SmallFileCopyThreads, Items.Count);
+    while (threadsCount < maxThreads)
+    {
+        DWORD threadID;
+        HANDLE thread = HANDLES(CreateThread(NULL, 0, ThreadF, this, 0, &threadID));
+        if (thread == NULL)
+        {
+            TRACE_E("CSmallFileCopyPool::CopyRun(): unable to start copy thread.");
+            break;
+        }
+        threads[threadsCount++] = thread;
+    }
+    // if no thread has started, no item is marked as copied and DoCopyFile handles the whole run
+
+    // wait for the threads and keep the progress dialog updated meanwhile
+    pd.Source = Items[0].Op->SourceName;
+    pd.Target = Items[0].Op->TargetName;
+    observer.SetOperationInfo(&pd);
+    int lastShown = 0;
+    while (threadsCount > 0 &&
+           WaitForMultipleObjects(threadsCount, threads, TRUE, 200) == WAIT_TIMEOUT)
+    {
+        CQuadWord doneSize;
+        int lastStarted;
+        HANDLES(EnterCriticalSection(&DoneCS));
+        doneSize = DoneSize;
+        lastStarted = LastStarted;
+        HANDLES(LeaveCriticalSection(&DoneCS));
+
+        if (lastStarted != lastShown && lastStarted >= 0)
+        {
+            lastShown = lastStarted;
+            pd.Source = Items[lastStarted].Op->SourceName;
+            pd.Target = Items[lastStarted].Op->TargetName;
+            observer.SetOperationInfo(&pd);
+        }
+        observer.SetProgressWithoutSuspend(0, CaclProg(totalDone + doneSize, script->TotalSize));
+        ReportDoneToJournal();
+    }
+    while (threadsCount > 0)
+        HANDLES(CloseHandle(threads[--threadsCount]));
+    ReportDoneToJournal();
+
+    totalDone += DoneSize;
+    script->SetProgressSize(totalDone);
+    observer.SetProgress(0, CaclProg(totalDone, script->TotalSize));
+}
+
+BOOL CSmallFileCopyPool::CopySmallFile(COperation* op, void* buffer)
+{
+    HANDLE in = op->OpenSourceFile(FILE_FLAG_SEQUENTIAL_SCAN);
+    if (in == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    // CREATE_NEW: an existing target means a question for the user, leave it to DoCopyFile
+    HANDLE out = op->CreateTargetFileEx(GENERIC_WRITE, 0, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    HANDLES_ADD_EX(__otQuiet, out != INVALID_HANDLE_VALUE, __htFile,
+                   __hoCreateFile, out, GetLastError(), TRUE);
+    if (out == INVALID_HANDLE_VALUE)
+    {
+        HANDLES(CloseHandle(in));
+        return FALSE;
+    }
+
+    BOOL ok = TRUE;
+    CQuadWord operationDone(0, 0);
+    while (1)
+    {
+        DWORD read;
+        if (!ReadFile(in, buffer, OPERATION_BUFFER, &read, NULL))
+        {
+            ok = FALSE;
+            break;
+        }
+        if (read == 0)
+            break; // EOF
+        DWORD written;
+        if (!WriteFile(out, buffer, read, &written, NULL) || written != read)
+        {
+            ok = FALSE;
+            break;
+        }
+        operationDone += CQuadWord(read, 0);
+    }
+
+    FILETIME lastWrite;
+    if (ok && (!GetFileTime(in, NULL, NULL, &lastWrite) || !SetFileTime(out, NULL, NULL, &lastWrite)))
+        ok = FALSE; // DoCopyFile will ask the user what to do
+    HANDLES(CloseHandle(in));
+    if (!HANDLES(CloseHandle(out)))
+        ok = FALSE;
+    if (!ok)
+    {
+        op->DeleteTargetFile(); // DoCopyFile starts from scratch
+        return FALSE;
+    }
+
+    op->SetTargetAttributes((op->Attr & ClearReadonlyMask) | FILE_ATTRIBUTE_ARCHIVE);
+
+    // the same accounting as in DoCopyFile: data only after the whole file is done (failed files
+    // must not add anything), zero/small files take as long as files of size COPY_MIN_FILE_SIZE
+    if (operationDone.Value > 0)
+        Script->AddBytesToSpeedMetersAndTFSandPS(operationDone.LoDWord, FALSE, OPERATION_BUFFER);
+    if (operationDone < COPY_MIN_FILE_SIZE)
+        Script->AddBytesToSpeedMetersAndTFSandPS((DWORD)(COPY_MIN_FILE_SIZE - operationDone).Value, TRUE, 0, NULL, MAX_OP_FILESIZE);
+    return TRUE;
+}
+
+void CSmallFileCopyPool::ReportDoneToJournal()
+{
+    if (Script->Journal == NULL)
+        return;
+
+    // the journal counts the operations done in the script order, so only the files in front of
+    // the first file not copied yet can be reported (the others follow when it is copied)
+    HANDLES(EnterCriticalSection(&DoneCS));
+    int done = JournalDone;
+    while (done < Items.Count && Items[done].Copied)
+        done++;
+    HANDLES(LeaveCriticalSection(&DoneCS));
+    while (JournalDone < done)
+        Script->Journal->OperationDone(Script, RunFirst + JournalDone++);
+}
+
+void CSmallFileCopyPool::ThreadBody()
+{
+    void* buffer = malloc(OPERATION_BUFFER);
+    if (buffer == NULL)
+    {
+        TRACE_E(LOW_MEMORY);
+        return;
+    }
+    while (1)
+    {
+        Observer->WaitIfSuspended(); // if we should be in suspend mode, wait ...
+        if (Observer->IsCancelled())
+            break;
+        int index = (int)InterlockedIncrement(&NextItem) - 1;
+        if (index >= Items.Count)
+            break;
+
+        CSmallFileCopyItem* item = &Items[index];
+        HANDLES(EnterCriticalSection(&DoneCS));
+        LastStarted = index;
+        HANDLES(LeaveCriticalSection(&DoneCS));
+
+        if (CopySmallFile(item->Op, buffer))
+        {
+            HANDLES(EnterCriticalSection(&DoneCS));
+            item->Copied = TRUE;
+            DoneSize += item->Op->Size;
+            HANDLES(LeaveCriticalSection(&DoneCS));
+        }
+    }
+    free(buffer);
+}
+
+unsigned CSmallFileCopyPool::ThreadFBody(void* param)
+{
+    CALL_STACK_MESSAGE1("CSmallFileCopyPool::ThreadFBody()");
+    SetThreadNameInVCAndTrace("SmallFileCopy");
+    ((CSmallFileCopyPool*)param)->ThreadBody();
+    return 0;
+}
+
+unsigned CSmallFileCopyPool::ThreadFEH(void* param)
+{
+#ifndef CALLSTK_DISABLE
+    __try
+    {
+#endif // CALLSTK_DISABLE
+        return ThreadFBody(param);
+#ifndef CALLSTK_DISABLE
+    }
+    __except (CCallStack::HandleException(GetExceptionInformation()))
+    {
+        TRACE_I("Thread SmallFileCopy: calling ExitProcess(1).");
+        //    ExitProcess(1);
+        TerminateProcess(GetCurrentProcess(), 1); // harsher exit (this one still invokes something)
+        return 1;
+    }
+#endif // CALLSTK_DISABLE
+}
+
+DWORD WINAPI CSmallFileCopyPool::ThreadF(void* param)
+{
+#ifndef CALLSTK_DISABLE
+    CCallStack stack;
+#endif // CALLSTK_DISABLE
+    return ThreadFEH(param);
+}
+
+//
+// ****************************************************************************
+// CParallelDeletePool
+//
+// deletes runs of consecutive ocDeleteFile and ocDeleteDir operations on several threads;
+// files are independent of each other and a directory becomes ready for deletion once all
+// its files and subdirectories from the run are deleted, so independent subtrees are deleted
+// at once and every directory is still removed after its children; like CSmallFileCopyPool
+// the pool handles only the trouble-free case (no question, no Recycle Bin, no error), a file
+// which cannot be deleted and all directories above it are left to DoDeleteFile and
+// DoDeleteDir in the worker thread, so questions and error messages are still shown one at
+// a time and in the script order
+
+struct CParallelDeleteItem
+{
+    COperation* Op;
+    int Parent;       // index in Items of the directory containing this item; -1 = the directory is not in the run
+    int Remaining;    // directory: number of its items from the run which are not processed yet
+    BOOL ChildFailed; // directory: some of its items was not deleted, so the directory is not empty
+    BOOL Deleted;     // TRUE = deleted by the pool, FALSE = must be deleted by DoDeleteFile/DoDeleteDir
+    int NextReady;    // next item in the queue of items ready for deletion; -1 = end of the queue
+};
+
+class CParallelDeletePool
+{
+protected:
+    COperations* Script;
+    IWorkerObserver* Observer;
+
+    TDirectArray<CParallelDeleteItem> Items; // current run of files and directories
+    int RunFirst;                            // script index of the first operation of the current run
+    int RunEnd;                              // script index behind the last operation of the current run
+
+    CRITICAL_SECTION QueueCS; // critical section protecting the items and the variables below
+    int ReadyFirst;           // first item in the queue of items ready for deletion; -1 = the queue is empty
+    int ReadyLast;            // last item in the queue of items ready for deletion
+    int Finished;             // number of processed items (deleted or left to the worker thread)
+    BOOL Stop;                // TRUE = the pool threads should end (all items processed or the operation cancelled)
+    HANDLE ReadySem;          // semaphore counting the items in the queue (and the wake-ups of the threads at the end)
+    CQuadWord DoneSize;       // sum of op->Size of the items already deleted by the pool
+    int LastStarted;          // index in Items of the item started last (only for the progress dialog)
+
+public:
+    CParallelDeletePool() : Items(100, 400)
+    {
+        HANDLES(InitializeCriticalSection(&QueueCS));
+        Script = NULL;
+        Observer = NULL;
+        RunFirst = RunEnd = 0;
+        ReadyFirst = ReadyLast = -1;
+        Finished = 0;
+        Stop = FALSE;
+        ReadySem = NULL;
+        LastStarted = -1;
+    }
+
+    ~CParallelDeletePool() { HANDLES(DeleteCriticalSection(&QueueCS)); }
+
+    // returns TRUE if the operation with script index 'index' was already done by the pool
+    BOOL IsDeleted(int index)
+    {
+        return index >= RunFirst && index < RunEnd && Items[index - RunFirst].Deleted;
+    }
+
+    // if script index 'index' lies behind the current run, looks for a new run of files and
+    // directories to delete starting at 'index' and deletes it using several threads; adds
+    // the sizes of the deleted items to 'totalDone'; may be called only from the worker thread
+    void DeleteRun(COperations* script, int index, IWorkerObserver& observer, CWorkerState& workerState,
+                   CQuadWord& totalDone, CProgressData& pd);
+
+protected:
+    BOOL IsParallelDeleteOp(COperation* op, CWorkerState& workerState, BOOL filesToRecycleBin);
+    BOOL DeleteItem(COperation* op);
+    void AddReady(int index); // must be called inside QueueCS
+    void ThreadBody();
+
+    static unsigned ThreadFBody(void* param);
+    static unsigned ThreadFEH(void* param);
+    static DWORD WINAPI ThreadF(void* param);
+};
+
+BOOL CParallelDeletePool::IsParallelDeleteOp(COperation* op, CWorkerState& workerState, BOOL filesToRecycleBin)
+{
+    if (op->Opcode == ocDeleteDir) // the same condition as in DoDeleteDir ('dontUseRecycleBin' is TargetName != -1)
+    {
+        return !Script->CanUseRecycleBin || (DWORD)(DWORD_PTR)op->TargetName != -1 ||
+               !(Script->InvertRecycleBin && workerState.UseRecycleBin == 0 ||
+                 !Script->InvertRecycleBin && workerState.UseRecycleBin == 1);
+    }
+    if (op->Opcode != ocDeleteFile ||
+        filesToRecycleBin || // files may go to the Recycle Bin, leave them to DoDeleteFile
+        (op->Attr & (FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM)) != 0 && // the user must confirm deletion of hidden and system files
+            !workerState.DeleteHiddenAll && workerState.CnfrmSHFileDel)
+    {
+        return FALSE;
+    }
+    std::wstring nameW = op->HasWideSource() ? op->SourceNameW : AnsiToWide(op->SourceName);
+    return !FileNameIsInvalidW(nameW.c_str(), TRUE) && !ShouldBypassRecycleBinForDeleteW(nameW.c_str());
+}
+
+void CParallelDeletePool::DeleteRun(COperations* script, int index, IWorkerObserver& observer, CWorkerState& workerState,
+                                    CQuadWord& totalDone, CProgressData& pd)
+{
+    if (index < RunEnd)
+        return; // still inside the current run
+
+    Items.DestroyMembers();
+    RunFirst = RunEnd = index;
+
+    // TRUE if some files can go to the Recycle Bin (the same logic as in DoDeleteFile)
+    BOOL filesToRecycleBin = script->CanUseRecycleBin &&
+                             (workerState.UseRecycleBin == 0 ? script->InvertRecycleBin : !script->InvertRecycleBin);
+    if (workerState.ParallelDeleteThreads < 2 ||
+        script->RemovableSrcDisk) // parallel access would only slow down removable media
+    {
+        return;
+    }
+
+    Script = script;
+    int end = index;
+    COperation* op;
+    while (end - index < PARALLEL_DELETE_MAX_RUN &&
+           (op = script->GetOperation(end, &observer, FALSE)) != NULL && // only operations already published by a pipelined build
+           IsParallelDeleteOp(op, workerState, filesToRecycleBin))
+    {
+        end++;
+    }
+    if (end - index < PARALLEL_DELETE_MIN_RUN)
+        return; // too short a run, DoDeleteFile and DoDeleteDir will handle it
+
+    // the script lists the items of a directory right before the directory itself (its subtree
+    // is contiguous), so the items of the run waiting for their directory form a stack
+    TDirectArray<int> waiting(100, 400);
+    int i;
+    for (i = index; i < end; i++)
+    {
+        CParallelDeleteItem item;
+        item.Op = script->GetOperation(i, &observer, FALSE);
+        item.Parent = -1;
+        item.Remaining = 0;
+        item.ChildFailed = FALSE;
+        item.Deleted = FALSE;
+        item.NextReady = -1;
+        Items.Add(item);
+        waiting.Add(i - index);
+        if (!Items.IsGood() || !waiting.IsGood())
+        {
+            Items.ResetState();
+            Items.DestroyMembers();
+            return; // low memory, DoDeleteFile and DoDeleteDir will handle it
+        }
+        if (item.Op->Opcode == ocDeleteDir)
+        {
+            CParallelDeleteItem* dir = &Items[Items.Count - 1];
+            int dirLen = (int)strlen(dir->Op->SourceName);
+            while (waiting.Count > 1)
+            {
+                CParallelDeleteItem* child = &Items[waiting[waiting.Count - 2]];
+                if (StrNICmp(child->Op->SourceName, dir->Op->SourceName, dirLen) != 0 ||
+                    child->Op->SourceName[dirLen] != '\\')
+                {
+                    break; // not inside this directory
+                }
+                child->Parent = Items.Count - 1;
+                dir->Remaining++;
+                waiting.Delete(waiting.Count - 2);
+            }
+        }
+    }
+    RunEnd = end;
+
+    Observer = &observer;
+    ReadyFirst = ReadyLast = -1;
+    Finished = 0;
+    Stop = FALSE;
+    DoneSize = CQuadWord(0, 0);
+    LastStarted = -1;
+    ReadySem = HANDLES(CreateSemaphore(NULL, 0, Items.Count + PARALLEL_DELETE_MAX_THREADS, NULL));
+    if (ReadySem == NULL)
+    {
+        TRACE_E("CParallelDeletePool::DeleteRun(): unable to create semaphore.");
+        return; // nothing is marked as deleted, DoDeleteFile and DoDeleteDir handle the whole run
+    }
+    for (i = 0; i < Items.Count; i++)
+    {
+        if (Items[i].Remaining == 0) // files and empty directories
+            AddReady(i);
+    }
+
+    HANDLE threads[PARALLEL_DELETE_MAX_THREADS];
+    int threadsCount = 0;
+    int maxThreads = min(workerState.ParallelDeleteThreads, Items.Count);
+    while (threadsCount < maxThreads)
+    {
+        DWORD threadID;
+        HANDLE thread = HANDLES(CreateThread(NULL, 0, ThreadF, this, 0, &threadID));
+        if (thread == NULL)
+        {
+            TRACE_E("CParallelDeletePool::DeleteRun(): unable to start delete thread.");
+            break;
+        }
+        threads[threadsCount++] = thread;
+    }
+    // if no thread has started, no item is marked as deleted and DoDeleteFile and DoDeleteDir handle the whole run
+
+    // wait for the threads and keep the progress dialog updated meanwhile
+    pd.Source = Items[0].Op->SourceName;
+    observer.SetOperationInfo(&pd);
+    int lastShown = 0;
+    while (threadsCount > 0 &&
+           WaitForMultipleObjects(threadsCount, threads, TRUE, 200) == WAIT_TIMEOUT)
+    {
+        CQuadWord doneSize;
+        int lastStarted;
+        HANDLES(EnterCriticalSection(&QueueCS));
+        doneSize = DoneSize;
+        lastStarted = LastStarted;
+        HANDLES(LeaveCriticalSection(&QueueCS));
+
+        if (lastStarted != lastShown && lastStarted >= 0)
+        {
+            lastShown = lastStarted;
+            pd.Source = Items[lastStarted].Op->SourceName;
+            observer.SetOperationInfo(&pd);
+        }
+        observer.SetProgressWithoutSuspend(0, CaclProg(totalDone + doneSize, script->TotalSize));
+    }
+    while (threadsCount > 0)
+        HANDLES(CloseHandle(threads[--threadsCount]));
+    HANDLES(CloseHandle(ReadySem));
+    ReadySem = NULL;
+
+    totalDone += DoneSize;
+    script->SetProgressSize(totalDone);
+    observer.SetProgress(0, CaclProg(totalDone, script->TotalSize));
+}
+
+void CParallelDeletePool::AddReady(int index)
+{
+    if (ReadyLast != -1)
+        Items[ReadyLast].NextReady = index;
+    else
+        ReadyFirst = index;
+    ReadyLast = index;
+    ReleaseSemaphore(ReadySem, 1, NULL);
+}
+
+BOOL CParallelDeletePool::DeleteItem(COperation* op)
+{
+    // the same steps as DoDeleteFile and DoDeleteDir use (an error is reported by them later)
+    std::wstring nameW = op->HasWideSource() ? op->SourceNameW : AnsiToWide(op->SourceName);
+    if (op->Opcode == ocDeleteFile)
+    {
+        ClearReadOnlyAttrW(nameW.c_str(), op->Attr); // ensure it can be deleted
+        return DeleteFileAux(nameW.c_str()) == ERROR_SUCCESS;
+    }
+
+    // a path ending with a space/dot needs a trailing backslash (see DoDeleteDir)
+    std::wstring nameRmDirW = MakeCopyWithBackslashIfNeededW(nameW.c_str());
+    ClearReadOnlyAttrW(nameRmDirW.c_str(), op->Attr); // ensure it can be deleted
+    if (RemoveDirectoryAux(nameRmDirW.c_str()) != ERROR_SUCCESS)
+        return FALSE; // e.g. a file was added meanwhile, DoDeleteDir will report it
+    Script->AddBytesToSpeedMetersAndTFSandPS((DWORD)op->Size.Value, TRUE, 0, NULL, MAX_OP_FILESIZE);
+    return TRUE;
+}
+
+void CParallelDeletePool::ThreadBody()
+{
+    while (1)
+    {
+        WaitForSingleObject(ReadySem, INFINITE);
+
+        int index = -1;
+        BOOL childFailed = FALSE;
+        HANDLES(EnterCriticalSection(&QueueCS));
+        if (!Stop && ReadyFirst != -1)
+        {
+            index = ReadyFirst;
+            ReadyFirst = Items[index].NextReady;
+            if (ReadyFirst == -1)
+                ReadyLast = -1;
+            childFailed = Items[index].ChildFailed;
+            LastStarted = index;
+        }
+        HANDLES(LeaveCriticalSection(&QueueCS));
+        if (index == -1)
+            break; // Stop
+
+        Observer->WaitIfSuspended(); // if we should be in suspend mode, wait ...
+        BOOL cancelled = Observer->IsCancelled();
+        BOOL deleted = !cancelled && !childFailed && DeleteItem(Items[index].Op);
+
+        HANDLES(EnterCriticalSection(&QueueCS));
+        CParallelDeleteItem* item = &Items[index];
+        item->Deleted = deleted;
+        if (deleted)
+            DoneSize += item->Op->Size;
+        if (item->Parent != -1)
+        {
+            CParallelDeleteItem* parent = &Items[item->Parent];
+            if (!deleted)
+                parent->ChildFailed = TRUE; // the directory stays non-empty, leave it to DoDeleteDir
+            if (--parent->Remaining == 0)
+                AddReady(item->Parent);
+        }
+        if (!Stop && (++Finished == Items.Count || cancelled))
+        {
+            Stop = TRUE;
+            ReleaseSemaphore(ReadySem, PARALLEL_DELETE_MAX_THREADS, NULL); // wake up all threads so they can end
+        }
+        HANDLES(LeaveCriticalSection(&QueueCS));
+    }
+}
+
+unsigned CParallelDeletePool::ThreadFBody(void* param)
+{
+    CALL_STACK_MESSAGE1("CParallelDeletePool::ThreadFBody()");
+    SetThreadNameInVCAndTrace("ParallelDelete");
+    ((CParallelDeletePool*)param)->ThreadBody();
+    return 0;
+}
+
+unsigned CParallelDeletePool::ThreadFEH(void* param)
+{
+#ifndef CALLSTK_DISABLE
+    __try
+    {
+#endif // CALLSTK_DISABLE
+        return ThreadFBody(param);
+#ifndef CALLSTK_DISABLE
+    }
+    __except (CCallStack::HandleException(GetExceptionInformation()))
+    {
+        TRACE_I("Thread ParallelDelete: calling ExitProcess(1).");
+        //    ExitProcess(1);
+        TerminateProcess(GetCurrentProcess(), 1); // harsher exit (this one still invokes something)
+        return 1;
+    }
+#endif // CALLSTK_DISABLE
+}
+
+DWORD WINAPI CParallelDeletePool::ThreadF(void* param)
+{
+#ifndef CALLSTK_DISABLE
+    CCallStack stack;
+#endif // CALLSTK_DISABLE
+    return ThreadFEH(param);
+}
+
+unsigned ThreadWorkerBody(void* parameter)
+{
+    CALL_STACK_MESSAGE1("ThreadWorkerBody()");
+    SetThreadNameInVCAndTrace("Worker");
+    TRACE_I("Begin");
+
+    CWorkerData* data = (CWorkerData*)parameter;
+    //--- create a local copy of the data
+    HANDLE wContinue = data->WContinue;
+    CWorkerState workerState;
+    workerState.Init();
+    COperations* script = data->Script;
+    if (script->TotalSize == CQuadWord(0, 0) &&
+        !script->IsPipelinedBuild()) // a pipelined build is still adding to TotalSize (CaclProg() copes with zero)
+    {
+        script->TotalSize = CQuadWord(1, 0); // guard against division by zero
+                                             // TRACE_E("ThreadWorkerBody(): script->TotalSize may not be zero!");  // when building the script we do not set the "synchronizing one", which caused issues in Calculate Occupied Space
+    }
+
+    if (script->CopySecurity)
+        GainWriteOwnerAccess();
+
+    CDialogWorkerObserver dialogObserver(data->HProgressDlg, data->WorkerNotSuspended,
+                                         data->CancelWorker, data->OperationProgress,
+                                         data->SummaryProgress);
+    IWorkerObserver& observer = dialogObserver;
+    void* buffer = data->Buffer;
+    BOOL bufferIsAllocated = data->BufferIsAllocated;
+    CChangeAttrsData* attrsData = (CChangeAttrsData*)data->Buffer;
+    DWORD clearReadonlyMask = data->ClearReadonlyMask;
+    CConvertData convertData;
+    if (data->ConvertData != NULL) // make a copy of the data for Convert
+    {
+        convertData = *data->ConvertData;
+    }
+    SetEvent(wContinue); // data ready; resume the main thread or the progress-dialog thread
+                         //---
+    observer.SetProgress(0, 0);
+    script->InitSpeedMeters(FALSE);
+
+    CPathBuffer lastLantasticCheckRoot; // Heap-allocated for long path support; last path root checked for Lantastic ("" = nothing checked yet)
+    lastLantasticCheckRoot[0] = 0;
+    BOOL lastIsLantasticPath = FALSE;                                                                                  // result of checking root lastLantasticCheckRoot
+    int mustDeleteFileBeforeOverwrite = 0; /* need test */                                                             // (added for SNAP server - NSA drive - SetEndOfFile fails - 0/1/2 = need-test/yes/no
+    int allocWholeFileOnStart = 0; /* need test */                                                                     // safety measure (e.g. SNAP servers - NSA drives - may fail); cannot risk a broken Copy - 0/1/2 = need-test/yes/no
+    int setDirTimeAfterMove = script->PreserveDirTime && script->SourcePathIsNetwork ? 0 /* need test */ : 2 /* no */; // e.g. on Samba, moving/renaming a directory changes its date and time - 0/1/2 = need-test/yes/no
+
+    BOOL Error = FALSE;
+    CQuadWord totalDone;
+    totalDone = CQuadWord(0, 0);
+    CProgressData pd;
+    BOOL novellRenamePatch = FALSE; // TRUE when the read-only attribute must be cleared before MoveFile (required on Novell)
+    char* tgtBuffer = NULL;         // conversion buffer for ocConvert
+    CAsyncCopyParams* asyncPar = NULL;
+    CSmallFileCopyPool smallFilesPool; // copies runs of small files on several threads
+    CParallelDeletePool deletePool;    // deletes runs of files and directories on several threads
+    if (buffer != NULL)
+    {
+        // operation label strings are loaded in workerState.Init()
+
+        TRACE_I("Worker: script->Count=" << script->Count << ", IsCancelled=" << observer.IsCancelled());
+        int i;
+        COperation* op;
+        CCopyJournal* journal = NULL; // journal for resuming the operation after an interruption
+        if (CCopyJournal::IsWanted(script))
+        {
+            journal = new CCopyJournal;
+            if (!journal->Create(script))
+            {
+                delete journal;
+                journal = NULL;
+            }
+            script->Journal = journal;
+        }
+        if (script->ResumeIndex > 0) // resumed operation: the operations in front of ResumeIndex were done by the interrupted operation
+        {
+            CQuadWord doneFileSize(0, 0);
+            for (i = 0; i < script->ResumeIndex && i < script->Count; i++)
+            {
+                COperation* doneOp = &script->At(i); // a resumed script is never built in pipelined mode
+                totalDone += doneOp->Size;
+                if (doneOp->Opcode == ocCopyFile || doneOp->Opcode == ocMoveFile)
+                    doneFileSize += doneOp->FileSize;
+            }
+            script->SetTFSandProgressSize(doneFileSize, totalDone);
+            observer.SetProgress(0, CaclProg(totalDone, script->TotalSize));
+        }
+        for (i = script->ResumeIndex; !observer.IsCancelled() && (op = script->GetOperation(i, &observer)) != NULL; i++)
+        {
+            if (journal != NULL)
+                journal->StartOperation(script, i);
+
+            switch (op->Opcode)
+            {
+            case ocCopyFile:
+            {
+                pd.Operation = workerState.OpStrCopying;
+                pd.Preposition = workerState.OpStrCopyingPrep;
+                smallFilesPool.CopyRun(script, i, observer, workerState, clearReadonlyMask, totalDone, pd,
+                                       lastLantasticCheckRoot, lastIsLantasticPath);
+                if (smallFilesPool.IsCopied(i))
+                    break; // already copied by the small-file thread pool
+
+                pd.Source = op->SourceName;
+                pd.Target = op->TargetName;
+                observer.SetOperationInfo(&pd);
+
+                observer.SetProgress(0, CaclProg(totalDone, script->TotalSize));
+
+                BOOL lantasticCheck = IsLantasticDrive(op->TargetName, lastLantasticCheckRoot, lastIsLantasticPath);
+
+                Error = !DoCopyFile(op, observer, buffer, script, totalDone,
+                                    clearReadonlyMask, NULL, lantasticCheck, mustDeleteFileBeforeOverwrite,
+                                    allocWholeFileOnStart, workerState,
+                                    (op->OpFlags & OPFL_COPY_ADS) != 0,
+                                    (op->OpFlags & OPFL_AS_ENCRYPTED) != 0,
+                                    FALSE, asyncPar);
+                break;
+            }
+
+            case ocMoveDir:
+            case ocMoveFile:
             {
                 pd.Operation = workerState.OpStrMoving;
                 pd.Source = op->SourceName;
@@ -8242,9 +10220,9 @@ unsigned ThreadWorkerBody(void* parameter)
                         // skip all script operations up to the label that closes this directory
                         CQuadWord skipTotal(0, 0);
                         int createDirIndex = i;
-                        while (++i < script->Count)
+                        COperation* oper;
+                        while ((oper = script->GetOperation(++i, &observer, TRUE, FALSE)) != NULL) // skipped operations keep their compact names
                         {
-                            COperation* oper = &script->At(i);
                             if (oper->Opcode == ocLabelForSkipOfCreateDir && (int)oper->Attr == createDirIndex)
                             {
                                 script->AddBytesToTFS(CQuadWord((DWORD)(DWORD_PTR)oper->SourceName, (DWORD)(DWORD_PTR)oper->TargetName));
@@ -8252,7 +10230,7 @@ unsigned ThreadWorkerBody(void* parameter)
                             }
                             skipTotal += oper->Size;
                         }
-                        if (i == script->Count)
+                        if (oper == NULL)
                         {
                             i = createDirIndex;
                             TRACE_E("ThreadWorkerBody(): unable to find end-label for dir-create operation: opcode=" << op->Opcode << ", index=" << i);
@@ -8280,19 +10258,18 @@ unsigned ThreadWorkerBody(void* parameter)
                 // locate the skip-label; it stores the index of the create-dir operation along with
                 // whether the target directory already existed or was created (date/time are copied
                 // only when we created the directory)
-                COperation* skipLabel = NULL;
-                if (i + 1 < script->Count && script->At(i + 1).Opcode == ocLabelForSkipOfCreateDir)
-                    skipLabel = &script->At(i + 1);
-                else
+                COperation* skipLabel = script->GetOperation(i + 1, &observer);
+                if (skipLabel != NULL && skipLabel->Opcode != ocLabelForSkipOfCreateDir)
                 {
-                    if (i + 2 < script->Count && script->At(i + 2).Opcode == ocLabelForSkipOfCreateDir)
-                        skipLabel = &script->At(i + 2);
+                    skipLabel = script->GetOperation(i + 2, &observer);
+                    if (skipLabel != NULL && skipLabel->Opcode != ocLabelForSkipOfCreateDir)
+                        skipLabel = NULL;
                 }
                 if (skipLabel != NULL)
                 {
-                    if (skipLabel->Attr < (DWORD)script->Count)
+                    if (skipLabel->Attr < (DWORD)i) // the create-dir operation always precedes ocCopyDirTime
                     {
-                        COperation* crDir = &script->At(skipLabel->Attr);
+                        COperation* crDir = script->GetOperation(skipLabel->Attr, &observer);
                         if (crDir->Opcode == ocCreateDir && (crDir->OpFlags & OPFL_AS_ENCRYPTED) == 0)
                         {
                             if (crDir->Attr == 0x10000000 /* dir already existed */)
@@ -8344,9 +10321,13 @@ unsigned ThreadWorkerBody(void* parameter)
             {
                 TRACE_I("Worker: delete op=" << op->Opcode << " src=" << (op->SourceName ? op->SourceName : "(null)"));
                 pd.Operation = workerState.OpStrDeleting;
-                pd.Source = op->SourceName;
                 pd.Preposition = "";
                 pd.Target = "";
+                deletePool.DeleteRun(script, i, observer, workerState, totalDone, pd);
+                if (deletePool.IsDeleted(i))
+                    break; // already deleted by the parallel delete pool
+
+                pd.Source = op->SourceName;
                 observer.SetOperationInfo(&pd);
 
                 observer.SetProgress(0, CaclProg(totalDone, script->TotalSize));
@@ -8432,8 +10413,23 @@ unsigned ThreadWorkerBody(void* parameter)
             }
             if (Error)
                 break;
+            if (journal != NULL)
+                journal->OperationDone(script, i);
+            script->ResumeOffset = CQuadWord(0, 0); // only the first operation may continue in a partially copied file
+            script->ReleaseNames(op);
             observer.WaitIfSuspended(); // if we should be in suspend mode, wait ...
         }
+        if (!Error && !observer.IsCancelled() && i < script->Count && script->NamesLowMemory)
+        { // the names of operation 'i' could not be restored, the rest of the script was not executed
+            observer.NotifyErrorById(IDS_ERRORTITLE, "", IDS_WORKERLOWMEMORY);
+            Error = TRUE;
+        }
+        if (journal != NULL)
+        {
+            script->Journal = NULL;
+            journal->Close(!Error && !observer.IsCancelled() && i == script->Count);
+            delete journal;
+        }
         if (!Error && !observer.IsCancelled() && i == script->Count && totalDone != script->TotalSize &&
             (totalDone != CQuadWord(0, 0) || script->TotalSize != CQuadWord(1, 0))) // intentional change of script->TotalSize to one (prevents division by zero)
         {
@@ -8467,17 +10463,36 @@ unsigned ThreadWorkerBody(void* parameter)
     observer.NotifyDone();              // we're done ...
     WaitForSingleObject(wContinue, INFINITE);       // we need to stop the main thread
 
-    FreeScript(script); // calls delete, so the main thread cannot be running
+    script->WorkerHasEnded(); // a pipelined build must end before the script can be freed
+    FreeScript(script);       // calls delete, so the main thread cannot be running
 
     TRACE_I("End");
     return 0;
 }
 
+int WorkerDirectThreads = 0;
+
 BOOL RunWorkerDirect(COperations* script, IWorkerObserver& observer,
-                     CChangeAttrsData* attrsData, CConvertData* convertData)
+                     CChangeAttrsData* attrsData, CConvertData* convertData,
+                     CWorkerDirectStats* stats)
 {
+    DWORD startTime = GetTickCount();
+    if (stats != NULL)
+    {
+        stats->Time = 0;
+        stats->Operations = 0;
+        stats->Files = 0;
+        stats->FileBytes = CQuadWord(0, 0);
+        stats->PeakWorkingSet = 0;
+    }
+
     CWorkerState workerState;
     workerState.Init();
+    if (WorkerDirectThreads > 0)
+    {
+        workerState.SmallFileCopyThreads = min(WorkerDirectThreads, SMALLFILE_COPY_MAX_THREADS);
+        workerState.ParallelDeleteThreads = min(WorkerDirectThreads, PARALLEL_DELETE_MAX_THREADS);
+    }
 
     if (script->TotalSize == CQuadWord(0, 0))
         script->TotalSize = CQuadWord(1, 0);
@@ -8520,23 +10535,30 @@ BOOL RunWorkerDirect(COperations* script, IWorkerObserver& observer,
     BOOL novellRenamePatch = FALSE;
     char* tgtBuffer = NULL;
     CAsyncCopyParams* asyncPar = NULL;
+    CSmallFileCopyPool smallFilesPool;
+    CParallelDeletePool deletePool;
     DWORD clearReadonlyMask = script->ClearReadonlyMask;
     CConvertData convertDataLocal;
     if (convertData != NULL)
         convertDataLocal = *convertData;
 
     int i;
-    for (i = 0; !observer.IsCancelled() && i < script->Count; i++)
+    COperation* op;
+    for (i = 0; !observer.IsCancelled() && (op = script->GetOperation(i, &observer)) != NULL; i++)
     {
-        COperation* op = &script->At(i);
 
         switch (op->Opcode)
         {
         case ocCopyFile:
         {
             pd.Operation = workerState.OpStrCopying;
-            pd.Source = op->SourceName;
             pd.Preposition = workerState.OpStrCopyingPrep;
+            smallFilesPool.CopyRun(script, i, observer, workerState, clearReadonlyMask, totalDone, pd,
+                                   lastLantasticCheckRoot, lastIsLantasticPath);
+            if (smallFilesPool.IsCopied(i))
+                break; // already copied by the small-file thread pool
+
+            pd.Source = op->SourceName;
             pd.Target = op->TargetName;
             observer.SetOperationInfo(&pd);
             observer.SetProgress(0, CaclProg(totalDone, script->TotalSize));
@@ -8574,9 +10596,13 @@ BOOL RunWorkerDirect(COperations* script, IWorkerObserver& observer,
         case ocDeleteFile:
         {
             pd.Operation = workerState.OpStrDeleting;
-            pd.Source = op->SourceName;
             pd.Preposition = "";
             pd.Target = "";
+            deletePool.DeleteRun(script, i, observer, workerState, totalDone, pd);
+            if (deletePool.IsDeleted(i))
+                break; // already deleted by the parallel delete pool
+
+            pd.Source = op->SourceName;
             observer.SetOperationInfo(&pd);
             observer.SetProgress(0, CaclProg(totalDone, script->TotalSize));
 
@@ -8608,9 +10634,9 @@ BOOL RunWorkerDirect(COperations* script, IWorkerObserver& observer,
                 {
                     CQuadWord skipTotal(0, 0);
                     int createDirIndex = i;
-                    while (++i < script->Count)
+                    COperation* oper;
+                    while ((oper = script->GetOperation(++i, &observer, TRUE, FALSE)) != NULL) // skipped operations keep their compact names
                     {
-                        COperation* oper = &script->At(i);
                         if (oper->Opcode == ocLabelForSkipOfCreateDir && (int)oper->Attr == createDirIndex)
                         {
                             script->AddBytesToTFS(CQuadWord((DWORD)(DWORD_PTR)oper->SourceName, (DWORD)(DWORD_PTR)oper->TargetName));
@@ -8618,7 +10644,7 @@ BOOL RunWorkerDirect(COperations* script, IWorkerObserver& observer,
                         }
                         skipTotal += oper->Size;
                     }
-                    if (i == script->Count)
+                    if (oper == NULL)
                         i = createDirIndex;
                     else
                         totalDone += skipTotal;
@@ -8640,9 +10666,13 @@ BOOL RunWorkerDirect(COperations* script, IWorkerObserver& observer,
         case ocDeleteDirLink:
         {
             pd.Operation = workerState.OpStrDeleting;
-            pd.Source = op->SourceName;
             pd.Preposition = "";
             pd.Target = "";
+            deletePool.DeleteRun(script, i, observer, workerState, totalDone, pd);
+            if (deletePool.IsDeleted(i))
+                break; // already deleted by the parallel delete pool
+
+            pd.Source = op->SourceName;
             observer.SetOperationInfo(&pd);
             observer.SetProgress(0, CaclProg(totalDone, script->TotalSize));
 
@@ -8726,10 +10756,30 @@ BOOL RunWorkerDirect(COperations* script, IWorkerObserver& observer,
         case ocLabelForSkipOfCreateDir:
             break;
         }
+        if (stats != NULL)
+        {
+            stats->Operations++;
+            switch (op->Opcode)
+            {
+            case ocCopyFile:
+            case ocMoveFile:
+                stats->FileBytes += op->FileSize; // the break; is intentionally missing here
+            case ocDeleteFile:
+            case ocConvert:
+                stats->Files++;
+                break;
+            }
+        }
         if (Error)
             break;
+        script->ReleaseNames(op);
         observer.WaitIfSuspended();
     }
+    if (!Error && !observer.IsCancelled() && i < script->Count && script->NamesLowMemory)
+    { // the names of operation 'i' could not be restored, the rest of the script was not executed
+        observer.NotifyErrorById(IDS_ERRORTITLE, "", IDS_WORKERLOWMEMORY);
+        Error = TRUE;
+    }
 
     if (asyncPar != NULL)
         delete asyncPar;
@@ -8738,6 +10788,15 @@ BOOL RunWorkerDirect(COperations* script, IWorkerObserver& observer,
     if (bufferIsAllocated)
         free(buffer);
 
+    if (stats != NULL)
+    {
+        stats->Time = GetTickCount() - startTime;
+        PROCESS_MEMORY_COUNTERS memCounters;
+        if (GetProcessMemoryInfo(GetCurrentProcess(), &memCounters, sizeof(memCounters)))
+            stats->PeakWorkingSet = memCounters.PeakWorkingSetSize;
+        TRACE_I("RunWorkerDirect(): " << stats->Operations << " operations (" << stats->Files << " files) in " << stats->Time << " ms");
+    }
+
     BOOL success = !Error && !observer.IsCancelled();
     observer.SetError(Error != FALSE);
     observer.NotifyDone();
@@ -8827,7 +10886,62 @@ void FreeScript(COperations* script)
     delete script;
 }
 
-BOOL COperationsQueue::AddOperation(HWND dlg, BOOL startOnIdle, BOOL* startPaused)
+// returns TRUE if the operations using volumes 'd1' and 'd2' share a volume (unknown volume is shared with all)
+BOOL QueueDevicesConflict(const COperationsQueueDevices& d1, const COperationsQueueDevices& d2)
+{
+    if (d1.SourceRoot[0] == 0 || d1.TargetRoot[0] == 0 || d2.SourceRoot[0] == 0 || d2.TargetRoot[0] == 0)
+        return TRUE;
+    return StrICmp(d1.SourceRoot, d2.SourceRoot) == 0 || StrICmp(d1.SourceRoot, d2.TargetRoot) == 0 ||
+           StrICmp(d1.TargetRoot, d2.SourceRoot) == 0 || StrICmp(d1.TargetRoot, d2.TargetRoot) == 0;
+}
+
+void COperations::SetQueueDevices(const char* sourcePath, const char* targetPath)
+{
+    QueueDevices.SourceRoot[0] = 0;
+    QueueDevices.TargetRoot[0] = 0;
+    if (sourcePath != NULL && sourcePath[0] != 0)
+        GetRootPath(QueueDevices.SourceRoot, sourcePath);
+    if (targetPath != NULL && targetPath[0] != 0)
+        GetRootPath(QueueDevices.TargetRoot, targetPath);
+}
+
+BOOL COperationsQueue::CanStart(int index)
+{
+    for (int i = 0; i < OperDlgs.Count; i++)
+    {
+        if (i == index)
+            continue;
+        BOOL waiting = OperPaused[i] == 1 /* auto-paused */ || OperPaused[i] == 3 /* auto-paused until all finish */;
+        if (!waiting || i < index && OperPaused[i] == 1 /* auto-paused */) // operations waiting in front of us have precedence (except the ones which wait for all others)
+        {
+            if (OperPaused[index] == 3 /* auto-paused until all finish */ && !waiting ||
+                QueueDevicesConflict(OperDevices[index], OperDevices[i]))
+            {
+                return FALSE;
+            }
+        }
+    }
+    return TRUE;
+}
+
+void COperationsQueue::ResumeWaitingOperations(HWND dlg, HWND* foregroundWnd)
+{
+    for (int i = 0; i < OperDlgs.Count; i++)
+    {
+        if ((OperPaused[i] == 1 /* auto-paused */ || OperPaused[i] == 3 /* auto-paused until all finish */) && CanStart(i))
+        {
+            OperPaused[i] = 0 /* running */; // the dialog confirms it by SetPaused(), but the following operations must see it now
+            PostMessage(OperDlgs[i], WM_COMMAND, CM_RESUMEOPER, 0);
+            if (foregroundWnd != NULL && GetForegroundWindow() == dlg)
+            {
+                *foregroundWnd = OperDlgs[i];
+                foregroundWnd = NULL; // activate only the first resumed operation
+            }
+        }
+    }
+}
+
+BOOL COperationsQueue::AddOperation(HWND dlg, BOOL startOnIdle, const COperationsQueueDevices* devices, BOOL* startPaused)
 {
     CALL_STACK_MESSAGE1("COperationsQueue::AddOperation()");
 
@@ -8839,30 +10953,44 @@ BOOL COperationsQueue::AddOperation(HWND dlg, BOOL startOnIdle, BOOL* startPause
             break;
 
     BOOL ret = FALSE;
+    *startPaused = FALSE;
     if (i == OperDlgs.Count) // the operation can be added
     {
         OperDlgs.Add(dlg);
         if (OperDlgs.IsGood())
         {
-            if (startOnIdle)
+            OperPaused.Add(startOnIdle ? 1 /* auto-paused */ : 0 /* running */);
+            if (OperPaused.IsGood())
             {
-                int j;
-                for (j = 0; j < OperPaused.Count && OperPaused[j] == 1 /* auto-paused */; j++)
-                    ; // if another operation is already running or was paused manually, start this one as "auto-paused"
-                *startPaused = j < OperPaused.Count;
+                OperDevices.Add(*devices);
+                if (OperDevices.IsGood())
+                    ret = TRUE;
+                else
+                {
+                    OperDevices.ResetState();
+                    OperPaused.Delete(OperPaused.Count - 1);
+                    if (!OperPaused.IsGood())
+                        OperPaused.ResetState();
+                }
             }
             else
-                *startPaused = FALSE;
-            OperPaused.Add(*startPaused ? 1 /* auto-paused */ : 0 /* running */);
-            if (!OperPaused.IsGood())
-            {
                 OperPaused.ResetState();
+            if (!ret)
+            {
                 OperDlgs.Delete(OperDlgs.Count - 1);
                 if (!OperDlgs.IsGood())
                     OperDlgs.ResetState();
             }
             else
-                ret = TRUE;
+            {
+                // if another operation uses the same volumes (it is running or was paused manually), start this one as "auto-paused"
+                if (startOnIdle)
+                {
+                    *startPaused = !CanStart(i);
+                    if (!*startPaused)
+                        OperPaused[i] = 0 /* running */;
+                }
+            }
         }
         else
             OperDlgs.ResetState();
@@ -8894,6 +11022,9 @@ void COperationsQueue::OperationEnded(HWND dlg, BOOL doNotResume, HWND* foregrou
             OperPaused.Delete(i);
             if (!OperPaused.IsGood())
                 OperPaused.ResetState();
+            OperDevices.Delete(i);
+            if (!OperDevices.IsGood())
+                OperDevices.ResetState();
             break;
         }
     }
@@ -8901,18 +11032,8 @@ void COperationsQueue::OperationEnded(HWND dlg, BOOL doNotResume, HWND* foregrou
         TRACE_E("COperationsQueue::OperationEnded(): unexpected situation: operation was not found!");
     else
     {
-        if (!doNotResume)
-        {
-            int j;
-            for (j = 0; j < OperPaused.Count && OperPaused[j] == 1 /* auto-paused */; j++)
-                ; // if no operation is running and none was paused manually, resume the first one in the queue
-            if (j == OperPaused.Count && OperDlgs.Count > 0)
-            {
-                PostMessage(OperDlgs[0], WM_COMMAND, CM_RESUMEOPER, 0);
-                if (foregroundWnd != NULL && GetForegroundWindow() == dlg)
-                    *foregroundWnd = OperDlgs[0];
-            }
-        }
+        if (!doNotResume) // the volumes of the ended operation are free, resume the operations waiting for them
+            ResumeWaitingOperations(dlg, foregroundWnd);
     }
 
     HANDLES(LeaveCriticalSection(&QueueCritSect));
@@ -8960,29 +11081,25 @@ void COperationsQueue::AutoPauseOperation(HWND dlg, HWND* foregroundWnd)
     {
         if (OperDlgs[i] == dlg)
         {
+            COperationsQueueDevices devices = OperDevices[i];
             int j;
             for (j = i; j + 1 < OperDlgs.Count; j++)
                 OperDlgs[j] = OperDlgs[j + 1];
             for (j = i; j + 1 < OperPaused.Count; j++)
                 OperPaused[j] = OperPaused[j + 1];
+            for (j = i; j + 1 < OperDevices.Count; j++)
+                OperDevices[j] = OperDevices[j + 1];
             OperDlgs[j] = dlg;
-            OperPaused[j] = 1 /* auto-paused */;
+            OperPaused[j] = 3 /* auto-paused until all finish */; // the user wants to wait for all other operations, not only for the ones using the same volumes
+            OperDevices[j] = devices;
             break;
         }
     }
     if (i == OperDlgs.Count)
         TRACE_E("COperationsQueue::AutoPauseOperation(): operation was not found!");
 
-    // if no operation is running and none was paused manually, resume the first one in the queue
-    int j;
-    for (j = 0; j < OperPaused.Count && OperPaused[j] == 1 /* auto-paused */; j++)
-        ;
-    if (j == OperPaused.Count && OperDlgs.Count > 0)
-    {
-        PostMessage(OperDlgs[0], WM_COMMAND, CM_RESUMEOPER, 0);
-        if (foregroundWnd != NULL && GetForegroundWindow() == dlg)
-            *foregroundWnd = OperDlgs[0];
-    }
+    // the volumes of the paused operation are free, resume the operations waiting for them
+    ResumeWaitingOperations(dlg, foregroundWnd);
 
     HANDLES(LeaveCriticalSection(&QueueCritSect));
 }
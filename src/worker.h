@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <deque>
 #include <vector>
 #include <string>
 
@@ -33,8 +34,39 @@ class IWorkerObserver; // forward declaration for RunWorkerDirect
 #define ASYNC_SLOW_COPY_BUF_SIZE (8 * 1024)    // 8KB buffer for slow copy (primarily network disks over VPN)
 #define ASYNC_SLOW_COPY_BUF_MINBLOCKS 12
 
+// asynchronous copy of large files: block size and number of blocks are tuned at runtime for each pair
+// of source and target volumes (see CAsyncCopyTuner), the best settings are kept for the rest of the session
+#define ASYNC_COPY_MAX_BUF_SIZE (8 * 1024 * 1024)       // largest block size tried by the tuner
+#define ASYNC_COPY_MAX_BLOCKS 16                        // largest number of blocks tried by the tuner (default is 8)
+#define ASYNC_COPY_MAX_IN_FLIGHT (64 * 1024 * 1024)     // limit for block size * number of blocks (memory held by the worker)
+#define ASYNC_COPY_TUNE_MIN_FILE_SIZE (32 * 1024 * 1024) // smaller files use the best known settings but are not measured
+#define ASYNC_COPY_TUNE_MIN_TIME 200                    // ms, shorter copies are not measured (speed would be too inaccurate)
+
+// small-file thread pool: runs of consecutive small files are copied by several threads at once
+// (per-file open/create/close latency dominates here, so overlapping it pays off mainly on SSDs and network disks)
+#define SMALLFILE_COPY_MAX_SIZE (256 * 1024) // largest file copied by the pool (read in OPERATION_BUFFER blocks); WARNING: must fit in a DWORD (progress is added via LoDWord)
+#define SMALLFILE_COPY_MIN_RUN 8             // shorter runs of small files are not worth starting the threads
+#define SMALLFILE_COPY_MAX_RUN 512           // longest run handed to the pool at once (keeps the deferred errors close to their files)
+#define SMALLFILE_COPY_MAX_THREADS 8         // upper limit for the number of pool threads
+
+// parallel delete: runs of consecutive ocDeleteFile and ocDeleteDir operations are deleted by several threads,
+// independent subtrees at once (a directory is removed only after all its files and subdirectories)
+#define PARALLEL_DELETE_MIN_RUN 16    // shorter runs are not worth starting the threads
+#define PARALLEL_DELETE_MAX_RUN 4096  // longest run handed to the pool at once (keeps the deferred errors close to their files)
+#define PARALLEL_DELETE_MAX_THREADS 8 // upper limit for the number of pool threads
+
+// pipelined script building: Copy/Move starts while the source tree is still being enumerated
+#define SCRIPT_PIPE_START_DELAY 2000  // ms of enumeration after which the operation is started without waiting for the complete script
+#define SCRIPT_PIPE_MAX_AHEAD 100000  // maximum number of operations the build may be ahead of the worker (then it waits)
+
+// resumable Copy/Move: long operations keep a journal on disk so they can be resumed after an interruption (see CCopyJournal)
+#define COPY_JOURNAL_MIN_SIZE CQuadWord(0x40000000, 0) // scripts copying at least 1GB of data get a journal
+#define COPY_JOURNAL_MIN_COUNT 5000                    // scripts with at least this many operations get a journal (pipelined builds always)
+#define COPY_JOURNAL_SAVE_PERIOD 2000                  // ms, the state of the operation is saved to the journal at most this often
+
 // WARNING: HIGH_SPEED_LIMIT must be >= the largest value in the previous group (OPERATION_BUFFER,
-//        REMOVABLE_DISK_COPY_BUFFER, ASYNC_COPY_BUF_SIZE)
+//        REMOVABLE_DISK_COPY_BUFFER, ASYNC_COPY_BUF_SIZE); tuned blocks (ASYNC_COPY_MAX_BUF_SIZE) are not
+//        used when the speed limit is on
 #define HIGH_SPEED_LIMIT (1024 * 1024) // when the speed-limit >= this number we throttle by inserting a braking \ Sleep after (speed-limit / HIGH_SPEED_LIMIT_BRAKE_DIV) bytes, if needed
 #define HIGH_SPEED_LIMIT_BRAKE_DIV 10  // see HIGH_SPEED_LIMIT for details
 
@@ -61,6 +93,7 @@ struct CConvertData // data used by ocConvert
 };
 
 class COperations;
+class CCopyJournal;
 struct CProgressDlgArrItem;
 
 struct CStartProgressDialogData
@@ -237,11 +270,19 @@ struct COperation
     bool OwnsSourceName = true;
     bool OwnsTargetName = true;
 
+    // Compact form of the names (see COperations::Add): true = SourceName/TargetName (and SourceNameW/
+    // TargetNameW if not empty) hold only the name of the file, the path to it is in SourceDir/TargetDir;
+    // the worker gets the full names from COperations::GetOperation()
+    bool CompactNames = false;
+    const char* SourceDir; // NULL or the directory of SourceName (with trailing backslash) shared in COperations
+    const char* TargetDir; // NULL or the directory of TargetName (with trailing backslash) shared in COperations
+
     // Default constructor - initializes pointers to NULL
     COperation() : Opcode(ocCopyFile), Size(), FileSize(),
                    SourceName(NULL), TargetName(NULL),
                    Attr(0), OpFlags(0),
-                   OwnsSourceName(true), OwnsTargetName(true) {}
+                   OwnsSourceName(true), OwnsTargetName(true),
+                   CompactNames(false), SourceDir(NULL), TargetDir(NULL) {}
 
     // Destructor - frees owned pointers
     ~COperation()
@@ -262,7 +303,8 @@ struct COperation
           SourceName(other.SourceName), TargetName(other.TargetName),
           SourceNameW(std::move(other.SourceNameW)), TargetNameW(std::move(other.TargetNameW)),
           Attr(other.Attr), OpFlags(other.OpFlags),
-          OwnsSourceName(other.OwnsSourceName), OwnsTargetName(other.OwnsTargetName)
+          OwnsSourceName(other.OwnsSourceName), OwnsTargetName(other.OwnsTargetName),
+          CompactNames(other.CompactNames), SourceDir(other.SourceDir), TargetDir(other.TargetDir)
     {
         // Null out source to prevent double-free
         other.SourceName = NULL;
@@ -295,6 +337,9 @@ struct COperation
             OpFlags = other.OpFlags;
             OwnsSourceName = other.OwnsSourceName;
             OwnsTargetName = other.OwnsTargetName;
+            CompactNames = other.CompactNames;
+            SourceDir = other.SourceDir;
+            TargetDir = other.TargetDir;
 
             // Null out source to prevent double-free
             other.SourceName = NULL;
@@ -353,40 +398,79 @@ struct COperation
                                         DWORD (*operationFn)(const wchar_t* path));
 };
 
+struct COperationsQueueDevices // volumes used by a Copy/Move operation (see COperationsQueue)
+{
+    char SourceRoot[MAX_PATH]; // root of the source volume (see GetRootPath); empty string = unknown (the operation shares it with everybody)
+    char TargetRoot[MAX_PATH]; // root of the target volume; empty string = unknown
+};
+
 class COperations
 {
 private:
-    std::vector<COperation> m_ops;  // Operation storage - std::vector handles non-POD types correctly
+    // Operation storage - std::deque handles non-POD types correctly and keeps the addresses
+    // of existing operations stable while the script grows (pipelined build, see BeginPipelinedBuild)
+    std::deque<COperation> m_ops;
 
 public:
     int Count;  // Number of operations (kept in sync with m_ops.size())
 
     // TDirectArray compatibility methods
+    // WARNING: during a pipelined build only the building thread may use At(), the worker uses GetOperation()
     COperation& At(int index) { return m_ops[index]; }
     const COperation& At(int index) const { return m_ops[index]; }
 
+    // file operations are stored in compact form (see COperation::CompactNames): long scripts mostly
+    // contain many files from a few directories, so each directory name is stored only once
     int Add(COperation& op) {
+        if (op.Opcode == ocCopyFile || op.Opcode == ocMoveFile || op.Opcode == ocDeleteFile)
+            SetCompactNames(op);
+        if (Pipelined)
+            HANDLES(EnterCriticalSection(&PipeCS));
         m_ops.push_back(std::move(op));
-        // Automatically populate wide paths for long path support
-        m_ops.back().PopulateWidePathsFromAnsi();
+        // Automatically populate wide paths for long path support (compact names get them in GetOperation)
+        if (!m_ops.back().CompactNames)
+            m_ops.back().PopulateWidePathsFromAnsi();
         Count = (int)m_ops.size();
+        if (Pipelined)
+            HANDLES(LeaveCriticalSection(&PipeCS));
         return Count - 1;
     }
 
-    BOOL IsGood() const { return TRUE; }  // std::vector doesn't have error states like TDirectArray
+    BOOL IsGood() const { return TRUE; }  // std::deque doesn't have error states like TDirectArray
 
-    void ResetState() {}  // No-op: std::vector doesn't have error states
+    void ResetState() {}  // No-op: std::deque doesn't have error states
 
+    // WARNING: during a pipelined build only unpublished operations may be deleted
     void Delete(int index) {
+        if (Pipelined)
+            HANDLES(EnterCriticalSection(&PipeCS));
         m_ops.erase(m_ops.begin() + index);
         Count = (int)m_ops.size();
+        if (Pipelined)
+            HANDLES(LeaveCriticalSection(&PipeCS));
     }
 
     void DestroyMembers() {
         m_ops.clear();
         Count = 0;
+        DirNames.clear();
+        LastDirs[0] = LastDirs[1] = NULL;
     }
 
+private:
+    // directories of the names stored in compact form; std::deque keeps the strings in place while
+    // further directories are added (operations point to them), used only by the building thread
+    std::deque<std::string> DirNames;
+    const char* LastDirs[2]; // the last two used directories from DirNames (typically source and target)
+
+    // converts the names of 'op' to compact form (does nothing if it fails)
+    void SetCompactNames(COperation& op);
+    // returns the directory 'dir' (length 'len') from DirNames, adds it if it is not there yet;
+    // returns NULL on low memory
+    const char* GetSharedDir(const char* dir, int len);
+    // restores the full names of 'op' stored in compact form; returns FALSE on low memory
+    BOOL SetFullNames(COperation* op);
+
 public:
     CQuadWord TotalSize;      // WARNING: not the byte size of the files (usable only for progress calculations)
     CQuadWord CompressedSize; // sum of file sizes after compression
@@ -421,8 +505,10 @@ public:
     BOOL OverwriteOlder;        // overwrite older items and skip newer ones without prompting
     BOOL CopySecurity;          // preserve NTFS permissions; FALSE = don't care = perform no extra handling and accept any result
     BOOL CopyAttrs;             // preserve the Archive, Encrypt, and Compress attributes; FALSE = don't care = perform no extra handling and accept any result
+    BOOL VerifyCopy;            // verify copied files: read the target file back and compare its CRC-32 with the data written
+    BOOL DeltaCopy;             // existing large target files are overwritten in place, only blocks differing from the source are written (see DoCopyFileLoopDelta)
     BOOL PreserveDirTime;       // preserve directory timestamps (during Move we detect unintended changes and fix them manually; works e.g. on Samba)
-    BOOL StartOnIdle;           // should start only when nothing else is running
+    BOOL StartOnIdle;           // should start only when no other operation uses its volumes (see COperationsQueue)
     BOOL SourcePathIsNetwork;   // TRUE = the source path is a network path (UNC or mapped drive)
 
     // for the status line in the progress dialog (Copy and Move only)
@@ -442,6 +528,17 @@ public:
     std::string WaitInQueueFrom;    // text for the "waiting in queue" state: top line (From)
     std::string WaitInQueueTo;      // text for the "waiting in queue" state: bottom line (To)
 
+    COperationsQueueDevices QueueDevices; // volumes used by the operation (for COperationsQueue, see SetQueueDevices)
+
+    std::string PipelinedCaption; // non-empty = the operation may be started with this progress dialog caption while the script is still being built (see BeginPipelinedBuild)
+
+    // resumed operation (see LoadCopyJournal): the worker starts with the operation at ResumeIndex, the target
+    // file of this operation already contains ResumeOffset bytes copied by the interrupted operation
+    int ResumeIndex;
+    CQuadWord ResumeOffset;  // DoCopyFile continues behind these bytes if they match the source file (the worker clears it)
+    CCopyJournal* Journal;   // NULL or the journal of the running operation (used only by the worker thread)
+    BOOL NamesLowMemory;     // TRUE = the last GetOperation() returned NULL because it could not restore the full names (used only by the worker thread)
+
 private:
     // for the status line in the progress dialog (Copy and Move only)
     CRITICAL_SECTION StatusCS;              // critical section protecting TransferSpeedMeter, ProgressSpeedMeter, and
@@ -465,9 +562,26 @@ private:
     DWORD LastFileBlockCount;     // blocks copied since the last file started (WARNING: overflow-protected; values > 1000000 mean "a lot", the exact amount doesn't matter)
     DWORD LastFileStartTime;      // GetTickCount() from when we started copying the last file
 
+    // pipelined build: the worker already executes the script while the main thread is still adding
+    // operations; the main thread publishes operations in batches (the last added operation is never
+    // published before the build ends, BuildScriptDir may still delete it) and waits when it gets
+    // too far ahead of the worker (SCRIPT_PIPE_MAX_AHEAD)
+    BOOL Pipelined;          // TRUE = pipelined build was started (m_ops, Count and the following members are protected by PipeCS)
+    CRITICAL_SECTION PipeCS; // critical section for the pipelined build
+    HANDLE PipePublished;    // auto-reset event: new operations were published or the build has ended (wakes the worker)
+    HANDLE PipeConsumed;     // auto-reset event: the worker moved to the next operation or ended (wakes the main thread)
+    int PublishedCount;      // number of operations the worker may execute
+    int ConsumedCount;       // index of the operation the worker is executing
+    BOOL BuildEnded;         // TRUE = the main thread has finished the build (it does not touch the script any more)
+    BOOL BuildFailed;        // TRUE = the build was cancelled or failed (the worker ends after the published operations)
+    BOOL WorkerEnded;        // TRUE = the worker has ended (the build is pointless, it should be cancelled)
+
 public:
     COperations(int base, int delta, const char* waitInQueueSubject, const char* waitInQueueFrom, const char* waitInQueueTo);
-    ~COperations() { HANDLES(DeleteCriticalSection(&StatusCS)); }
+    ~COperations();
+
+    // sets QueueDevices to the volumes of 'sourcePath' and 'targetPath' (NULL = unknown volume)
+    void SetQueueDevices(const char* sourcePath, const char* targetPath);
 
     void SetWorkPath1(const char* path, BOOL inclSubDirs)
     {
@@ -506,37 +620,75 @@ public:
 
     void SetSpeedLimit(BOOL useSpeedLimit, DWORD speedLimit);
     void GetSpeedLimit(BOOL* useSpeedLimit, DWORD* speedLimit);
+
+    // pipelined build, methods for the building (main) thread:
+    // switches the script to pipelined mode before the worker is started (publishes all operations
+    // added so far except the last one and adds their sizes to TotalSize); returns FALSE on error
+    BOOL BeginPipelinedBuild();
+    // cancels BeginPipelinedBuild() if the worker could not be started
+    void CancelPipelinedBuild();
+    BOOL IsPipelinedBuild() const { return Pipelined; }
+    // publishes new operations (except the last one) for the worker and refines TotalSize; returns
+    // FALSE if the worker has already ended (the build should be cancelled); 'tooFarAhead' receives
+    // TRUE if the build is too far ahead of the worker and should wait (see WaitForWorker)
+    BOOL PublishOperations(BOOL* tooFarAhead);
+    // waits at most 'timeout' ms for the worker to move on (sent messages are processed meanwhile)
+    void WaitForWorker(DWORD timeout);
+    // publishes all remaining operations and ends the build; 'success' is FALSE if the build was
+    // cancelled or failed; WARNING: after this call the script may be freed by the worker at any time
+    void EndPipelinedBuild(BOOL success);
+
+    // pipelined build, methods for the worker thread:
+    // returns the operation at 'index' (with full names) or NULL if the script has no more operations
+    // or on low memory (then NamesLowMemory is set to TRUE); during a pipelined build waits until the operation is published (NULL also
+    // if 'observer' is cancelled), if 'wait' is FALSE returns NULL for an operation that is not
+    // published yet; if 'fullNames' is FALSE the names are left as they are stored (for operations
+    // the worker only skips, their names may be in compact form, see COperation::CompactNames)
+    COperation* GetOperation(int index, IWorkerObserver* observer, BOOL wait = TRUE, BOOL fullNames = TRUE);
+    // returns the operation at 'index' as it is stored (names may be in compact form, see COperation::CompactNames)
+    // or NULL if the operation is not published yet; 'complete' receives TRUE if no more operations will be added
+    COperation* GetStoredOperation(int index, BOOL* complete);
+    // called by the worker after it has executed the operation 'op': frees the full names restored
+    // by GetOperation() (the operation is never executed again, its names become NULL)
+    void ReleaseNames(COperation* op);
+    // called by the worker when it stops executing the script; during a pipelined build waits until
+    // the main thread ends the build (the script must not be freed sooner)
+    void WorkerHasEnded();
 };
 
+// operations in the queue are scheduled per volume: an operation waiting in the queue starts when no
+// running (or manually paused) operation uses any of its volumes, so operations between unrelated disks
+// run at the same time and only the ones sharing a disk wait for each other
 class COperationsQueue // queue of disk Copy/Move operations
 {
 protected:
     CRITICAL_SECTION QueueCritSect; // object's critical section
 
-    // OperDlgs and OperPaused arrays have the same number of elements and share indices (each operation uses the same index in both arrays)
-    TDirectArray<HWND> OperDlgs;    // array of HWND handles: dialogs of operations in the queue
-    TDirectArray<DWORD> OperPaused; // int array describing queue operation state: 2/1/0 = "manually-paused"/"auto-paused"/"running"
+    // OperDlgs, OperPaused, and OperDevices arrays have the same number of elements and share indices (each operation uses the same index in all arrays)
+    TDirectArray<HWND> OperDlgs;                       // array of HWND handles: dialogs of operations in the queue
+    TDirectArray<DWORD> OperPaused;                    // int array describing queue operation state: 3/2/1/0 = "auto-paused until all other operations finish"/"manually-paused"/"auto-paused"/"running"
+    TDirectArray<COperationsQueueDevices> OperDevices; // volumes used by the operations
 
 public:
-    COperationsQueue() : OperDlgs(5, 10), OperPaused(5, 10)
+    COperationsQueue() : OperDlgs(5, 10), OperPaused(5, 10), OperDevices(5, 10)
     {
         HANDLES(InitializeCriticalSection(&QueueCritSect));
     }
     ~COperationsQueue()
     {
-        if (OperDlgs.Count > 0 || OperPaused.Count > 0)
+        if (OperDlgs.Count > 0 || OperPaused.Count > 0 || OperDevices.Count > 0)
             TRACE_E("~COperationsQueue(): unexpected situation: operation queue is not empty!");
         HANDLES(DeleteCriticalSection(&QueueCritSect));
     }
 
     // adds an operation to the queue; returns TRUE on success, otherwise the addition failed (not enough memory);
     // 'dlg' is the handle of the operation dialog window; 'startOnIdle' is TRUE if the operation should start
-    // only when nothing else is running; in 'startPaused' (must not be NULL) it returns TRUE when
-    // the added operation should start "paused", otherwise it starts "running"
-    BOOL AddOperation(HWND dlg, BOOL startOnIdle, BOOL* startPaused);
+    // only when no other operation uses its volumes 'devices'; in 'startPaused' (must not be NULL) it returns
+    // TRUE when the added operation should start "paused", otherwise it starts "running"
+    BOOL AddOperation(HWND dlg, BOOL startOnIdle, const COperationsQueueDevices* devices, BOOL* startPaused);
 
     // removes the operation from the queue (the operation finished); if 'doNotResume' is FALSE, it posts
-    // a "resume" of the first operation in the queue when every operation in the queue is "paused";
+    // a "resume" to the "auto-paused" operations which can start now (see CanStart);
     // if 'foregroundWnd' is not NULL, it stores the handle of the dialog that should be activated
     // (if no activation is needed, the value remains unchanged)
     void OperationEnded(HWND dlg, BOOL doNotResume, HWND* foregroundWnd);
@@ -552,6 +704,16 @@ public:
 
     // returns the current number of operations in the queue
     int GetNumOfOperations();
+
+protected:
+    // returns TRUE if the operation at 'index' can run now: no running or manually paused operation
+    // uses its volumes and no operation waiting in front of it in the queue wants them;
+    // WARNING: must be called in QueueCritSect
+    BOOL CanStart(int index);
+
+    // posts a "resume" to the "auto-paused" operations which can start now; see OperationEnded
+    // for 'dlg' and 'foregroundWnd'; WARNING: must be called in QueueCritSect
+    void ResumeWaitingOperations(HWND dlg, HWND* foregroundWnd);
 };
 
 extern COperationsQueue OperationsQueue; // queue of disk Copy/Move operations
@@ -560,14 +722,116 @@ HANDLE StartWorker(COperations* script, HWND hDlg, CChangeAttrsData* attrsData,
                    CConvertData* convertData, HANDLE wContinue, HANDLE workerNotSuspended,
                    BOOL* cancelWorker, int* operationProgress, int* summaryProgress);
 
+// statistics of one RunWorkerDirect() call, used for measuring the throughput of the worker
+// (e.g. files per second and MB per second of the copy/move/delete scripts)
+struct CWorkerDirectStats
+{
+    DWORD Time;            // duration of the whole script in milliseconds
+    int Operations;        // number of executed operations
+    int Files;             // number of executed file operations (copy, move, delete, convert)
+    CQuadWord FileBytes;   // sum of the sizes of the copied and moved files
+    SIZE_T PeakWorkingSet; // peak working set of the process at the end of the script (bytes)
+};
+
 // Headless worker execution — runs operations synchronously on the calling thread.
 // Uses the provided IWorkerObserver instead of the progress dialog.
 // Returns TRUE if all operations completed without error, FALSE on error/cancel.
+// If 'stats' is not NULL, it receives the statistics of the run (also on error/cancel).
 BOOL RunWorkerDirect(COperations* script, IWorkerObserver& observer,
-                     CChangeAttrsData* attrsData = NULL, CConvertData* convertData = NULL);
+                     CChangeAttrsData* attrsData = NULL, CConvertData* convertData = NULL,
+                     CWorkerDirectStats* stats = NULL);
+
+// number of threads of the small-file copy and parallel delete pools used by RunWorkerDirect()
+// (1 = do not use the pools); 0 = by the number of processors like StartWorker (default);
+// used for measuring how the pools scale
+extern int WorkerDirectThreads;
 
 void FreeScript(COperations* script);
 
+//
+// ****************************************************************************
+// CCopyJournal
+//
+// journal of a long Copy/Move operation (see COPY_JOURNAL_MIN_SIZE) written by the worker to the
+// "Sally\Copy Journals" directory under CSIDL_LOCAL_APPDATA: the script, the number of
+// operations done and the offset reached in the file being copied; the journal is deleted when
+// the operation finishes, otherwise (cancel, error, crash, disconnected network drive, ...) it
+// stays on disk and the operation can be resumed in the next session (see ResumeInterruptedCopies)
+
+struct CCopyJournalDirRec // position of an ocCreateDir record in the journal (its Attr is updated when it is done)
+{
+    int Index;               // index of the operation in the script
+    unsigned __int64 Offset; // offset of the record in the journal file
+};
+
+class CCopyJournal
+{
+protected:
+    HANDLE File;
+    CPathBuffer FileName;      // name of the journal file
+    unsigned __int64 FileSize; // size of the data written to File (the records in Buffer follow it)
+    char* Buffer;              // records not written to File yet
+    int BufferLen;             // number of bytes in Buffer
+    int OpsCount;              // number of operations written to the journal (File + Buffer)
+    int SavedOpsCount;         // number of operations written to File
+    BOOL ScriptComplete;       // TRUE = the whole script is in the journal
+    int DoneCount;             // number of operations done (the operation is resumed with the next one)
+    CQuadWord FileOffset;      // bytes of the operation at DoneCount already written to its target file
+    BOOL Dirty;                // TRUE = DoneCount or FileOffset changed since the last save
+    DWORD LastSaveTime;        // GetTickCount() of the last save of the state
+    const char* LastDirs[2];   // source and target directory of the last record (written only when they change)
+    BOOL WriteFailed;          // TRUE = writing failed, the journal is not usable (it is deleted in Close)
+
+    TDirectArray<CCopyJournalDirRec> CreateDirs; // records of ocCreateDir operations not done yet
+    int NextCreateDir;                           // index of the first record in CreateDirs not done yet
+
+public:
+    CCopyJournal();
+    ~CCopyJournal();
+
+    // returns TRUE if the operation 'script' is long enough to be worth the journal
+    static BOOL IsWanted(COperations* script);
+
+    // creates the journal file and writes the options of 'script' into it; returns FALSE on error
+    BOOL Create(COperations* script);
+
+    // the worker starts the operation at 'index': writes the operations published so far into
+    // the journal (their names are still available, see COperations::ReleaseNames)
+    void StartOperation(COperations* script, int index);
+
+    // the worker has written 'offset' bytes of the current operation to its target file
+    void SetFileOffset(const CQuadWord& offset)
+    {
+        FileOffset = offset;
+        Dirty = TRUE;
+        if (GetTickCount() - LastSaveTime >= COPY_JOURNAL_SAVE_PERIOD)
+            SaveState();
+    }
+
+    // the worker has done all operations of 'script' up to 'index'
+    void OperationDone(COperations* script, int index);
+
+    // closes the journal; 'finished' is TRUE if the whole script was done (the journal is deleted),
+    // otherwise the journal stays on disk if the operation can be resumed from it
+    void Close(BOOL finished);
+
+protected:
+    BOOL WriteOperation(COperation* op);
+    BOOL WriteName(int dirIndex, BOOL owns, const char* dir, const char* name, const std::wstring& nameW);
+    BOOL WriteString(const char* str);
+    BOOL WriteWString(const std::wstring& str);
+    BOOL Write(const void* data, int size);
+    BOOL WriteAt(unsigned __int64 offset, const void* data, int size);
+    BOOL Flush();
+    void SaveState();
+};
+
+// returns TRUE if there is a journal of an interrupted Copy/Move operation on disk
+BOOL ExistInterruptedCopies();
+
+// offers the user to resume the interrupted Copy/Move operations found on disk; called in the main thread
+void ResumeInterruptedCopies(HWND parent);
+
 //
 // File information classes and Io Status block (see NTDDK.H)
 //
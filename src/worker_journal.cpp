@@ -0,0 +1,729 @@
+﻿// SPDX-FileCopyrightText: 2026 Sally Authors
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#include "precomp.h"
+
+#include "cfgdlg.h"
+#include "mainwnd.h"
+#include "dialogs.h"
+#include "worker.h"
+#include "ui/IPrompter.h"
+#include "common/unicode/helpers.h"
+#include "common/widepath.h"
+#include "common/IFileSystem.h"
+
+//
+// ****************************************************************************
+// CCopyJournal
+//
+// layout of the journal file (numbers in the machine byte order, strings are stored as DWORD length
+// + characters without the null terminator, length 0xFFFFFFFF means NULL):
+//   CCopyJournalHeader (rewritten in place whenever the state of the operation is saved)
+//   options of the script: DWORD with bits from GetJournalOptions(), ClearReadonlyMask, speed limit,
+//     WorkPath1, WorkPath2 and the WaitInQueueXXX texts
+//   records of the operations: CCopyJournalRecord followed by the source and the target name, each
+//     of them starts with a BYTE with its kind (JRN_XXX)
+
+#define COPY_JOURNAL_MAGIC 0x314E4A53        // "SJN1"
+#define COPY_JOURNAL_VERSION 1               // version of the journal format
+#define COPY_JOURNAL_BUFFER_SIZE (64 * 1024) // records are written to the journal file in blocks of this size
+#define COPY_JOURNAL_MAX_STRING 0x100000     // longer strings mean a damaged journal
+
+#define JRN_NUMBER 0   // not a string (see COperation::OwnsSourceName): the value of the pointer follows as unsigned __int64
+#define JRN_FULLNAME 1 // full name follows: name + Unicode name (empty = made from the name)
+#define JRN_LASTDIR 2  // compact form (see COperation::CompactNames) in the directory of the last compact name: name + Unicode name
+#define JRN_NEWDIR 3   // compact form in a new directory: directory + name + Unicode name
+
+struct CCopyJournalHeader
+{
+    DWORD Magic;                 // COPY_JOURNAL_MAGIC
+    DWORD Version;               // COPY_JOURNAL_VERSION
+    DWORD ScriptComplete;        // TRUE = all operations of the script are in the journal
+    int OpsCount;                // number of operation records in the journal
+    int DoneCount;               // number of operations done (the operation is resumed with the next one)
+    DWORD Reserved;              // zero
+    unsigned __int64 FileOffset; // bytes of the operation at DoneCount already written to its target file
+};
+
+struct CCopyJournalRecord
+{
+    DWORD Opcode;
+    DWORD OpFlags;
+    DWORD Attr;     // WARNING: for ocCreateDir rewritten when the operation is done (see CCopyJournal::OperationDone)
+    DWORD Reserved; // zero
+    unsigned __int64 Size;
+    unsigned __int64 FileSize;
+};
+
+// fills 'opts' with the options of 'script' stored in the journal and returns their count
+// WARNING: the order is part of the journal format (add new options only at the end)
+static int GetJournalOptions(COperations* script, BOOL* opts[32])
+{
+    int count = 0;
+    opts[count++] = &script->IsCopyOrMoveOperation;
+    opts[count++] = &script->IsCopyOperation;
+    opts[count++] = &script->OverwriteOlder;
+    opts[count++] = &script->CopySecurity;
+    opts[count++] = &script->CopyAttrs;
+    opts[count++] = &script->VerifyCopy;
+    opts[count++] = &script->PreserveDirTime;
+    opts[count++] = &script->SourcePathIsNetwork;
+    opts[count++] = &script->ShowStatus;
+    opts[count++] = &script->FastMoveUsed;
+    opts[count++] = &script->RemovableTgtDisk;
+    opts[count++] = &script->RemovableSrcDisk;
+    opts[count++] = &script->CanUseRecycleBin;
+    opts[count++] = &script->SameRootButDiffVolume;
+    opts[count++] = &script->TargetPathSupADS;
+    opts[count++] = &script->InvertRecycleBin;
+    opts[count++] = &script->WorkPath1InclSubDirs;
+    opts[count++] = &script->WorkPath2InclSubDirs;
+    opts[count++] = &script->DeltaCopy;
+    return count;
+}
+
+// returns the directory with the journals in 'path'; the journals describe the disks of this machine,
+// so they are kept in the local (not roaming) application data; if 'create' is TRUE, the directory
+// is created; returns FALSE if the path cannot be obtained
+static BOOL GetCopyJournalDir(CPathBuffer& path, BOOL create)
+{
+    if (SHGetFolderPath(NULL, CSIDL_LOCAL_APPDATA, NULL, 0 /* SHGFP_TYPE_CURRENT */, path.Get()) != S_OK ||
+        !SalPathAppend(path.Get(), "Sally", path.Size()))
+    {
+        return FALSE;
+    }
+    if (create)
+        SalLPCreateDirectory(path.Get(), NULL); // if it fails (e.g. already exists), we don't care...
+    if (!SalPathAppend(path.Get(), "Copy Journals", path.Size()))
+        return FALSE;
+    if (create)
+        SalLPCreateDirectory(path.Get(), NULL); // if it fails (e.g. already exists), we don't care...
+    return TRUE;
+}
+
+CCopyJournal::CCopyJournal() : CreateDirs(100, 500)
+{
+    File = NULL;
+    FileSize = 0;
+    Buffer = NULL;
+    BufferLen = 0;
+    OpsCount = 0;
+    SavedOpsCount = 0;
+    ScriptComplete = FALSE;
+    DoneCount = 0;
+    FileOffset = CQuadWord(0, 0);
+    Dirty = FALSE;
+    LastSaveTime = GetTickCount();
+    LastDirs[0] = LastDirs[1] = NULL;
+    WriteFailed = FALSE;
+    NextCreateDir = 0;
+}
+
+CCopyJournal::~CCopyJournal()
+{
+    if (File != NULL)
+        Close(TRUE);
+    if (Buffer != NULL)
+        free(Buffer);
+}
+
+BOOL CCopyJournal::IsWanted(COperations* script)
+{
+    return script->IsCopyOrMoveOperation &&
+           (script->IsPipelinedBuild() || // enumeration of the source takes long, the operation will be long too
+            script->ResumeIndex > 0 || script->ResumeOffset.Value > 0 ||
+            script->TotalFileSize >= COPY_JOURNAL_MIN_SIZE || script->Count >= COPY_JOURNAL_MIN_COUNT);
+}
+
+BOOL CCopyJournal::Create(COperations* script)
+{
+    CALL_STACK_MESSAGE1("CCopyJournal::Create()");
+    Buffer = (char*)malloc(COPY_JOURNAL_BUFFER_SIZE);
+    if (Buffer == NULL)
+    {
+        TRACE_E(LOW_MEMORY);
+        return FALSE;
+    }
+
+    if (!GetCopyJournalDir(FileName, TRUE))
+    {
+        TRACE_E("CCopyJournal::Create(): unable to get directory for copy journals.");
+        return FALSE;
+    }
+    SYSTEMTIME st;
+    GetLocalTime(&st);
+    char name[100];
+    _snprintf_s(name, _TRUNCATE, "%04u%02u%02u-%02u%02u%02u-%u.sjn", st.wYear, st.wMonth, st.wDay,
+                st.wHour, st.wMinute, st.wSecond, GetCurrentThreadId());
+    if (!SalPathAppend(FileName.Get(), name, FileName.Size()))
+        return FALSE;
+
+    // other instances of Salamander must not take the journal of a running operation (see ResumeInterruptedCopies)
+    File = SalCreateFileH(FileName.Get(), GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (File == INVALID_HANDLE_VALUE)
+    {
+        DWORD err = GetLastError();
+        TRACE_E("CCopyJournal::Create(): unable to create file " << FileName.Get() << ", error: " << GetErrorText(err));
+        File = NULL;
+        return FALSE;
+    }
+
+    DoneCount = script->ResumeIndex;
+    FileOffset = script->ResumeOffset;
+
+    CCopyJournalHeader header; // written again in SaveState()
+    memset(&header, 0, sizeof(header));
+    BOOL* opts[32];
+    int optsCount = GetJournalOptions(script, opts);
+    DWORD optsMask = 0;
+    for (int i = 0; i < optsCount; i++)
+    {
+        if (*opts[i])
+            optsMask |= 1 << i;
+    }
+    BOOL useSpeedLimit;
+    DWORD speedLimit;
+    script->GetSpeedLimit(&useSpeedLimit, &speedLimit);
+    DWORD values[4] = {optsMask, script->ClearReadonlyMask, (DWORD)useSpeedLimit, speedLimit};
+    if (!Write(&header, sizeof(header)) || !Write(values, sizeof(values)) ||
+        !WriteString(script->WorkPath1.Get()) || !WriteString(script->WorkPath2.Get()) ||
+        !WriteString(script->WaitInQueueSubject.c_str()) || !WriteString(script->WaitInQueueFrom.c_str()) ||
+        !WriteString(script->WaitInQueueTo.c_str()))
+    {
+        Close(TRUE);
+        return FALSE;
+    }
+    SaveState();
+    return TRUE;
+}
+
+void CCopyJournal::StartOperation(COperations* script, int index)
+{
+    if (WriteFailed)
+        return;
+
+    // write all operations published so far (the operation at 'index' is among them)
+    COperation* op;
+    BOOL complete;
+    while ((op = script->GetStoredOperation(OpsCount, &complete)) != NULL)
+    {
+        if (!WriteOperation(op))
+            return;
+    }
+    if (complete && !ScriptComplete)
+    {
+        ScriptComplete = TRUE;
+        Dirty = TRUE;
+    }
+
+    FileOffset = script->ResumeOffset; // non-zero only for the first operation of a resumed script
+    if (Dirty && GetTickCount() - LastSaveTime >= COPY_JOURNAL_SAVE_PERIOD)
+        SaveState();
+}
+
+void CCopyJournal::OperationDone(COperations* script, int index)
+{
+    if (WriteFailed)
+        return;
+
+    // ocCopyDirTime needs to know whether ocCreateDir created the directory or it already existed
+    // (see ThreadWorkerBody), store this result of the done ocCreateDir operations
+    while (NextCreateDir < CreateDirs.Count && CreateDirs[NextCreateDir].Index <= index)
+    {
+        CCopyJournalDirRec* rec = &CreateDirs[NextCreateDir++];
+        BOOL complete;
+        COperation* crDir = script->GetStoredOperation(rec->Index, &complete);
+        if (crDir != NULL)
+        {
+            unsigned __int64 attrOffset = rec->Offset + offsetof(CCopyJournalRecord, Attr);
+            if (attrOffset >= FileSize) // the record is still in Buffer (records are never split, see Write)
+                memcpy(Buffer + (attrOffset - FileSize), &crDir->Attr, sizeof(DWORD));
+            else
+            {
+                if (!WriteAt(attrOffset, &crDir->Attr, sizeof(DWORD)))
+                    return;
+            }
+        }
+    }
+
+    if (index + 1 > DoneCount) // files copied by the small-file pool are reported before the worker gets to them
+    {
+        DoneCount = index + 1;
+        FileOffset = CQuadWord(0, 0);
+        Dirty = TRUE;
+    }
+    if (Dirty && GetTickCount() - LastSaveTime >= COPY_JOURNAL_SAVE_PERIOD)
+        SaveState();
+}
+
+void CCopyJournal::Close(BOOL finished)
+{
+    CALL_STACK_MESSAGE2("CCopyJournal::Close(%d)", finished);
+    if (File == NULL)
+        return;
+
+    // the operation can be resumed only if the whole script is in the journal; if nothing was done yet,
+    // there is nothing to resume either (the user can simply start the operation again)
+    BOOL keep = !finished && ScriptComplete && (DoneCount > 0 || FileOffset.Value > 0);
+    if (keep)
+    {
+        Dirty = TRUE;
+        SaveState();
+        keep = !WriteFailed;
+    }
+    HANDLES(CloseHandle(File));
+    File = NULL;
+    if (!keep)
+        gFileSystem->DeleteFile(AnsiToWide(FileName.Get()).c_str());
+    else
+        TRACE_I("CCopyJournal::Close(): journal of interrupted operation was kept: " << FileName.Get());
+}
+
+BOOL CCopyJournal::WriteOperation(COperation* op)
+{
+    if (op->Opcode == ocCreateDir) // its Attr is rewritten when it is done, remember where the record is
+    {
+        CCopyJournalDirRec rec;
+        rec.Index = OpsCount;
+        rec.Offset = FileSize + BufferLen; // holds also if Write() flushes the buffer before the record
+        CreateDirs.Add(rec);
+        if (!CreateDirs.IsGood())
+        {
+            CreateDirs.ResetState();
+            WriteFailed = TRUE; // without the record the resumed operation could not set the directory times correctly
+            return FALSE;
+        }
+    }
+
+    CCopyJournalRecord rec;
+    rec.Opcode = op->Opcode;
+    rec.OpFlags = op->OpFlags;
+    rec.Attr = op->Attr;
+    rec.Reserved = 0;
+    rec.Size = op->Size.Value;
+    rec.FileSize = op->FileSize.Value;
+    // names in compact form are written the same way (directory + name), restored names (the worker
+    // already got the operation) as full names
+    if (!Write(&rec, sizeof(rec)) ||
+        !WriteName(0, op->OwnsSourceName, op->CompactNames ? op->SourceDir : NULL, op->SourceName, op->SourceNameW) ||
+        !WriteName(1, op->OwnsTargetName, op->CompactNames ? op->TargetDir : NULL, op->TargetName, op->TargetNameW))
+    {
+        return FALSE;
+    }
+    OpsCount++;
+    return TRUE;
+}
+
+BOOL CCopyJournal::WriteName(int dirIndex, BOOL owns, const char* dir, const char* name, const std::wstring& nameW)
+{
+    BYTE kind;
+    if (!owns)
+    {
+        kind = JRN_NUMBER;
+        unsigned __int64 value = (DWORD_PTR)name;
+        return Write(&kind, sizeof(kind)) && Write(&value, sizeof(value));
+    }
+
+    if (dir == NULL)
+        kind = JRN_FULLNAME;
+    else
+        kind = dir == LastDirs[dirIndex] ? JRN_LASTDIR : JRN_NEWDIR; // directories are shared in COperations, see GetSharedDir()
+    if (!Write(&kind, sizeof(kind)))
+        return FALSE;
+    if (kind == JRN_NEWDIR)
+    {
+        if (!WriteString(dir))
+            return FALSE;
+        LastDirs[dirIndex] = dir;
+    }
+    return WriteString(name) && WriteWString(nameW);
+}
+
+BOOL CCopyJournal::WriteString(const char* str)
+{
+    DWORD len = str == NULL ? 0xFFFFFFFF : (DWORD)strlen(str);
+    return Write(&len, sizeof(len)) && (str == NULL || Write(str, len));
+}
+
+BOOL CCopyJournal::WriteWString(const std::wstring& str)
+{
+    DWORD len = (DWORD)str.length();
+    return Write(&len, sizeof(len)) && Write(str.c_str(), len * sizeof(wchar_t));
+}
+
+BOOL CCopyJournal::Write(const void* data, int size)
+{
+    if (WriteFailed)
+        return FALSE;
+    // data which do not fit into the buffer start a new block (so CCopyJournalRecord is never split,
+    // see OperationDone)
+    if (BufferLen + size > COPY_JOURNAL_BUFFER_SIZE && !Flush())
+        return FALSE;
+    if (size > COPY_JOURNAL_BUFFER_SIZE) // too long for the buffer (long Unicode name), write it directly
+    {
+        if (!WriteAt(FileSize, data, size))
+            return FALSE;
+        FileSize += size;
+        return TRUE;
+    }
+    memcpy(Buffer + BufferLen, data, size);
+    BufferLen += size;
+    return TRUE;
+}
+
+BOOL CCopyJournal::WriteAt(unsigned __int64 offset, const void* data, int size)
+{
+    if (WriteFailed)
+        return FALSE;
+    OVERLAPPED overlapped;
+    memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.Offset = (DWORD)offset;
+    overlapped.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD written;
+    if (!WriteFile(File, data, size, &written, &overlapped) || written != (DWORD)size)
+    {
+        DWORD err = GetLastError();
+        TRACE_E("CCopyJournal::WriteAt(): unable to write to file " << FileName.Get() << ", error: " << GetErrorText(err));
+        WriteFailed = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+BOOL CCopyJournal::Flush()
+{
+    if (BufferLen > 0)
+    {
+        if (!WriteAt(FileSize, Buffer, BufferLen))
+            return FALSE;
+        FileSize += BufferLen;
+        BufferLen = 0;
+    }
+    SavedOpsCount = OpsCount; // WARNING: the file may end with a part of the next record (it is not counted)
+    return TRUE;
+}
+
+void CCopyJournal::SaveState()
+{
+    LastSaveTime = GetTickCount();
+    if (WriteFailed || !Flush())
+        return;
+
+    CCopyJournalHeader header;
+    memset(&header, 0, sizeof(header));
+    header.Magic = COPY_JOURNAL_MAGIC;
+    header.Version = COPY_JOURNAL_VERSION;
+    header.ScriptComplete = ScriptComplete;
+    header.OpsCount = SavedOpsCount;
+    header.DoneCount = DoneCount;
+    header.FileOffset = FileOffset.Value;
+    if (WriteAt(0, &header, sizeof(header)))
+        Dirty = FALSE;
+}
+
+//
+// ****************************************************************************
+// resuming of interrupted operations
+//
+
+// buffered reading of the journal file
+class CCopyJournalReader
+{
+protected:
+    HANDLE File;
+    char* Buffer;
+    int BufferLen; // number of bytes in Buffer
+    int BufferPos; // position of the next byte to read in Buffer
+
+public:
+    CCopyJournalReader(HANDLE file)
+    {
+        File = file;
+        Buffer = (char*)malloc(COPY_JOURNAL_BUFFER_SIZE);
+        if (Buffer == NULL)
+            TRACE_E(LOW_MEMORY);
+        BufferLen = 0;
+        BufferPos = 0;
+    }
+    ~CCopyJournalReader()
+    {
+        if (Buffer != NULL)
+            free(Buffer);
+    }
+
+    // reads 'size' bytes; returns FALSE on error or at the end of the file
+    BOOL Read(void* data, int size);
+
+    // reads a string written by CCopyJournal::WriteString; 'isNull' (if not NULL) receives TRUE for
+    // NULL (the string is empty then)
+    BOOL ReadString(std::string& str, BOOL* isNull = NULL);
+
+    // reads a string written by CCopyJournal::WriteWString
+    BOOL ReadWString(std::wstring& str);
+};
+
+BOOL CCopyJournalReader::Read(void* data, int size)
+{
+    if (Buffer == NULL)
+        return FALSE;
+    char* dst = (char*)data;
+    while (size > 0)
+    {
+        if (BufferPos == BufferLen)
+        {
+            DWORD read;
+            if (!ReadFile(File, Buffer, COPY_JOURNAL_BUFFER_SIZE, &read, NULL) || read == 0)
+                return FALSE;
+            BufferLen = read;
+            BufferPos = 0;
+        }
+        int len = min(size, BufferLen - BufferPos);
+        memcpy(dst, Buffer + BufferPos, len);
+        BufferPos += len;
+        dst += len;
+        size -= len;
+    }
+    return TRUE;
+}
+
+BOOL CCopyJournalReader::ReadString(std::string& str, BOOL* isNull)
+{
+    DWORD len;
+    if (!Read(&len, sizeof(len)))
+        return FALSE;
+    if (isNull != NULL)
+        *isNull = len == 0xFFFFFFFF;
+    if (len == 0xFFFFFFFF)
+        len = 0;
+    if (len > COPY_JOURNAL_MAX_STRING)
+        return FALSE;
+    str.resize(len);
+    return len == 0 || Read(&str[0], len);
+}
+
+BOOL CCopyJournalReader::ReadWString(std::wstring& str)
+{
+    DWORD len;
+    if (!Read(&len, sizeof(len)) || len > COPY_JOURNAL_MAX_STRING)
+        return FALSE;
+    str.resize(len);
+    return len == 0 || Read(&str[0], len * sizeof(wchar_t));
+}
+
+// reads one name of the operation record written by CCopyJournal::WriteName; for the compact form
+// 'dir' receives the directory of the name (otherwise it is set to empty string) and 'nameW' only
+// the Unicode name of the file (see COperation::SetSourceNameW); returns FALSE on error
+static BOOL ReadJournalName(CCopyJournalReader& reader, std::string& lastDir, std::string& dir,
+                            char** name, std::wstring& nameW, bool* owns)
+{
+    *name = NULL;
+    dir.clear();
+    BYTE kind;
+    if (!reader.Read(&kind, sizeof(kind)) || kind > JRN_NEWDIR)
+        return FALSE;
+    if (kind == JRN_NUMBER)
+    {
+        unsigned __int64 value;
+        if (!reader.Read(&value, sizeof(value)))
+            return FALSE;
+        *name = (char*)(DWORD_PTR)value;
+        *owns = false;
+        return TRUE;
+    }
+
+    *owns = true;
+    if (kind == JRN_NEWDIR && !reader.ReadString(lastDir))
+        return FALSE;
+    std::string fileName;
+    BOOL isNull;
+    if (!reader.ReadString(fileName, &isNull) || !reader.ReadWString(nameW))
+        return FALSE;
+    if (isNull)
+        return TRUE;
+    if (kind != JRN_FULLNAME)
+    {
+        dir = lastDir;
+        fileName.insert(0, lastDir);
+    }
+    *name = DupStr(fileName.c_str());
+    return *name != NULL;
+}
+
+// reads the script from the journal opened as 'file'; returns NULL if the journal is damaged or
+// the operation cannot be resumed from it
+static COperations* LoadCopyJournal(HANDLE file)
+{
+    CALL_STACK_MESSAGE1("LoadCopyJournal()");
+    CCopyJournalReader reader(file);
+    CCopyJournalHeader header;
+    if (!reader.Read(&header, sizeof(header)) || header.Magic != COPY_JOURNAL_MAGIC ||
+        header.Version != COPY_JOURNAL_VERSION || !header.ScriptComplete ||
+        header.DoneCount < 0 || header.DoneCount >= header.OpsCount)
+    {
+        return NULL; // damaged, an incomplete script (e.g. the build was cancelled) or nothing left to do
+    }
+
+    COperations* script = new COperations(1000, 500, NULL, NULL, NULL);
+    BOOL ok = FALSE;
+    DWORD values[4];
+    std::string str[5];
+    if (reader.Read(values, sizeof(values)) && reader.ReadString(str[0]) && reader.ReadString(str[1]) &&
+        reader.ReadString(str[2]) && reader.ReadString(str[3]) && reader.ReadString(str[4]))
+    {
+        BOOL* opts[32];
+        int optsCount = GetJournalOptions(script, opts);
+        for (int i = 0; i < optsCount; i++)
+            *opts[i] = (values[0] & (1 << i)) != 0;
+        script->ClearReadonlyMask = values[1];
+        script->SetSpeedLimit(values[2] != 0, values[3] != 0 ? values[3] : 1);
+        script->SetWorkPath1(str[0].c_str(), script->WorkPath1InclSubDirs);
+        script->SetWorkPath2(str[1].c_str(), script->WorkPath2InclSubDirs);
+        script->WaitInQueueSubject = str[2];
+        script->WaitInQueueFrom = str[3];
+        script->WaitInQueueTo = str[4];
+
+        std::string lastDirs[2];
+        std::string dir;
+        int i;
+        for (i = 0; i < header.OpsCount; i++)
+        {
+            CCopyJournalRecord rec;
+            if (!reader.Read(&rec, sizeof(rec)) || rec.Opcode > ocCopyDirTime)
+                break;
+            COperation op;
+            op.Opcode = (COperationCode)rec.Opcode;
+            op.OpFlags = rec.OpFlags;
+            op.Attr = rec.Attr;
+            op.Size.Value = rec.Size;
+            op.FileSize.Value = rec.FileSize;
+
+            std::wstring nameW;
+            if (!ReadJournalName(reader, lastDirs[0], dir, &op.SourceName, nameW, &op.OwnsSourceName))
+                break;
+            if (!dir.empty() && !nameW.empty())
+                op.SetSourceNameW(dir.c_str(), nameW);
+            else
+                op.SourceNameW.swap(nameW);
+            if (!ReadJournalName(reader, lastDirs[1], dir, &op.TargetName, nameW, &op.OwnsTargetName))
+                break;
+            if (!dir.empty() && !nameW.empty())
+                op.SetTargetNameW(dir.c_str(), nameW);
+            else
+                op.TargetNameW.swap(nameW);
+
+            if (i == header.DoneCount && op.OwnsSourceName && op.OwnsTargetName) // the volumes for the operations queue
+                script->SetQueueDevices(op.SourceName, op.TargetName);
+            script->TotalSize += op.Size;
+            if (op.Opcode == ocCopyFile || op.Opcode == ocMoveFile)
+            {
+                script->TotalFileSize += op.FileSize;
+                script->FilesCount++;
+            }
+            if (op.Opcode == ocCreateDir)
+                script->DirsCount++;
+            script->Add(op);
+        }
+        ok = i == header.OpsCount;
+    }
+    if (!ok)
+    {
+        TRACE_E("LoadCopyJournal(): journal is damaged.");
+        FreeScript(script);
+        return NULL;
+    }
+    script->ResumeIndex = header.DoneCount;
+    script->ResumeOffset.Value = header.FileOffset;
+    return script;
+}
+
+BOOL ExistInterruptedCopies()
+{
+    CPathBuffer path;
+    if (!GetCopyJournalDir(path, FALSE) || !SalPathAppend(path.Get(), "*.sjn", path.Size()))
+        return FALSE;
+    WIN32_FIND_DATAW data;
+    HANDLE find = SalFindFirstFileHW(path.Get(), &data);
+    if (find == INVALID_HANDLE_VALUE)
+        return FALSE;
+    HANDLES(FindClose(find));
+    return TRUE;
+}
+
+void ResumeInterruptedCopies(HWND parent)
+{
+    CALL_STACK_MESSAGE1("ResumeInterruptedCopies()");
+    CPathBuffer dir;
+    if (!GetCopyJournalDir(dir, FALSE))
+        return;
+    CPathBuffer path(dir.Get());
+    if (!SalPathAppend(path.Get(), "*.sjn", path.Size()))
+        return;
+
+    TIndirectArray<char> names(10, 10);
+    WIN32_FIND_DATAW data;
+    HANDLE find = SalFindFirstFileHW(path.Get(), &data);
+    if (find != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if ((data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) == 0)
+            {
+                char* name = DupStr(WideToAnsi(data.cFileName).c_str());
+                if (name != NULL)
+                {
+                    names.Add(name);
+                    if (!names.IsGood())
+                    {
+                        free(name);
+                        names.ResetState();
+                    }
+                }
+            }
+        } while (SalLPFindNextFile(find, &data));
+        HANDLES(FindClose(find));
+    }
+
+    for (int i = 0; i < names.Count; i++)
+    {
+        if (!path.Assign(dir) || !SalPathAppend(path.Get(), names[i], path.Size()))
+            continue;
+        // the journal of an operation running in another instance of Salamander cannot be opened (see CCopyJournal::Create)
+        HANDLE file = SalCreateFileH(path.Get(), GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE)
+            continue;
+        COperations* script = LoadCopyJournal(file);
+        if (script == NULL)
+        {
+            HANDLES(CloseHandle(file));
+            gFileSystem->DeleteFile(AnsiToWide(path.Get()).c_str());
+            continue;
+        }
+
+        const COperation& next = script->At(script->ResumeIndex);
+        std::string nextName = next.OwnsSourceName && next.SourceName != NULL ? next.SourceName : "";
+        if (next.CompactNames && next.SourceDir != NULL)
+            nextName.insert(0, next.SourceDir);
+        std::wstring msg = FormatStrW(LoadStrW(IDS_RESUMECOPY),
+                                      LoadStrW(script->IsCopyOperation ? IDS_COPY : IDS_MOVE),
+                                      AnsiToWide(nextName).c_str(), AnsiToWide(script->WorkPath1.Get()).c_str(),
+                                      script->ResumeIndex, script->Count);
+        PromptResult res = gPrompter->AskYesNoCancel(parent, LoadStrW(IDS_RESUMECOPYTITLE), msg.c_str());
+        if (res.type == PromptResult::kYes)
+        {
+            char caption[50]; // otherwise the LoadStr buffer gets overwritten before being copied to the dialog's local buffer
+            lstrcpyn(caption, LoadStr(script->IsCopyOperation ? IDS_COPY : IDS_MOVE), 50);
+            if (StartProgressDialog(script, caption, NULL, NULL))
+            {
+                HANDLES(CloseHandle(file));
+                gFileSystem->DeleteFile(AnsiToWide(path.Get()).c_str()); // the worker writes a new journal of the resumed operation
+                continue;
+            }
+        }
+        FreeScript(script);
+        HANDLES(CloseHandle(file));
+        if (res.type == PromptResult::kNo)
+            gFileSystem->DeleteFile(AnsiToWide(path.Get()).c_str());
+        if (res.type == PromptResult::kCancel)
+            break; // ask again next time
+    }
+}
@@ -6187,14 +6187,20 @@ void CSalamanderDirectory::SetApproximateCount(int files, int dirs)
     if (files > 1)
     {
         if (Files.Count == 0)
+        {
             Files.SetDelta(DeltaForTotalCount(files));
+            Files.Reserve(files);
+        }
         else
             TRACE_E("CSalamanderDirectory::SetApproximateCount() Files.Count = " << Files.Count);
     }
     if (dirs > 1)
     {
         if (Dirs.Count == 0)
+        {
             Dirs.SetDelta(DeltaForTotalCount(dirs));
+            Dirs.Reserve(dirs);
+        }
         else
             TRACE_E("CSalamanderDirectory::SetApproximateCount() Dirs.Count = " << Dirs.Count);
     }